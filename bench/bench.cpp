@@ -0,0 +1,367 @@
+// ⚡🔌 Arduino-CTL 🔌⚡
+//
+// Copyright (C) 2024 ixaxaar
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Host benchmarks of the command pipeline, end to end and stage by stage.
+//
+// Usage: bench [--filter TEXT] [--out FILE] [--baseline FILE] [--threshold FRACTION]
+//
+// Results are printed as a table on stderr and written as JSON to stdout (or
+// --out). With --baseline, every case that got slower than the baseline by
+// more than the threshold (default 0.15) is listed and the exit status is 1;
+// so is a baseline file that is missing or cannot be parsed.
+
+#include <arduinoctl.h>
+#include <params.h>
+#include "sim.h"
+#include <base64.hpp>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <stdio.h>
+
+void setup();
+
+// Each case runs for at least this long per sample
+static const std::chrono::nanoseconds MIN_SAMPLE_TIME = std::chrono::milliseconds(10);
+
+// Samples per case; the fastest is reported, as it is the least disturbed by the host
+static const int SAMPLES = 5;
+
+static const size_t BATCH_SIZES[] = {1, 10, 100, 1000};
+static const size_t PAYLOAD_SIZES[] = {1, 64, 1024, 16384, 65536};
+
+struct BenchResult
+{
+    std::string name;  ///< Stage measured
+    size_t batch;      ///< Commands per request, 0 if not applicable
+    size_t bytes;      ///< Payload bytes, 0 if not applicable
+    uint64_t iterations; ///< Iterations per sample
+    double nsPerOp;    ///< Nanoseconds per iteration of the fastest sample
+};
+
+// Keeps results of measured work alive so the compiler cannot drop it
+static volatile size_t benchSink = 0;
+
+static std::vector<BenchResult> results;
+static std::string filter;
+
+// Time a piece of work and record the result
+template <typename Work>
+static void measure(const char *name, size_t batch, size_t bytes, Work work)
+{
+    char label[64];
+    snprintf(label, sizeof(label), "%s/%zu/%zu", name, batch, bytes);
+    if (!filter.empty() && std::string(label).find(filter) == std::string::npos)
+    {
+        return;
+    }
+
+    typedef std::chrono::steady_clock Clock;
+    uint64_t iterations = 1;
+    work(); // Warm up caches and pooled buffers
+    for (;;)
+    {
+        Clock::time_point start = Clock::now();
+        for (uint64_t i = 0; i < iterations; ++i)
+        {
+            work();
+        }
+        if (Clock::now() - start >= MIN_SAMPLE_TIME)
+        {
+            break;
+        }
+        iterations *= 2;
+    }
+
+    double best = 0;
+    for (int sample = 0; sample < SAMPLES; ++sample)
+    {
+        Clock::time_point start = Clock::now();
+        for (uint64_t i = 0; i < iterations; ++i)
+        {
+            work();
+        }
+        double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / iterations;
+        if (sample == 0 || ns < best)
+        {
+            best = ns;
+        }
+    }
+    results.push_back({name, batch, bytes, iterations, best});
+    fprintf(stderr, "%-32s %14.1f ns/op %10llu iterations\n", label, best, static_cast<unsigned long long>(iterations));
+}
+
+static std::string base64(const std::vector<uint8_t> &data)
+{
+    std::string encoded(encode_base64_length(data.size()) + 1, '\0');
+    encoded.resize(encode_base64(data.data(), data.size(), reinterpret_cast<unsigned char *>(&encoded[0])));
+    return encoded;
+}
+
+static std::vector<uint8_t> payload(size_t bytes)
+{
+    std::vector<uint8_t> data(bytes);
+    for (size_t i = 0; i < bytes; ++i)
+    {
+        data[i] = static_cast<uint8_t>(i * 31 + 7);
+    }
+    return data;
+}
+
+// A request with a batch of GPIO reads, the smallest command the modules have
+static std::string readRequest(size_t batch)
+{
+    std::string request = "{\"api_key\":\"DefaultAPIKey\",\"commands\":[";
+    for (size_t i = 0; i < batch; ++i)
+    {
+        request += i > 0 ? "," : "";
+        request += "{\"module\":\"gpio\",\"command\":\"digitalRead\",\"params\":{\"numSamples\":\"1\"}}";
+    }
+    return request + "]}";
+}
+
+// A request with one SPI transfer of a payload, which is decoded on the way in and encoded on the way out
+static std::string transferRequest(size_t bytes)
+{
+    return "{\"api_key\":\"DefaultAPIKey\",\"commands\":[{\"module\":\"spi\",\"command\":\"transfer\",\"params\":{\"data\":\"" +
+           base64(payload(bytes)) + "\"}}]}";
+}
+
+static void benchEndToEnd()
+{
+    for (size_t batch : BATCH_SIZES)
+    {
+        std::string request = readRequest(batch);
+        measure("execute", batch, 0, [&request]()
+                { benchSink += remoteServer.executeCommands(request).size(); });
+    }
+    sim::attachSpi(SS, std::make_shared<sim::SpiLoopback>());
+    for (size_t bytes : PAYLOAD_SIZES)
+    {
+        std::string request = transferRequest(bytes);
+        measure("execute", 1, bytes, [&request]()
+                { benchSink += remoteServer.executeCommands(request).size(); });
+    }
+}
+
+static void benchStages()
+{
+    JsonDocumentPool pool(1);
+    for (size_t batch : BATCH_SIZES)
+    {
+        std::string request = readRequest(batch);
+        measure("parse", batch, 0, [&]()
+                {
+            JsonDocumentPool::Lease lease = pool.acquire(JsonDocumentPool::capacityFor(request.data(), request.size(), false));
+            benchSink += deserializeJson(lease.doc(), request) == DeserializationError::Ok; });
+    }
+
+    // Module lookup resolves both names of every command, as resolveCommand does
+    NameIndex modules;
+    modules.build({"analog", "gpio", "i2c", "i2s", "spi"});
+    NameIndex functions;
+    functions.build({"digitalRead", "digitalWrite"});
+    for (size_t batch : BATCH_SIZES)
+    {
+        measure("lookup", batch, 0, [&]()
+                {
+            for (size_t i = 0; i < batch; ++i)
+            {
+                benchSink += modules.find("gpio", 4) + functions.find("digitalRead", 11);
+            } });
+    }
+
+    // Param binding goes through readFromDevice's own schema, with bindParams() as its handler does;
+    // the description's check() binds into a throwaway Params struct
+    I2CCtl i2c;
+    FunctionInfo readFromDevice = i2c.getSupportedFunctions()[i2c.opcodeOf("readFromDevice")];
+    std::vector<std::pair<std::string, std::string>> params = {{"address", "72"}, {"numBytes", "16"}};
+    ParamError error;
+    for (size_t batch : BATCH_SIZES)
+    {
+        measure("params", batch, 0, [&]()
+                {
+            for (size_t i = 0; i < batch; ++i)
+            {
+                benchSink += readFromDevice.check(params, error);
+            } });
+    }
+
+    for (size_t bytes : PAYLOAD_SIZES)
+    {
+        std::vector<uint8_t> data = payload(bytes);
+        std::vector<unsigned char> encoded(encode_base64_length(bytes) + 1);
+        measure("base64_encode", 0, bytes, [&]()
+                { benchSink += encode_base64(data.data(), bytes, encoded.data()); });
+        size_t encodedLength = encode_base64(data.data(), bytes, encoded.data());
+        std::vector<unsigned char> decoded(bytes + 3);
+        measure("base64_decode", 0, bytes, [&]()
+                { benchSink += decode_base64(encoded.data(), encodedLength, decoded.data()); });
+
+        // The shared codec, against the library cases above
+        std::string text;
+        measure("base64codec_encode", 0, bytes, [&]()
+                {
+                    text.clear();
+                    base64Append(text, data.data(), bytes);
+                    benchSink += text.size(); });
+        measure("base64codec_decode", 0, bytes, [&]()
+                {
+                    size_t written = 0;
+                    base64Decode(text.data(), text.size(), decoded.data(), written);
+                    benchSink += written; });
+    }
+
+    std::string response;
+    for (size_t bytes : PAYLOAD_SIZES)
+    {
+        ResultSink result;
+        std::vector<uint8_t> data = payload(bytes);
+        memcpy(result.allocBytes(bytes), data.data(), bytes);
+        measure("serialize", 1, bytes, [&]()
+                {
+            response.clear();
+            result.appendJson(response);
+            benchSink += response.size(); });
+    }
+    for (size_t batch : BATCH_SIZES)
+    {
+        std::vector<ResultSink> batchResults(batch);
+        for (ResultSink &result : batchResults)
+        {
+            result.setInt(1);
+        }
+        measure("serialize_ints", batch, 0, [&]()
+                {
+            response.clear();
+            for (const ResultSink &result : batchResults)
+            {
+                result.appendJson(response);
+            }
+            benchSink += response.size(); });
+    }
+}
+
+static std::string toJson(const std::vector<BenchResult> &benchmarks)
+{
+    std::ostringstream json;
+    json << "{\"benchmarks\":[";
+    for (size_t i = 0; i < benchmarks.size(); ++i)
+    {
+        const BenchResult &result = benchmarks[i];
+        char line[192];
+        snprintf(line, sizeof(line), "%s\n{\"name\":\"%s\",\"batch\":%zu,\"bytes\":%zu,\"iterations\":%llu,\"ns_per_op\":%.1f}",
+                 i > 0 ? "," : "", result.name.c_str(), result.batch, result.bytes, static_cast<unsigned long long>(result.iterations), result.nsPerOp);
+        json << line;
+    }
+    json << "\n]}\n";
+    return json.str();
+}
+
+// Compare against a baseline file written by an earlier run; returns the number of regressions,
+// counting a missing or unreadable baseline as one so the check cannot pass without running
+static int compareWithBaseline(const char *path, double threshold)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        fprintf(stderr, "No baseline at %s; run make bench-baseline to create it\n", path);
+        return 1;
+    }
+    std::stringstream text;
+    text << file.rdbuf();
+    std::string contents = text.str();
+    DynamicJsonDocument baseline(JsonDocumentPool::capacityFor(contents.data(), contents.size(), false));
+    if (deserializeJson(baseline, contents))
+    {
+        fprintf(stderr, "Failed to parse the baseline at %s\n", path);
+        return 1;
+    }
+
+    int regressions = 0;
+    for (JsonObject entry : baseline["benchmarks"].as<JsonArray>())
+    {
+        for (const BenchResult &result : results)
+        {
+            if (result.name != (entry["name"] | "") || result.batch != (entry["batch"] | 0u) || result.bytes != (entry["bytes"] | 0u))
+            {
+                continue;
+            }
+            double before = entry["ns_per_op"].as<double>();
+            if (before > 0 && result.nsPerOp > before * (1 + threshold))
+            {
+                fprintf(stderr, "REGRESSION %s/%zu/%zu: %.1f ns/op, baseline %.1f ns/op (+%.0f%%)\n", result.name.c_str(), result.batch, result.bytes,
+                        result.nsPerOp, before, (result.nsPerOp / before - 1) * 100);
+                ++regressions;
+            }
+        }
+    }
+    return regressions;
+}
+
+int main(int argc, char **argv)
+{
+    const char *out = nullptr;
+    const char *baseline = nullptr;
+    double threshold = 0.15;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string option = argv[i];
+        if (option == "--filter")
+        {
+            filter = argv[i + 1];
+        }
+        else if (option == "--out")
+        {
+            out = argv[i + 1];
+        }
+        else if (option == "--baseline")
+        {
+            baseline = argv[i + 1];
+        }
+        else if (option == "--threshold")
+        {
+            threshold = atof(argv[i + 1]);
+        }
+        else
+        {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    sim::reset();
+    setup();
+    sim::takeSerialOutput();
+
+    benchEndToEnd();
+    benchStages();
+
+    std::string json = toJson(results);
+    if (out != nullptr)
+    {
+        std::ofstream(out) << json;
+    }
+    else
+    {
+        fputs(json.c_str(), stdout);
+    }
+    if (baseline != nullptr && compareWithBaseline(baseline, threshold) > 0)
+    {
+        return 1;
+    }
+    return 0;
+}
@@ -58,13 +58,13 @@ public:
     void deinit() override;
 
     /**
-     * @brief Execute a command on the I2C module
+     * @brief Execute a command on the module by opcode
      *
-     * @param command The command to execute ("readFromDevice", "writeToDevice", or "setClock")
+     * @param opcode The opcode of the command ("readFromDevice", "writeToDevice", or "setClock")
      * @param params A vector of parameter name-value pairs for the command
-     * @return A pair containing the return type as a string and a void pointer to the return value
+     * @param result Sink the command writes its result into
      */
-    std::pair<std::string, void *> execute(const std::string &command, const std::vector<std::pair<std::string, std::string>> &params) override;
+    void dispatch(uint16_t opcode, const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result) override;
 
     /**
      * @brief Get information about the functions supported by this module
@@ -73,19 +73,66 @@ public:
      */
     std::vector<FunctionInfo> getSupportedFunctions() override;
 
+    /**
+     * @brief Get the hardware resource this module drives
+     * @return BusResource::I2c
+     */
+    BusResource resource() const override { return BusResource::I2c; }
+
 private:
-    int _sdaPin;         ///< The SDA (data) pin number
-    int _sclPin;         ///< The SCL (clock) pin number
-    uint32_t _frequency; ///< The I2C clock frequency in Hz
+    int _sdaPin;                  ///< The SDA (data) pin number
+    int _sclPin;                  ///< The SCL (clock) pin number
+    uint32_t _frequency;          ///< The I2C clock frequency in Hz
+    std::vector<uint8_t> _buffer; ///< Decoded write payload, reused across commands
+
+    /**
+     * @brief Opcodes of the supported commands, in getSupportedFunctions() order
+     */
+    enum Opcode : uint16_t
+    {
+        OP_READ_FROM_DEVICE,
+        OP_WRITE_TO_DEVICE,
+        OP_SET_CLOCK,
+        OP_COUNT
+    };
+
+    /// Command handler invoked through the dispatch jump table
+    typedef void (I2CCtl::*Handler)(const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result);
+
+    static const Handler handlers[OP_COUNT]; ///< Jump table indexed by opcode
+
+    /**
+     * @brief Parse the parameters of "readFromDevice" and run it
+     *
+     * @param params A vector of parameter name-value pairs for the command
+     * @param result Sink the command writes its result into
+     */
+    void handleReadFromDevice(const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result);
+
+    /**
+     * @brief Parse the parameters of "writeToDevice" and run it
+     *
+     * @param params A vector of parameter name-value pairs for the command
+     * @param result Sink the command writes its result into
+     */
+    void handleWriteToDevice(const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result);
+
+    /**
+     * @brief Parse the parameters of "setClock" and run it
+     *
+     * @param params A vector of parameter name-value pairs for the command
+     * @param result Sink the command writes its result into
+     */
+    void handleSetClock(const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result);
 
     /**
      * @brief Read data from an I2C device
      *
      * @param address The 7-bit I2C address of the device
      * @param numBytes The number of bytes to read
-     * @return A vector of uint8_t containing the read data
+     * @param result Sink receiving the bytes read
      */
-    std::vector<uint8_t> readFromDevice(uint8_t address, size_t numBytes);
+    void readFromDevice(uint8_t address, size_t numBytes, ResultSink &result);
 
     /**
      * @brief Write data to an I2C device
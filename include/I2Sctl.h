@@ -56,13 +56,13 @@ public:
     void deinit() override;
 
     /**
-     * @brief Execute a command on the I2S module
+     * @brief Execute a command on the module by opcode
      *
-     * @param command The command to execute ("readData" or "writeData")
+     * @param opcode The opcode of the command ("readData" or "writeData")
      * @param params A vector of parameter name-value pairs for the command
-     * @return A pair containing the return type as a string and a void pointer to the return value
+     * @param result Sink the command writes its result into
      */
-    std::pair<std::string, void *> execute(const std::string &command, const std::vector<std::pair<std::string, std::string>> &params) override;
+    void dispatch(uint16_t opcode, const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result) override;
 
     /**
      * @brief Get information about the functions supported by this module
@@ -71,18 +71,56 @@ public:
      */
     std::vector<FunctionInfo> getSupportedFunctions() override;
 
+    /**
+     * @brief Get the hardware resource this module drives
+     * @return BusResource::I2s
+     */
+    BusResource resource() const override { return BusResource::I2s; }
+
 private:
-    i2s_port_t _i2sPort;       ///< The I2S port being used
-    i2s_config_t _i2sConfig;   ///< The I2S configuration
-    i2s_pin_config_t _i2sPins; ///< The I2S pin configuration
+    i2s_port_t _i2sPort;          ///< The I2S port being used
+    i2s_config_t _i2sConfig;      ///< The I2S configuration
+    i2s_pin_config_t _i2sPins;    ///< The I2S pin configuration
+    std::vector<uint8_t> _buffer; ///< Decoded write payload, reused across commands
+
+    /**
+     * @brief Opcodes of the supported commands, in getSupportedFunctions() order
+     */
+    enum Opcode : uint16_t
+    {
+        OP_READ_DATA,
+        OP_WRITE_DATA,
+        OP_COUNT
+    };
+
+    /// Command handler invoked through the dispatch jump table
+    typedef void (I2SCtl::*Handler)(const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result);
+
+    static const Handler handlers[OP_COUNT]; ///< Jump table indexed by opcode
+
+    /**
+     * @brief Parse the parameters of "readData" and run it
+     *
+     * @param params A vector of parameter name-value pairs for the command
+     * @param result Sink the command writes its result into
+     */
+    void handleReadData(const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result);
+
+    /**
+     * @brief Parse the parameters of "writeData" and run it
+     *
+     * @param params A vector of parameter name-value pairs for the command
+     * @param result Sink the command writes its result into
+     */
+    void handleWriteData(const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result);
 
     /**
      * @brief Read data from the I2S interface
      *
      * @param numBytes The number of bytes to read
-     * @return A vector of uint8_t containing the read data
+     * @param result Sink receiving the bytes read
      */
-    std::vector<uint8_t> readData(size_t numBytes);
+    void readData(size_t numBytes, ResultSink &result);
 
     /**
      * @brief Write data to the I2S interface
@@ -59,13 +59,13 @@ public:
     void deinit() override;
 
     /**
-     * @brief Execute a command on the SPI module
+     * @brief Execute a command on the module by opcode
      *
-     * @param command The command to execute ("transfer" or "setSettings")
+     * @param opcode The opcode of the command ("transfer" or "setSettings")
      * @param params A vector of parameter name-value pairs for the command
-     * @return A pair containing the return type as a string and a void pointer to the return value
+     * @param result Sink the command writes its result into
      */
-    std::pair<std::string, void *> execute(const std::string &command, const std::vector<std::pair<std::string, std::string>> &params) override;
+    void dispatch(uint16_t opcode, const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result) override;
 
     /**
      * @brief Get information about the functions supported by this module
@@ -74,6 +74,12 @@ public:
      */
     std::vector<FunctionInfo> getSupportedFunctions() override;
 
+    /**
+     * @brief Get the hardware resource this module drives
+     * @return BusResource::Spi
+     */
+    BusResource resource() const override { return BusResource::Spi; }
+
 private:
     int8_t _sckPin;           ///< The SCK (clock) pin number
     int8_t _misoPin;          ///< The MISO (Master In Slave Out) pin number
@@ -82,12 +88,43 @@ private:
     SPISettings _spiSettings; ///< The current SPI settings
 
     /**
-     * @brief Transfer data over SPI
+     * @brief Opcodes of the supported commands, in getSupportedFunctions() order
+     */
+    enum Opcode : uint16_t
+    {
+        OP_TRANSFER,
+        OP_SET_SETTINGS,
+        OP_COUNT
+    };
+
+    /// Command handler invoked through the dispatch jump table
+    typedef void (SPICtl::*Handler)(const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result);
+
+    static const Handler handlers[OP_COUNT]; ///< Jump table indexed by opcode
+
+    /**
+     * @brief Parse the parameters of "transfer" and run it
+     *
+     * @param params A vector of parameter name-value pairs for the command
+     * @param result Sink the command writes its result into
+     */
+    void handleTransfer(const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result);
+
+    /**
+     * @brief Parse the parameters of "setSettings" and run it
+     *
+     * @param params A vector of parameter name-value pairs for the command
+     * @param result Sink the command writes its result into
+     */
+    void handleSetSettings(const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result);
+
+    /**
+     * @brief Transfer data over SPI, full duplex and in place
      *
-     * @param data A vector of uint8_t containing the data to transfer
-     * @return A vector of uint8_t containing the received data
+     * @param data The bytes to send, each overwritten with the byte clocked in during its transfer
+     * @param length Number of bytes
      */
-    std::vector<uint8_t> transfer(const std::vector<uint8_t> &data);
+    void transfer(uint8_t *data, size_t length);
 
     /**
      * @brief Begin an SPI transaction
@@ -20,13 +20,24 @@
 #include <Arduino.h>
 #include <vector>
 #include <string>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <driver/i2s.h>
 #include "module.h"
+#include "samples.h"
 
 /**
  * @brief Analog control module for Arduino-CTL
  *
  * This class implements the ModuleInterface for analog operations,
  * including reading from analog inputs and writing to analog outputs (PWM).
+ *
+ * Besides one-off reads, the pin can be sampled continuously: I2S0 in
+ * built-in ADC mode converts it at a fixed rate into a ring of DMA blocks in
+ * the background, and "readContinuous" pulls the completed blocks.
+ *
+ * "scan" samples a list of pins in one pass instead of the module's pin,
+ * through the ADC1 pattern table when every pin has an ADC1 channel.
  */
 class AnalogCtl : public ModuleInterface
 {
@@ -57,13 +68,23 @@ public:
     void deinit() override;
 
     /**
-     * @brief Execute a command on the Analog module
+     * @brief Execute a command on the module by opcode
      *
-     * @param command The command to execute ("readAnalog" or "writeAnalog")
+     * @param opcode The opcode of the command ("readAnalog" or "writeAnalog")
      * @param params A vector of parameter name-value pairs for the command
-     * @return A pair containing the return type as a string and a void pointer to the return value
+     * @param result Sink the command writes its result into
      */
-    std::pair<std::string, void *> execute(const std::string &command, const std::vector<std::pair<std::string, std::string>> &params) override;
+    void dispatch(uint16_t opcode, const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result) override;
+
+    /**
+     * @brief Execute "writeAnalog" with packed values, one argument per value
+     *
+     * @param opcode The opcode of the command; only "writeAnalog" has a packed form
+     * @param args The values to write
+     * @param count Number of values
+     * @return true if the command was executed
+     */
+    bool dispatchPacked(uint16_t opcode, const int32_t *args, size_t count) override;
 
     /**
      * @brief Get information about the functions supported by this module
@@ -72,17 +93,105 @@ public:
      */
     std::vector<FunctionInfo> getSupportedFunctions() override;
 
+    /**
+     * @brief Get the hardware resource this module drives
+     * @return BusResource::Adc
+     */
+    BusResource resource() const override { return BusResource::Adc; }
+
 private:
-    int _pin;        ///< The analog pin number being used
-    int _resolution; ///< The ADC resolution in bits
+    int _pin;                     ///< The analog pin number being used
+    int _resolution;              ///< The ADC resolution in bits
+    std::vector<uint8_t> _buffer; ///< Decoded values payload, reused across commands
+    std::vector<int> _values;     ///< Values unpacked from _buffer, reused across commands
+
+    bool _continuous;               ///< Whether continuous sampling owns I2S0
+    QueueHandle_t _events;          ///< I2S0 event queue, reporting dropped DMA blocks
+    uint32_t _sampleRate;           ///< Conversions per second of continuous sampling
+    int _blockSamples;              ///< Samples per DMA block
+    int _ringBlocks;                ///< DMA blocks in the ring
+    int64_t _continuousStart;       ///< esp_timer time of the first conversion
+    uint64_t _consumed;             ///< Conversions read or dropped since the start
+    std::vector<uint16_t> _words;   ///< Raw DMA words, reused across reads
+    std::vector<uint8_t> _scanPins; ///< Pins of the current scan, reused across scans
+
+    /**
+     * @brief Opcodes of the supported commands, in getSupportedFunctions() order
+     */
+    enum Opcode : uint16_t
+    {
+        OP_READ_ANALOG,
+        OP_WRITE_ANALOG,
+        OP_START_CONTINUOUS,
+        OP_READ_CONTINUOUS,
+        OP_STOP_CONTINUOUS,
+        OP_SCAN,
+        OP_COUNT
+    };
+
+    /// Command handler invoked through the dispatch jump table
+    typedef void (AnalogCtl::*Handler)(const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result);
+
+    static const Handler handlers[OP_COUNT]; ///< Jump table indexed by opcode
+
+    /**
+     * @brief Parse the parameters of "readAnalog" and run it
+     *
+     * @param params A vector of parameter name-value pairs for the command
+     * @param result Sink the command writes its result into
+     */
+    void handleReadAnalog(const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result);
+
+    /**
+     * @brief Parse the parameters of "writeAnalog" and run it
+     *
+     * @param params A vector of parameter name-value pairs for the command
+     * @param result Sink the command writes its result into
+     */
+    void handleWriteAnalog(const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result);
+
+    /**
+     * @brief Parse the parameters of "startContinuous" and run it
+     *
+     * @param params A vector of parameter name-value pairs for the command
+     * @param result Sink the command writes its result into
+     */
+    void handleStartContinuous(const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result);
+
+    /**
+     * @brief Parse the parameters of "readContinuous" and run it
+     *
+     * @param params A vector of parameter name-value pairs for the command
+     * @param result Sink the command writes its result into
+     */
+    void handleReadContinuous(const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result);
+
+    /**
+     * @brief Run "stopContinuous"
+     *
+     * @param params Unused; the command takes no parameters
+     * @param result Unused; the command has no result
+     */
+    void handleStopContinuous(const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result);
+
+    /**
+     * @brief Parse the parameters of "scan" and run it
+     *
+     * @param params A vector of parameter name-value pairs for the command
+     * @param result Sink the command writes its result into
+     */
+    void handleScan(const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result);
 
     /**
      * @brief Read analog values from the specified pin
      *
      * @param numSamples The number of samples to read
-     * @return A vector of int values read from the analog pin
+     * @param encoding Format of the samples; U16 and Packed12 fit the ADC's 9 to 12 bits
+     * @param reduction Reduction applied to the samples before they are encoded
+     * @param factor Samples per window of the reduction
+     * @param result Sink receiving the encoded values
      */
-    std::vector<int> readAnalog(int numSamples);
+    void readAnalog(int numSamples, SampleEncoding encoding, SampleReduction reduction, uint32_t factor, ResultSink &result);
 
     /**
      * @brief Write analog values (PWM) to the specified pin
@@ -90,6 +199,76 @@ private:
      * @param values A vector of int values to write to the analog pin
      */
     void writeAnalog(const std::vector<int> &values);
+
+    /**
+     * @brief Start converting the pin continuously into a ring of DMA blocks
+     *
+     * @param sampleRate Conversions per second
+     * @param blockSamples Samples per DMA block; even, as the DMA moves samples in pairs
+     * @param numBlocks Number of blocks in the ring
+     * @param result Sink receiving an error if the pin has no ADC1 channel or I2S0 is taken
+     */
+    void startContinuous(uint32_t sampleRate, int blockSamples, int numBlocks, ResultSink &result);
+
+    /**
+     * @brief Read the next completed blocks of continuous sampling
+     *
+     * Blocks the DMA dropped because the ring was full are skipped, so the
+     * samples returned are evenly spaced from the start time reported with them.
+     *
+     * @param numBlocks Number of blocks to read
+     * @param encoding Format of the samples
+     * @param reduction Reduction applied to the samples before they are encoded; windows do not span reads
+     * @param factor Samples per window of the reduction
+     * @param timeoutMs Longest time to wait for the blocks; fewer samples are returned on timeout
+     * @param result Sink receiving the encoded samples and the time of the first one
+     */
+    void readContinuous(int numBlocks, SampleEncoding encoding, SampleReduction reduction, uint32_t factor, uint32_t timeoutMs, ResultSink &result);
+
+    /**
+     * @brief Stop continuous sampling and release I2S0
+     */
+    void stopContinuous();
+
+    /**
+     * @brief Sample every pin of _scanPins in turn, numSamples times
+     *
+     * Uses the pattern table when it can, else analogRead() with the sets paced at the sample rate.
+     *
+     * @param numSamples Samples per pin
+     * @param sampleRate Sets of samples per second
+     * @param blocks Whether to return the samples of each pin as a block instead of interleaved
+     * @param encoding Format of the samples
+     * @param result Sink receiving the encoded samples, the time of the first one and the skew
+     */
+    void scan(size_t numSamples, uint32_t sampleRate, bool blocks, SampleEncoding encoding, ResultSink &result);
+
+    /**
+     * @brief Scan through the ADC1 pattern table with I2S0 in built-in ADC mode
+     *
+     * Each conversion takes the next entry of the table, so adjacent pins are
+     * one conversion period apart. Fills _words with the interleaved samples.
+     *
+     * @param numSamples Samples per pin
+     * @param sampleRate Sets of samples per second
+     * @param start Receives the esp_timer time of the first sample
+     * @param skew Receives the delay between adjacent pins in nanoseconds
+     * @return ESP_OK; ESP_ERR_NOT_SUPPORTED if I2S0 is in use, leaving the scan to analogRead();
+     *         ESP_ERR_TIMEOUT if the DMA fell short; ESP_ERR_INVALID_RESPONSE if the data does not follow the pattern
+     */
+    esp_err_t scanPattern(size_t numSamples, uint32_t sampleRate, int64_t &start, uint32_t &skew);
+
+    /**
+     * @brief Scan with analogRead(), pin after pin as fast as it converts
+     *
+     * Fills _words with the interleaved samples.
+     *
+     * @param numSamples Samples per pin
+     * @param sampleRate Sets of samples per second
+     * @param start Receives the esp_timer time of the first sample
+     * @param skew Receives the largest delay seen between adjacent pins in nanoseconds
+     */
+    void scanLoop(size_t numSamples, uint32_t sampleRate, int64_t &start, uint32_t &skew);
 };
 
 #endif // ANALOG_H
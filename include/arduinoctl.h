@@ -20,12 +20,26 @@
 #include <Arduino.h>
 #include <vector>
 #include <memory>
+#include <functional>
+#include <mutex>
 #include "module.h"
+#include "nameindex.h"
+#include "result.h"
+#include "jsonpool.h"
+#include "msgpack.h"
+#include "udpframe.h"
+#include "executor.h"
+#include "jobs.h"
+#include "programs.h"
+#include "resultcache.h"
+#include "metrics.h"
+#include "responsestream.h"
 #include <WiFi.h>
 #include <AsyncTCP.h>
+#include <AsyncUDP.h>
 #include <ESPAsyncWebServer.h>
 #include <ArduinoJson.h>
-#include <base64.hpp>
+#include "base64codec.h"
 #include "analogctl.h"
 #include "gpioctl.h"
 #include "I2Cctl.h"
@@ -33,6 +47,111 @@
 #include "SPIctl.h"
 #include "configctl.h"
 
+/**
+ * @brief Largest request body accepted by the HTTP endpoints, in bytes
+ *
+ * Bodies are buffered whole before they are parsed; override with a build flag
+ * (e.g. -DARDUINOCTL_MAX_BODY_SIZE=65536) on boards with more free heap.
+ */
+#ifndef ARDUINOCTL_MAX_BODY_SIZE
+#define ARDUINOCTL_MAX_BODY_SIZE 32768
+#endif
+
+/**
+ * @brief Number of requests that can execute with pooled JSON documents at the same time
+ */
+#ifndef ARDUINOCTL_DOCUMENT_POOL_SIZE
+#define ARDUINOCTL_DOCUMENT_POOL_SIZE 2
+#endif
+
+/**
+ * @brief Stack size in bytes of the task that executes commands
+ */
+#ifndef ARDUINOCTL_EXECUTOR_STACK_SIZE
+#define ARDUINOCTL_EXECUTOR_STACK_SIZE 8192
+#endif
+
+/**
+ * @brief FreeRTOS priority of the task that executes commands
+ *
+ * The default matches the Arduino loop task, which shares its core.
+ */
+#ifndef ARDUINOCTL_EXECUTOR_PRIORITY
+#define ARDUINOCTL_EXECUTOR_PRIORITY 1
+#endif
+
+/**
+ * @brief Core the task that executes commands is pinned to, away from the WiFi stack on core 0
+ */
+#ifndef ARDUINOCTL_EXECUTOR_CORE
+#define ARDUINOCTL_EXECUTOR_CORE 1
+#endif
+
+/**
+ * @brief Stack size in bytes of each per-bus executor task
+ */
+#ifndef ARDUINOCTL_BUS_EXECUTOR_STACK_SIZE
+#define ARDUINOCTL_BUS_EXECUTOR_STACK_SIZE 4096
+#endif
+
+/**
+ * @brief Number of batches that can wait for the executor before requests are refused with 503
+ */
+#ifndef ARDUINOCTL_EXECUTOR_QUEUE_DEPTH
+#define ARDUINOCTL_EXECUTOR_QUEUE_DEPTH 8
+#endif
+
+/**
+ * @brief Number of ?async=1 jobs whose results can wait to be fetched from /jobs
+ */
+#ifndef ARDUINOCTL_MAX_JOBS
+#define ARDUINOCTL_MAX_JOBS 8
+#endif
+
+/**
+ * @brief Number of stored command programs kept at the same time
+ */
+#ifndef ARDUINOCTL_MAX_PROGRAMS
+#define ARDUINOCTL_MAX_PROGRAMS 16
+#endif
+
+/**
+ * @brief Number of read results the result cache holds
+ */
+#ifndef ARDUINOCTL_CACHE_SIZE
+#define ARDUINOCTL_CACHE_SIZE 16
+#endif
+
+/**
+ * @brief How long an HTTP handler waits for a batch before switching to a deferred response, in milliseconds
+ *
+ * Short batches are answered from the handler; longer ones hand the connection
+ * back to AsyncTCP and are answered once the executor finishes them.
+ */
+#ifndef ARDUINOCTL_INLINE_WAIT_MS
+#define ARDUINOCTL_INLINE_WAIT_MS 20
+#endif
+
+/**
+ * @brief Smallest byte result streamed into HTTP responses from the module's buffer, in bytes
+ *
+ * Larger results are not copied into the response text: they are encoded into
+ * the network buffer as the connection drains, so a response never holds a
+ * second copy of them. See responsestream.h.
+ */
+#ifndef ARDUINOCTL_STREAM_THRESHOLD
+#define ARDUINOCTL_STREAM_THRESHOLD 1024
+#endif
+
+/**
+ * @brief UDP port of the fire-and-forget fast path, or 0 to leave it disabled
+ *
+ * See udpframe.h for the frame format.
+ */
+#ifndef ARDUINOCTL_UDP_PORT
+#define ARDUINOCTL_UDP_PORT 0
+#endif
+
 /**
  * @brief Main class for remote control of Arduino modules
  *
@@ -56,6 +175,14 @@ public:
      */
     void registerModule(const std::string &name, std::shared_ptr<ModuleInterface> module);
 
+    /**
+     * @brief Build the module and opcode lookup tables
+     *
+     * Called by begin() once registration is complete. Commands executed before that
+     * build the tables on first use; registering another module invalidates them.
+     */
+    void finalizeRegistry();
+
     /**
      * @brief Execute a set of commands received as a JSON string
      *
@@ -64,6 +191,34 @@ public:
      */
     std::string executeCommands(const std::string &jsonCommands);
 
+    /**
+     * @brief Execute a set of commands received as a mutable JSON buffer
+     *
+     * The buffer is parsed in place, so strings are not copied into the JSON document;
+     * its contents are undefined afterwards.
+     *
+     * Byte results of at least ARDUINOCTL_STREAM_THRESHOLD bytes are spliced into
+     * the response rather than copied, and encoded as the response is read.
+     *
+     * @param json A buffer containing the JSON commands
+     * @param length Length of the JSON in bytes
+     * @param response Receives the JSON results of the executed commands
+     */
+    void executeCommands(char *json, size_t length, ResponseStream &response);
+
+    /**
+     * @brief Execute a set of commands received as MessagePack
+     *
+     * The message has the same shape as the JSON request. Byte parameters and byte
+     * results are raw binary payloads instead of base64 strings. Large byte results
+     * are spliced into the response as for executeCommands().
+     *
+     * @param data The MessagePack message
+     * @param length Length of the message in bytes
+     * @param response Receives the MessagePack results of the executed commands
+     */
+    void executeMsgPack(const uint8_t *data, size_t length, ResponseStream &response);
+
     /**
      * @brief Initialize the RemoteControlServer
      *
@@ -73,6 +228,72 @@ public:
      */
     bool begin();
 
+    /**
+     * @brief Get the cache of read results, for its hit and miss counters
+     * @return The cache
+     */
+    const ResultCache &resultCache() const { return cache; }
+
+    /**
+     * @brief The /capabilities document and its entity tag
+     */
+    struct Capabilities
+    {
+        std::string json; ///< Every module with its bus, commands, parameter types and result types
+        std::string etag; ///< Quoted hash of json, compared against If-None-Match
+    };
+
+    /**
+     * @brief Get the capabilities document built by finalizeRegistry()
+     *
+     * Safe to call from the web server task while the registry is rebuilt: the
+     * document is replaced whole, and callers keep the one they got alive.
+     *
+     * @return The document, or null before the registry is first built
+     */
+    std::shared_ptr<const Capabilities> capabilities() const { return std::atomic_load(&capabilityDocument); }
+
+    /**
+     * @brief Append the pipeline counters and latency histograms in Prometheus text format
+     * @param out Buffer to append to
+     */
+    void renderMetrics(std::string &out) const;
+
+    /**
+     * @brief Add the time a read of a streamed response spent encoding its payloads
+     *
+     * The Encode phase of a streamed response is recorded once, with the time
+     * spent building it, when its last byte has been read.
+     *
+     * @param response The response being sent
+     * @param micros Time the read took
+     * @param finished Whether the read reached the end of the response
+     */
+    void recordStreamedEncode(ResponseStream &response, uint32_t micros, bool finished);
+
+    /**
+     * @brief Queue a batch of commands to the executor task
+     *
+     * @param job The job holding the request; its response is set before it finishes
+     * @param track Whether to give the job an ID and keep it for /jobs until fetched
+     * @return true if the job was queued, false if the executor or the job table is full
+     */
+    bool submitJob(const std::shared_ptr<Job> &job, bool track);
+
+    /**
+     * @brief Look up a job queued with tracking
+     *
+     * @param id The ID of the job
+     * @return The job, or null if it is unknown or was already fetched
+     */
+    std::shared_ptr<Job> findJob(uint32_t id) { return jobs.find(id); }
+
+    /**
+     * @brief Stop tracking a job once its result has been fetched
+     * @param id The ID of the job
+     */
+    void forgetJob(uint32_t id) { jobs.remove(id); }
+
 private:
     /**
      * @brief Vector of registered modules
@@ -82,14 +303,272 @@ private:
     std::vector<std::pair<std::string, std::shared_ptr<ModuleInterface>>> modules;
 
     /**
-     * @brief Execute a single command on a specific module
+     * @brief Perfect-hash table from module name to its index in modules
+     */
+    NameIndex moduleIndex;
+
+    /**
+     * @brief Whether moduleIndex and the module opcode tables are up to date
+     */
+    bool registryBuilt = false;
+
+    /**
+     * @brief A command of the batch being executed
+     */
+    struct BatchCommand
+    {
+        int module;                                              ///< Index of the module in modules, or -1 if the command did not resolve
+        uint16_t opcode;                                         ///< Opcode of the command on that module
+        uint32_t cacheMs;                                        ///< How long a cacheable result may be reused, 0 to always run
+        std::vector<std::pair<std::string, std::string>> params; ///< Parameter name-value pairs of the command
+        ResultSink result;                                       ///< Sink the command writes its result into
+    };
+
+    /**
+     * @brief Commands of the batch being executed, in request order
+     *
+     * Entries are reused across batches so their parameter and result buffers keep their capacity.
+     */
+    std::vector<BatchCommand> batch;
+
+    /**
+     * @brief Resource of each module in modules, cached by finalizeRegistry()
+     */
+    std::vector<BusResource> moduleBuses;
+
+    /**
+     * @brief Document served by /capabilities, rebuilt by finalizeRegistry()
+     */
+    std::shared_ptr<const Capabilities> capabilityDocument;
+
+    /**
+     * @brief Describe the registered modules for /capabilities
+     * @return The document and its entity tag
+     */
+    std::shared_ptr<const Capabilities> buildCapabilities();
+
+    /**
+     * @brief Whether each command of each module is cacheable, indexed by module then opcode
+     */
+    std::vector<std::vector<bool>> cacheableCommands;
+
+    /**
+     * @brief Recent results of cacheable commands that asked for caching
+     */
+    ResultCache cache;
+
+    /**
+     * @brief Request counters and per-phase and per-command latency histograms
+     */
+    Metrics metrics;
+
+    /**
+     * @brief Execute a batch entry, through the result cache when it asks for caching
+     *
+     * Commands that are not cacheable drop the cached results of their module.
+     *
+     * @param entry The entry
+     */
+    void executeBatchCommand(BatchCommand &entry);
+
+    /**
+     * @brief One executor per bus resource; BusResource::General commands run on the batch executor
+     */
+    std::unique_ptr<Executor> busExecutors[static_cast<size_t>(BusResource::Count)];
+
+    /**
+     * @brief Given by each bus executor when it has run its share of a batch
+     */
+    SemaphoreHandle_t batchDone = nullptr;
+
+    /**
+     * @brief Get a cleared batch entry, growing the batch if needed
+     *
+     * @param index Position of the command in the batch
+     * @return The entry
+     */
+    BatchCommand &batchCommand(size_t index);
+
+    /**
+     * @brief Record the time spent encoding a batch's results
+     *
+     * @param stream The streamed response the results went into, or null if they were
+     *               fully encoded; its phase is then recorded once it has been sent
+     * @param micros Time spent encoding
+     */
+    void recordEncode(ResponseStream *stream, uint32_t micros);
+
+    /**
+     * @brief Execute the first count entries of batch
+     *
+     * Commands on different buses run concurrently on the bus executors; commands
+     * on the same bus run in request order.
+     *
+     * @param count Number of commands in the batch
+     * @param serial Whether to run every command in request order on the calling task
+     */
+    void runBatch(size_t count, bool serial);
+
+    /**
+     * @brief Stored programs, pre-resolved to module indices and opcodes
+     */
+    ProgramStore programs;
+
+    /**
+     * @brief Arguments of the program invocation being executed, reused across requests
+     */
+    std::vector<std::pair<std::string, std::string>> programArgs;
+
+    /**
+     * @brief Compile and store a program
+     *
+     * Every command is resolved and its constant parameters are bound through the
+     * command's schema, so a stored program fails only on its placeholders.
+     * finalizeRegistry() resolves the steps again by name.
+     *
+     * @param commands The commands of the program, in the same form as a request's "commands"
+     * @param error Receives the reason the program was rejected
+     * @return The ID of the program, or 0 if it was rejected
+     */
+    uint32_t defineProgram(JsonArray commands, const char *&error);
+
+    /**
+     * @brief Fill the batch with the commands of a stored program
      *
-     * @param moduleName The name of the module to execute the command on
-     * @param command The name of the command to execute
+     * Commands whose placeholders have no argument fail with an error result.
+     *
+     * @param steps The steps of the program
+     * @param args Argument name-value pairs of the invocation
+     * @return Number of commands in the batch
+     */
+    size_t loadProgram(const std::vector<ProgramStep> &steps, const std::vector<std::pair<std::string, std::string>> &args);
+
+    /**
+     * @brief Execute the commands of a batch that target one bus, in request order
+     *
+     * @param count Number of commands in the batch
+     * @param bus The bus whose commands to run
+     */
+    void runBusCommands(size_t count, BusResource bus);
+
+    /**
+     * @brief Token UDP fast-path frames must carry, derived from the API key
+     */
+    uint32_t udpToken = 0;
+
+    /**
+     * @brief Out-of-order filter of the UDP fast path, one per module
+     */
+    std::vector<SequenceFilter> udpSequences;
+
+    /**
+     * @brief Execute a UDP fast-path frame
+     *
+     * Runs on the AsyncUDP task, which checks the frame and queues the command to
+     * the executor. Frames that are malformed, carry the wrong token, address an
+     * unknown module, arrive out of order or find the executor full are dropped silently.
+     *
+     * @param data The datagram payload
+     * @param length Length of the payload in bytes
+     */
+    void handleUdpPacket(const uint8_t *data, size_t length);
+
+    /**
+     * @brief Resolve a module/command name pair to a module index and opcode
+     *
+     * @param moduleName Pointer to the module name characters
+     * @param moduleLength Length of the module name in bytes
+     * @param commandName Pointer to the command name characters
+     * @param commandLength Length of the command name in bytes
+     * @param module Receives the index of the module in modules
+     * @param opcode Receives the opcode of the command on that module
+     * @param result Receives an error if the pair cannot be resolved
+     * @return true if the pair was resolved
+     */
+    bool resolveCommand(const char *moduleName, size_t moduleLength, const char *commandName, size_t commandLength, int &module, uint16_t &opcode, ResultSink &result);
+
+    /**
+     * @brief Check a client-supplied API key
+     *
+     * @param apiKey Pointer to the key characters
+     * @param length Length of the key in bytes
+     * @return true if the key matches the configured API key
+     */
+    bool checkApiKey(const char *apiKey, size_t length) const;
+
+    /**
+     * @brief Execute the commands of a MessagePack message
+     *
+     * @param data The MessagePack message
+     * @param length Length of the message in bytes
+     * @param response Buffer receiving the MessagePack results
+     * @param authenticated Whether the sender is already authenticated, skipping the API key check
+     * @param stream If set, response is its text and large byte results are spliced into it
+     * @return true if the message was parsed and its API key accepted
+     */
+    bool executeMessage(const uint8_t *data, size_t length, std::string &response, bool authenticated, ResponseStream *stream = nullptr);
+
+    /**
+     * @brief State of a connected WebSocket client
+     */
+    struct WebSocketSession
+    {
+        uint32_t clientId;   ///< AsyncWebSocketClient::id() of the client
+        bool authenticated;  ///< Whether the client has sent a valid API key
+        std::string message; ///< Reassembly buffer for messages split across frames
+    };
+
+    /**
+     * @brief Sessions of the connected WebSocket clients
+     */
+    std::vector<WebSocketSession> webSocketSessions;
+
+    /**
+     * @brief Guards webSocketSessions, which AsyncTCP callbacks and the executor both touch
+     */
+    std::mutex sessionMutex;
+
+    /**
+     * @brief Handle an event on the /ws WebSocket
+     *
+     * @param socket The WebSocket the event occurred on
+     * @param client The client the event concerns
+     * @param type The event type
+     * @param arg Event-specific data (an AwsFrameInfo for data events)
+     * @param data Received payload for data events
+     * @param len Length of the payload
+     */
+    void handleWebSocketEvent(AsyncWebSocket *socket, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len);
+
+    /**
+     * @brief Queue a complete WebSocket message to the executor
+     *
+     * Messages of a client run in the order they arrive.
+     *
+     * @param session The session of the client that sent the message
+     * @param binary Whether the message is MessagePack (binary frame) rather than JSON (text frame)
+     * @param data The message; it is copied
+     * @param length Length of the message in bytes
+     */
+    void submitWebSocketMessage(const WebSocketSession &session, bool binary, const uint8_t *data, size_t length);
+
+    /**
+     * @brief Execute a WebSocket message on the executor task and send the response to its client
+     *
+     * @param job The job holding the message
+     * @param clientId The ID of the client that sent the message
+     */
+    void executeWebSocketMessage(Job &job, uint32_t clientId);
+
+    /**
+     * @brief Execute a single resolved command on a specific module
+     *
+     * @param module The index of the module in modules
+     * @param opcode The opcode of the command on that module
      * @param params A vector of parameter name-value pairs for the command
-     * @return std::string A JSON string containing the result of the executed command
+     * @param result Sink the command writes its result into
      */
-    std::string executeCommand(const std::string &moduleName, const std::string &command, const std::vector<std::pair<std::string, std::string>> &params);
+    void executeCommand(size_t module, uint16_t opcode, const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result);
 
     /**
      * @brief Configuration management object
@@ -98,20 +577,43 @@ private:
      */
     ConfigCtl configCtl;
 
-    // Helper function to encode binary data to base64
-    static std::string encodeBase64(const std::vector<uint8_t> &data)
-    {
-        size_t encodedLength = encode_base64_length(data.size());
-        std::string encoded(encodedLength, 0);
-        encode_base64(data.data(), data.size(), reinterpret_cast<unsigned char *>(&encoded[0]));
-        return encoded;
-    }
+    /**
+     * @brief Pool of request documents and response buffers reused across requests
+     */
+    JsonDocumentPool documentPool;
+
+    /**
+     * @brief Task that executes every batch of commands, off the AsyncTCP task
+     */
+    Executor executor;
+
+    /**
+     * @brief Jobs queued with ?async=1, until their results are fetched
+     */
+    JobTable jobs;
+
+    /**
+     * @brief Serializes command execution, which shares batch, documentPool slots and the modules
+     */
+    std::mutex executionMutex;
+
+    /**
+     * @brief Execute the commands of a parsed request document
+     *
+     * @param doc The parsed request
+     * @param error The result of parsing the request
+     * @param response Buffer receiving the JSON string containing the results of the executed commands
+     * @param authenticated Whether the sender is already authenticated, skipping the API key check
+     * @param stream If set, response is its text and large byte results are spliced into it
+     * @return true if the request was parsed and its API key accepted
+     */
+    bool executeDocument(JsonDocument &doc, DeserializationError error, std::string &response, bool authenticated, ResponseStream *stream = nullptr);
 
     // Helper function to decode base64 to binary data
     static std::vector<uint8_t> decodeBase64(const std::string &encoded)
     {
-        std::vector<uint8_t> decoded(decode_base64_length(reinterpret_cast<const unsigned char *>(encoded.c_str())));
-        decode_base64(reinterpret_cast<const unsigned char *>(encoded.c_str()), encoded.length(), decoded.data());
+        std::vector<uint8_t> decoded;
+        base64Decode(encoded, decoded);
         return decoded;
     }
 };
@@ -123,6 +625,18 @@ private:
  */
 extern AsyncWebServer server;
 
+/**
+ * @brief Global instance of the AsyncWebSocket
+ *
+ * Persistent command sessions on /ws, attached to the web server.
+ */
+extern AsyncWebSocket webSocket;
+
+/**
+ * @brief Global instance of the AsyncUDP listener for the fast path
+ */
+extern AsyncUDP udp;
+
 /**
  * @brief Global instance of the RemoteControlServer
  *
@@ -131,10 +645,10 @@ extern AsyncWebServer server;
 extern RemoteControlServer remoteServer;
 
 /**
- * @brief Handler function for the /execute endpoint
+ * @brief Body handler for the /execute and /msgpack endpoints
  *
- * This function is called when a POST request is received on the /execute endpoint.
- * It processes the received JSON data and executes the requested commands.
+ * This function is called for every chunk of a POST body received on those endpoints.
+ * It copies the chunks into a per-request buffer sized from the total body length.
  *
  * @param request The AsyncWebServerRequest object containing the request details
  * @param data Pointer to the received data
@@ -142,7 +656,27 @@ extern RemoteControlServer remoteServer;
  * @param index Starting index of the data chunk
  * @param total Total length of the data
  */
-void handleExecute(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total);
+void handleRequestBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total);
+
+/**
+ * @brief Handler function for the /execute endpoint
+ *
+ * This function is called once the whole POST body has been received on the /execute endpoint.
+ * It processes the buffered JSON data and executes the requested commands.
+ *
+ * @param request The AsyncWebServerRequest object containing the request details
+ */
+void handleExecute(AsyncWebServerRequest *request);
+
+/**
+ * @brief Handler function for the /msgpack endpoint
+ *
+ * This function is called once the whole POST body has been received on the /msgpack endpoint.
+ * It executes the commands of the buffered MessagePack message and replies in MessagePack.
+ *
+ * @param request The AsyncWebServerRequest object containing the request details
+ */
+void handleMsgPack(AsyncWebServerRequest *request);
 
 /**
  * @brief Arduino setup function
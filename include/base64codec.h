@@ -0,0 +1,93 @@
+// ⚡🔌 Arduino-CTL 🔌⚡
+//
+// Copyright (C) 2024 ixaxaar
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef BASE64CODEC_H
+#define BASE64CODEC_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Get the length of the base64 encoding of a payload, padding included
+ * @param length Payload length in bytes
+ * @return Number of characters
+ */
+inline size_t base64EncodedLength(size_t length) { return (length + 2) / 3 * 4; }
+
+/**
+ * @brief Get the number of bytes a base64 text decodes to
+ *
+ * Trailing padding is accounted for; the characters are not validated.
+ *
+ * @param text The base64 characters
+ * @param length Number of characters
+ * @return Decoded length in bytes
+ */
+size_t base64DecodedLength(const char *text, size_t length);
+
+/**
+ * @brief Encode bytes as padded base64
+ *
+ * Three input bytes are encoded per step through a lookup table. The output is
+ * not NUL-terminated.
+ *
+ * @param data The bytes to encode
+ * @param length Number of bytes
+ * @param out Receives base64EncodedLength(length) characters
+ * @return Number of characters written
+ */
+size_t base64Encode(const uint8_t *data, size_t length, char *out);
+
+/**
+ * @brief Encode bytes as base64 directly at the end of a buffer
+ *
+ * @param out The buffer to append to
+ * @param data The bytes to encode
+ * @param length Number of bytes
+ */
+void base64Append(std::string &out, const uint8_t *data, size_t length);
+
+/**
+ * @brief Decode base64 into a caller-provided buffer
+ *
+ * Both the standard and the URL-safe alphabet are accepted, with or without
+ * padding. The output may alias the input: decoding in place is supported,
+ * since every four characters are read before the three bytes they encode are
+ * written.
+ *
+ * @param text The base64 characters
+ * @param length Number of characters
+ * @param out Receives base64DecodedLength(text, length) bytes
+ * @param written Receives the number of bytes written
+ * @return true on success, false on a character outside the alphabet or a truncated group
+ */
+bool base64Decode(const char *text, size_t length, uint8_t *out, size_t &written);
+
+/**
+ * @brief Decode base64 into a reusable buffer
+ *
+ * The buffer is resized to the decoded length; its capacity is kept, so a
+ * warmed-up buffer decodes without allocating.
+ *
+ * @param text The base64 characters
+ * @param out Receives the decoded bytes
+ * @return true on success, false on invalid input (out is then left empty)
+ */
+bool base64Decode(const std::string &text, std::vector<uint8_t> &out);
+
+#endif // BASE64CODEC_H
@@ -0,0 +1,77 @@
+// ⚡🔌 Arduino-CTL 🔌⚡
+//
+// Copyright (C) 2024 ixaxaar
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef EXECUTOR_H
+#define EXECUTOR_H
+
+#include <Arduino.h>
+#include <functional>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+
+/**
+ * @brief A FreeRTOS task that runs queued work items one at a time
+ *
+ * Lets hardware operations block (delays, bus transfers, DMA reads) without
+ * stalling the AsyncTCP task that serves the network.
+ */
+class Executor
+{
+public:
+    /**
+     * @brief Constructor for Executor
+     *
+     * @param name Name of the task, for debugging
+     * @param stackSize Stack size of the task in bytes
+     * @param priority FreeRTOS priority of the task
+     * @param core Core the task is pinned to (0, 1, or tskNO_AFFINITY)
+     * @param depth Number of work items that can wait in the queue
+     */
+    Executor(const char *name, uint32_t stackSize, UBaseType_t priority, BaseType_t core, size_t depth);
+
+    /**
+     * @brief Create the queue and start the task
+     *
+     * @return true if the task is running
+     */
+    bool begin();
+
+    /**
+     * @brief Queue a work item without blocking
+     *
+     * @param work The work to run on the executor task
+     * @return true if the item was queued, false if the queue is full or the executor is not running
+     */
+    bool submit(std::function<void()> work);
+
+private:
+    const char *_name;     ///< Name of the task
+    uint32_t _stackSize;   ///< Stack size of the task in bytes
+    UBaseType_t _priority; ///< FreeRTOS priority of the task
+    BaseType_t _core;      ///< Core the task is pinned to
+    size_t _depth;         ///< Capacity of the queue
+    QueueHandle_t _queue;  ///< Queue of heap-allocated std::function<void()> pointers
+    TaskHandle_t _task;    ///< The executor task
+
+    /**
+     * @brief Task entry point: run work items as they arrive
+     * @param arg The Executor
+     */
+    static void run(void *arg);
+};
+
+#endif // EXECUTOR_H
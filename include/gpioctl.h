@@ -20,12 +20,19 @@
 #include <Arduino.h>
 #include <vector>
 #include <string>
+#include <driver/rmt.h>
 #include "module.h"
+#include "samples.h"
 
 /**
  * @brief GPIO control module for Arduino-CTL
  *
- * This class implements the ModuleInterface for GPIO operations.
+ * This class implements the ModuleInterface for GPIO operations. The pin
+ * commands drive the pin chosen at init; the bank commands address any set of
+ * pins by mask (bit n is GPIO n) and read or write the whole set at once
+ * through the GPIO set, clear and input registers. "capture" turns a set of
+ * pins into a logic analyzer, and "playPattern" hands the pin to the RMT
+ * peripheral to play a timed waveform.
  */
 class GPIOCtl : public ModuleInterface
 {
@@ -56,13 +63,24 @@ public:
     void deinit() override;
 
     /**
-     * @brief Execute a command on the GPIO module
+     * @brief Execute a command on the module by opcode
      *
-     * @param command The command to execute ("setPinMode", "digitalRead", or "digitalWrite")
+     * @param opcode The opcode of the command ("setPinMode", "digitalRead", "digitalWrite", "bankMode", "bankRead", "bankWrite", "capture",
+     *               "playPattern" or "stopPattern")
      * @param params A vector of parameter name-value pairs for the command
-     * @return A pair containing the return type as a string and a void pointer to the return value
+     * @param result Sink the command writes its result into
      */
-    std::pair<std::string, void *> execute(const std::string &command, const std::vector<std::pair<std::string, std::string>> &params) override;
+    void dispatch(uint16_t opcode, const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result) override;
+
+    /**
+     * @brief Execute "digitalWrite" with packed values, one argument per value
+     *
+     * @param opcode The opcode of the command; only "digitalWrite" has a packed form
+     * @param args The values to write
+     * @param count Number of values
+     * @return true if the command was executed
+     */
+    bool dispatchPacked(uint16_t opcode, const int32_t *args, size_t count) override;
 
     /**
      * @brief Get information about the functions supported by this module
@@ -71,9 +89,130 @@ public:
      */
     std::vector<FunctionInfo> getSupportedFunctions() override;
 
+    /**
+     * @brief Get the hardware resource this module drives
+     * @return BusResource::Gpio
+     */
+    BusResource resource() const override { return BusResource::Gpio; }
+
+    /**
+     * @brief A logic analyzer capture, with its timing in CPU cycles
+     */
+    struct CaptureSettings
+    {
+        uint32_t mask;            ///< Pins to sample, bit n for GPIO n (GPIO0-31 only)
+        size_t numSamples;        ///< Samples to return, including the pre-trigger ones
+        size_t preTrigger;        ///< Samples to keep from before the trigger
+        uint32_t cyclesPerSample; ///< Sample period
+        uint32_t timeoutCycles;   ///< How long to wait for the trigger
+        uint32_t triggerMask;     ///< Pins the trigger looks at, 0 to start at once
+        uint32_t triggerValue;    ///< Levels of those pins that fire the trigger
+        bool triggerEdge;         ///< Fire only when the pins start matching, not while they match
+    };
+
 private:
-    int _pin;  ///< The GPIO pin number being controlled
-    int _mode; ///< The current mode of the GPIO pin
+    int _pin;                           ///< The GPIO pin number being controlled
+    int _mode;                          ///< The current mode of the GPIO pin
+    std::vector<uint8_t> _buffer;       ///< Decoded values payload, reused across commands
+    std::vector<int> _values;           ///< Values unpacked from _buffer, reused across commands
+    std::vector<rmt_item32_t> _pattern;     ///< Items of the pattern being played; the RMT driver reads them while it plays
+    std::vector<rmt_item32_t> _nextPattern; ///< Items of the pattern being built, swapped in once the driver is stopped
+    bool _patternInstalled;                 ///< Whether the RMT driver owns the pin
+    bool _patternLoops;                     ///< Whether the pattern being played repeats until stopped
+
+    /**
+     * @brief Opcodes of the supported commands, in getSupportedFunctions() order
+     */
+    enum Opcode : uint16_t
+    {
+        OP_SET_PIN_MODE,
+        OP_DIGITAL_READ,
+        OP_DIGITAL_WRITE,
+        OP_BANK_MODE,
+        OP_BANK_READ,
+        OP_BANK_WRITE,
+        OP_CAPTURE,
+        OP_PLAY_PATTERN,
+        OP_STOP_PATTERN,
+        OP_COUNT
+    };
+
+    /// Command handler invoked through the dispatch jump table
+    typedef void (GPIOCtl::*Handler)(const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result);
+
+    static const Handler handlers[OP_COUNT]; ///< Jump table indexed by opcode
+
+    /**
+     * @brief Parse the parameters of "setPinMode" and run it
+     *
+     * @param params A vector of parameter name-value pairs for the command
+     * @param result Sink the command writes its result into
+     */
+    void handleSetPinMode(const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result);
+
+    /**
+     * @brief Parse the parameters of "digitalRead" and run it
+     *
+     * @param params A vector of parameter name-value pairs for the command
+     * @param result Sink the command writes its result into
+     */
+    void handleDigitalRead(const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result);
+
+    /**
+     * @brief Parse the parameters of "digitalWrite" and run it
+     *
+     * @param params A vector of parameter name-value pairs for the command
+     * @param result Sink the command writes its result into
+     */
+    void handleDigitalWrite(const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result);
+
+    /**
+     * @brief Parse the parameters of "bankMode" and run it
+     *
+     * @param params A vector of parameter name-value pairs for the command
+     * @param result Sink the command writes its result into
+     */
+    void handleBankMode(const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result);
+
+    /**
+     * @brief Parse the parameters of "bankRead" and run it
+     *
+     * @param params A vector of parameter name-value pairs for the command
+     * @param result Sink the command writes its result into
+     */
+    void handleBankRead(const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result);
+
+    /**
+     * @brief Parse the parameters of "bankWrite" and run it
+     *
+     * @param params A vector of parameter name-value pairs for the command
+     * @param result Sink the command writes its result into
+     */
+    void handleBankWrite(const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result);
+
+    /**
+     * @brief Parse the parameters of "capture" and run it
+     *
+     * @param params A vector of parameter name-value pairs for the command
+     * @param result Sink the command writes its result into
+     */
+    void handleCapture(const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result);
+
+    /**
+     * @brief Parse the parameters of "playPattern" and run it
+     *
+     * @param params A vector of parameter name-value pairs for the command
+     * @param result Sink the command writes its result into
+     */
+    void handlePlayPattern(const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result);
+
+    /**
+     * @brief Run "stopPattern"
+     *
+     * @param params A vector of parameter name-value pairs for the command (none are used)
+     * @param result Sink the command writes its result into
+     */
+    void handleStopPattern(const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result);
 
     /**
      * @brief Set the mode of the GPIO pin
@@ -86,9 +225,10 @@ private:
      * @brief Read the digital value of the GPIO pin
      *
      * @param numSamples The number of samples to read
-     * @return A vector of int values read from the pin (0 or 1)
+     * @param encoding Format of the samples; Bits packs eight samples per byte
+     * @param result Sink receiving the encoded samples (0 or 1)
      */
-    std::vector<int> digitalRead(int numSamples);
+    void digitalRead(int numSamples, SampleEncoding encoding, ResultSink &result);
 
     /**
      * @brief Write digital values to the GPIO pin
@@ -96,6 +236,73 @@ private:
      * @param values A vector of int values to write to the pin (0 or 1)
      */
     void digitalWrite(const std::vector<int> &values);
+
+    /**
+     * @brief Read a set of pins at once
+     *
+     * Each sample packs the levels of the pins in mask into its low bits, lowest
+     * pin first, and takes the fewest little-endian bytes that hold them all.
+     *
+     * @param mask The pins to read, bit n for GPIO n
+     * @param numSamples The number of samples to read
+     * @param intervalUs Microseconds between samples, 0 to sample back to back
+     * @param result Sink receiving the samples
+     */
+    void bankRead(uint64_t mask, int numSamples, uint32_t intervalUs, ResultSink &result);
+
+    /**
+     * @brief Drive a set of pins through a sequence of states
+     *
+     * Each step is packed as bankRead() returns samples. A step writes the clear
+     * register, then the set register, of each 32-pin bank: the pins of a bank
+     * that fall change in one cycle, and those that rise one register write later.
+     *
+     * @param mask The pins to drive, bit n for GPIO n
+     * @param steps The packed steps
+     * @param numSteps Number of steps
+     * @param intervalUs Microseconds between steps
+     */
+    void bankWrite(uint64_t mask, const uint8_t *steps, size_t numSteps, uint32_t intervalUs);
+
+    /**
+     * @brief Sample a set of pins at a fixed rate around a trigger
+     *
+     * Samples are paced by the CPU cycle counter with interrupts masked on the
+     * calling core, so the capture runs at the same rate whatever the web server
+     * and the other tasks are doing. Until the trigger fires the samples go to a
+     * ring buffer, which keeps the pre-trigger ones. Interrupts stay masked from
+     * the trigger wait through the last sample; the two share one bound on the
+     * time they are masked.
+     *
+     * The result is a bit stream, least significant bit first, holding for each
+     * sample the levels of the pins in the mask, lowest pin first.
+     *
+     * @param settings The capture
+     * @param result Sink receiving the samples, or an error on trigger timeout or overrun
+     */
+    void capture(const CaptureSettings &settings, ResultSink &result);
+
+    /**
+     * @brief Play _nextPattern on the pin through the RMT peripheral
+     *
+     * The peripheral times every level change, so playback neither jitters nor
+     * keeps a CPU busy; unless asked to wait, the command returns as it starts.
+     * A pattern already playing is stopped and replaced.
+     *
+     * @param loop Whether to repeat the pattern until it is stopped
+     * @param idleLevel Level the pin holds once a pattern that does not loop ends
+     * @param wait Whether to return only once the pattern has played (ignored for loops)
+     * @return ESP_OK, or the error of the RMT driver if the channel could not be set up
+     */
+    esp_err_t playPattern(bool loop, uint8_t idleLevel, bool wait);
+
+    /**
+     * @brief Give the pin back from the RMT peripheral to the pin commands
+     *
+     * @param finish Whether to let a pattern that does not loop play to its end first; the wait
+     *               is bounded, as the caller may be a network task
+     */
+    void stopPattern(bool finish);
 };
 
 #endif // GPIO_H
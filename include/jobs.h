@@ -0,0 +1,130 @@
+// ⚡🔌 Arduino-CTL 🔌⚡
+//
+// Copyright (C) 2024 ixaxaar
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "responsestream.h"
+
+/**
+ * @brief A batch of commands queued for the executor, and its response once it has run
+ *
+ * Shared between the network handler that created it and the executor task that
+ * runs it, so it is always held through a std::shared_ptr.
+ */
+class Job
+{
+public:
+    /**
+     * @brief Constructor for Job
+     *
+     * @param storage malloc()ed block holding the input, freed with the job
+     * @param input The request message, inside storage and NUL-terminated
+     * @param length Length of the message in bytes
+     * @param msgpack Whether the message is MessagePack rather than JSON
+     */
+    Job(void *storage, char *input, size_t length, bool msgpack);
+
+    ~Job();
+
+    uint32_t id = 0;         ///< ID clients poll the job with, or 0 if it is not tracked
+    char *const input;       ///< The request message, parsed in place
+    const size_t length;     ///< Length of the message in bytes
+    const bool msgpack;      ///< Whether the message and the response are MessagePack
+    ResponseStream response; ///< The response, valid once isDone() returns true
+
+    /**
+     * @brief Check whether the job has run; response may only be read after this returns true
+     * @return true once the executor has finished the job
+     */
+    bool isDone() const { return _done.load(); }
+
+    /**
+     * @brief Wait for the job to finish
+     *
+     * Only one caller may wait on a job.
+     *
+     * @param timeoutMs Longest time to wait in milliseconds
+     * @return true if the job finished in time
+     */
+    bool wait(uint32_t timeoutMs);
+
+    /**
+     * @brief Mark the job as finished after its response has been written
+     */
+    void finish();
+
+private:
+    void *_storage;              ///< malloc()ed block holding the input
+    std::atomic<bool> _done;     ///< Whether the job has run
+    SemaphoreHandle_t _finished; ///< Given once by finish()
+
+    Job(const Job &) = delete;
+    Job &operator=(const Job &) = delete;
+};
+
+/**
+ * @brief Bounded table of jobs whose results clients fetch later
+ */
+class JobTable
+{
+public:
+    /**
+     * @brief Constructor for JobTable
+     *
+     * @param capacity Largest number of jobs tracked at the same time
+     */
+    explicit JobTable(size_t capacity);
+
+    /**
+     * @brief Start tracking a job
+     *
+     * When the table is full, the oldest finished job is dropped to make room.
+     *
+     * @param job The job, with its id set
+     * @return true if the job is tracked, false if every tracked job is still pending
+     */
+    bool add(const std::shared_ptr<Job> &job);
+
+    /**
+     * @brief Look up a tracked job
+     *
+     * @param id The ID of the job
+     * @return The job, or null if no job with that ID is tracked
+     */
+    std::shared_ptr<Job> find(uint32_t id);
+
+    /**
+     * @brief Stop tracking a job
+     * @param id The ID of the job
+     */
+    void remove(uint32_t id);
+
+private:
+    size_t _capacity;                        ///< Largest number of tracked jobs
+    std::vector<std::shared_ptr<Job>> _jobs; ///< Tracked jobs, oldest first
+    std::mutex _mutex;                       ///< Guards _jobs
+};
+
+#endif // JOBS_H
@@ -0,0 +1,122 @@
+// ⚡🔌 Arduino-CTL 🔌⚡
+//
+// Copyright (C) 2024 ixaxaar
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef JSONPOOL_H
+#define JSONPOOL_H
+
+#include <ArduinoJson.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Pool of reusable JSON documents and response buffers
+ *
+ * Each request leases one slot for the lifetime of its execution. A slot keeps
+ * its document and response buffer between requests, so steady-state traffic
+ * parses and serializes without touching the heap. Documents only grow, in
+ * power-of-two steps, which keeps long-running boards from fragmenting.
+ */
+class JsonDocumentPool
+{
+private:
+    struct Slot
+    {
+        std::unique_ptr<DynamicJsonDocument> doc; ///< Pooled document, null until first use
+        std::string text;                         ///< Pooled response buffer
+        bool busy = false;                        ///< Whether the slot is leased
+    };
+
+public:
+    /**
+     * @brief A leased document and response buffer
+     *
+     * Returns the slot to the pool when destroyed. If every slot was busy the
+     * lease owns a temporary document instead.
+     */
+    class Lease
+    {
+    public:
+        Lease(Lease &&other);
+        ~Lease();
+
+        /**
+         * @brief Get the leased document, cleared and with at least the requested capacity
+         * @return The document
+         */
+        JsonDocument &doc() { return *_doc; }
+
+        /**
+         * @brief Get the leased response buffer, empty but keeping its capacity
+         * @return The buffer
+         */
+        std::string &text() { return _slot ? _slot->text : _text; }
+
+    private:
+        friend class JsonDocumentPool;
+        Lease(JsonDocumentPool *pool, Slot *slot, DynamicJsonDocument *doc);
+        Lease(const Lease &) = delete;
+        Lease &operator=(const Lease &) = delete;
+
+        JsonDocumentPool *_pool;                    ///< Owning pool
+        Slot *_slot;                                ///< Leased slot, or null for a temporary lease
+        DynamicJsonDocument *_doc;                  ///< The document handed out
+        std::unique_ptr<DynamicJsonDocument> _temp; ///< Temporary document when no slot was free
+        std::string _text;                          ///< Temporary response buffer when no slot was free
+    };
+
+    /**
+     * @brief Constructor for JsonDocumentPool
+     *
+     * @param slots Number of requests that can hold a pooled document at the same time
+     */
+    explicit JsonDocumentPool(size_t slots);
+
+    /**
+     * @brief Lease a document with at least the given capacity
+     *
+     * @param capacity Required document capacity in bytes; 0 leases only the response buffer
+     * @return The lease
+     */
+    Lease acquire(size_t capacity);
+
+    /**
+     * @brief Estimate the document capacity needed to parse a JSON text
+     *
+     * Counts the commas and opening brackets of the text, which bounds the number
+     * of values it can contain. The estimate is an upper bound, so a document of
+     * this capacity never runs out of memory while parsing.
+     *
+     * @param json The JSON text
+     * @param length Length of the text in bytes
+     * @param zeroCopy Whether strings stay in the input buffer (mutable input) rather than being copied
+     * @return The capacity in bytes
+     */
+    static size_t capacityFor(const char *json, size_t length, bool zeroCopy);
+
+private:
+    std::vector<Slot> _slots; ///< Pooled slots
+    std::mutex _mutex;        ///< Guards the busy flags of _slots
+
+    /**
+     * @brief Return a slot to the pool
+     * @param slot The slot to release
+     */
+    void release(Slot *slot);
+};
+
+#endif // JSONPOOL_H
@@ -0,0 +1,160 @@
+// ⚡🔌 Arduino-CTL 🔌⚡
+//
+// Copyright (C) 2024 ixaxaar
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Stage of the command pipeline a duration is recorded for
+ */
+enum class Phase : uint8_t
+{
+    Parse,   ///< Parsing or validating the request document
+    Resolve, ///< Resolving commands and extracting their parameters
+    Execute, ///< Running the batch on the hardware
+    Encode,  ///< Encoding the results into the response, base64 included; streamed payloads count until the last byte is read
+    Count    ///< Number of phases
+};
+
+/**
+ * @brief Latency histogram with power-of-two microsecond buckets
+ *
+ * Recording is a count-leading-zeros and two atomic increments, cheap enough
+ * to run around every command.
+ */
+class LatencyHistogram
+{
+public:
+    static const size_t BUCKETS = 22; ///< Finite buckets, with upper bounds of 4 us to 8.4 s
+
+    LatencyHistogram();
+
+    /**
+     * @brief Record a duration
+     * @param micros The duration in microseconds
+     */
+    void record(uint32_t micros);
+
+    /**
+     * @brief Append the histogram in Prometheus text format
+     *
+     * @param out Buffer to append to
+     * @param name Metric name, without the _bucket/_sum/_count suffix
+     * @param labels Label pairs for every line, e.g. "phase=\"parse\"", or empty
+     */
+    void render(std::string &out, const char *name, const std::string &labels) const;
+
+private:
+    std::atomic<uint32_t> _counts[BUCKETS + 1]; ///< Per-bucket counts; the last bucket is +Inf
+    std::atomic<uint64_t> _sum;                 ///< Sum of the recorded durations in microseconds
+};
+
+/**
+ * @brief Counters and latency histograms of the command pipeline
+ */
+class Metrics
+{
+public:
+    Metrics();
+
+    /**
+     * @brief Allocate one histogram per command
+     *
+     * @param commands Name of each module with the names of its commands in opcode order
+     */
+    void setCommands(const std::vector<std::pair<std::string, std::vector<std::string>>> &commands);
+
+    /**
+     * @brief Record the hardware time of a command
+     *
+     * @param module Index of the module
+     * @param opcode Opcode of the command
+     * @param micros The duration in microseconds
+     */
+    void recordCommand(size_t module, uint16_t opcode, uint32_t micros);
+
+    /**
+     * @brief Record the time of a pipeline phase
+     *
+     * @param phase The phase
+     * @param micros The duration in microseconds
+     */
+    void recordPhase(Phase phase, uint32_t micros);
+
+    /**
+     * @brief Count a request and its size
+     * @param bytes Size of the request in bytes
+     */
+    void countRequest(size_t bytes);
+
+    /**
+     * @brief Count the size of a response
+     * @param bytes Size of the response in bytes
+     */
+    void countResponse(size_t bytes);
+
+    /**
+     * @brief Count a request rejected before its commands ran (parse error, bad API key)
+     */
+    void countRequestError() { _requestErrors.fetch_add(1, std::memory_order_relaxed); }
+
+    /**
+     * @brief Count executed commands and the ones that returned an error
+     *
+     * @param commands Number of commands
+     * @param errors Number of commands that returned an error
+     */
+    void countCommands(size_t commands, size_t errors);
+
+    /**
+     * @brief Append every metric in Prometheus text format
+     * @param out Buffer to append to
+     */
+    void render(std::string &out) const;
+
+    /**
+     * @brief Append a counter in Prometheus text format
+     *
+     * @param out Buffer to append to
+     * @param name Metric name
+     * @param help Description for the HELP line
+     * @param value The counter value
+     */
+    static void renderCounter(std::string &out, const char *name, const char *help, uint64_t value);
+
+private:
+    std::vector<std::string> _moduleNames;                       ///< Name of each module
+    std::vector<std::string> _commandNames;                      ///< Name of each command, flattened in module order
+    std::vector<size_t> _offsets;                                ///< Index of the first command of each module in _commandNames
+    std::unique_ptr<LatencyHistogram[]> _commands;               ///< Histogram of each command, indexed like _commandNames
+    LatencyHistogram _phases[static_cast<size_t>(Phase::Count)]; ///< Histogram of each phase
+    std::atomic<uint32_t> _requests;                             ///< Requests received
+    std::atomic<uint32_t> _requestErrors;                        ///< Requests rejected before running
+    std::atomic<uint32_t> _commandsRun;                          ///< Commands executed
+    std::atomic<uint32_t> _commandErrors;                        ///< Commands that returned an error
+    std::atomic<uint64_t> _requestBytes;                         ///< Bytes of request bodies
+    std::atomic<uint64_t> _responseBytes;                        ///< Bytes of responses
+};
+
+#endif // METRICS_H
@@ -18,17 +18,49 @@
 #define MODULE_H
 
 #include <Arduino.h>
+#include <functional>
 #include <vector>
+#include <string>
+#include "nameindex.h"
+#include "result.h"
+
+struct ParamError;
 
 /**
  * @brief Struct to hold information about a function
  *
- * This struct contains the name of a function and its parameters.
+ * This struct contains the name of a function, its parameters and the kind of result it produces.
  */
 struct FunctionInfo
 {
     std::string name;                                        ///< Name of the function
     std::vector<std::pair<std::string, std::string>> params; ///< Vector of parameter name-type pairs
+    bool cacheable;                                          ///< Whether the function only reads hardware, so its results may be cached
+    ResultType result;                                       ///< Kind of value the function writes on success
+
+    /**
+     * @brief Check parameter values against the function's schema without running it
+     *
+     * Empty for functions that take no parameters.
+     */
+    std::function<bool(const std::vector<std::pair<std::string, std::string>> &, ParamError &)> check;
+};
+
+/**
+ * @brief Hardware resource a module drives
+ *
+ * Commands on different resources may run concurrently; commands on the same
+ * resource always run one at a time, in request order.
+ */
+enum class BusResource : uint8_t
+{
+    General, ///< Not tied to a bus; runs on the batch executor
+    Gpio,    ///< Digital pins
+    Adc,     ///< Analog inputs and PWM outputs
+    I2c,     ///< The I2C bus
+    Spi,     ///< The SPI bus
+    I2s,     ///< The I2S peripheral
+    Count    ///< Number of resources
 };
 
 /**
@@ -51,23 +83,92 @@ public:
     virtual void deinit() = 0;
 
     /**
-     * @brief Execute a command on the module
+     * @brief Execute a command on the module by name
+     *
+     * Resolves the command through the opcode table and dispatches it.
+     *
      * @param command The command to execute
      * @param params Vector of parameter name-value pairs for the command
-     * @return A pair containing the return type as a string and a void pointer to the return value
+     * @param result Sink the command writes its result into
+     */
+    void execute(const std::string &command, const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result);
+
+    /**
+     * @brief Execute a command on the module by opcode
+     * @param opcode The opcode of the command, i.e. its index in getSupportedFunctions()
+     * @param params Vector of parameter name-value pairs for the command
+     * @param result Sink the command writes its result into
+     */
+    virtual void dispatch(uint16_t opcode, const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result) = 0;
+
+    /**
+     * @brief Execute a fire-and-forget command with packed integer arguments
+     *
+     * Used by the UDP fast path, which bypasses parameter parsing and produces no
+     * result. Modules override this for the commands that have a packed form.
+     *
+     * @param opcode The opcode of the command
+     * @param args The integer arguments of the command
+     * @param count Number of arguments
+     * @return true if the command has a packed form and was executed
      */
-    virtual std::pair<std::string, void *> execute(const std::string &command, const std::vector<std::pair<std::string, std::string>> &params) = 0;
+    virtual bool dispatchPacked(uint16_t /*opcode*/, const int32_t * /*args*/, size_t /*count*/) { return false; }
 
     /**
      * @brief Get information about the functions supported by this module
+     *
+     * The position of each entry is the opcode of that function.
+     *
      * @return Vector of FunctionInfo structs describing the supported functions
      */
     virtual std::vector<FunctionInfo> getSupportedFunctions() = 0;
 
+    /**
+     * @brief Get the hardware resource this module drives
+     *
+     * @return The resource, which selects the executor the module's commands run on
+     */
+    virtual BusResource resource() const { return BusResource::General; }
+
+    /**
+     * @brief Build the command name to opcode table from getSupportedFunctions()
+     *
+     * Called by the server once registration finishes; opcodeOf() builds it on first use otherwise.
+     */
+    void buildOpcodeTable();
+
+    /**
+     * @brief Resolve a command name to its opcode
+     * @param command Pointer to the command name characters
+     * @param length Length of the command name in bytes
+     * @return The opcode, or INVALID_OPCODE if the module does not support the command
+     */
+    uint16_t opcodeOf(const char *command, size_t length);
+
+    /**
+     * @brief Resolve a command name to its opcode
+     * @param command The command name
+     * @return The opcode, or INVALID_OPCODE if the module does not support the command
+     */
+    uint16_t opcodeOf(const std::string &command) { return opcodeOf(command.data(), command.size()); }
+
+    /**
+     * @brief Resolve a NUL-terminated command name to its opcode
+     * @param command The command name
+     * @return The opcode, or INVALID_OPCODE if the module does not support the command
+     */
+    uint16_t opcodeOf(const char *command) { return opcodeOf(command, strlen(command)); }
+
+    static const uint16_t INVALID_OPCODE = 0xFFFF; ///< Returned by opcodeOf() for unknown commands
+
     /**
      * @brief Virtual destructor
      */
     virtual ~ModuleInterface() {}
+
+private:
+    NameIndex _opcodes;         ///< Command name to opcode table
+    bool _opcodesBuilt = false; ///< Whether _opcodes has been built
 };
 
 #endif // MODULE_H
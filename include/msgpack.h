@@ -0,0 +1,280 @@
+// ⚡🔌 Arduino-CTL 🔌⚡
+//
+// Copyright (C) 2024 ixaxaar
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MSGPACK_H
+#define MSGPACK_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Kind of the next value in a MessagePack stream
+ */
+enum class MsgPackType : uint8_t
+{
+    Nil,
+    Bool,
+    Int,
+    Float,
+    String,
+    Binary,
+    Array,
+    Map,
+    Invalid ///< Extension types, reserved bytes and truncated input
+};
+
+/**
+ * @brief Minimal MessagePack encoder appending to a byte buffer
+ *
+ * Integers are written in their shortest encoding, as the format recommends.
+ */
+class MsgPackWriter
+{
+public:
+    /**
+     * @brief Constructor for MsgPackWriter
+     *
+     * @param out The buffer to append the encoded values to
+     */
+    explicit MsgPackWriter(std::string &out);
+
+    /**
+     * @brief Write a map header; the entries follow as key, value, key, value...
+     * @param size Number of key-value pairs
+     */
+    void writeMap(uint32_t size);
+
+    /**
+     * @brief Write an array header; the elements follow
+     * @param size Number of elements
+     */
+    void writeArray(uint32_t size);
+
+    /**
+     * @brief Write a string
+     *
+     * @param value Pointer to the UTF-8 characters
+     * @param length Length in bytes
+     */
+    void writeString(const char *value, size_t length);
+
+    /**
+     * @brief Write a NUL-terminated string
+     * @param value The string
+     */
+    void writeString(const char *value) { writeString(value, strlen(value)); }
+
+    /**
+     * @brief Write a raw byte payload
+     *
+     * @param data Pointer to the bytes
+     * @param length Number of bytes
+     */
+    void writeBinary(const uint8_t *data, size_t length);
+
+    /**
+     * @brief Write the header of a raw byte payload, for payloads appended separately
+     * @param length Number of bytes that follow
+     */
+    void writeBinaryHeader(size_t length);
+
+    /**
+     * @brief Write a signed integer
+     * @param value The value
+     */
+    void writeInt(int64_t value);
+
+    /**
+     * @brief Write a boolean
+     * @param value The value
+     */
+    void writeBool(bool value);
+
+    /**
+     * @brief Write nil
+     */
+    void writeNil();
+
+private:
+    std::string &_out; ///< Buffer receiving the encoded values
+
+    /**
+     * @brief Append a type byte followed by a big-endian length or value
+     *
+     * @param type The type byte
+     * @param value The value to append after the type byte
+     * @param bytes Number of bytes of value to append (0, 1, 2, 4 or 8)
+     */
+    void writeHeader(uint8_t type, uint64_t value, int bytes);
+};
+
+/**
+ * @brief Minimal MessagePack decoder reading from a byte buffer
+ *
+ * Strings and binary payloads are returned as pointers into the input, so
+ * reading never allocates. A reader is a small value: copying it saves the
+ * current position.
+ */
+class MsgPackReader
+{
+public:
+    /**
+     * @brief Constructor for MsgPackReader
+     *
+     * @param data The encoded input, which must outlive the reader
+     * @param length Length of the input in bytes
+     */
+    MsgPackReader(const uint8_t *data, size_t length);
+
+    /**
+     * @brief Get the kind of the next value without consuming it
+     * @return The type of the next value
+     */
+    MsgPackType peek() const;
+
+    /**
+     * @brief Check whether the whole input has been consumed
+     * @return true at the end of the input
+     */
+    bool atEnd() const { return _position >= _length; }
+
+    /**
+     * @brief Get a pointer to the next value in the input
+     *
+     * The bytes between two positions are the raw encoding of the values read in between.
+     *
+     * @return Pointer to the next value
+     */
+    const uint8_t *position() const { return _data + _position; }
+
+    /**
+     * @brief Read a map header
+     * @param size Receives the number of key-value pairs
+     * @return true on success, false if the next value is not a map
+     */
+    bool readMap(uint32_t &size);
+
+    /**
+     * @brief Read an array header
+     * @param size Receives the number of elements
+     * @return true on success, false if the next value is not an array
+     */
+    bool readArray(uint32_t &size);
+
+    /**
+     * @brief Read a string
+     *
+     * @param value Receives a pointer to the characters inside the input (not NUL-terminated)
+     * @param length Receives the length in bytes
+     * @return true on success, false if the next value is not a string
+     */
+    bool readString(const char *&value, size_t &length);
+
+    /**
+     * @brief Read a binary payload
+     *
+     * @param data Receives a pointer to the bytes inside the input
+     * @param length Receives the number of bytes
+     * @return true on success, false if the next value is not binary
+     */
+    bool readBinary(const uint8_t *&data, size_t &length);
+
+    /**
+     * @brief Read a signed or unsigned integer
+     * @param value Receives the value
+     * @return true on success, false if the next value is not an integer representable as int64_t
+     */
+    bool readInt(int64_t &value);
+
+    /**
+     * @brief Read a float32 or float64
+     * @param value Receives the value
+     * @return true on success, false if the next value is not a float
+     */
+    bool readFloat(double &value);
+
+    /**
+     * @brief Read a boolean
+     * @param value Receives the value
+     * @return true on success, false if the next value is not a boolean
+     */
+    bool readBool(bool &value);
+
+    /**
+     * @brief Read nil
+     * @return true on success, false if the next value is not nil
+     */
+    bool readNil();
+
+    /**
+     * @brief Skip the next value, including everything nested in it
+     *
+     * Skipping the root value of a document validates its structure.
+     *
+     * @return true on success, false on truncated or unsupported input
+     */
+    bool skip();
+
+private:
+    const uint8_t *_data; ///< Encoded input
+    size_t _length;       ///< Length of the input in bytes
+    size_t _position;     ///< Offset of the next value
+
+    /**
+     * @brief Read a big-endian unsigned value following the type byte
+     *
+     * @param bytes Number of bytes to read (1, 2, 4 or 8)
+     * @param value Receives the value
+     * @return true on success, false on truncated input
+     */
+    bool readBigEndian(int bytes, uint64_t &value);
+
+    /**
+     * @brief Read the length of a string, binary or extension payload and check it fits the input
+     *
+     * @param lengthBytes Number of bytes of the length field (0 for fixed-size types)
+     * @param fixedLength Length for fixed-size types
+     * @param length Receives the payload length
+     * @return true on success, false on truncated input
+     */
+    bool readPayloadLength(int lengthBytes, size_t fixedLength, size_t &length);
+
+    /**
+     * @brief Skip the next value, refusing to recurse deeper than a fixed limit
+     *
+     * @param depth Current nesting depth
+     * @return true on success, false on truncated, unsupported or too deeply nested input
+     */
+    bool skip(int depth);
+};
+
+/**
+ * @brief Read a MessagePack params map into the name-value pairs modules take
+ *
+ * Values are converted to the same text the JSON endpoint would pass for the
+ * equivalent JSON value; binary payloads are base64-encoded, which is what the
+ * modules' byte parameters expect.
+ *
+ * @param reader Reader positioned at the params map
+ * @param params Receives the name-value pairs (cleared first)
+ * @return true on success, false if the value is not a map of scalar values
+ */
+bool readMsgPackParams(MsgPackReader &reader, std::vector<std::pair<std::string, std::string>> &params);
+
+#endif // MSGPACK_H
@@ -0,0 +1,108 @@
+// ⚡🔌 Arduino-CTL 🔌⚡
+//
+// Copyright (C) 2024 ixaxaar
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAMEINDEX_H
+#define NAMEINDEX_H
+
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Perfect-hash lookup table from names to dense indices
+ *
+ * The table is built once from a fixed set of names (module names, command
+ * names) by searching for a hash seed under which no two names share a slot.
+ * A lookup is then a single hash, one slot load and one string compare. If no
+ * seed separates the names, lookups fall back to a linear search.
+ */
+class NameIndex
+{
+public:
+    /**
+     * @brief Constructor for NameIndex
+     *
+     * Creates an empty index in which every lookup fails.
+     */
+    NameIndex();
+
+    /**
+     * @brief Build the index from a list of names
+     *
+     * @param names The names to index; a name's index is its position in this vector
+     * @return true if a perfect hash was found, false if lookups fall back to a linear search
+     */
+    bool build(const std::vector<std::string> &names);
+
+    /**
+     * @brief Look up a name
+     *
+     * @param name Pointer to the name characters
+     * @param length Length of the name in bytes
+     * @return The index of the name, or -1 if it is not in the table
+     */
+    int find(const char *name, size_t length) const;
+
+    /**
+     * @brief Look up a NUL-terminated name
+     *
+     * @param name The name to look up
+     * @return The index of the name, or -1 if it is not in the table
+     */
+    int find(const char *name) const { return find(name, strlen(name)); }
+
+    /**
+     * @brief Look up a name
+     *
+     * @param name The name to look up
+     * @return The index of the name, or -1 if it is not in the table
+     */
+    int find(const std::string &name) const { return find(name.data(), name.size()); }
+
+    /**
+     * @brief Get the number of indexed names
+     * @return Number of names
+     */
+    size_t size() const { return _names.size(); }
+
+    /**
+     * @brief Get the name stored at an index
+     *
+     * @param index The index returned by find()
+     * @return The name
+     */
+    const std::string &name(size_t index) const { return _names[index]; }
+
+private:
+    uint32_t _seed;                  ///< Seed under which all names hash to distinct slots
+    uint32_t _mask;                  ///< Slot count minus one (slot count is a power of two)
+    std::vector<int16_t> _slots;     ///< Slot to name index, -1 for empty slots
+    std::vector<std::string> _names; ///< Indexed names
+    bool _linear;                    ///< Whether lookups search _names because no seed was found
+
+    /**
+     * @brief Seeded FNV-1a hash with a final avalanche step
+     *
+     * @param name Pointer to the name characters
+     * @param length Length of the name in bytes
+     * @param seed The hash seed
+     * @return The 32-bit hash
+     */
+    static uint32_t hash(const char *name, size_t length, uint32_t seed);
+};
+
+#endif // NAMEINDEX_H
@@ -0,0 +1,247 @@
+// ⚡🔌 Arduino-CTL 🔌⚡
+//
+// Copyright (C) 2024 ixaxaar
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PARAMS_H
+#define PARAMS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <limits>
+#include <string>
+#include <vector>
+#include "module.h"
+#include "result.h"
+
+/**
+ * @brief Parse a decimal integer without throwing, in the manner of std::from_chars
+ *
+ * The whole range must be an optional '-' followed by digits; no whitespace,
+ * sign '+', base prefix or trailing characters are accepted.
+ *
+ * @param first Pointer to the first character
+ * @param last Pointer past the last character
+ * @param value Receives the value
+ * @return true on success, false on malformed input or overflow of int64_t
+ */
+bool parseInteger(const char *first, const char *last, int64_t &value);
+
+/**
+ * @brief Why binding a parameter failed
+ */
+struct ParamError
+{
+    const char *param;   ///< Name of the offending parameter, or null
+    const char *message; ///< What is wrong with it, or null if nothing is
+};
+
+/**
+ * @brief Declaration of one parameter of a command, bound into a field of the command's Params struct
+ *
+ * Build entries with integerParam() and textParam(). A command's parameters are
+ * a constexpr array of specs: the same array binds requests (bindParams()) and
+ * describes the command (describeCommand()), so the two cannot drift apart.
+ */
+template <typename Params>
+struct ParamSpec
+{
+    const char *name; ///< Parameter name in requests
+    const char *type; ///< Type reported by getSupportedFunctions(), e.g. "uint8_t"
+    int64_t min;      ///< Smallest accepted value of integer parameters
+    int64_t max;      ///< Largest accepted value of integer parameters
+
+    /**
+     * @brief Parse a value into its field
+     * @return An error message, or null on success
+     */
+    const char *(*bind)(const ParamSpec &spec, Params &params, const std::string &value);
+};
+
+/**
+ * @brief Smallest value of an integer type, as int64_t
+ */
+template <typename T>
+constexpr int64_t minOf()
+{
+    return static_cast<int64_t>(std::numeric_limits<T>::min());
+}
+
+/**
+ * @brief Largest value of an integer type, clamped to int64_t
+ */
+template <typename T>
+constexpr int64_t maxOf()
+{
+    return static_cast<uint64_t>(std::numeric_limits<T>::max()) > static_cast<uint64_t>(std::numeric_limits<int64_t>::max())
+               ? std::numeric_limits<int64_t>::max()
+               : static_cast<int64_t>(std::numeric_limits<T>::max());
+}
+
+template <typename Params, typename T, T Params::*Member>
+const char *bindInteger(const ParamSpec<Params> &spec, Params &params, const std::string &value)
+{
+    int64_t number;
+    if (!parseInteger(value.data(), value.data() + value.size(), number))
+    {
+        return "Invalid integer";
+    }
+    if (number < spec.min || number > spec.max)
+    {
+        return "Out of range";
+    }
+    params.*Member = static_cast<T>(number);
+    return nullptr;
+}
+
+template <typename Params, const std::string *Params::*Member>
+const char *bindText(const ParamSpec<Params> & /*spec*/, Params &params, const std::string &value)
+{
+    params.*Member = &value;
+    return nullptr;
+}
+
+/**
+ * @brief Declare an integer parameter
+ *
+ * Values outside [min, max] are rejected instead of wrapping into the field.
+ *
+ * @tparam Params The command's parameter struct
+ * @tparam T Type of the field
+ * @tparam Member The field
+ * @param name Parameter name in requests
+ * @param type Type name reported to clients
+ * @param min Smallest accepted value; defaults to the smallest value of T
+ * @param max Largest accepted value; defaults to the largest value of T
+ */
+template <typename Params, typename T, T Params::*Member>
+constexpr ParamSpec<Params> integerParam(const char *name, const char *type, int64_t min = minOf<T>(), int64_t max = maxOf<T>())
+{
+    return ParamSpec<Params>{name, type, min, max, &bindInteger<Params, T, Member>};
+}
+
+/**
+ * @brief Declare a parameter the handler interprets itself, such as a base64 payload
+ *
+ * The field receives a pointer to the value in the request, which stays valid
+ * while the command runs; it is left untouched when the parameter is absent.
+ *
+ * @tparam Params The command's parameter struct
+ * @tparam Member The field
+ * @param name Parameter name in requests
+ * @param type Type name reported to clients
+ */
+template <typename Params, const std::string *Params::*Member>
+constexpr ParamSpec<Params> textParam(const char *name, const char *type)
+{
+    return ParamSpec<Params>{name, type, 0, 0, &bindText<Params, Member>};
+}
+
+/**
+ * @brief Bind the parameters of a request to a command's Params struct in one pass
+ *
+ * Parameters the schema does not declare are ignored, and fields of absent
+ * parameters keep their values. Every valid parameter is bound even when
+ * another one is not; the first failure is reported.
+ *
+ * @param specs The command's parameter schema
+ * @param values Name-value pairs of the request
+ * @param params The struct to fill
+ * @param error Receives the first failure
+ * @return true if every declared parameter present was valid
+ */
+template <typename Params, size_t N>
+bool bindParams(const ParamSpec<Params> (&specs)[N], const std::vector<std::pair<std::string, std::string>> &values, Params &params, ParamError &error)
+{
+    error = ParamError{nullptr, nullptr};
+    for (const auto &value : values)
+    {
+        for (const ParamSpec<Params> &spec : specs)
+        {
+            if (value.first == spec.name)
+            {
+                const char *message = spec.bind(spec, params, value.second);
+                if (message != nullptr && error.message == nullptr)
+                {
+                    error = ParamError{spec.name, message};
+                }
+                break;
+            }
+        }
+    }
+    return error.message == nullptr;
+}
+
+/**
+ * @brief Bind the parameters of a command, reporting a failure as its result
+ *
+ * @param specs The command's parameter schema
+ * @param values Name-value pairs of the request
+ * @param params The struct to fill
+ * @param result Receives the error, naming the offending parameter, on failure
+ * @return true if the command may run
+ */
+template <typename Params, size_t N>
+bool bindParams(const ParamSpec<Params> (&specs)[N], const std::vector<std::pair<std::string, std::string>> &values, Params &params, ResultSink &result)
+{
+    ParamError error;
+    if (bindParams(specs, values, params, error))
+    {
+        return true;
+    }
+    result.setError(error.message, error.param);
+    return false;
+}
+
+/**
+ * @brief Describe a command for getSupportedFunctions() from its parameter schema
+ *
+ * The description's check() binds values through the same schema, so stored
+ * programs are validated exactly as the command would bind them.
+ *
+ * @param name Command name
+ * @param specs The command's parameter schema
+ * @param result Kind of value the command writes on success
+ * @param cacheable Whether the command only reads hardware
+ * @return The description
+ */
+template <typename Params, size_t N>
+FunctionInfo describeCommand(const char *name, const ParamSpec<Params> (&specs)[N], ResultType result = ResultType::None, bool cacheable = false)
+{
+    FunctionInfo info{name, {}, cacheable, result, [&specs](const std::vector<std::pair<std::string, std::string>> &values, ParamError &error)
+                      {
+                          Params params{};
+                          return bindParams(specs, values, params, error);
+                      }};
+    for (const ParamSpec<Params> &spec : specs)
+    {
+        info.params.emplace_back(spec.name, spec.type);
+    }
+    return info;
+}
+
+/**
+ * @brief Describe a command that takes no parameters
+ *
+ * @param name Command name
+ * @param result Kind of value the command writes on success
+ * @param cacheable Whether the command only reads hardware
+ * @return The description
+ */
+inline FunctionInfo describeCommand(const char *name, ResultType result = ResultType::None, bool cacheable = false)
+{
+    return FunctionInfo{name, {}, cacheable, result, nullptr};
+}
+
+#endif // PARAMS_H
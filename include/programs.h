@@ -0,0 +1,106 @@
+// ⚡🔌 Arduino-CTL 🔌⚡
+//
+// Copyright (C) 2024 ixaxaar
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PROGRAMS_H
+#define PROGRAMS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief A pre-resolved command of a stored program
+ *
+ * Parameter values that start with '$' are placeholders, filled from the
+ * arguments of each invocation.
+ */
+struct ProgramStep
+{
+    std::string moduleName;                                  ///< Name of the module, to resolve the step again when the registry is rebuilt
+    std::string commandName;                                 ///< Name of the command on that module
+    int module;                                              ///< Index of the module in the server's registry
+    uint16_t opcode;                                         ///< Opcode of the command on that module
+    uint32_t cacheMs;                                        ///< How long a cacheable result may be reused, 0 to always run
+    std::vector<std::pair<std::string, std::string>> params; ///< Parameter name-value pairs, placeholders included
+    std::vector<std::pair<size_t, std::string>> bindings;    ///< Index into params and argument name of each placeholder
+
+    /**
+     * @brief Produce the parameters of one invocation
+     *
+     * @param args Argument name-value pairs of the invocation, names without the '$'
+     * @param out Receives the parameters with placeholders replaced
+     * @return The name of an argument the invocation is missing, or null on success
+     */
+    const char *bind(const std::vector<std::pair<std::string, std::string>> &args, std::vector<std::pair<std::string, std::string>> &out) const;
+};
+
+/**
+ * @brief Bounded store of compiled programs
+ */
+class ProgramStore
+{
+public:
+    /**
+     * @brief Constructor for ProgramStore
+     *
+     * @param capacity Largest number of programs stored at the same time
+     */
+    explicit ProgramStore(size_t capacity);
+
+    /**
+     * @brief Store a program
+     *
+     * @param steps The compiled commands of the program, in order
+     * @return The ID of the program, or 0 if the store is full
+     */
+    uint32_t add(std::vector<ProgramStep> steps);
+
+    /**
+     * @brief Look up a program
+     *
+     * @param id The ID of the program
+     * @return The steps of the program, or null if no program has that ID
+     */
+    const std::vector<ProgramStep> *find(uint32_t id) const;
+
+    /**
+     * @brief Delete a program
+     *
+     * @param id The ID of the program
+     * @return true if the program existed
+     */
+    bool remove(uint32_t id);
+
+    /**
+     * @brief Resolve the steps of every program again, after the registry is rebuilt
+     *
+     * Programs with a step that no longer resolves are deleted.
+     *
+     * @param resolveStep Updates the module and opcode of a step from its names, returning false if they are gone
+     * @return Number of programs deleted
+     */
+    size_t resolve(const std::function<bool(ProgramStep &)> &resolveStep);
+
+private:
+    size_t _capacity;                                                     ///< Largest number of stored programs
+    uint32_t _nextId;                                                     ///< ID of the next stored program
+    std::vector<std::pair<uint32_t, std::vector<ProgramStep>>> _programs; ///< Stored programs by ID
+};
+
+#endif // PROGRAMS_H
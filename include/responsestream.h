@@ -0,0 +1,110 @@
+// ⚡🔌 Arduino-CTL 🔌⚡
+//
+// Copyright (C) 2024 ixaxaar
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RESPONSESTREAM_H
+#define RESPONSESTREAM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include "result.h"
+
+/**
+ * @brief A response whose large byte payloads are encoded as they are sent
+ *
+ * The response is kept as text with the payloads left out, plus the result
+ * sinks holding them. Sinks are taken over by swapping, so a payload stays in
+ * the buffer the module wrote it into, and read() encodes it (as base64 or raw
+ * bytes) straight into the network buffer. Beyond the payloads themselves, a
+ * response never needs more than its small text part.
+ */
+class ResponseStream
+{
+public:
+    std::string text;           ///< The response without the spliced payloads
+    uint32_t encodeMicros = 0;  ///< Time spent encoding the response so far, in microseconds
+    bool encodePending = false; ///< Whether encodeMicros is still to be recorded, once the response has been read out
+
+    /**
+     * @brief Empty the response, releasing the spliced sinks
+     */
+    void clear();
+
+    /**
+     * @brief Append a byte result as JSON, taking over its sink instead of copying the bytes
+     * @param result The result; left holding an empty sink
+     */
+    void spliceJson(ResultSink &result);
+
+    /**
+     * @brief Append a byte result as MessagePack, taking over its sink instead of copying the bytes
+     * @param result The result; left holding an empty sink
+     */
+    void spliceMsgPack(ResultSink &result);
+
+    /**
+     * @brief Get the length of the whole response
+     * @return Bytes of text plus encoded payloads
+     */
+    size_t size() const;
+
+    /**
+     * @brief Copy a window of the response, encoding payloads on the fly
+     *
+     * @param position Offset of the window in the response
+     * @param out Buffer receiving the bytes
+     * @param maxLen Size of the buffer
+     * @return Number of bytes copied, 0 at the end of the response
+     */
+    size_t read(size_t position, uint8_t *out, size_t maxLen) const;
+
+private:
+    struct Payload
+    {
+        size_t offset;     ///< Position in text the payload goes before
+        bool base64;       ///< Whether the payload is sent as base64 rather than raw bytes
+        ResultSink result; ///< Sink holding the payload bytes
+
+        /**
+         * @brief Get the length of the payload as sent
+         * @return Number of bytes or base64 characters
+         */
+        size_t length() const;
+
+        /**
+         * @brief Copy part of the payload as sent
+         *
+         * @param position Offset in the payload as sent
+         * @param out Buffer receiving the bytes
+         * @param count Number of bytes to copy, at most length() - position
+         */
+        void read(size_t position, uint8_t *out, size_t count) const;
+    };
+
+    std::vector<Payload> _payloads; ///< Spliced payloads, in text order
+
+    /**
+     * @brief Take over a sink as the payload at the current end of the text
+     *
+     * @param result The sink to take over
+     * @param base64 Whether the payload is sent as base64
+     * @return The payload, holding the sink
+     */
+    Payload &splice(ResultSink &result, bool base64);
+};
+
+#endif // RESPONSESTREAM_H
@@ -0,0 +1,254 @@
+// ⚡🔌 Arduino-CTL 🔌⚡
+//
+// Copyright (C) 2024 ixaxaar
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RESULT_H
+#define RESULT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Kind of value held by a ResultSink
+ */
+enum class ResultType : uint8_t
+{
+    None,  ///< The command produced no value
+    Int,   ///< A single integer
+    Bytes, ///< A byte buffer (raw bytes or packed samples)
+    Error  ///< The command failed; an error message is set
+};
+
+/**
+ * @brief Typed result channel that modules write command results into
+ *
+ * A sink is owned by the caller and reused across commands. Byte results are
+ * written in place into a buffer whose capacity is kept between commands, so
+ * a warmed-up sink executes commands without any heap allocation.
+ */
+class ResultSink
+{
+public:
+    /**
+     * @brief Constructor for ResultSink
+     *
+     * Creates an empty sink holding no value.
+     */
+    ResultSink();
+
+    /**
+     * @brief Reset the sink to hold no value, keeping the byte buffer capacity
+     */
+    void clear();
+
+    /**
+     * @brief Store an integer result
+     * @param value The value
+     */
+    void setInt(int value);
+
+    /**
+     * @brief Store an error result
+     * @param message The error message; must outlive the sink (normally a string literal)
+     * @param param Name of the parameter at fault, reported next to the message, or null; must outlive the sink
+     */
+    void setError(const char *message, const char *param = nullptr);
+
+    /**
+     * @brief Store a byte result and get a buffer to write it into
+     *
+     * @param size The number of bytes the command will write
+     * @return Pointer to a buffer of at least size bytes, valid until the next call on the sink
+     */
+    uint8_t *allocBytes(size_t size);
+
+    /**
+     * @brief Shrink a byte result after a short read
+     * @param size The number of bytes actually written, at most the size passed to allocBytes()
+     */
+    void setSize(size_t size);
+
+    /**
+     * @brief Describe how the samples of a byte result are encoded
+     *
+     * Reported next to the data, so clients can decode packed formats. Cleared
+     * by allocBytes(); results without a format are plain bytes or native ints.
+     *
+     * @param format Name of the encoding; must outlive the sink (normally a string literal)
+     * @param count Number of samples encoded in the bytes
+     */
+    void setFormat(const char *format, size_t count);
+
+    /**
+     * @brief Timestamp a byte result with the time of its first sample
+     *
+     * Reported as "start" next to the data. Cleared by allocBytes().
+     *
+     * @param micros Time of the first sample on the esp_timer clock, in microseconds
+     */
+    void setStartTime(int64_t micros);
+
+    /**
+     * @brief Report the delay between the samples of adjacent channels of a multi-channel result
+     *
+     * Reported as "skewNs" next to the data when non-zero. Cleared by allocBytes().
+     *
+     * @param nanos The delay in nanoseconds
+     */
+    void setSkew(uint32_t nanos);
+
+    /**
+     * @brief Get the kind of value held
+     * @return The result type
+     */
+    ResultType type() const { return _type; }
+
+    /**
+     * @brief Get the integer result
+     * @return The value passed to setInt()
+     */
+    int intValue() const { return _int; }
+
+    /**
+     * @brief Get the error message
+     * @return The message passed to setError()
+     */
+    const char *error() const { return _error; }
+
+    /**
+     * @brief Get the parameter an error is about
+     * @return The param passed to setError(), or null
+     */
+    const char *errorParam() const { return _errorParam; }
+
+    /**
+     * @brief Get the byte result
+     * @return Pointer to the bytes written after allocBytes()
+     */
+    const uint8_t *data() const { return _bytes.data(); }
+
+    /**
+     * @brief Get the size of the byte result
+     * @return Number of valid bytes
+     */
+    size_t size() const { return _size; }
+
+    /**
+     * @brief Get the encoding of the byte result
+     * @return The format passed to setFormat(), or null
+     */
+    const char *format() const { return _format; }
+
+    /**
+     * @brief Get the number of samples in the byte result
+     * @return The count passed to setFormat()
+     */
+    size_t count() const { return _count; }
+
+    /**
+     * @brief Check whether the byte result carries a start time
+     * @return true after setStartTime()
+     */
+    bool timed() const { return _timed; }
+
+    /**
+     * @brief Get the time of the first sample of the byte result
+     * @return The time passed to setStartTime()
+     */
+    int64_t startTime() const { return _start; }
+
+    /**
+     * @brief Get the channel-to-channel skew of the byte result
+     * @return The skew passed to setSkew(), or 0
+     */
+    uint32_t skew() const { return _skew; }
+
+    /**
+     * @brief Append the result as a JSON object to a response buffer
+     *
+     * Byte results are base64-encoded directly into the buffer, followed by
+     * "format" and "count" when the result has a format, "start" when it is
+     * timed and "skewNs" when it has a skew.
+     *
+     * @param out The response buffer to append to
+     */
+    void appendJson(std::string &out) const;
+
+    /**
+     * @brief Append the result as a MessagePack map to a response buffer
+     *
+     * Byte results are written as a raw binary payload, without base64,
+     * followed by "format" and "count" when the result has a format, "start"
+     * when it is timed and "skewNs" when it has a skew.
+     *
+     * @param out The response buffer to append to
+     */
+    void appendMsgPack(std::string &out) const;
+
+    /**
+     * @brief Append the JSON of a byte result up to its base64 payload
+     *
+     * The head, the base64 of data() and the tail make up what appendJson()
+     * writes; streamed responses write the payload separately.
+     *
+     * @param out The response buffer to append to
+     */
+    void appendJsonHead(std::string &out) const;
+
+    /**
+     * @brief Append the JSON of a byte result that follows its base64 payload
+     * @param out The response buffer to append to
+     */
+    void appendJsonTail(std::string &out) const;
+
+    /**
+     * @brief Append the MessagePack of a byte result up to its binary payload
+     *
+     * The head, the raw bytes of data() and the tail make up what appendMsgPack()
+     * writes; streamed responses write the payload separately.
+     *
+     * @param out The response buffer to append to
+     */
+    void appendMsgPackHead(std::string &out) const;
+
+    /**
+     * @brief Append the MessagePack of a byte result that follows its binary payload
+     * @param out The response buffer to append to
+     */
+    void appendMsgPackTail(std::string &out) const;
+
+    /**
+     * @brief Exchange the contents of two sinks, byte buffers included, without copying
+     * @param other The other sink
+     */
+    void swap(ResultSink &other);
+
+private:
+    ResultType _type;            ///< Kind of value held
+    int _int;                    ///< Integer result
+    const char *_error;          ///< Error message
+    const char *_errorParam;     ///< Parameter the error is about, or null
+    std::vector<uint8_t> _bytes; ///< Byte buffer, grown but never shrunk
+    size_t _size;                ///< Number of valid bytes in _bytes
+    const char *_format;         ///< Encoding of the byte result, or null
+    size_t _count;               ///< Number of samples in the byte result
+    bool _timed;                 ///< Whether _start is set
+    int64_t _start;              ///< Time of the first sample in microseconds
+    uint32_t _skew;              ///< Delay between adjacent channels in nanoseconds, or 0
+};
+
+#endif // RESULT_H
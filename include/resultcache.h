@@ -0,0 +1,123 @@
+// ⚡🔌 Arduino-CTL 🔌⚡
+//
+// Copyright (C) 2024 ixaxaar
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RESULTCACHE_H
+#define RESULTCACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "result.h"
+
+/**
+ * @brief Short-lived cache of read results, keyed on module, opcode and parameters
+ *
+ * Commands on one bus run one at a time, so identical reads arriving together
+ * are served by the first one's hardware access. Entries expire after the TTL
+ * the request asks for; any non-cacheable command on a module drops that
+ * module's entries, since it may have changed what a read would return.
+ */
+class ResultCache
+{
+public:
+    /**
+     * @brief Constructor for ResultCache
+     *
+     * @param capacity Largest number of cached results
+     */
+    explicit ResultCache(size_t capacity);
+
+    /**
+     * @brief Look up a fresh result
+     *
+     * @param module Index of the module
+     * @param opcode Opcode of the command
+     * @param params Parameter name-value pairs of the command
+     * @param now Current time in milliseconds
+     * @param result Receives the cached result on a hit
+     * @return true on a hit
+     */
+    bool lookup(int module, uint16_t opcode, const std::vector<std::pair<std::string, std::string>> &params, uint32_t now, ResultSink &result);
+
+    /**
+     * @brief Cache a result; errors are not cached
+     *
+     * @param module Index of the module
+     * @param opcode Opcode of the command
+     * @param params Parameter name-value pairs of the command
+     * @param now Current time in milliseconds
+     * @param ttl How long the result stays fresh, in milliseconds
+     * @param result The result to cache
+     */
+    void store(int module, uint16_t opcode, const std::vector<std::pair<std::string, std::string>> &params, uint32_t now, uint32_t ttl, const ResultSink &result);
+
+    /**
+     * @brief Drop every cached result of a module
+     * @param module Index of the module
+     */
+    void invalidate(int module);
+
+    /**
+     * @brief Get the number of lookups served from the cache
+     * @return The hit count
+     */
+    uint32_t hits() const { return _hits; }
+
+    /**
+     * @brief Get the number of lookups that went to the hardware
+     * @return The miss count
+     */
+    uint32_t misses() const { return _misses; }
+
+private:
+    struct Entry
+    {
+        bool valid = false;                                      ///< Whether the entry holds a result
+        int module = -1;                                         ///< Index of the module
+        uint16_t opcode = 0;                                     ///< Opcode of the command
+        uint32_t hash = 0;                                       ///< Hash of the key, checked before the parameters
+        uint32_t expires = 0;                                    ///< Time the result goes stale, in milliseconds
+        std::vector<std::pair<std::string, std::string>> params; ///< Parameters of the command
+        ResultType type = ResultType::None;                      ///< Kind of the cached result
+        int intValue = 0;                                        ///< Integer result
+        std::vector<uint8_t> bytes;                              ///< Byte result
+        const char *format = nullptr;                            ///< Encoding of the byte result, or null
+        size_t count = 0;                                        ///< Number of samples in the byte result
+        bool timed = false;                                      ///< Whether the byte result carries a start time
+        int64_t startTime = 0;                                   ///< Time of the first sample, in microseconds
+        uint32_t skew = 0;                                       ///< Delay between adjacent channels in nanoseconds, or 0
+    };
+
+    std::vector<Entry> _entries; ///< Cache slots
+    std::mutex _mutex;           ///< Guards _entries; bus executors use the cache concurrently
+    uint32_t _hits;              ///< Lookups served from the cache
+    uint32_t _misses;            ///< Lookups that went to the hardware
+
+    /**
+     * @brief Hash a cache key
+     *
+     * @param module Index of the module
+     * @param opcode Opcode of the command
+     * @param params Parameter name-value pairs of the command
+     * @return The hash
+     */
+    static uint32_t hashKey(int module, uint16_t opcode, const std::vector<std::pair<std::string, std::string>> &params);
+};
+
+#endif // RESULTCACHE_H
@@ -0,0 +1,194 @@
+// ⚡🔌 Arduino-CTL 🔌⚡
+//
+// Copyright (C) 2024 ixaxaar
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SAMPLES_H
+#define SAMPLES_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+/**
+ * @brief Wire format of a sampled byte result, chosen per request with the "encoding" parameter
+ *
+ * Multi-byte fields are little-endian. Varints are LEB128: seven bits per
+ * byte, least significant group first, high bit set on every byte but the last.
+ */
+enum class SampleEncoding : uint8_t
+{
+    Int32,    ///< One native int per sample (the default, and the only format before encodings)
+    Bits,     ///< One bit per sample, least significant bit first; meant for digital reads
+    U16,      ///< One uint16 per sample
+    Packed12, ///< Two 12-bit samples in three bytes, the first sample in the low 12 bits
+    Delta,    ///< Zigzag varint of the difference to the previous sample (the first to 0)
+    Rle       ///< Runs of equal samples, each a varint value followed by a varint length
+};
+
+/**
+ * @brief Look up an encoding by the name requests use
+ *
+ * @param name "int32", "bits", "u16", "packed12", "delta" or "rle"
+ * @param encoding Receives the encoding
+ * @return true if the name is known
+ */
+bool parseSampleEncoding(const std::string &name, SampleEncoding &encoding);
+
+/**
+ * @brief Get the name of an encoding, as reported in responses
+ * @param encoding The encoding
+ * @return The name parseSampleEncoding() accepts
+ */
+const char *sampleEncodingName(SampleEncoding encoding);
+
+/**
+ * @brief Get the largest number of bytes a run of samples can encode to
+ *
+ * @param encoding The encoding
+ * @param count Number of samples
+ * @return Upper bound of the encoded size
+ */
+size_t maxEncodedSize(SampleEncoding encoding, size_t count);
+
+/**
+ * @brief Reduction applied to samples before they are encoded, chosen per request with the "reduce" parameter
+ *
+ * Every reduction but None works on windows of a fixed number of samples
+ * (the decimation factor) and writes a fixed number of values per window.
+ * A trailing partial window is dropped.
+ */
+enum class SampleReduction : uint8_t
+{
+    None,  ///< Every sample, unchanged
+    Box,   ///< The mean of each window: a box filter followed by decimation
+    Cic,   ///< A third-order CIC decimator, scaled back to the sample range; the first two values settle
+    Stats, ///< Min, max, mean and RMS of each window
+    Peak   ///< Min and max of each window, so a decimated trace keeps glitches narrower than a window
+};
+
+/**
+ * @brief Look up a reduction by the name requests use
+ *
+ * @param name "none", "box", "cic", "stats" or "peak"
+ * @param reduction Receives the reduction
+ * @return true if the name is known
+ */
+bool parseSampleReduction(const std::string &name, SampleReduction &reduction);
+
+/**
+ * @brief Get the number of values a reduction writes for a run of samples
+ *
+ * @param reduction The reduction
+ * @param count Number of samples
+ * @param factor Samples per window
+ * @return Number of values passed on to the encoder
+ */
+size_t reducedCount(SampleReduction reduction, size_t count, uint32_t factor);
+
+/**
+ * @brief Encodes samples one at a time as they are taken, straight into the result buffer
+ */
+class SampleEncoder
+{
+public:
+    /**
+     * @brief Constructor for SampleEncoder
+     *
+     * @param encoding The encoding to write
+     * @param out Buffer of at least maxEncodedSize() bytes for the samples to come
+     */
+    SampleEncoder(SampleEncoding encoding, uint8_t *out);
+
+    /**
+     * @brief Encode the next sample
+     * @param sample The sample; Packed12 keeps its low 12 bits
+     */
+    void add(uint16_t sample);
+
+    /**
+     * @brief Flush the pending bit byte, half pair or run
+     * @return Number of bytes written in total
+     */
+    size_t finish();
+
+private:
+    SampleEncoding _encoding; ///< The encoding written
+    uint8_t *_out;            ///< Output buffer
+    size_t _length;           ///< Bytes written so far
+    size_t _count;            ///< Samples added so far
+    uint16_t _previous;       ///< Last sample added, for Delta and Rle
+    uint32_t _run;            ///< Length of the current run, for Rle
+
+    /**
+     * @brief Append a LEB128 varint
+     * @param value The value
+     */
+    void writeVarint(uint32_t value);
+};
+
+/**
+ * @brief Reduces samples in a single streaming pass as they are taken, feeding the values to an encoder
+ *
+ * Only integer arithmetic is used: sums for the mean, a sum of squares and an
+ * integer square root for the RMS, and wrapping 64-bit integrators and combs
+ * for the CIC filter. Factors up to MAX_FACTOR keep every sum in range.
+ */
+class SampleReducer
+{
+public:
+    static const uint32_t MAX_FACTOR = 4096; ///< Largest window, in samples
+
+    /**
+     * @brief Constructor for SampleReducer
+     *
+     * @param reduction The reduction to apply
+     * @param factor Samples per window, 1 to MAX_FACTOR
+     * @param out Encoder receiving the reduced values
+     */
+    SampleReducer(SampleReduction reduction, uint32_t factor, SampleEncoder &out);
+
+    /**
+     * @brief Reduce the next sample
+     * @param sample The sample
+     */
+    void add(uint16_t sample);
+
+    /**
+     * @brief Get the number of values passed to the encoder so far
+     * @return The count of reduced values
+     */
+    size_t count() const { return _count; }
+
+private:
+    SampleReduction _reduction; ///< The reduction applied
+    uint32_t _factor;           ///< Samples per window
+    SampleEncoder &_out;        ///< Encoder receiving the values
+    size_t _count;              ///< Values written so far
+    uint32_t _phase;            ///< Samples in the current window
+    uint16_t _min;              ///< Smallest sample of the current window
+    uint16_t _max;              ///< Largest sample of the current window
+    uint32_t _sum;              ///< Sum of the current window
+    uint64_t _sumSquares;       ///< Sum of the squares of the current window
+    uint64_t _integrators[3];   ///< CIC integrator stages, wrapping
+    uint64_t _combs[3];         ///< Previous input of each CIC comb stage
+
+    /**
+     * @brief Pass a value to the encoder
+     * @param value The value
+     */
+    void emit(uint16_t value);
+};
+
+#endif // SAMPLES_H
@@ -0,0 +1,106 @@
+// ⚡🔌 Arduino-CTL 🔌⚡
+//
+// Copyright (C) 2024 ixaxaar
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef UDPFRAME_H
+#define UDPFRAME_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief Version byte at the start of every UDP fast-path frame
+ */
+#define UDP_FRAME_VERSION 1
+
+/**
+ * @brief Size of the fixed frame header in bytes
+ */
+#define UDP_FRAME_HEADER_SIZE 12
+
+/**
+ * @brief Largest number of arguments a frame can carry
+ */
+#define UDP_FRAME_MAX_ARGS 8
+
+/**
+ * @brief A decoded UDP fast-path frame
+ *
+ * On the wire all fields are little-endian:
+ *
+ *   offset  size  field
+ *   0       1     version (UDP_FRAME_VERSION)
+ *   1       1     module: index of the module in registration order
+ *   2       1     opcode: index of the command in the module's getSupportedFunctions()
+ *   3       1     argc: number of arguments
+ *   4       4     token: udpTokenFor() of the API key
+ *   8       4     sequence number
+ *   12      4*argc  int32 arguments
+ */
+struct UdpFrame
+{
+    uint8_t module;                    ///< Index of the module in registration order
+    uint8_t opcode;                    ///< Opcode of the command on that module
+    uint8_t argc;                      ///< Number of valid entries in args
+    uint32_t sequence;                 ///< Sender sequence number
+    int32_t args[UDP_FRAME_MAX_ARGS]; ///< Packed command arguments
+};
+
+/**
+ * @brief Derive the token UDP frames must carry from the API key
+ *
+ * The token only keeps stray traffic from driving pins; it travels in clear
+ * text, so the fast path belongs on trusted networks.
+ *
+ * @param apiKey Pointer to the key characters
+ * @param length Length of the key in bytes
+ * @return The 32-bit token (FNV-1a of the key)
+ */
+uint32_t udpTokenFor(const char *apiKey, size_t length);
+
+/**
+ * @brief Decode and validate a UDP fast-path frame
+ *
+ * @param data The datagram payload
+ * @param length Length of the payload in bytes
+ * @param token The expected token
+ * @param frame Receives the decoded frame
+ * @return true if the frame is well-formed and carries the expected token
+ */
+bool parseUdpFrame(const uint8_t *data, size_t length, uint32_t token, UdpFrame &frame);
+
+/**
+ * @brief Drops frames that arrive out of order
+ *
+ * Sequence numbers are compared modulo 2^32, so they may wrap. A sender that
+ * restarts at sequence 0 is accepted again.
+ */
+class SequenceFilter
+{
+public:
+    /**
+     * @brief Check a sequence number and record it if it is newer than the last accepted one
+     *
+     * @param sequence The sequence number of the received frame
+     * @return true if the frame should be executed
+     */
+    bool accept(uint32_t sequence);
+
+private:
+    bool _started = false; ///< Whether a frame has been accepted yet
+    uint32_t _last = 0;    ///< Sequence number of the last accepted frame
+};
+
+#endif // UDPFRAME_H
@@ -0,0 +1,206 @@
+// ⚡🔌 Arduino-CTL 🔌⚡
+//
+// Copyright (C) 2024 ixaxaar
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SIM_ARDUINO_H
+#define SIM_ARDUINO_H
+
+// Host stand-in for the ESP32 Arduino core; see sim.h for the simulation model
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <string>
+
+#define LOW 0x0
+#define HIGH 0x1
+
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define PULLUP 0x04
+#define INPUT_PULLUP 0x05
+#define PULLDOWN 0x08
+#define INPUT_PULLDOWN 0x09
+#define OPEN_DRAIN 0x10
+#define OUTPUT_OPEN_DRAIN 0x12
+#define ANALOG 0xC0
+
+#define LSBFIRST 0
+#define MSBFIRST 1
+
+#define ESP_INTR_FLAG_LEVEL1 (1 << 1)
+
+// Number of GPIOs of the ESP32
+#define NUM_DIGITAL_PINS 40
+
+// Default pins of the esp32dev board
+static const uint8_t SDA = 21;
+static const uint8_t SCL = 22;
+static const uint8_t SS = 5;
+static const uint8_t MOSI = 23;
+static const uint8_t MISO = 19;
+static const uint8_t SCK = 18;
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+uint16_t analogRead(uint8_t pin);
+void analogReadResolution(uint8_t bits);
+void analogWrite(uint8_t pin, int value);
+int8_t digitalPinToAnalogChannel(uint8_t pin);
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+uint32_t esp_random();
+
+/**
+ * @brief Get the CPU clock frequency
+ * @return sim::CPU_MHZ
+ */
+uint32_t getCpuFrequencyMhz();
+
+/**
+ * @brief The ESP object of the core, for its cycle counter
+ */
+class EspClass
+{
+public:
+    /**
+     * @brief Read the CPU cycle counter
+     *
+     * The count follows the calling task's virtual clock; each read takes
+     * sim::CYCLE_COUNT_READ_CYCLES, so polling loops make progress.
+     *
+     * @return The cycle count, wrapping at 32 bits
+     */
+    uint32_t getCycleCount();
+};
+
+extern EspClass ESP;
+
+/**
+ * @brief Minimal Arduino String: a std::string behind the Arduino interface the library uses
+ */
+class String
+{
+public:
+    String(const char *value = "") : _value(value ? value : "") {}
+    String(const char *value, size_t length) : _value(value, length) {}
+    explicit String(int value) : _value(std::to_string(value)) {}
+    explicit String(unsigned long value) : _value(std::to_string(value)) {}
+
+    const char *c_str() const { return _value.c_str(); }
+    size_t length() const { return _value.size(); }
+    bool isEmpty() const { return _value.empty(); }
+    bool equals(const char *other) const { return _value == other; }
+    bool operator==(const String &other) const { return _value == other._value; }
+    bool operator==(const char *other) const { return _value == other; }
+    bool operator!=(const String &other) const { return _value != other._value; }
+    String &operator+=(const String &other)
+    {
+        _value += other._value;
+        return *this;
+    }
+    String &operator+=(const char *other)
+    {
+        _value += other;
+        return *this;
+    }
+    String &operator+=(char other)
+    {
+        _value += other;
+        return *this;
+    }
+    bool equalsIgnoreCase(const String &other) const;
+
+private:
+    std::string _value; ///< The characters
+};
+
+inline String operator+(String left, const String &right)
+{
+    left += right;
+    return left;
+}
+
+class Print;
+
+/**
+ * @brief An object that can print itself, as IPAddress does
+ */
+class Printable
+{
+public:
+    virtual ~Printable() {}
+    virtual size_t printTo(Print &p) const = 0;
+};
+
+/**
+ * @brief Base of everything text can be printed to
+ */
+class Print
+{
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size);
+    size_t write(const char *str) { return str ? write(reinterpret_cast<const uint8_t *>(str), strlen(str)) : 0; }
+    size_t write(const char *buffer, size_t size) { return write(reinterpret_cast<const uint8_t *>(buffer), size); }
+
+    size_t print(const char *value) { return write(value); }
+    size_t print(const String &value) { return write(value.c_str(), value.length()); }
+    size_t print(char value) { return write(static_cast<uint8_t>(value)); }
+    size_t print(int value) { return print(static_cast<long>(value)); }
+    size_t print(unsigned int value) { return print(static_cast<unsigned long>(value)); }
+    size_t print(long value);
+    size_t print(unsigned long value);
+    size_t print(double value, int digits = 2);
+    size_t print(const Printable &value) { return value.printTo(*this); }
+    size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+    size_t println() { return write("\r\n"); }
+    template <typename T>
+    size_t println(const T &value) { return print(value) + println(); }
+};
+
+/**
+ * @brief Serial port whose output is captured for sim::takeSerialOutput
+ */
+class HardwareSerial : public Print
+{
+public:
+    void begin(unsigned long baud) {}
+    void end() {}
+    int available() { return 0; }
+    int read() { return -1; }
+    void flush() {}
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *buffer, size_t size) override;
+    using Print::write;
+};
+
+extern HardwareSerial Serial;
+
+#endif // SIM_ARDUINO_H
@@ -0,0 +1,61 @@
+// ⚡🔌 Arduino-CTL 🔌⚡
+//
+// Copyright (C) 2024 ixaxaar
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SIM_ASYNCUDP_H
+#define SIM_ASYNCUDP_H
+
+// Host stand-in for AsyncUDP; datagrams are injected with sim::udpSend
+
+#include <Arduino.h>
+#include <functional>
+
+class AsyncUDPPacket
+{
+public:
+    AsyncUDPPacket(uint8_t *data, size_t length) : _data(data), _length(length) {}
+    uint8_t *data() { return _data; }
+    size_t length() { return _length; }
+
+private:
+    uint8_t *_data; ///< The payload
+    size_t _length; ///< Payload length in bytes
+};
+
+typedef std::function<void(AsyncUDPPacket &packet)> AuPacketHandlerFunction;
+
+class AsyncUDP
+{
+public:
+    AsyncUDP() : _port(0) {}
+    ~AsyncUDP();
+    bool listen(uint16_t port);
+    void onPacket(AuPacketHandlerFunction callback) { _handler = callback; }
+    void close();
+
+    /**
+     * @brief Deliver a datagram to the packet handler, as sim::udpSend does
+     *
+     * @param data The payload
+     * @param length Payload length in bytes
+     */
+    void receive(uint8_t *data, size_t length);
+
+private:
+    uint16_t _port;                  ///< Port listened on, or 0
+    AuPacketHandlerFunction _handler; ///< Packet handler
+};
+
+#endif // SIM_ASYNCUDP_H
@@ -0,0 +1,429 @@
+// ⚡🔌 Arduino-CTL 🔌⚡
+//
+// Copyright (C) 2024 ixaxaar
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SIM_ESPASYNCWEBSERVER_H
+#define SIM_ESPASYNCWEBSERVER_H
+
+// Host stand-in for ESPAsyncWebServer. There is no socket: sim::http and
+// sim::WebSocket hand requests and frames straight to the registered handlers.
+
+#include <Arduino.h>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace sim
+{
+    struct WebSocketConnection;
+}
+
+typedef enum
+{
+    HTTP_GET = 0b00000001,
+    HTTP_POST = 0b00000010,
+    HTTP_DELETE = 0b00000100,
+    HTTP_PUT = 0b00001000,
+    HTTP_PATCH = 0b00010000,
+    HTTP_HEAD = 0b00100000,
+    HTTP_OPTIONS = 0b01000000,
+    HTTP_ANY = 0b01111111,
+} WebRequestMethod;
+
+typedef uint8_t WebRequestMethodComposite;
+
+// Returned by a response filler that has no data yet; the filler is called again later
+#define RESPONSE_TRY_AGAIN 0xFFFFFFFF
+
+class AsyncWebServer;
+class AsyncWebServerRequest;
+
+typedef std::function<size_t(uint8_t *buffer, size_t maxLen, size_t index)> AwsResponseFiller;
+typedef std::function<void(AsyncWebServerRequest *request)> ArRequestHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest *request, const String &filename, size_t index, uint8_t *data, size_t len, bool final)> ArUploadHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total)> ArBodyHandlerFunction;
+typedef std::function<void(void)> ArDisconnectHandler;
+
+class AsyncWebParameter
+{
+public:
+    AsyncWebParameter(const String &name, const String &value, bool form = false, bool file = false, size_t size = 0)
+        : _name(name), _value(value), _size(size), _isForm(form), _isFile(file) {}
+    const String &name() const { return _name; }
+    const String &value() const { return _value; }
+    size_t size() const { return _size; }
+    bool isPost() const { return _isForm; }
+    bool isFile() const { return _isFile; }
+
+private:
+    String _name;
+    String _value;
+    size_t _size;
+    bool _isForm;
+    bool _isFile;
+};
+
+class AsyncWebHeader
+{
+public:
+    AsyncWebHeader(const String &name, const String &value) : _name(name), _value(value) {}
+    const String &name() const { return _name; }
+    const String &value() const { return _value; }
+
+private:
+    String _name;
+    String _value;
+};
+
+/**
+ * @brief Base of all responses; the simulated server pulls the body through fillBody
+ */
+class AsyncWebServerResponse
+{
+public:
+    AsyncWebServerResponse(int code, const String &contentType) : _code(code), _contentType(contentType) {}
+    virtual ~AsyncWebServerResponse() {}
+
+    void setCode(int code) { _code = code; }
+    void setContentType(const String &type) { _contentType = type; }
+    void addHeader(const String &name, const String &value) { _headers.push_back(AsyncWebHeader(name, value)); }
+
+    int code() const { return _code; }
+    const String &contentType() const { return _contentType; }
+    const std::vector<AsyncWebHeader> &headers() const { return _headers; }
+
+    /**
+     * @brief Produce the next piece of the body
+     *
+     * @param buffer Buffer to fill
+     * @param maxLen Capacity of the buffer
+     * @param index Number of body bytes produced so far
+     * @return Number of bytes produced, 0 at the end of the body, or RESPONSE_TRY_AGAIN
+     */
+    virtual size_t fillBody(uint8_t *buffer, size_t maxLen, size_t index) = 0;
+
+private:
+    int _code;
+    String _contentType;
+    std::vector<AsyncWebHeader> _headers;
+};
+
+class AsyncBasicResponse : public AsyncWebServerResponse
+{
+public:
+    AsyncBasicResponse(int code, const String &contentType, const std::string &content)
+        : AsyncWebServerResponse(code, contentType), _content(content) {}
+    size_t fillBody(uint8_t *buffer, size_t maxLen, size_t index) override;
+
+private:
+    std::string _content;
+};
+
+class AsyncCallbackResponse : public AsyncWebServerResponse
+{
+public:
+    /**
+     * @brief Constructor for AsyncCallbackResponse
+     *
+     * @param contentType Content type
+     * @param length Body length, or SIZE_MAX for a chunked response that ends when the filler returns 0
+     * @param filler Produces the body
+     */
+    AsyncCallbackResponse(const String &contentType, size_t length, AwsResponseFiller filler)
+        : AsyncWebServerResponse(200, contentType), _length(length), _filler(filler) {}
+    size_t fillBody(uint8_t *buffer, size_t maxLen, size_t index) override;
+
+private:
+    size_t _length;
+    AwsResponseFiller _filler;
+};
+
+class AsyncResponseStream : public AsyncWebServerResponse, public Print
+{
+public:
+    explicit AsyncResponseStream(const String &contentType) : AsyncWebServerResponse(200, contentType) {}
+    size_t write(uint8_t data) override;
+    size_t write(const uint8_t *data, size_t length) override;
+    using Print::write;
+    size_t fillBody(uint8_t *buffer, size_t maxLen, size_t index) override;
+
+private:
+    std::string _content;
+};
+
+class AsyncWebServerRequest
+{
+public:
+    void *_tempObject; ///< Handler scratch space; free()d with the request
+
+    AsyncWebServerRequest(AsyncWebServer *server, WebRequestMethodComposite method, const String &url,
+                          const std::vector<AsyncWebParameter> &params, const std::vector<AsyncWebHeader> &headers, size_t contentLength);
+    ~AsyncWebServerRequest();
+
+    AsyncWebServer *server() const { return _server; }
+    WebRequestMethodComposite method() const { return _method; }
+    const String &url() const { return _url; }
+    size_t contentLength() const { return _contentLength; }
+
+    void send(AsyncWebServerResponse *response);
+    void send(int code, const String &contentType = String(), const String &content = String());
+    void send(int code, const String &contentType, const uint8_t *content, size_t length);
+    void send(const String &contentType, size_t length, AwsResponseFiller callback);
+
+    AsyncWebServerResponse *beginResponse(int code, const String &contentType = String(), const String &content = String());
+    AsyncWebServerResponse *beginResponse(int code, const String &contentType, const uint8_t *content, size_t length);
+    AsyncWebServerResponse *beginResponse(const String &contentType, size_t length, AwsResponseFiller callback);
+    AsyncWebServerResponse *beginChunkedResponse(const String &contentType, AwsResponseFiller callback);
+    AsyncResponseStream *beginResponseStream(const String &contentType, size_t bufferSize = 1460);
+
+    size_t params() const { return _params.size(); }
+    bool hasParam(const String &name, bool post = false, bool file = false) const;
+    AsyncWebParameter *getParam(const String &name, bool post = false, bool file = false) const;
+    AsyncWebParameter *getParam(size_t index) const;
+
+    size_t headers() const { return _headers.size(); }
+    bool hasHeader(const String &name) const;
+    AsyncWebHeader *getHeader(const String &name) const;
+
+    void onDisconnect(ArDisconnectHandler callback) { _onDisconnect = callback; }
+
+    /**
+     * @brief Get the response sent by the handler
+     * @return The response, or null if none was sent
+     */
+    AsyncWebServerResponse *response() const { return _response; }
+
+private:
+    AsyncWebServerRequest(const AsyncWebServerRequest &) = delete;
+    AsyncWebServerRequest &operator=(const AsyncWebServerRequest &) = delete;
+
+    AsyncWebServer *_server;
+    WebRequestMethodComposite _method;
+    String _url;
+    std::vector<AsyncWebParameter> _params;
+    std::vector<AsyncWebHeader> _headers;
+    size_t _contentLength;
+    AsyncWebServerResponse *_response;
+    ArDisconnectHandler _onDisconnect;
+};
+
+class AsyncWebHandler
+{
+public:
+    virtual ~AsyncWebHandler() {}
+    virtual bool canHandle(AsyncWebServerRequest *request) { return false; }
+    virtual void handleRequest(AsyncWebServerRequest *request) {}
+    virtual void handleBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {}
+};
+
+class AsyncCallbackWebHandler : public AsyncWebHandler
+{
+public:
+    AsyncCallbackWebHandler() : _method(HTTP_ANY) {}
+    void setUri(const String &uri) { _uri = uri; }
+    void setMethod(WebRequestMethodComposite method) { _method = method; }
+    void onRequest(ArRequestHandlerFunction fn) { _onRequest = fn; }
+    void onUpload(ArUploadHandlerFunction fn) { _onUpload = fn; }
+    void onBody(ArBodyHandlerFunction fn) { _onBody = fn; }
+
+    bool canHandle(AsyncWebServerRequest *request) override;
+    void handleRequest(AsyncWebServerRequest *request) override;
+    void handleBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) override;
+
+private:
+    String _uri;
+    WebRequestMethodComposite _method;
+    ArRequestHandlerFunction _onRequest;
+    ArUploadHandlerFunction _onUpload;
+    ArBodyHandlerFunction _onBody;
+};
+
+class AsyncWebServer
+{
+public:
+    explicit AsyncWebServer(uint16_t port);
+    ~AsyncWebServer();
+
+    void begin() { _listening = true; }
+    void end() { _listening = false; }
+    uint16_t port() const { return _port; }
+    bool listening() const { return _listening; }
+
+    AsyncWebHandler &addHandler(AsyncWebHandler *handler);
+    bool removeHandler(AsyncWebHandler *handler);
+    AsyncCallbackWebHandler &on(const char *uri, ArRequestHandlerFunction onRequest);
+    AsyncCallbackWebHandler &on(const char *uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest);
+    AsyncCallbackWebHandler &on(const char *uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest, ArUploadHandlerFunction onUpload);
+    AsyncCallbackWebHandler &on(const char *uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest, ArUploadHandlerFunction onUpload, ArBodyHandlerFunction onBody);
+    void onNotFound(ArRequestHandlerFunction fn) { _notFound = fn; }
+    void reset();
+
+    /**
+     * @brief Find the first handler that accepts a request, in registration order
+     * @param request The request
+     * @return The handler, or null
+     */
+    AsyncWebHandler *findHandler(AsyncWebServerRequest *request);
+
+    /**
+     * @brief Answer a request no handler accepted
+     * @param request The request
+     */
+    void handleNotFound(AsyncWebServerRequest *request);
+
+    /**
+     * @brief Get the handlers, in registration order
+     * @return The handlers
+     */
+    const std::vector<AsyncWebHandler *> &handlers() const { return _handlers; }
+
+private:
+    AsyncWebServer(const AsyncWebServer &) = delete;
+    AsyncWebServer &operator=(const AsyncWebServer &) = delete;
+
+    uint16_t _port;
+    bool _listening;
+    std::vector<AsyncWebHandler *> _handlers;
+    std::vector<std::unique_ptr<AsyncCallbackWebHandler>> _callbackHandlers;
+    ArRequestHandlerFunction _notFound;
+};
+
+typedef enum
+{
+    WS_DISCONNECTED,
+    WS_CONNECTED,
+    WS_DISCONNECTING
+} AwsClientStatus;
+
+typedef enum
+{
+    WS_CONTINUATION,
+    WS_TEXT,
+    WS_BINARY,
+    WS_DISCONNECT = 0x08,
+    WS_PING,
+    WS_PONG
+} AwsFrameType;
+
+typedef enum
+{
+    WS_EVT_CONNECT,
+    WS_EVT_DISCONNECT,
+    WS_EVT_PONG,
+    WS_EVT_ERROR,
+    WS_EVT_DATA
+} AwsEventType;
+
+typedef struct
+{
+    uint8_t message_opcode; ///< Opcode of the message: WS_TEXT or WS_BINARY
+    uint32_t num;           ///< Frame number of the message, from 0
+    uint8_t final;          ///< Whether this is the last frame of the message
+    uint8_t masked;         ///< Whether the frame was masked
+    uint8_t opcode;         ///< Opcode of this frame: WS_CONTINUATION for all but the first
+    uint64_t len;           ///< Length of this frame
+    uint8_t mask[4];        ///< Mask key
+    uint64_t index;         ///< Offset of the current data within the frame
+} AwsFrameInfo;
+
+class AsyncWebSocket;
+
+class AsyncWebSocketClient
+{
+public:
+    void *_tempObject;
+
+    AsyncWebSocketClient(AsyncWebSocket *server, uint32_t id, std::shared_ptr<sim::WebSocketConnection> connection);
+
+    uint32_t id() const { return _id; }
+    AsyncWebSocket *server() const { return _server; }
+    AwsClientStatus status() const;
+    bool canSend() const { return true; }
+
+    void close(uint16_t code = 0, const char *message = NULL);
+    void text(const char *message, size_t len);
+    void text(const char *message) { text(message, strlen(message)); }
+    void text(const String &message) { text(message.c_str(), message.length()); }
+    void binary(const uint8_t *message, size_t len);
+    void binary(const char *message, size_t len) { binary(reinterpret_cast<const uint8_t *>(message), len); }
+
+    /**
+     * @brief Get the state shared with the simulated client end
+     * @return The connection
+     */
+    const std::shared_ptr<sim::WebSocketConnection> &connection() const { return _connection; }
+
+private:
+    AsyncWebSocket *_server;
+    uint32_t _id;
+    std::shared_ptr<sim::WebSocketConnection> _connection;
+};
+
+typedef std::function<void(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len)> AwsEventHandler;
+
+class AsyncWebSocket : public AsyncWebHandler
+{
+public:
+    explicit AsyncWebSocket(const String &url) : _url(url), _nextId(1) {}
+
+    const char *url() const { return _url.c_str(); }
+    void onEvent(AwsEventHandler handler) { _eventHandler = handler; }
+
+    size_t count() const;
+    AsyncWebSocketClient *client(uint32_t id);
+    void close(uint32_t id, uint16_t code = 0, const char *message = NULL);
+    void text(uint32_t id, const char *message, size_t len);
+    void text(uint32_t id, const char *message) { text(id, message, strlen(message)); }
+    void text(uint32_t id, const String &message) { text(id, message.c_str(), message.length()); }
+    void binary(uint32_t id, const uint8_t *message, size_t len);
+    void binary(uint32_t id, const char *message, size_t len) { binary(id, reinterpret_cast<const uint8_t *>(message), len); }
+    void textAll(const char *message, size_t len);
+    void textAll(const String &message) { textAll(message.c_str(), message.length()); }
+    void cleanupClients(uint16_t maxClients = 8);
+
+    /**
+     * @brief Accept a connection from the simulated client end and raise WS_EVT_CONNECT
+     *
+     * @param connection State shared with the client end
+     * @return The new client's ID
+     */
+    uint32_t connect(std::shared_ptr<sim::WebSocketConnection> connection);
+
+    /**
+     * @brief Raise WS_EVT_DATA for a frame received from a client
+     *
+     * @param id The client's ID
+     * @param info Frame description
+     * @param data Frame payload
+     * @param len Payload length
+     */
+    void receive(uint32_t id, AwsFrameInfo &info, uint8_t *data, size_t len);
+
+    /**
+     * @brief Raise WS_EVT_DISCONNECT and forget a client
+     * @param id The client's ID
+     */
+    void disconnect(uint32_t id);
+
+private:
+    String _url;
+    AwsEventHandler _eventHandler;
+    uint32_t _nextId;
+    mutable std::mutex _mutex; ///< Guards _clients, which executor tasks send through
+    std::vector<std::unique_ptr<AsyncWebSocketClient>> _clients;
+};
+
+#endif // SIM_ESPASYNCWEBSERVER_H
@@ -0,0 +1,85 @@
+// ⚡🔌 Arduino-CTL 🔌⚡
+//
+// Copyright (C) 2024 ixaxaar
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SIM_FS_H
+#define SIM_FS_H
+
+// Host stand-in for the Arduino FS library, backed by an in-memory file table
+
+#include <Arduino.h>
+#include <memory>
+
+namespace fs
+{
+    struct FileData;
+
+    /**
+     * @brief An open file of the simulated file system
+     *
+     * Writes go straight to the file table, so a file does not need to be
+     * closed or flushed before it is read again.
+     */
+    class File : public Print
+    {
+    public:
+        File() : _position(0), _writable(false) {}
+        File(std::shared_ptr<FileData> data, const char *path, bool writable, bool append);
+
+        explicit operator bool() const { return _data != nullptr; }
+
+        size_t write(uint8_t c) override;
+        size_t write(const uint8_t *buffer, size_t size) override;
+        using Print::write;
+
+        int available();
+        int read();
+        int peek();
+        size_t read(uint8_t *buffer, size_t size);
+        size_t readBytes(char *buffer, size_t length) { return read(reinterpret_cast<uint8_t *>(buffer), length); }
+        bool seek(uint32_t position);
+        size_t position() const { return _position; }
+        size_t size() const;
+        const char *path() const { return _path.c_str(); }
+        void flush() {}
+        void close() { _data.reset(); }
+
+    private:
+        std::shared_ptr<FileData> _data; ///< Contents, shared with the file table
+        std::string _path;               ///< Path the file was opened with
+        size_t _position;                ///< Offset of the next read or write
+        bool _writable;                  ///< Whether the file was opened for writing
+    };
+
+    /**
+     * @brief A simulated file system
+     */
+    class FS
+    {
+    public:
+        File open(const char *path, const char *mode = "r");
+        File open(const String &path, const char *mode = "r") { return open(path.c_str(), mode); }
+        bool exists(const char *path);
+        bool exists(const String &path) { return exists(path.c_str()); }
+        bool remove(const char *path);
+        bool remove(const String &path) { return remove(path.c_str()); }
+        bool rename(const char *from, const char *to);
+    };
+}
+
+using fs::File;
+using fs::FS;
+
+#endif // SIM_FS_H
@@ -0,0 +1,63 @@
+// ⚡🔌 Arduino-CTL 🔌⚡
+//
+// Copyright (C) 2024 ixaxaar
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SIM_WIFI_H
+#define SIM_WIFI_H
+
+// Host stand-in for the ESP32 WiFi library; the simulated station is always connected
+
+#include <Arduino.h>
+
+typedef enum
+{
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL = 1,
+    WL_SCAN_COMPLETED = 2,
+    WL_CONNECTED = 3,
+    WL_CONNECT_FAILED = 4,
+    WL_CONNECTION_LOST = 5,
+    WL_DISCONNECTED = 6
+} wl_status_t;
+
+class IPAddress : public Printable
+{
+public:
+    IPAddress(uint8_t a = 0, uint8_t b = 0, uint8_t c = 0, uint8_t d = 0) : _address{a, b, c, d} {}
+    uint8_t operator[](int index) const { return _address[index]; }
+    String toString() const;
+    size_t printTo(Print &p) const override;
+
+private:
+    uint8_t _address[4]; ///< Octets, most significant first
+};
+
+class WiFiClass
+{
+public:
+    WiFiClass() : _status(WL_IDLE_STATUS) {}
+    wl_status_t begin(const char *ssid, const char *passphrase = NULL);
+    bool disconnect(bool wifiOff = false);
+    wl_status_t status() const { return _status; }
+    bool isConnected() const { return _status == WL_CONNECTED; }
+    IPAddress localIP() const { return IPAddress(127, 0, 0, 1); }
+
+private:
+    wl_status_t _status; ///< Connection state
+};
+
+extern WiFiClass WiFi;
+
+#endif // SIM_WIFI_H
@@ -0,0 +1,71 @@
+// ⚡🔌 Arduino-CTL 🔌⚡
+//
+// Copyright (C) 2024 ixaxaar
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SIM_WIRE_H
+#define SIM_WIRE_H
+
+// Host stand-in for the Arduino Wire library, talking to the devices attached with sim::attachI2c
+
+#include <Arduino.h>
+
+#define I2C_BUFFER_LENGTH 128
+
+/**
+ * @brief I2C controller of the simulated bus
+ *
+ * Transfers advance the calling task's virtual clock by the time they take on
+ * the wire: nine clock periods per byte, plus start, address and stop.
+ */
+class TwoWire
+{
+public:
+    TwoWire();
+
+    bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0);
+    bool end();
+    bool setClock(uint32_t frequency);
+    uint32_t getClock() const { return _frequency; }
+
+    void beginTransmission(uint16_t address);
+    uint8_t endTransmission(bool sendStop = true);
+    size_t requestFrom(uint16_t address, size_t size, bool sendStop = true);
+
+    size_t write(uint8_t data);
+    size_t write(const uint8_t *data, size_t length);
+    int available();
+    int read();
+    int peek();
+    void flush() {}
+
+private:
+    uint32_t _frequency;                 ///< Bus clock in Hz
+    uint16_t _txAddress;                 ///< Address of the transmission being built
+    uint8_t _txBuffer[I2C_BUFFER_LENGTH]; ///< Bytes of the transmission being built
+    size_t _txLength;                    ///< Number of bytes in _txBuffer
+    uint8_t _rxBuffer[I2C_BUFFER_LENGTH]; ///< Bytes received by the last requestFrom
+    size_t _rxLength;                    ///< Number of bytes in _rxBuffer
+    size_t _rxIndex;                     ///< Next byte of _rxBuffer to read
+
+    /**
+     * @brief Advance the virtual clock by the duration of a transaction
+     * @param bytes Number of data bytes after the address byte
+     */
+    void spend(size_t bytes) const;
+};
+
+extern TwoWire Wire;
+
+#endif // SIM_WIRE_H
@@ -0,0 +1,244 @@
+// ⚡🔌 Arduino-CTL 🔌⚡
+//
+// Copyright (C) 2024 ixaxaar
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "sim.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string.h>
+#include <thread>
+
+// Virtual clock of the calling task, in microseconds
+static thread_local uint64_t taskClock = 0;
+
+// Core the calling task is pinned to; the Arduino loop task runs on core 1
+static thread_local BaseType_t taskCore = 1;
+
+namespace sim
+{
+    uint64_t now()
+    {
+        return taskClock;
+    }
+
+    void advance(uint64_t micros)
+    {
+        taskClock += micros;
+    }
+
+    void advanceTo(uint64_t micros)
+    {
+        if (micros > taskClock)
+        {
+            taskClock = micros;
+        }
+    }
+
+    void resetClock()
+    {
+        taskClock = 0;
+    }
+}
+
+struct SimTask
+{
+    TaskFunction_t code; ///< Entry point
+    void *parameters;    ///< Argument of the entry point
+    BaseType_t core;     ///< Core the task is pinned to
+    uint64_t started;    ///< Virtual time of the creating task when the task was created
+};
+
+// Thrown by vTaskDelete(NULL) to unwind the calling task's thread
+struct TaskDeleted
+{
+};
+
+static thread_local SimTask *currentTask = nullptr;
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t code, const char *name, uint32_t stackDepth, void *parameters,
+                                   UBaseType_t priority, TaskHandle_t *createdTask, BaseType_t coreId)
+{
+    SimTask *task = new SimTask{code, parameters, coreId == tskNO_AFFINITY ? 0 : coreId, taskClock};
+    std::thread thread([task]()
+                       {
+        currentTask = task;
+        taskCore = task->core;
+        taskClock = task->started;
+        try
+        {
+            task->code(task->parameters);
+        }
+        catch (const TaskDeleted &)
+        {
+        } });
+    thread.detach();
+    if (createdTask)
+    {
+        *createdTask = task;
+    }
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t code, const char *name, uint32_t stackDepth, void *parameters,
+                       UBaseType_t priority, TaskHandle_t *createdTask)
+{
+    return xTaskCreatePinnedToCore(code, name, stackDepth, parameters, priority, createdTask, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    // Threads cannot be stopped from outside, so only self-deletion is supported
+    if (task == nullptr || task == currentTask)
+    {
+        throw TaskDeleted();
+    }
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    sim::advance(static_cast<uint64_t>(ticks) * portTICK_PERIOD_MS * 1000);
+    std::this_thread::yield();
+}
+
+TickType_t xTaskGetTickCount()
+{
+    return static_cast<TickType_t>(taskClock / (portTICK_PERIOD_MS * 1000));
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle()
+{
+    return currentTask;
+}
+
+BaseType_t xPortGetCoreID()
+{
+    return taskCore;
+}
+
+void taskYIELD()
+{
+    std::this_thread::yield();
+}
+
+struct SimQueue
+{
+    struct Item
+    {
+        std::vector<uint8_t> data; ///< Copy of the item
+        uint64_t sent;             ///< Virtual time of the sender
+    };
+
+    UBaseType_t length;           ///< Capacity
+    UBaseType_t itemSize;         ///< Size of each item in bytes; 0 for semaphores
+    std::deque<Item> items;       ///< Queued items, oldest first
+    std::mutex mutex;             ///< Guards items
+    std::condition_variable changed; ///< Signalled when an item is added or removed
+};
+
+// Wait on a queue condition for up to the given number of ticks, in real time
+template <typename Predicate>
+static bool waitFor(SimQueue *queue, std::unique_lock<std::mutex> &lock, TickType_t ticks, Predicate ready)
+{
+    if (ticks == portMAX_DELAY)
+    {
+        queue->changed.wait(lock, ready);
+        return true;
+    }
+    return queue->changed.wait_for(lock, std::chrono::milliseconds(static_cast<uint64_t>(ticks) * portTICK_PERIOD_MS), ready);
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize)
+{
+    if (length == 0)
+    {
+        return nullptr;
+    }
+    SimQueue *queue = new SimQueue();
+    queue->length = length;
+    queue->itemSize = itemSize;
+    return queue;
+}
+
+void vQueueDelete(QueueHandle_t queue)
+{
+    delete queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticksToWait)
+{
+    std::unique_lock<std::mutex> lock(queue->mutex);
+    if (!waitFor(queue, lock, ticksToWait, [queue]()
+                 { return queue->items.size() < queue->length; }))
+    {
+        return pdFALSE;
+    }
+    const uint8_t *bytes = static_cast<const uint8_t *>(item);
+    queue->items.push_back({std::vector<uint8_t>(bytes, bytes + (item ? queue->itemSize : 0)), taskClock});
+    queue->changed.notify_all();
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *buffer, TickType_t ticksToWait)
+{
+    std::unique_lock<std::mutex> lock(queue->mutex);
+    if (!waitFor(queue, lock, ticksToWait, [queue]()
+                 { return !queue->items.empty(); }))
+    {
+        return pdFALSE;
+    }
+    SimQueue::Item &item = queue->items.front();
+    if (buffer != nullptr && !item.data.empty())
+    {
+        memcpy(buffer, item.data.data(), item.data.size());
+    }
+    // Whatever the sender did before sending happened before the receiver continues
+    sim::advanceTo(item.sent);
+    queue->items.pop_front();
+    queue->changed.notify_all();
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue)
+{
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    return static_cast<UBaseType_t>(queue->items.size());
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary()
+{
+    return xQueueCreate(1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount, UBaseType_t initialCount)
+{
+    SemaphoreHandle_t semaphore = xQueueCreate(maxCount, 0);
+    for (UBaseType_t i = 0; semaphore != nullptr && i < initialCount; ++i)
+    {
+        xQueueSend(semaphore, nullptr, 0);
+    }
+    return semaphore;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex()
+{
+    // Starts available; taking it does not move the clock back, so the creator's time is harmless
+    return xSemaphoreCreateCounting(1, 1);
+}
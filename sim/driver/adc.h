@@ -0,0 +1,62 @@
+// ⚡🔌 Arduino-CTL 🔌⚡
+//
+// Copyright (C) 2024 ixaxaar
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SIM_DRIVER_ADC_H
+#define SIM_DRIVER_ADC_H
+
+// Host stand-in for the ESP-IDF ADC driver: the settings the I2S-ADC path takes; conversions read the simulated pins
+
+#include "../esp_err.h"
+
+typedef enum
+{
+    ADC_UNIT_1 = 1,
+    ADC_UNIT_2 = 2
+} adc_unit_t;
+
+typedef enum
+{
+    ADC1_CHANNEL_0 = 0, ///< GPIO36
+    ADC1_CHANNEL_1,     ///< GPIO37
+    ADC1_CHANNEL_2,     ///< GPIO38
+    ADC1_CHANNEL_3,     ///< GPIO39
+    ADC1_CHANNEL_4,     ///< GPIO32
+    ADC1_CHANNEL_5,     ///< GPIO33
+    ADC1_CHANNEL_6,     ///< GPIO34
+    ADC1_CHANNEL_7,     ///< GPIO35
+    ADC1_CHANNEL_MAX
+} adc1_channel_t;
+
+typedef enum
+{
+    ADC_WIDTH_BIT_9 = 0,
+    ADC_WIDTH_BIT_10,
+    ADC_WIDTH_BIT_11,
+    ADC_WIDTH_BIT_12
+} adc_bits_width_t;
+
+typedef enum
+{
+    ADC_ATTEN_DB_0 = 0,
+    ADC_ATTEN_DB_2_5,
+    ADC_ATTEN_DB_6,
+    ADC_ATTEN_DB_11
+} adc_atten_t;
+
+esp_err_t adc1_config_width(adc_bits_width_t width);
+esp_err_t adc1_config_channel_atten(adc1_channel_t channel, adc_atten_t atten);
+
+#endif // SIM_DRIVER_ADC_H
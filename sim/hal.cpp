@@ -0,0 +1,507 @@
+// ⚡🔌 Arduino-CTL 🔌⚡
+//
+// Copyright (C) 2024 ixaxaar
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <Arduino.h>
+#include "sim.h"
+#include "siminternal.h"
+#include "soc/gpio_struct.h"
+#include "driver/adc.h"
+#include "esp_timer.h"
+#include <deque>
+#include <mutex>
+#include <stdarg.h>
+#include <stdio.h>
+#include <thread>
+
+HardwareSerial Serial;
+
+// Simulated state of one GPIO
+struct PinState
+{
+    uint8_t mode;             ///< Mode set by pinMode, 0 if never set
+    uint8_t output;           ///< Level driven by digitalWrite
+    int input;                ///< Level driven from outside, or -1 if released
+    int analogOutput;         ///< Value of the last analogWrite, or -1
+    bool hasSource;           ///< Whether a waveform is connected
+    sim::Waveform source;     ///< The connected waveform
+    std::deque<sim::Edge> edges; ///< Recent level changes
+};
+
+static PinState pins[NUM_DIGITAL_PINS];
+static uint8_t adcResolution = 12;
+static std::mutex pinMutex; // Bus executors touch pins from several tasks
+
+static std::string serialOutput;
+static std::mutex serialMutex;
+
+static uint32_t randomState = 0x2545F491;
+static std::mutex randomMutex;
+
+namespace sim
+{
+    void resetPins()
+    {
+        std::lock_guard<std::mutex> lock(pinMutex);
+        for (PinState &pin : pins)
+        {
+            pin = PinState();
+            pin.input = -1;
+            pin.analogOutput = -1;
+        }
+        adcResolution = 12;
+    }
+
+    void reset()
+    {
+        resetClock();
+        resetPins();
+        resetI2c();
+        resetSpi();
+        resetI2s();
+        resetRmt();
+        resetFiles();
+        std::lock_guard<std::mutex> lock(serialMutex);
+        serialOutput.clear();
+    }
+
+    double Waveform::at(uint64_t micros) const
+    {
+        double t = frequency * micros / 1e6 + phase;
+        double cycle = t - floor(t);
+        switch (shape)
+        {
+        case Shape::Sine:
+            return offset + amplitude * sin(2 * M_PI * cycle);
+        case Shape::Square:
+            return offset + (cycle < 0.5 ? amplitude : -amplitude);
+        case Shape::Triangle:
+            return offset + amplitude * (cycle < 0.5 ? 4 * cycle - 1 : 3 - 4 * cycle);
+        case Shape::Sawtooth:
+            return offset + amplitude * (2 * cycle - 1);
+        case Shape::Noise:
+        {
+            // splitmix64 of the time: uniform in [-1, 1) and the same for every run
+            uint64_t z = micros + 0x9E3779B97F4A7C15ULL;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            z ^= z >> 31;
+            return offset + amplitude * ((z >> 11) * (2.0 / 9007199254740992.0) - 1);
+        }
+        case Shape::Constant:
+        default:
+            return offset;
+        }
+    }
+
+    void setInput(uint8_t pin, uint8_t level)
+    {
+        std::lock_guard<std::mutex> lock(pinMutex);
+        if (pin < NUM_DIGITAL_PINS)
+        {
+            pins[pin].input = level ? HIGH : LOW;
+        }
+    }
+
+    void releaseInput(uint8_t pin)
+    {
+        std::lock_guard<std::mutex> lock(pinMutex);
+        if (pin < NUM_DIGITAL_PINS)
+        {
+            pins[pin].input = -1;
+            pins[pin].hasSource = false;
+        }
+    }
+
+    void setAnalogSource(uint8_t pin, const Waveform &waveform)
+    {
+        std::lock_guard<std::mutex> lock(pinMutex);
+        if (pin < NUM_DIGITAL_PINS)
+        {
+            pins[pin].hasSource = true;
+            pins[pin].source = waveform;
+        }
+    }
+
+    uint8_t pinModeOf(uint8_t pin)
+    {
+        std::lock_guard<std::mutex> lock(pinMutex);
+        return pin < NUM_DIGITAL_PINS ? pins[pin].mode : 0;
+    }
+
+    uint8_t outputLevel(uint8_t pin)
+    {
+        std::lock_guard<std::mutex> lock(pinMutex);
+        return pin < NUM_DIGITAL_PINS ? pins[pin].output : LOW;
+    }
+
+    int analogOutput(uint8_t pin)
+    {
+        std::lock_guard<std::mutex> lock(pinMutex);
+        return pin < NUM_DIGITAL_PINS ? pins[pin].analogOutput : -1;
+    }
+
+    std::vector<Edge> edges(uint8_t pin)
+    {
+        std::lock_guard<std::mutex> lock(pinMutex);
+        if (pin >= NUM_DIGITAL_PINS)
+        {
+            return std::vector<Edge>();
+        }
+        return std::vector<Edge>(pins[pin].edges.begin(), pins[pin].edges.end());
+    }
+
+    std::string takeSerialOutput()
+    {
+        std::lock_guard<std::mutex> lock(serialMutex);
+        std::string output;
+        output.swap(serialOutput);
+        return output;
+    }
+}
+
+// Pins start released, as after sim::reset
+static struct PinInitializer
+{
+    PinInitializer() { sim::resetPins(); }
+} pinInitializer;
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+    std::lock_guard<std::mutex> lock(pinMutex);
+    if (pin < NUM_DIGITAL_PINS)
+    {
+        pins[pin].mode = mode;
+    }
+}
+
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+    uint8_t level = val ? HIGH : LOW;
+    {
+        std::lock_guard<std::mutex> lock(pinMutex);
+        if (pin >= NUM_DIGITAL_PINS)
+        {
+            return;
+        }
+        PinState &state = pins[pin];
+        if (state.output == level && !state.edges.empty())
+        {
+            return;
+        }
+        state.output = level;
+        state.edges.push_back({sim::now(), level});
+        if (state.edges.size() > sim::EDGE_HISTORY)
+        {
+            state.edges.pop_front();
+        }
+    }
+    sim::spiPinChanged(pin, level);
+}
+
+namespace sim
+{
+    void drivePin(uint8_t pin, uint64_t time, uint8_t level)
+    {
+        std::lock_guard<std::mutex> lock(pinMutex);
+        if (pin >= NUM_DIGITAL_PINS)
+        {
+            return;
+        }
+        PinState &state = pins[pin];
+        level = level ? HIGH : LOW;
+        if (state.output == level && !state.edges.empty())
+        {
+            return;
+        }
+        state.output = level;
+        state.edges.push_back({time, level});
+        if (state.edges.size() > EDGE_HISTORY)
+        {
+            state.edges.pop_front();
+        }
+    }
+}
+
+// Voltage on a pin at a time, or a negative value if nothing drives it
+static double pinVoltage(const PinState &state, uint64_t time)
+{
+    if (state.hasSource)
+    {
+        return state.source.at(time);
+    }
+    if (state.input >= 0)
+    {
+        return state.input ? sim::ADC_FULL_SCALE_VOLTS : 0;
+    }
+    return -1;
+}
+
+// Level digitalRead returns for a pin; the caller holds pinMutex
+static int pinLevel(const PinState &state)
+{
+    // Output pins read back the level they drive
+    if (state.mode & (OUTPUT & ~INPUT))
+    {
+        return state.output;
+    }
+    double volts = pinVoltage(state, sim::now());
+    if (volts >= 0)
+    {
+        return volts >= sim::ADC_FULL_SCALE_VOLTS / 2 ? HIGH : LOW;
+    }
+    return (state.mode & PULLUP) ? HIGH : LOW;
+}
+
+int digitalRead(uint8_t pin)
+{
+    std::lock_guard<std::mutex> lock(pinMutex);
+    return pin < NUM_DIGITAL_PINS ? pinLevel(pins[pin]) : LOW;
+}
+
+gpio_dev_t GPIO;
+
+// Register writes take no virtual time, so all pins of a write change at the same instant
+template <int Bank, bool Set>
+SimGpioOutputRegister<Bank, Set> &SimGpioOutputRegister<Bank, Set>::operator=(uint32_t mask)
+{
+    for (; mask != 0; mask &= mask - 1)
+    {
+        digitalWrite(static_cast<uint8_t>(Bank * 32 + __builtin_ctz(mask)), Set ? HIGH : LOW);
+    }
+    return *this;
+}
+
+template <int Bank>
+SimGpioInputRegister<Bank>::operator uint32_t() const
+{
+    std::lock_guard<std::mutex> lock(pinMutex);
+    uint32_t levels = 0;
+    for (int bit = 0; bit < 32 && Bank * 32 + bit < NUM_DIGITAL_PINS; ++bit)
+    {
+        levels |= static_cast<uint32_t>(pinLevel(pins[Bank * 32 + bit])) << bit;
+    }
+    return levels;
+}
+
+template struct SimGpioOutputRegister<0, true>;
+template struct SimGpioOutputRegister<0, false>;
+template struct SimGpioOutputRegister<1, true>;
+template struct SimGpioOutputRegister<1, false>;
+template struct SimGpioInputRegister<0>;
+template struct SimGpioInputRegister<1>;
+
+// Conversion of a voltage at a resolution
+static uint16_t convert(double volts, uint8_t bits)
+{
+    double fraction = std::min(1.0, std::max(0.0, volts / sim::ADC_FULL_SCALE_VOLTS));
+    return static_cast<uint16_t>(lround(fraction * ((1u << bits) - 1)));
+}
+
+uint16_t analogRead(uint8_t pin)
+{
+    sim::advance(sim::ADC_CONVERSION_MICROS);
+    std::lock_guard<std::mutex> lock(pinMutex);
+    if (pin >= NUM_DIGITAL_PINS)
+    {
+        return 0;
+    }
+    return convert(pinVoltage(pins[pin], sim::now()), adcResolution);
+}
+
+namespace sim
+{
+    uint16_t adcSample(uint8_t pin, uint64_t time)
+    {
+        std::lock_guard<std::mutex> lock(pinMutex);
+        return pin < NUM_DIGITAL_PINS ? convert(pinVoltage(pins[pin], time), 12) : 0;
+    }
+}
+
+int8_t digitalPinToAnalogChannel(uint8_t pin)
+{
+    // ADC1 channels 0-7, then ADC2 channels 0-9 numbered from 10
+    static const uint8_t ADC_PINS[] = {36, 37, 38, 39, 32, 33, 34, 35, 0, 0, 4, 0, 2, 15, 13, 12, 14, 27, 25, 26};
+    for (int8_t channel = 0; channel < static_cast<int8_t>(sizeof(ADC_PINS)); ++channel)
+    {
+        if ((channel < 8 || channel >= 10) && ADC_PINS[channel] == pin)
+        {
+            return channel;
+        }
+    }
+    return -1;
+}
+
+esp_err_t adc1_config_width(adc_bits_width_t width)
+{
+    return ESP_OK;
+}
+
+esp_err_t adc1_config_channel_atten(adc1_channel_t channel, adc_atten_t atten)
+{
+    return channel >= 0 && channel < ADC1_CHANNEL_MAX ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+void analogReadResolution(uint8_t bits)
+{
+    std::lock_guard<std::mutex> lock(pinMutex);
+    adcResolution = std::min<uint8_t>(16, std::max<uint8_t>(1, bits));
+}
+
+void analogWrite(uint8_t pin, int value)
+{
+    std::lock_guard<std::mutex> lock(pinMutex);
+    if (pin < NUM_DIGITAL_PINS)
+    {
+        pins[pin].analogOutput = value;
+    }
+}
+
+unsigned long millis()
+{
+    return static_cast<unsigned long>(sim::now() / 1000);
+}
+
+int64_t esp_timer_get_time()
+{
+    return static_cast<int64_t>(sim::now());
+}
+
+unsigned long micros()
+{
+    return static_cast<unsigned long>(sim::now());
+}
+
+void delay(uint32_t ms)
+{
+    sim::advance(static_cast<uint64_t>(ms) * 1000);
+    std::this_thread::yield();
+}
+
+void delayMicroseconds(uint32_t us)
+{
+    sim::advance(us);
+}
+
+void yield()
+{
+    std::this_thread::yield();
+}
+
+EspClass ESP;
+
+// Cycles the calling task has spent below the microsecond resolution of its clock
+static thread_local uint32_t pendingCycles = 0;
+
+uint32_t getCpuFrequencyMhz()
+{
+    return sim::CPU_MHZ;
+}
+
+uint32_t EspClass::getCycleCount()
+{
+    pendingCycles += sim::CYCLE_COUNT_READ_CYCLES;
+    if (pendingCycles >= sim::CPU_MHZ)
+    {
+        sim::advance(pendingCycles / sim::CPU_MHZ);
+        pendingCycles %= sim::CPU_MHZ;
+    }
+    return static_cast<uint32_t>(sim::now() * sim::CPU_MHZ + pendingCycles);
+}
+
+uint32_t esp_random()
+{
+    // xorshift32: repeatable across runs, unlike the hardware RNG
+    std::lock_guard<std::mutex> lock(randomMutex);
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return randomState;
+}
+
+bool String::equalsIgnoreCase(const String &other) const
+{
+    if (_value.size() != other._value.size())
+    {
+        return false;
+    }
+    for (size_t i = 0; i < _value.size(); ++i)
+    {
+        if (tolower(static_cast<unsigned char>(_value[i])) != tolower(static_cast<unsigned char>(other._value[i])))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t Print::write(const uint8_t *buffer, size_t size)
+{
+    size_t written = 0;
+    while (written < size && write(buffer[written]))
+    {
+        ++written;
+    }
+    return written;
+}
+
+size_t Print::print(long value)
+{
+    char text[24];
+    snprintf(text, sizeof(text), "%ld", value);
+    return write(text);
+}
+
+size_t Print::print(unsigned long value)
+{
+    char text[24];
+    snprintf(text, sizeof(text), "%lu", value);
+    return write(text);
+}
+
+size_t Print::print(double value, int digits)
+{
+    char text[64];
+    snprintf(text, sizeof(text), "%.*f", digits, value);
+    return write(text);
+}
+
+size_t Print::printf(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    char text[256];
+    int length = vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    if (length < 0)
+    {
+        return 0;
+    }
+    return write(text, std::min(static_cast<size_t>(length), sizeof(text) - 1));
+}
+
+size_t HardwareSerial::write(uint8_t c)
+{
+    std::lock_guard<std::mutex> lock(serialMutex);
+    serialOutput += static_cast<char>(c);
+    return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size)
+{
+    std::lock_guard<std::mutex> lock(serialMutex);
+    serialOutput.append(reinterpret_cast<const char *>(buffer), size);
+    return size;
+}
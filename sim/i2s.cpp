@@ -0,0 +1,319 @@
+// ⚡🔌 Arduino-CTL 🔌⚡
+//
+// Copyright (C) 2024 ixaxaar
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <driver/i2s.h>
+#include <freertos/queue.h>
+#include <soc/syscon_struct.h>
+#include "sim.h"
+#include "siminternal.h"
+#include <deque>
+#include <mutex>
+#include <string.h>
+
+// Most bytes a port buffers between a write and the matching read; older bytes are lost
+static const size_t LOOPBACK_CAPACITY = 64 * 1024;
+
+// GPIO of each ADC1 channel
+static const uint8_t ADC1_PINS[ADC1_CHANNEL_MAX] = {36, 37, 38, 39, 32, 33, 34, 35};
+
+// Simulated state of one I2S port
+struct I2sPort
+{
+    bool installed;           ///< Whether the driver is installed
+    i2s_config_t config;      ///< Configuration passed to i2s_driver_install
+    std::deque<uint8_t> fifo; ///< Bytes written and not read back yet
+    QueueHandle_t events;     ///< Event queue created by i2s_driver_install, or null
+    bool adcEnabled;          ///< Whether i2s_adc_enable started conversions
+    uint64_t adcStart;        ///< Virtual time of the first conversion in microseconds
+    uint64_t adcTaken;        ///< Conversions read or dropped since the start
+};
+
+static I2sPort ports[I2S_NUM_MAX];
+static adc1_channel_t adcChannel = ADC1_CHANNEL_0; ///< Channel chosen by i2s_set_adc_mode
+
+syscon_dev_t SYSCON;
+static std::mutex i2sMutex;
+
+namespace sim
+{
+    size_t i2sPending(int port)
+    {
+        std::lock_guard<std::mutex> lock(i2sMutex);
+        return port >= 0 && port < I2S_NUM_MAX ? ports[port].fifo.size() : 0;
+    }
+
+    void resetI2s()
+    {
+        std::lock_guard<std::mutex> lock(i2sMutex);
+        for (I2sPort &port : ports)
+        {
+            if (port.events != nullptr)
+            {
+                vQueueDelete(port.events);
+            }
+            port = I2sPort();
+        }
+        adcChannel = ADC1_CHANNEL_0;
+        SYSCON = syscon_dev_t();
+    }
+}
+
+// Get an installed port, or null; the caller holds i2sMutex
+static I2sPort *installedPort(i2s_port_t port)
+{
+    if (port < 0 || port >= I2S_NUM_MAX || !ports[port].installed)
+    {
+        return nullptr;
+    }
+    return &ports[port];
+}
+
+// Advance the clock by the time the port's frame clock takes to move a number of bytes
+static void spend(const i2s_config_t &config, size_t bytes)
+{
+    uint64_t channels = config.channel_format == I2S_CHANNEL_FMT_ONLY_LEFT || config.channel_format == I2S_CHANNEL_FMT_ONLY_RIGHT ? 1 : 2;
+    uint64_t bytesPerSecond = static_cast<uint64_t>(config.sample_rate) * channels * (config.bits_per_sample / 8);
+    if (bytesPerSecond > 0)
+    {
+        sim::advance((bytes * 1000000ULL + bytesPerSecond - 1) / bytesPerSecond);
+    }
+}
+
+// Deliver the conversions of a port in built-in ADC mode, as the DMA buffers would hold them: each
+// word is the channel in the top four bits over a 12-bit value, and the two words of each 32-bit
+// DMA word are swapped. The caller holds i2sMutex.
+static esp_err_t readConversions(I2sPort &state, uint16_t *words, size_t count, size_t *bytesRead, TickType_t ticksToWait)
+{
+    if (!state.adcEnabled)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    const uint64_t rate = state.config.sample_rate;
+    const uint64_t blockSize = state.config.dma_buf_len;
+    const uint64_t capacity = blockSize * state.config.dma_buf_count;
+    auto timeOf = [&](uint64_t conversion)
+    { return state.adcStart + conversion * 1000000 / rate; };
+
+    // Conversions finished so far; the DMA ring holds only the newest, dropping a buffer at a time
+    uint64_t done = (sim::now() - state.adcStart) * rate / 1000000 + 1;
+    while (done - state.adcTaken > capacity)
+    {
+        state.adcTaken += blockSize;
+        i2s_event_t event = {I2S_EVENT_RX_Q_OVF, static_cast<size_t>(blockSize * 2)};
+        if (state.events != nullptr)
+        {
+            xQueueSend(state.events, &event, 0);
+        }
+    }
+
+    // Wait for the rest, up to the timeout
+    uint64_t deadline = sim::now() + static_cast<uint64_t>(ticksToWait) * portTICK_PERIOD_MS * 1000;
+    uint64_t ready = std::min<uint64_t>(timeOf(state.adcTaken + count - 1), std::max(deadline, sim::now()));
+    sim::advanceTo(ready);
+    done = (sim::now() - state.adcStart) * rate / 1000000 + 1;
+    size_t available = static_cast<size_t>(std::min<uint64_t>(count, done - state.adcTaken)) & ~static_cast<size_t>(1);
+
+    // Conversions step through the ADC1 pattern table from its first entry
+    const uint32_t patternLength = SYSCON.saradc_ctrl.sar1_patt_len + 1;
+    for (size_t i = 0; i < available; ++i)
+    {
+        uint64_t conversion = state.adcTaken + i;
+        uint32_t entry = conversion % patternLength;
+        uint32_t channel = (SYSCON.saradc_sar1_patt_tab[entry / 4] >> (28 - entry % 4 * 8)) & 0x0F;
+        uint16_t value = channel < ADC1_CHANNEL_MAX ? sim::adcSample(ADC1_PINS[channel], timeOf(conversion)) : 0;
+        words[i ^ 1] = static_cast<uint16_t>((channel << 12) | value);
+    }
+    state.adcTaken += available;
+    if (bytesRead)
+    {
+        *bytesRead = available * 2;
+    }
+    return ESP_OK;
+}
+
+esp_err_t i2s_driver_install(i2s_port_t port, const i2s_config_t *config, int queueSize, void *queue)
+{
+    if (port < 0 || port >= I2S_NUM_MAX || config == nullptr)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    std::lock_guard<std::mutex> lock(i2sMutex);
+    if (ports[port].installed)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    ports[port].installed = true;
+    ports[port].config = *config;
+    ports[port].fifo.clear();
+    ports[port].adcEnabled = false;
+    if (queueSize > 0 && queue != nullptr)
+    {
+        ports[port].events = xQueueCreate(queueSize, sizeof(i2s_event_t));
+        *static_cast<QueueHandle_t *>(queue) = ports[port].events;
+    }
+    return ESP_OK;
+}
+
+esp_err_t i2s_driver_uninstall(i2s_port_t port)
+{
+    std::lock_guard<std::mutex> lock(i2sMutex);
+    I2sPort *state = installedPort(port);
+    if (state == nullptr)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    state->installed = false;
+    state->fifo.clear();
+    state->adcEnabled = false;
+    if (state->events != nullptr)
+    {
+        vQueueDelete(state->events);
+        state->events = nullptr;
+    }
+    return ESP_OK;
+}
+
+esp_err_t i2s_set_pin(i2s_port_t port, const i2s_pin_config_t *pins)
+{
+    std::lock_guard<std::mutex> lock(i2sMutex);
+    return installedPort(port) ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t i2s_set_sample_rates(i2s_port_t port, uint32_t rate)
+{
+    std::lock_guard<std::mutex> lock(i2sMutex);
+    I2sPort *state = installedPort(port);
+    if (state == nullptr)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    state->config.sample_rate = rate;
+    return ESP_OK;
+}
+
+esp_err_t i2s_zero_dma_buffer(i2s_port_t port)
+{
+    std::lock_guard<std::mutex> lock(i2sMutex);
+    I2sPort *state = installedPort(port);
+    if (state == nullptr)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    state->fifo.clear();
+    return ESP_OK;
+}
+
+esp_err_t i2s_read(i2s_port_t port, void *dest, size_t size, size_t *bytesRead, TickType_t ticksToWait)
+{
+    std::lock_guard<std::mutex> lock(i2sMutex);
+    I2sPort *state = installedPort(port);
+    if (state == nullptr)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (state->config.mode & I2S_MODE_ADC_BUILT_IN)
+    {
+        return readConversions(*state, static_cast<uint16_t *>(dest), size / 2, bytesRead, ticksToWait);
+    }
+    // Receive DMA never runs dry: once the looped-back data is used up, the line reads silence
+    uint8_t *bytes = static_cast<uint8_t *>(dest);
+    size_t looped = std::min(size, state->fifo.size());
+    std::copy(state->fifo.begin(), state->fifo.begin() + looped, bytes);
+    state->fifo.erase(state->fifo.begin(), state->fifo.begin() + looped);
+    memset(bytes + looped, 0, size - looped);
+    spend(state->config, size);
+    if (bytesRead)
+    {
+        *bytesRead = size;
+    }
+    return ESP_OK;
+}
+
+esp_err_t i2s_write(i2s_port_t port, const void *src, size_t size, size_t *bytesWritten, TickType_t ticksToWait)
+{
+    std::lock_guard<std::mutex> lock(i2sMutex);
+    I2sPort *state = installedPort(port);
+    if (state == nullptr)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    const uint8_t *bytes = static_cast<const uint8_t *>(src);
+    state->fifo.insert(state->fifo.end(), bytes, bytes + size);
+    if (state->fifo.size() > LOOPBACK_CAPACITY)
+    {
+        state->fifo.erase(state->fifo.begin(), state->fifo.begin() + (state->fifo.size() - LOOPBACK_CAPACITY));
+    }
+    spend(state->config, size);
+    if (bytesWritten)
+    {
+        *bytesWritten = size;
+    }
+    return ESP_OK;
+}
+
+esp_err_t i2s_set_adc_mode(adc_unit_t unit, adc1_channel_t channel)
+{
+    if (unit != ADC_UNIT_1 || channel < 0 || channel >= ADC1_CHANNEL_MAX)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    std::lock_guard<std::mutex> lock(i2sMutex);
+    adcChannel = channel;
+    return ESP_OK;
+}
+
+esp_err_t i2s_adc_enable(i2s_port_t port)
+{
+    std::lock_guard<std::mutex> lock(i2sMutex);
+    I2sPort *state = installedPort(port);
+    if (state == nullptr || port != I2S_NUM_0 || !(state->config.mode & I2S_MODE_ADC_BUILT_IN))
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    // Enabling restores the single-channel pattern of i2s_set_adc_mode, 12 bits at 11 dB
+    SYSCON.saradc_ctrl.sar1_patt_len = 0;
+    SYSCON.saradc_sar1_patt_tab[0] = static_cast<uint32_t>((adcChannel << 4) | (ADC_WIDTH_BIT_12 << 2) | ADC_ATTEN_DB_11) << 24;
+    state->adcEnabled = true;
+    state->adcStart = sim::now();
+    state->adcTaken = 0;
+    return ESP_OK;
+}
+
+esp_err_t i2s_start(i2s_port_t port)
+{
+    std::lock_guard<std::mutex> lock(i2sMutex);
+    I2sPort *state = installedPort(port);
+    if (state == nullptr)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    // Restarting resets the receive DMA; conversions start over from the first pattern entry
+    state->adcStart = sim::now();
+    state->adcTaken = 0;
+    return ESP_OK;
+}
+
+esp_err_t i2s_adc_disable(i2s_port_t port)
+{
+    std::lock_guard<std::mutex> lock(i2sMutex);
+    I2sPort *state = installedPort(port);
+    if (state == nullptr || !state->adcEnabled)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    state->adcEnabled = false;
+    return ESP_OK;
+}
@@ -0,0 +1,109 @@
+// ⚡🔌 Arduino-CTL 🔌⚡
+//
+// Copyright (C) 2024 ixaxaar
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <WiFi.h>
+#include <AsyncUDP.h>
+#include "sim.h"
+#include <map>
+#include <mutex>
+#include <stdio.h>
+
+WiFiClass WiFi;
+
+static std::map<uint16_t, AsyncUDP *> udpSockets;
+static std::mutex udpMutex;
+
+String IPAddress::toString() const
+{
+    char text[16];
+    snprintf(text, sizeof(text), "%u.%u.%u.%u", _address[0], _address[1], _address[2], _address[3]);
+    return String(text);
+}
+
+size_t IPAddress::printTo(Print &p) const
+{
+    return p.print(toString());
+}
+
+wl_status_t WiFiClass::begin(const char *ssid, const char *passphrase)
+{
+    _status = WL_CONNECTED;
+    return _status;
+}
+
+bool WiFiClass::disconnect(bool wifiOff)
+{
+    _status = WL_DISCONNECTED;
+    return true;
+}
+
+AsyncUDP::~AsyncUDP()
+{
+    close();
+}
+
+bool AsyncUDP::listen(uint16_t port)
+{
+    close();
+    std::lock_guard<std::mutex> lock(udpMutex);
+    if (udpSockets.count(port))
+    {
+        return false;
+    }
+    udpSockets[port] = this;
+    _port = port;
+    return true;
+}
+
+void AsyncUDP::close()
+{
+    std::lock_guard<std::mutex> lock(udpMutex);
+    if (_port != 0)
+    {
+        udpSockets.erase(_port);
+        _port = 0;
+    }
+}
+
+void AsyncUDP::receive(uint8_t *data, size_t length)
+{
+    if (_handler)
+    {
+        AsyncUDPPacket packet(data, length);
+        _handler(packet);
+    }
+}
+
+namespace sim
+{
+    bool udpSend(uint16_t port, const uint8_t *data, size_t length)
+    {
+        AsyncUDP *socket;
+        {
+            std::lock_guard<std::mutex> lock(udpMutex);
+            auto found = udpSockets.find(port);
+            if (found == udpSockets.end())
+            {
+                return false;
+            }
+            socket = found->second;
+        }
+        // The handler gets its own copy, as it would get the lwIP packet buffer
+        std::vector<uint8_t> packet(data, data + length);
+        socket->receive(packet.data(), packet.size());
+        return true;
+    }
+}
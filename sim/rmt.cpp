@@ -0,0 +1,232 @@
+// ⚡🔌 Arduino-CTL 🔌⚡
+//
+// Copyright (C) 2024 ixaxaar
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <driver/rmt.h>
+#include <Arduino.h>
+#include "sim.h"
+#include "siminternal.h"
+#include <mutex>
+
+// Frequency of the APB clock RMT channels divide down
+static const uint64_t APB_CLOCK_HZ = 80000000;
+
+// Simulated state of one RMT channel
+struct RmtChannel
+{
+    bool configured;         ///< Whether rmt_config was called
+    bool installed;          ///< Whether the driver is installed
+    rmt_config_t config;     ///< Configuration passed to rmt_config
+    bool looping;            ///< Whether a pattern is repeating until stopped
+    uint64_t endTime;        ///< Virtual time the last transmission ends, in microseconds
+};
+
+static RmtChannel channels[RMT_CHANNEL_MAX];
+static std::mutex rmtMutex;
+
+namespace sim
+{
+    bool rmtLooping(int channel)
+    {
+        std::lock_guard<std::mutex> lock(rmtMutex);
+        return channel >= 0 && channel < RMT_CHANNEL_MAX && channels[channel].looping;
+    }
+
+    void resetRmt()
+    {
+        std::lock_guard<std::mutex> lock(rmtMutex);
+        for (RmtChannel &channel : channels)
+        {
+            channel = RmtChannel();
+        }
+    }
+}
+
+// Get an installed channel, or null; the caller holds rmtMutex
+static RmtChannel *installedChannel(rmt_channel_t channel)
+{
+    if (channel < 0 || channel >= RMT_CHANNEL_MAX || !channels[channel].installed)
+    {
+        return nullptr;
+    }
+    return &channels[channel];
+}
+
+esp_err_t rmt_config(const rmt_config_t *config)
+{
+    if (config == nullptr || config->channel < 0 || config->channel >= RMT_CHANNEL_MAX || config->clk_div == 0 ||
+        config->mem_block_num == 0 || config->channel + config->mem_block_num > RMT_CHANNEL_MAX)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    std::lock_guard<std::mutex> lock(rmtMutex);
+    channels[config->channel].configured = true;
+    channels[config->channel].config = *config;
+    return ESP_OK;
+}
+
+esp_err_t rmt_driver_install(rmt_channel_t channel, size_t rxBufferSize, int intrAllocFlags)
+{
+    if (channel < 0 || channel >= RMT_CHANNEL_MAX)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    std::lock_guard<std::mutex> lock(rmtMutex);
+    if (channels[channel].installed || !channels[channel].configured)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    channels[channel].installed = true;
+    return ESP_OK;
+}
+
+esp_err_t rmt_driver_uninstall(rmt_channel_t channel)
+{
+    std::lock_guard<std::mutex> lock(rmtMutex);
+    RmtChannel *state = installedChannel(channel);
+    if (state == nullptr)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    state->installed = false;
+    state->looping = false;
+    return ESP_OK;
+}
+
+esp_err_t rmt_set_gpio(rmt_channel_t channel, rmt_mode_t mode, int gpio, bool invert)
+{
+    std::lock_guard<std::mutex> lock(rmtMutex);
+    if (channel < 0 || channel >= RMT_CHANNEL_MAX || gpio < 0 || gpio >= NUM_DIGITAL_PINS)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    channels[channel].config.gpio_num = gpio;
+    return ESP_OK;
+}
+
+esp_err_t rmt_set_idle_level(rmt_channel_t channel, bool enable, rmt_idle_level_t level)
+{
+    std::lock_guard<std::mutex> lock(rmtMutex);
+    if (channel < 0 || channel >= RMT_CHANNEL_MAX)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    channels[channel].config.tx_config.idle_output_en = enable;
+    channels[channel].config.tx_config.idle_level = level;
+    return ESP_OK;
+}
+
+esp_err_t rmt_set_tx_loop_mode(rmt_channel_t channel, bool loop)
+{
+    std::lock_guard<std::mutex> lock(rmtMutex);
+    if (channel < 0 || channel >= RMT_CHANNEL_MAX)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    channels[channel].config.tx_config.loop_en = loop;
+    return ESP_OK;
+}
+
+// Plays the items once from the current time; a looping pattern repeats only in
+// principle, since later repetitions would be stamped in the task's future
+esp_err_t rmt_write_items(rmt_channel_t channel, const rmt_item32_t *items, int count, bool waitTxDone)
+{
+    uint64_t end;
+    {
+        std::lock_guard<std::mutex> lock(rmtMutex);
+        RmtChannel *state = installedChannel(channel);
+        if (state == nullptr)
+        {
+            return ESP_ERR_INVALID_STATE;
+        }
+        const rmt_config_t &config = state->config;
+        const uint8_t pin = static_cast<uint8_t>(config.gpio_num);
+        const uint64_t start = sim::now();
+        uint64_t ticks = 0;
+        auto timeOf = [&](uint64_t tick)
+        { return start + tick * config.clk_div * 1000000 / APB_CLOCK_HZ; };
+        for (int i = 0; i < count; ++i)
+        {
+            const uint32_t durations[2] = {items[i].duration0, items[i].duration1};
+            const uint8_t levels[2] = {static_cast<uint8_t>(items[i].level0), static_cast<uint8_t>(items[i].level1)};
+            int half = 0;
+            for (; half < 2 && durations[half] != 0; ++half)
+            {
+                sim::drivePin(pin, timeOf(ticks), levels[half]);
+                ticks += durations[half];
+            }
+            if (half < 2)
+            {
+                break; // A zero duration ends the transmission
+            }
+        }
+        end = timeOf(ticks);
+        state->looping = config.tx_config.loop_en;
+        state->endTime = end;
+        if (!state->looping && config.tx_config.idle_output_en)
+        {
+            sim::drivePin(pin, end, config.tx_config.idle_level);
+        }
+    }
+    if (waitTxDone)
+    {
+        sim::advanceTo(end);
+    }
+    return ESP_OK;
+}
+
+esp_err_t rmt_wait_tx_done(rmt_channel_t channel, TickType_t ticksToWait)
+{
+    uint64_t end;
+    {
+        std::lock_guard<std::mutex> lock(rmtMutex);
+        RmtChannel *state = installedChannel(channel);
+        if (state == nullptr)
+        {
+            return ESP_ERR_INVALID_STATE;
+        }
+        if (state->looping)
+        {
+            sim::advance(static_cast<uint64_t>(ticksToWait) * portTICK_PERIOD_MS * 1000);
+            return ESP_ERR_TIMEOUT;
+        }
+        end = state->endTime;
+    }
+    uint64_t deadline = sim::now() + static_cast<uint64_t>(ticksToWait) * portTICK_PERIOD_MS * 1000;
+    if (end > deadline)
+    {
+        sim::advanceTo(deadline);
+        return ESP_ERR_TIMEOUT;
+    }
+    sim::advanceTo(end);
+    return ESP_OK;
+}
+
+esp_err_t rmt_tx_stop(rmt_channel_t channel)
+{
+    std::lock_guard<std::mutex> lock(rmtMutex);
+    RmtChannel *state = installedChannel(channel);
+    if (state == nullptr)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (state->looping && state->config.tx_config.idle_output_en)
+    {
+        sim::drivePin(static_cast<uint8_t>(state->config.gpio_num), sim::now(), state->config.tx_config.idle_level);
+    }
+    state->looping = false;
+    state->endTime = std::min(state->endTime, sim::now());
+    return ESP_OK;
+}
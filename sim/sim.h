@@ -0,0 +1,521 @@
+// ⚡🔌 Arduino-CTL 🔌⚡
+//
+// Copyright (C) 2024 ixaxaar
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Control and inspection API of the simulated hardware
+ *
+ * The headers in sim/ stand in for the Arduino core, ESP-IDF and the network
+ * libraries, so the library builds and runs on a Linux host. Tests use the
+ * functions below to drive inputs, attach virtual devices and send requests.
+ *
+ * Time is virtual: delays and bus transfers advance a per-task clock instead
+ * of sleeping, so the same workload always takes the same simulated time.
+ * Each task's clock follows causality: work handed over through a FreeRTOS
+ * queue or semaphore, a WebSocket message or an HTTP response moves the
+ * receiver's clock forward to the sender's, so tasks running in parallel
+ * finish at the latest of their clocks rather than the sum.
+ */
+namespace sim
+{
+    /**
+     * @brief Get the virtual time of the calling task
+     * @return Microseconds since the simulation started
+     */
+    uint64_t now();
+
+    /**
+     * @brief Move the calling task's clock forward
+     * @param micros Microseconds to advance
+     */
+    void advance(uint64_t micros);
+
+    /**
+     * @brief Move the calling task's clock forward to a point in time, if it is behind
+     * @param micros Target time in microseconds
+     */
+    void advanceTo(uint64_t micros);
+
+    /**
+     * @brief Reset all simulated hardware: pins, devices, files, I2S buffers, RMT channels and the calling task's clock
+     *
+     * Running tasks and registered web handlers are kept.
+     */
+    void reset();
+
+    /**
+     * @brief Shape of a waveform source
+     */
+    enum class Shape : uint8_t
+    {
+        Constant,
+        Sine,
+        Square,
+        Triangle,
+        Sawtooth,
+        Noise ///< Deterministic pseudo-random noise, a new value every microsecond
+    };
+
+    /**
+     * @brief A periodic voltage source for the virtual ADC
+     */
+    struct Waveform
+    {
+        Shape shape;      ///< Shape of the signal
+        double offset;    ///< DC offset in volts
+        double amplitude; ///< Peak amplitude in volts
+        double frequency; ///< Frequency in Hz (ignored for Constant and Noise)
+        double phase;     ///< Phase offset as a fraction of a period
+
+        /**
+         * @brief Evaluate the waveform
+         * @param micros Virtual time in microseconds
+         * @return The voltage
+         */
+        double at(uint64_t micros) const;
+    };
+
+    /**
+     * @brief Full-scale input voltage of the virtual ADC
+     */
+    const double ADC_FULL_SCALE_VOLTS = 3.3;
+
+    /**
+     * @brief Simulated duration of one analogRead conversion
+     */
+    const uint32_t ADC_CONVERSION_MICROS = 10;
+
+    /**
+     * @brief CPU clock frequency returned by getCpuFrequencyMhz
+     */
+    const uint32_t CPU_MHZ = 240;
+
+    /**
+     * @brief CPU cycles one read of the cycle counter takes, so polling loops advance the clock
+     */
+    const uint32_t CYCLE_COUNT_READ_CYCLES = 24;
+
+    /**
+     * @brief A level change of a pin, as driven by digitalWrite
+     */
+    struct Edge
+    {
+        uint64_t time; ///< Virtual time of the change in microseconds
+        uint8_t level; ///< New level (LOW or HIGH)
+    };
+
+    /**
+     * @brief Drive a pin from outside, as a button or another board would
+     *
+     * @param pin The pin number
+     * @param level The level digitalRead returns while the pin is an input
+     */
+    void setInput(uint8_t pin, uint8_t level);
+
+    /**
+     * @brief Stop driving a pin from outside, so it floats or follows its pull resistor
+     * @param pin The pin number
+     */
+    void releaseInput(uint8_t pin);
+
+    /**
+     * @brief Connect a voltage source to a pin, read by analogRead and (thresholded) digitalRead
+     *
+     * @param pin The pin number
+     * @param waveform The source
+     */
+    void setAnalogSource(uint8_t pin, const Waveform &waveform);
+
+    /**
+     * @brief Get the mode last set by pinMode
+     * @param pin The pin number
+     * @return The mode, or 0 if pinMode was never called
+     */
+    uint8_t pinModeOf(uint8_t pin);
+
+    /**
+     * @brief Get the level last written by digitalWrite
+     * @param pin The pin number
+     * @return LOW or HIGH
+     */
+    uint8_t outputLevel(uint8_t pin);
+
+    /**
+     * @brief Get the value last written by analogWrite
+     * @param pin The pin number
+     * @return The duty value, or -1 if analogWrite was never called
+     */
+    int analogOutput(uint8_t pin);
+
+    /**
+     * @brief Get the level changes of a pin since the last reset
+     *
+     * Only the most recent EDGE_HISTORY changes are kept.
+     *
+     * @param pin The pin number
+     * @return The changes, oldest first
+     */
+    std::vector<Edge> edges(uint8_t pin);
+
+    /**
+     * @brief Number of level changes kept per pin
+     */
+    const size_t EDGE_HISTORY = 4096;
+
+    /**
+     * @brief A virtual I2C target device
+     *
+     * Called on the task that runs the transaction, with the bus locked.
+     */
+    class I2cDevice
+    {
+    public:
+        virtual ~I2cDevice() {}
+
+        /**
+         * @brief Receive the bytes of a write transaction
+         *
+         * @param data The bytes written by the controller
+         * @param length Number of bytes
+         */
+        virtual void write(const uint8_t *data, size_t length) = 0;
+
+        /**
+         * @brief Answer a read transaction
+         *
+         * @param data Buffer to fill
+         * @param length Number of bytes the controller requested
+         * @return Number of bytes provided
+         */
+        virtual size_t read(uint8_t *data, size_t length) = 0;
+    };
+
+    /**
+     * @brief An I2C device with 256 byte-wide registers, as most sensors have
+     *
+     * The first byte of a write selects the register; the following bytes are
+     * stored from there on. Reads continue from the selected register. Both
+     * auto-increment the register pointer.
+     */
+    class RegisterDevice : public I2cDevice
+    {
+    public:
+        RegisterDevice();
+        void write(const uint8_t *data, size_t length) override;
+        size_t read(uint8_t *data, size_t length) override;
+
+        /**
+         * @brief Set a register value, as the device itself would
+         *
+         * @param reg Register address
+         * @param value New value
+         */
+        void setRegister(uint8_t reg, uint8_t value) { _registers[reg] = value; }
+
+        /**
+         * @brief Get a register value
+         * @param reg Register address
+         * @return The value
+         */
+        uint8_t getRegister(uint8_t reg) const { return _registers[reg]; }
+
+    private:
+        uint8_t _registers[256]; ///< Register file
+        uint8_t _pointer;        ///< Register selected for the next access
+    };
+
+    /**
+     * @brief An I2C device whose behaviour is given by callbacks
+     */
+    class ScriptedI2cDevice : public I2cDevice
+    {
+    public:
+        typedef std::function<void(const uint8_t *, size_t)> WriteHandler;
+        typedef std::function<size_t(uint8_t *, size_t)> ReadHandler;
+
+        /**
+         * @brief Constructor for ScriptedI2cDevice
+         *
+         * @param onWrite Called with the bytes of each write
+         * @param onRead Called to fill each read; returns the number of bytes provided
+         */
+        ScriptedI2cDevice(WriteHandler onWrite, ReadHandler onRead) : _onWrite(onWrite), _onRead(onRead) {}
+        void write(const uint8_t *data, size_t length) override { _onWrite(data, length); }
+        size_t read(uint8_t *data, size_t length) override { return _onRead(data, length); }
+
+    private:
+        WriteHandler _onWrite; ///< Write callback
+        ReadHandler _onRead;   ///< Read callback
+    };
+
+    /**
+     * @brief Connect a device to the I2C bus
+     *
+     * @param address 7-bit address the device answers to
+     * @param device The device
+     */
+    void attachI2c(uint8_t address, std::shared_ptr<I2cDevice> device);
+
+    /**
+     * @brief Disconnect the device at an I2C address
+     * @param address 7-bit address
+     */
+    void detachI2c(uint8_t address);
+
+    /**
+     * @brief A virtual SPI target device
+     */
+    class SpiDevice
+    {
+    public:
+        virtual ~SpiDevice() {}
+
+        /**
+         * @brief Called when the chip select pin goes low
+         */
+        virtual void select() {}
+
+        /**
+         * @brief Exchange one byte
+         * @param mosi Byte sent by the controller
+         * @return Byte sent back on MISO
+         */
+        virtual uint8_t transfer(uint8_t mosi) = 0;
+
+        /**
+         * @brief Called when the chip select pin goes high
+         */
+        virtual void deselect() {}
+    };
+
+    /**
+     * @brief An SPI device that echoes MOSI back on MISO, as a jumper wire between the two would
+     */
+    class SpiLoopback : public SpiDevice
+    {
+    public:
+        uint8_t transfer(uint8_t mosi) override { return mosi; }
+    };
+
+    /**
+     * @brief An SPI device whose behaviour is given by a callback
+     */
+    class ScriptedSpiDevice : public SpiDevice
+    {
+    public:
+        typedef std::function<uint8_t(uint8_t)> TransferHandler;
+
+        /**
+         * @brief Constructor for ScriptedSpiDevice
+         * @param onTransfer Called with each byte sent; returns the byte sent back
+         */
+        explicit ScriptedSpiDevice(TransferHandler onTransfer) : _onTransfer(onTransfer) {}
+        uint8_t transfer(uint8_t mosi) override { return _onTransfer(mosi); }
+
+    private:
+        TransferHandler _onTransfer; ///< Transfer callback
+    };
+
+    /**
+     * @brief Connect a device to the SPI bus
+     *
+     * The device takes part in transfers while its chip select pin is low.
+     * Transfers with no device selected read 0xFF, as a floating MISO line does.
+     *
+     * @param csPin The chip select pin of the device
+     * @param device The device
+     */
+    void attachSpi(uint8_t csPin, std::shared_ptr<SpiDevice> device);
+
+    /**
+     * @brief Disconnect the device on a chip select pin
+     * @param csPin The chip select pin
+     */
+    void detachSpi(uint8_t csPin);
+
+    /**
+     * @brief Number of bytes written to an I2S port that have not been read back yet
+     *
+     * The data output of each port is looped back to its data input.
+     *
+     * @param port The I2S port number
+     * @return Number of buffered bytes
+     */
+    size_t i2sPending(int port);
+
+    /**
+     * @brief Whether an RMT channel is repeating a pattern until it is stopped
+     *
+     * A looping pattern is played onto its pin once; the repetitions are not simulated.
+     *
+     * @param channel The RMT channel number
+     * @return true while the pattern loops
+     */
+    bool rmtLooping(int channel);
+
+    /**
+     * @brief Create or replace a file in the simulated SPIFFS
+     *
+     * @param path Absolute path of the file
+     * @param contents New contents
+     */
+    void writeFile(const std::string &path, const std::string &contents);
+
+    /**
+     * @brief Read a file from the simulated SPIFFS
+     *
+     * @param path Absolute path of the file
+     * @param contents Receives the contents
+     * @return true if the file exists
+     */
+    bool readFile(const std::string &path, std::string &contents);
+
+    /**
+     * @brief Get and clear everything printed to Serial so far
+     * @return The printed text
+     */
+    std::string takeSerialOutput();
+
+    /**
+     * @brief Response to a simulated HTTP request
+     */
+    struct HttpResponse
+    {
+        int code;                                                  ///< Status code, or 0 if the handler never answered
+        std::string contentType;                                   ///< Content type
+        std::vector<std::pair<std::string, std::string>> headers;  ///< Headers added by the handler
+        std::string body;                                          ///< Complete body, with chunked responses reassembled
+
+        /**
+         * @brief Get a response header
+         * @param name Header name, compared case-insensitively
+         * @return The value, or null if the header is not set
+         */
+        const char *header(const std::string &name) const;
+    };
+
+    /**
+     * @brief Send an HTTP request to the AsyncWebServer listening on a port
+     *
+     * Runs the handlers on the calling task. The body is delivered in
+     * TCP-segment-sized pieces, as AsyncTCP would, and responses that ask to
+     * be polled again are polled until they complete.
+     *
+     * @param method Request method, such as "GET" or "POST"
+     * @param url Path and optional query string
+     * @param body Request body
+     * @param headers Request headers
+     * @param port Port of the server
+     * @return The response
+     */
+    HttpResponse http(const std::string &method, const std::string &url, const std::string &body = std::string(),
+                      const std::vector<std::pair<std::string, std::string>> &headers = std::vector<std::pair<std::string, std::string>>(),
+                      uint16_t port = 80);
+
+    /**
+     * @brief Maximum payload of a simulated TCP segment
+     */
+    const size_t TCP_SEGMENT_SIZE = 1436;
+
+    struct WebSocketConnection;
+
+    /**
+     * @brief Client end of a simulated WebSocket connection
+     *
+     * Connects on construction and disconnects on destruction.
+     */
+    class WebSocket
+    {
+    public:
+        /**
+         * @brief A message received from the server
+         */
+        struct Message
+        {
+            bool binary;      ///< Whether it was a binary message
+            std::string data; ///< The payload
+        };
+
+        /**
+         * @brief Connect to an AsyncWebSocket handler
+         *
+         * @param path URL of the handler
+         * @param port Port of the server
+         */
+        explicit WebSocket(const std::string &path, uint16_t port = 80);
+        ~WebSocket();
+
+        /**
+         * @brief Check whether the handshake found a handler
+         * @return true if connected and not closed by the server
+         */
+        bool connected() const;
+
+        /**
+         * @brief Send a message
+         *
+         * @param data The payload
+         * @param binary Whether to send a binary rather than a text message
+         * @param fragment Largest frame to send; longer messages are split into continuation frames (0 for one frame)
+         */
+        void send(const std::string &data, bool binary = false, size_t fragment = 0);
+
+        /**
+         * @brief Wait for the next message from the server
+         *
+         * @param message Receives the message
+         * @param timeoutMs Longest real time to wait, in milliseconds
+         * @return true if a message arrived, false on timeout or when the server closed the connection
+         */
+        bool receive(Message &message, uint32_t timeoutMs = 1000);
+
+        /**
+         * @brief Get the close code sent by the server
+         * @return The code, or 0 while the connection is open
+         */
+        uint16_t closeCode() const;
+
+    private:
+        WebSocket(const WebSocket &) = delete;
+        WebSocket &operator=(const WebSocket &) = delete;
+
+        std::shared_ptr<WebSocketConnection> _connection; ///< State shared with the server end
+    };
+
+    /**
+     * @brief Deliver a UDP datagram to the AsyncUDP socket listening on a port
+     *
+     * Runs the packet handler on the calling task.
+     *
+     * @param port Destination port
+     * @param data The payload
+     * @param length Payload length in bytes
+     * @return true if a socket was listening
+     */
+    bool udpSend(uint16_t port, const uint8_t *data, size_t length);
+}
+
+#endif // SIM_H
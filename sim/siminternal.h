@@ -0,0 +1,60 @@
+// ⚡🔌 Arduino-CTL 🔌⚡
+//
+// Copyright (C) 2024 ixaxaar
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SIM_INTERNAL_H
+#define SIM_INTERNAL_H
+
+#include <stdint.h>
+
+// Hooks between the parts of the simulation; not for use by tests
+namespace sim
+{
+    void resetClock();
+    void resetPins();
+    void resetI2c();
+    void resetSpi();
+    void resetI2s();
+    void resetRmt();
+    void resetFiles();
+
+    /**
+     * @brief Tell the SPI bus that a pin changed level, for chip select
+     *
+     * @param pin The pin
+     * @param level Its new level
+     */
+    void spiPinChanged(uint8_t pin, uint8_t level);
+
+    /**
+     * @brief Change the output level of a pin at a given time, as a peripheral driving it would
+     *
+     * @param pin The pin
+     * @param time Virtual time of the change in microseconds
+     * @param level The new level
+     */
+    void drivePin(uint8_t pin, uint64_t time, uint8_t level);
+
+    /**
+     * @brief Convert the voltage of a pin at a given time, as the ADC's DMA path would
+     *
+     * @param pin The pin
+     * @param time Virtual time of the conversion in microseconds
+     * @return The 12-bit conversion, whatever analogReadResolution set
+     */
+    uint16_t adcSample(uint8_t pin, uint64_t time);
+}
+
+#endif // SIM_INTERNAL_H
@@ -0,0 +1,71 @@
+// ⚡🔌 Arduino-CTL 🔌⚡
+//
+// Copyright (C) 2024 ixaxaar
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SIM_SOC_GPIO_STRUCT_H
+#define SIM_SOC_GPIO_STRUCT_H
+
+// Host stand-in for the ESP32 GPIO register block: register writes and reads act on the simulated pins
+
+#include <stdint.h>
+
+/**
+ * @brief A write-1-to-set or write-1-to-clear output register
+ *
+ * @tparam Bank 0 for GPIO0-31, 1 for GPIO32-39
+ * @tparam Set true for the set register, false for the clear register
+ */
+template <int Bank, bool Set>
+struct SimGpioOutputRegister
+{
+    SimGpioOutputRegister &operator=(uint32_t mask);
+};
+
+/**
+ * @brief An input register, reading the levels of the 32 pins of a bank
+ *
+ * @tparam Bank 0 for GPIO0-31, 1 for GPIO32-39
+ */
+template <int Bank>
+struct SimGpioInputRegister
+{
+    operator uint32_t() const;
+};
+
+/**
+ * @brief The registers of the GPIO block the library uses, under their ESP-IDF names
+ */
+typedef struct
+{
+    SimGpioOutputRegister<0, true> out_w1ts;
+    SimGpioOutputRegister<0, false> out_w1tc;
+    struct
+    {
+        SimGpioOutputRegister<1, true> val;
+    } out1_w1ts;
+    struct
+    {
+        SimGpioOutputRegister<1, false> val;
+    } out1_w1tc;
+    SimGpioInputRegister<0> in;
+    struct
+    {
+        SimGpioInputRegister<1> val;
+    } in1;
+} gpio_dev_t;
+
+extern gpio_dev_t GPIO;
+
+#endif // SIM_SOC_GPIO_STRUCT_H
@@ -0,0 +1,58 @@
+// ⚡🔌 Arduino-CTL 🔌⚡
+//
+// Copyright (C) 2024 ixaxaar
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SIM_SOC_SYSCON_STRUCT_H
+#define SIM_SOC_SYSCON_STRUCT_H
+
+// Host stand-in for the ESP32 SYSCON register block: the SAR ADC1 pattern table the I2S-ADC path converts from
+
+#include <stdint.h>
+
+/**
+ * @brief The registers of the SYSCON block the library uses, under their ESP-IDF names
+ *
+ * Each pattern table word holds four entries, the first in the top byte; an
+ * entry is the channel in its top four bits over the bit width and attenuation.
+ */
+typedef struct
+{
+    union
+    {
+        struct
+        {
+            uint32_t start_force : 1;
+            uint32_t start : 1;
+            uint32_t sar2_mux : 1;
+            uint32_t work_mode : 2;
+            uint32_t sar_sel : 1;
+            uint32_t sar_clk_gated : 1;
+            uint32_t sar_clk_div : 8;
+            uint32_t sar1_patt_len : 4; ///< Number of ADC1 pattern entries minus one
+            uint32_t sar2_patt_len : 4;
+            uint32_t sar1_patt_p_clear : 1;
+            uint32_t sar2_patt_p_clear : 1;
+            uint32_t data_sar_sel : 1;
+            uint32_t data_to_i2s : 1;
+            uint32_t reserved27 : 5;
+        };
+        uint32_t val;
+    } saradc_ctrl;
+    uint32_t saradc_sar1_patt_tab[4]; ///< ADC1 pattern table, 16 entries
+} syscon_dev_t;
+
+extern syscon_dev_t SYSCON;
+
+#endif // SIM_SOC_SYSCON_STRUCT_H
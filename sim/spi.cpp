@@ -0,0 +1,135 @@
+// ⚡🔌 Arduino-CTL 🔌⚡
+//
+// Copyright (C) 2024 ixaxaar
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <SPI.h>
+#include "sim.h"
+#include "siminternal.h"
+#include <map>
+#include <mutex>
+
+SPIClass SPI;
+
+static std::map<uint8_t, std::shared_ptr<sim::SpiDevice>> spiDevices;
+static std::map<uint8_t, bool> spiSelected; // Chip select pins currently low
+static std::recursive_mutex spiMutex;       // Devices may toggle pins, which calls back into spiPinChanged
+
+namespace sim
+{
+    void attachSpi(uint8_t csPin, std::shared_ptr<SpiDevice> device)
+    {
+        std::lock_guard<std::recursive_mutex> lock(spiMutex);
+        spiDevices[csPin] = device;
+        spiSelected[csPin] = false;
+    }
+
+    void detachSpi(uint8_t csPin)
+    {
+        std::lock_guard<std::recursive_mutex> lock(spiMutex);
+        spiDevices.erase(csPin);
+        spiSelected.erase(csPin);
+    }
+
+    void resetSpi()
+    {
+        std::lock_guard<std::recursive_mutex> lock(spiMutex);
+        spiDevices.clear();
+        spiSelected.clear();
+    }
+
+    void spiPinChanged(uint8_t pin, uint8_t level)
+    {
+        std::lock_guard<std::recursive_mutex> lock(spiMutex);
+        auto device = spiDevices.find(pin);
+        if (device == spiDevices.end())
+        {
+            return;
+        }
+        bool selected = level == LOW;
+        if (spiSelected[pin] == selected)
+        {
+            return;
+        }
+        spiSelected[pin] = selected;
+        if (selected)
+        {
+            device->second->select();
+        }
+        else
+        {
+            device->second->deselect();
+        }
+    }
+}
+
+void SPIClass::begin(int8_t sck, int8_t miso, int8_t mosi, int8_t ss) {}
+
+void SPIClass::end() {}
+
+void SPIClass::beginTransaction(SPISettings settings)
+{
+    _settings = settings;
+}
+
+void SPIClass::endTransaction() {}
+
+uint8_t SPIClass::transfer(uint8_t data)
+{
+    sim::advance((8ULL * 1000000 + _settings._clock - 1) / _settings._clock);
+    std::lock_guard<std::recursive_mutex> lock(spiMutex);
+    // Every selected device sees MOSI; their MISO outputs are wired-AND, and an idle line reads high
+    uint8_t received = 0xFF;
+    for (auto &device : spiDevices)
+    {
+        if (spiSelected[device.first])
+        {
+            received &= device.second->transfer(data);
+        }
+    }
+    return received;
+}
+
+uint16_t SPIClass::transfer16(uint16_t data)
+{
+    uint8_t high = transfer(static_cast<uint8_t>(data >> 8));
+    uint8_t low = transfer(static_cast<uint8_t>(data));
+    return static_cast<uint16_t>((high << 8) | low);
+}
+
+void SPIClass::transfer(void *data, uint32_t size)
+{
+    uint8_t *bytes = static_cast<uint8_t *>(data);
+    for (uint32_t i = 0; i < size; ++i)
+    {
+        bytes[i] = transfer(bytes[i]);
+    }
+}
+
+void SPIClass::transferBytes(const uint8_t *data, uint8_t *out, uint32_t size)
+{
+    for (uint32_t i = 0; i < size; ++i)
+    {
+        uint8_t received = transfer(data ? data[i] : 0xFF);
+        if (out)
+        {
+            out[i] = received;
+        }
+    }
+}
+
+void SPIClass::writeBytes(const uint8_t *data, uint32_t size)
+{
+    transferBytes(data, nullptr, size);
+}
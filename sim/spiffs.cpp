@@ -0,0 +1,212 @@
+// ⚡🔌 Arduino-CTL 🔌⚡
+//
+// Copyright (C) 2024 ixaxaar
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <SPIFFS.h>
+#include "sim.h"
+#include "siminternal.h"
+#include <map>
+#include <mutex>
+
+fs::SPIFFSFS SPIFFS;
+
+// Capacity reported by the simulated partition, that of the default 1.5 MB SPIFFS layout
+static const size_t SPIFFS_CAPACITY = 1374476;
+
+namespace fs
+{
+    struct FileData
+    {
+        std::string contents; ///< The bytes of the file
+    };
+}
+
+static std::map<std::string, std::shared_ptr<fs::FileData>> files;
+static std::mutex fileMutex;
+
+namespace sim
+{
+    void writeFile(const std::string &path, const std::string &contents)
+    {
+        std::lock_guard<std::mutex> lock(fileMutex);
+        std::shared_ptr<fs::FileData> &file = files[path];
+        file = std::make_shared<fs::FileData>();
+        file->contents = contents;
+    }
+
+    bool readFile(const std::string &path, std::string &contents)
+    {
+        std::lock_guard<std::mutex> lock(fileMutex);
+        auto file = files.find(path);
+        if (file == files.end())
+        {
+            return false;
+        }
+        contents = file->second->contents;
+        return true;
+    }
+
+    void resetFiles()
+    {
+        std::lock_guard<std::mutex> lock(fileMutex);
+        files.clear();
+    }
+}
+
+namespace fs
+{
+    File::File(std::shared_ptr<FileData> data, const char *path, bool writable, bool append)
+        : _data(data), _path(path), _position(append ? data->contents.size() : 0), _writable(writable)
+    {
+    }
+
+    size_t File::write(uint8_t c)
+    {
+        return write(&c, 1);
+    }
+
+    size_t File::write(const uint8_t *buffer, size_t size)
+    {
+        if (!_data || !_writable)
+        {
+            return 0;
+        }
+        std::lock_guard<std::mutex> lock(fileMutex);
+        std::string &contents = _data->contents;
+        if (_position > contents.size())
+        {
+            contents.resize(_position);
+        }
+        contents.replace(_position, std::min(size, contents.size() - _position), reinterpret_cast<const char *>(buffer), size);
+        _position += size;
+        return size;
+    }
+
+    int File::available()
+    {
+        std::lock_guard<std::mutex> lock(fileMutex);
+        return _data && _position < _data->contents.size() ? static_cast<int>(_data->contents.size() - _position) : 0;
+    }
+
+    int File::read()
+    {
+        uint8_t c;
+        return read(&c, 1) == 1 ? c : -1;
+    }
+
+    int File::peek()
+    {
+        std::lock_guard<std::mutex> lock(fileMutex);
+        return _data && _position < _data->contents.size() ? static_cast<uint8_t>(_data->contents[_position]) : -1;
+    }
+
+    size_t File::read(uint8_t *buffer, size_t size)
+    {
+        std::lock_guard<std::mutex> lock(fileMutex);
+        if (!_data || _position >= _data->contents.size())
+        {
+            return 0;
+        }
+        size_t count = std::min(size, _data->contents.size() - _position);
+        memcpy(buffer, _data->contents.data() + _position, count);
+        _position += count;
+        return count;
+    }
+
+    bool File::seek(uint32_t position)
+    {
+        if (!_data)
+        {
+            return false;
+        }
+        _position = position;
+        return true;
+    }
+
+    size_t File::size() const
+    {
+        std::lock_guard<std::mutex> lock(fileMutex);
+        return _data ? _data->contents.size() : 0;
+    }
+
+    File FS::open(const char *path, const char *mode)
+    {
+        std::lock_guard<std::mutex> lock(fileMutex);
+        auto file = files.find(path);
+        if (mode[0] == 'r' && mode[1] != '+')
+        {
+            return file == files.end() ? File() : File(file->second, path, false, false);
+        }
+        std::shared_ptr<FileData> &data = files[path];
+        if (!data || mode[0] == 'w')
+        {
+            data = std::make_shared<FileData>();
+        }
+        return File(data, path, true, mode[0] == 'a');
+    }
+
+    bool FS::exists(const char *path)
+    {
+        std::lock_guard<std::mutex> lock(fileMutex);
+        return files.count(path) > 0;
+    }
+
+    bool FS::remove(const char *path)
+    {
+        std::lock_guard<std::mutex> lock(fileMutex);
+        return files.erase(path) > 0;
+    }
+
+    bool FS::rename(const char *from, const char *to)
+    {
+        std::lock_guard<std::mutex> lock(fileMutex);
+        auto file = files.find(from);
+        if (file == files.end())
+        {
+            return false;
+        }
+        std::shared_ptr<FileData> data = file->second;
+        files.erase(file);
+        files[to] = data;
+        return true;
+    }
+
+    bool SPIFFSFS::begin(bool formatOnFail, const char *basePath, uint8_t maxOpenFiles, const char *partitionLabel)
+    {
+        return true;
+    }
+
+    bool SPIFFSFS::format()
+    {
+        sim::resetFiles();
+        return true;
+    }
+
+    size_t SPIFFSFS::totalBytes()
+    {
+        return SPIFFS_CAPACITY;
+    }
+
+    size_t SPIFFSFS::usedBytes()
+    {
+        std::lock_guard<std::mutex> lock(fileMutex);
+        size_t used = 0;
+        for (const auto &file : files)
+        {
+            used += file.second->contents.size();
+        }
+        return used;
+    }
+}
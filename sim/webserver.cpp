@@ -0,0 +1,737 @@
+// ⚡🔌 Arduino-CTL 🔌⚡
+//
+// Copyright (C) 2024 ixaxaar
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <ESPAsyncWebServer.h>
+#include "sim.h"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <thread>
+
+// Longest real time a response may keep asking to be polled again before the request gives up
+static const std::chrono::seconds POLL_TIMEOUT(30);
+
+static std::mutex serverMutex;
+
+// Servers are global objects in other translation units, so the registry must exist before they register
+static std::vector<AsyncWebServer *> &servers()
+{
+    static std::vector<AsyncWebServer *> registered;
+    return registered;
+}
+
+namespace sim
+{
+    // State shared by the two ends of a simulated WebSocket connection
+    struct WebSocketConnection
+    {
+        struct Delivery
+        {
+            WebSocket::Message message; ///< The message
+            uint64_t sent;              ///< Virtual time of the sending task
+        };
+
+        AsyncWebSocket *socket = nullptr;  ///< Server end, or null if the handshake failed
+        uint32_t id = 0;                   ///< Client ID on the server end
+        std::mutex mutex;                  ///< Guards the fields below
+        std::condition_variable changed;   ///< Signalled when a message arrives or the server closes
+        std::deque<Delivery> inbox;        ///< Messages from the server not received yet
+        uint16_t closeCode = 0;            ///< Close code sent by the server, 0 while open
+    };
+}
+
+static std::string toStdString(const String &value)
+{
+    return std::string(value.c_str(), value.length());
+}
+
+size_t AsyncBasicResponse::fillBody(uint8_t *buffer, size_t maxLen, size_t index)
+{
+    if (index >= _content.size())
+    {
+        return 0;
+    }
+    size_t count = std::min(maxLen, _content.size() - index);
+    memcpy(buffer, _content.data() + index, count);
+    return count;
+}
+
+size_t AsyncCallbackResponse::fillBody(uint8_t *buffer, size_t maxLen, size_t index)
+{
+    if (_length != SIZE_MAX)
+    {
+        if (index >= _length)
+        {
+            return 0;
+        }
+        maxLen = std::min(maxLen, _length - index);
+    }
+    return _filler(buffer, maxLen, index);
+}
+
+size_t AsyncResponseStream::write(uint8_t data)
+{
+    _content += static_cast<char>(data);
+    return 1;
+}
+
+size_t AsyncResponseStream::write(const uint8_t *data, size_t length)
+{
+    _content.append(reinterpret_cast<const char *>(data), length);
+    return length;
+}
+
+size_t AsyncResponseStream::fillBody(uint8_t *buffer, size_t maxLen, size_t index)
+{
+    if (index >= _content.size())
+    {
+        return 0;
+    }
+    size_t count = std::min(maxLen, _content.size() - index);
+    memcpy(buffer, _content.data() + index, count);
+    return count;
+}
+
+AsyncWebServerRequest::AsyncWebServerRequest(AsyncWebServer *server, WebRequestMethodComposite method, const String &url,
+                                             const std::vector<AsyncWebParameter> &params, const std::vector<AsyncWebHeader> &headers, size_t contentLength)
+    : _tempObject(nullptr), _server(server), _method(method), _url(url), _params(params), _headers(headers), _contentLength(contentLength), _response(nullptr)
+{
+}
+
+AsyncWebServerRequest::~AsyncWebServerRequest()
+{
+    free(_tempObject);
+    delete _response;
+    if (_onDisconnect)
+    {
+        _onDisconnect();
+    }
+}
+
+void AsyncWebServerRequest::send(AsyncWebServerResponse *response)
+{
+    // Like the real server, only the first response of a request is sent
+    if (_response != nullptr)
+    {
+        delete response;
+        return;
+    }
+    _response = response;
+}
+
+void AsyncWebServerRequest::send(int code, const String &contentType, const String &content)
+{
+    send(beginResponse(code, contentType, content));
+}
+
+void AsyncWebServerRequest::send(int code, const String &contentType, const uint8_t *content, size_t length)
+{
+    send(beginResponse(code, contentType, content, length));
+}
+
+void AsyncWebServerRequest::send(const String &contentType, size_t length, AwsResponseFiller callback)
+{
+    send(beginResponse(contentType, length, callback));
+}
+
+AsyncWebServerResponse *AsyncWebServerRequest::beginResponse(int code, const String &contentType, const String &content)
+{
+    return new AsyncBasicResponse(code, contentType, toStdString(content));
+}
+
+AsyncWebServerResponse *AsyncWebServerRequest::beginResponse(int code, const String &contentType, const uint8_t *content, size_t length)
+{
+    return new AsyncBasicResponse(code, contentType, std::string(reinterpret_cast<const char *>(content), length));
+}
+
+AsyncWebServerResponse *AsyncWebServerRequest::beginResponse(const String &contentType, size_t length, AwsResponseFiller callback)
+{
+    return new AsyncCallbackResponse(contentType, length, callback);
+}
+
+AsyncWebServerResponse *AsyncWebServerRequest::beginChunkedResponse(const String &contentType, AwsResponseFiller callback)
+{
+    return new AsyncCallbackResponse(contentType, SIZE_MAX, callback);
+}
+
+AsyncResponseStream *AsyncWebServerRequest::beginResponseStream(const String &contentType, size_t bufferSize)
+{
+    return new AsyncResponseStream(contentType);
+}
+
+bool AsyncWebServerRequest::hasParam(const String &name, bool post, bool file) const
+{
+    return getParam(name, post, file) != nullptr;
+}
+
+AsyncWebParameter *AsyncWebServerRequest::getParam(const String &name, bool post, bool file) const
+{
+    for (const AsyncWebParameter &param : _params)
+    {
+        if (param.name() == name && param.isPost() == post && param.isFile() == file)
+        {
+            return const_cast<AsyncWebParameter *>(&param);
+        }
+    }
+    return nullptr;
+}
+
+AsyncWebParameter *AsyncWebServerRequest::getParam(size_t index) const
+{
+    return index < _params.size() ? const_cast<AsyncWebParameter *>(&_params[index]) : nullptr;
+}
+
+bool AsyncWebServerRequest::hasHeader(const String &name) const
+{
+    return getHeader(name) != nullptr;
+}
+
+AsyncWebHeader *AsyncWebServerRequest::getHeader(const String &name) const
+{
+    for (const AsyncWebHeader &header : _headers)
+    {
+        if (header.name().equalsIgnoreCase(name))
+        {
+            return const_cast<AsyncWebHeader *>(&header);
+        }
+    }
+    return nullptr;
+}
+
+bool AsyncCallbackWebHandler::canHandle(AsyncWebServerRequest *request)
+{
+    if (!_onRequest || !(_method & request->method()))
+    {
+        return false;
+    }
+    std::string uri = toStdString(_uri);
+    std::string url = toStdString(request->url());
+    return url == uri || url.compare(0, uri.size() + 1, uri + "/") == 0;
+}
+
+void AsyncCallbackWebHandler::handleRequest(AsyncWebServerRequest *request)
+{
+    if (_onRequest)
+    {
+        _onRequest(request);
+    }
+    else
+    {
+        request->send(500);
+    }
+}
+
+void AsyncCallbackWebHandler::handleBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total)
+{
+    if (_onBody)
+    {
+        _onBody(request, data, len, index, total);
+    }
+}
+
+AsyncWebServer::AsyncWebServer(uint16_t port) : _port(port), _listening(false)
+{
+    std::lock_guard<std::mutex> lock(serverMutex);
+    servers().push_back(this);
+}
+
+AsyncWebServer::~AsyncWebServer()
+{
+    std::lock_guard<std::mutex> lock(serverMutex);
+    servers().erase(std::remove(servers().begin(), servers().end(), this), servers().end());
+}
+
+AsyncWebHandler &AsyncWebServer::addHandler(AsyncWebHandler *handler)
+{
+    _handlers.push_back(handler);
+    return *handler;
+}
+
+bool AsyncWebServer::removeHandler(AsyncWebHandler *handler)
+{
+    auto found = std::find(_handlers.begin(), _handlers.end(), handler);
+    if (found == _handlers.end())
+    {
+        return false;
+    }
+    _handlers.erase(found);
+    return true;
+}
+
+AsyncCallbackWebHandler &AsyncWebServer::on(const char *uri, ArRequestHandlerFunction onRequest)
+{
+    return on(uri, HTTP_ANY, onRequest, nullptr, nullptr);
+}
+
+AsyncCallbackWebHandler &AsyncWebServer::on(const char *uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest)
+{
+    return on(uri, method, onRequest, nullptr, nullptr);
+}
+
+AsyncCallbackWebHandler &AsyncWebServer::on(const char *uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest, ArUploadHandlerFunction onUpload)
+{
+    return on(uri, method, onRequest, onUpload, nullptr);
+}
+
+AsyncCallbackWebHandler &AsyncWebServer::on(const char *uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest, ArUploadHandlerFunction onUpload, ArBodyHandlerFunction onBody)
+{
+    AsyncCallbackWebHandler *handler = new AsyncCallbackWebHandler();
+    handler->setUri(uri);
+    handler->setMethod(method);
+    handler->onRequest(onRequest);
+    handler->onUpload(onUpload);
+    handler->onBody(onBody);
+    _callbackHandlers.emplace_back(handler);
+    addHandler(handler);
+    return *handler;
+}
+
+void AsyncWebServer::reset()
+{
+    _handlers.clear();
+    _callbackHandlers.clear();
+    _notFound = nullptr;
+}
+
+AsyncWebHandler *AsyncWebServer::findHandler(AsyncWebServerRequest *request)
+{
+    for (AsyncWebHandler *handler : _handlers)
+    {
+        if (handler->canHandle(request))
+        {
+            return handler;
+        }
+    }
+    return nullptr;
+}
+
+void AsyncWebServer::handleNotFound(AsyncWebServerRequest *request)
+{
+    if (_notFound)
+    {
+        _notFound(request);
+    }
+    else
+    {
+        request->send(404);
+    }
+}
+
+AsyncWebSocketClient::AsyncWebSocketClient(AsyncWebSocket *server, uint32_t id, std::shared_ptr<sim::WebSocketConnection> connection)
+    : _tempObject(nullptr), _server(server), _id(id), _connection(connection)
+{
+}
+
+AwsClientStatus AsyncWebSocketClient::status() const
+{
+    std::lock_guard<std::mutex> lock(_connection->mutex);
+    return _connection->closeCode == 0 ? WS_CONNECTED : WS_DISCONNECTING;
+}
+
+void AsyncWebSocketClient::close(uint16_t code, const char *message)
+{
+    std::lock_guard<std::mutex> lock(_connection->mutex);
+    if (_connection->closeCode == 0)
+    {
+        _connection->closeCode = code != 0 ? code : 1000;
+        _connection->changed.notify_all();
+    }
+}
+
+// Queue a message for the client end, stamped with the sending task's clock
+static void deliver(sim::WebSocketConnection &connection, bool binary, const char *data, size_t len)
+{
+    std::lock_guard<std::mutex> lock(connection.mutex);
+    if (connection.closeCode != 0)
+    {
+        return;
+    }
+    connection.inbox.push_back({{binary, std::string(data, len)}, sim::now()});
+    connection.changed.notify_all();
+}
+
+void AsyncWebSocketClient::text(const char *message, size_t len)
+{
+    deliver(*_connection, false, message, len);
+}
+
+void AsyncWebSocketClient::binary(const uint8_t *message, size_t len)
+{
+    deliver(*_connection, true, reinterpret_cast<const char *>(message), len);
+}
+
+size_t AsyncWebSocket::count() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _clients.size();
+}
+
+AsyncWebSocketClient *AsyncWebSocket::client(uint32_t id)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (const auto &client : _clients)
+    {
+        if (client->id() == id)
+        {
+            return client.get();
+        }
+    }
+    return nullptr;
+}
+
+void AsyncWebSocket::close(uint32_t id, uint16_t code, const char *message)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (const auto &client : _clients)
+    {
+        if (client->id() == id)
+        {
+            client->close(code, message);
+        }
+    }
+}
+
+void AsyncWebSocket::text(uint32_t id, const char *message, size_t len)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (const auto &client : _clients)
+    {
+        if (client->id() == id)
+        {
+            client->text(message, len);
+        }
+    }
+}
+
+void AsyncWebSocket::binary(uint32_t id, const uint8_t *message, size_t len)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (const auto &client : _clients)
+    {
+        if (client->id() == id)
+        {
+            client->binary(message, len);
+        }
+    }
+}
+
+void AsyncWebSocket::textAll(const char *message, size_t len)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (const auto &client : _clients)
+    {
+        client->text(message, len);
+    }
+}
+
+void AsyncWebSocket::cleanupClients(uint16_t maxClients)
+{
+    // Close the oldest clients beyond the limit, as the real server does
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (size_t i = 0; i + maxClients < _clients.size(); ++i)
+    {
+        _clients[i]->close();
+    }
+}
+
+uint32_t AsyncWebSocket::connect(std::shared_ptr<sim::WebSocketConnection> connection)
+{
+    AsyncWebSocketClient *client;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        client = new AsyncWebSocketClient(this, _nextId++, connection);
+        _clients.emplace_back(client);
+    }
+    if (_eventHandler)
+    {
+        _eventHandler(this, client, WS_EVT_CONNECT, nullptr, nullptr, 0);
+    }
+    return client->id();
+}
+
+void AsyncWebSocket::receive(uint32_t id, AwsFrameInfo &info, uint8_t *data, size_t len)
+{
+    AsyncWebSocketClient *receiver = client(id);
+    if (receiver != nullptr && _eventHandler)
+    {
+        _eventHandler(this, receiver, WS_EVT_DATA, &info, data, len);
+    }
+}
+
+void AsyncWebSocket::disconnect(uint32_t id)
+{
+    AsyncWebSocketClient *leaving = client(id);
+    if (leaving == nullptr)
+    {
+        return;
+    }
+    if (_eventHandler)
+    {
+        _eventHandler(this, leaving, WS_EVT_DISCONNECT, nullptr, nullptr, 0);
+    }
+    std::lock_guard<std::mutex> lock(_mutex);
+    _clients.erase(std::remove_if(_clients.begin(), _clients.end(), [id](const std::unique_ptr<AsyncWebSocketClient> &client)
+                                  { return client->id() == id; }),
+                   _clients.end());
+}
+
+// Find the server listening on a port
+static AsyncWebServer *findServer(uint16_t port)
+{
+    std::lock_guard<std::mutex> lock(serverMutex);
+    for (AsyncWebServer *server : servers())
+    {
+        if (server->port() == port && server->listening())
+        {
+            return server;
+        }
+    }
+    return nullptr;
+}
+
+static WebRequestMethodComposite parseMethod(const std::string &method)
+{
+    static const struct
+    {
+        const char *name;
+        WebRequestMethod method;
+    } METHODS[] = {{"GET", HTTP_GET}, {"POST", HTTP_POST}, {"DELETE", HTTP_DELETE}, {"PUT", HTTP_PUT}, {"PATCH", HTTP_PATCH}, {"HEAD", HTTP_HEAD}, {"OPTIONS", HTTP_OPTIONS}};
+    for (const auto &entry : METHODS)
+    {
+        if (method == entry.name)
+        {
+            return entry.method;
+        }
+    }
+    return 0;
+}
+
+static std::string urlDecode(const std::string &text)
+{
+    std::string decoded;
+    for (size_t i = 0; i < text.size(); ++i)
+    {
+        if (text[i] == '+')
+        {
+            decoded += ' ';
+        }
+        else if (text[i] == '%' && i + 2 < text.size() && isxdigit(static_cast<unsigned char>(text[i + 1])) && isxdigit(static_cast<unsigned char>(text[i + 2])))
+        {
+            decoded += static_cast<char>(strtol(text.substr(i + 1, 2).c_str(), nullptr, 16));
+            i += 2;
+        }
+        else
+        {
+            decoded += text[i];
+        }
+    }
+    return decoded;
+}
+
+namespace sim
+{
+    const char *HttpResponse::header(const std::string &name) const
+    {
+        for (const auto &entry : headers)
+        {
+            if (String(entry.first.c_str()).equalsIgnoreCase(String(name.c_str())))
+            {
+                return entry.second.c_str();
+            }
+        }
+        return nullptr;
+    }
+
+    HttpResponse http(const std::string &method, const std::string &url, const std::string &body,
+                      const std::vector<std::pair<std::string, std::string>> &headers, uint16_t port)
+    {
+        HttpResponse result = {0, std::string(), {}, std::string()};
+        AsyncWebServer *server = findServer(port);
+        if (server == nullptr)
+        {
+            return result;
+        }
+
+        size_t queryStart = url.find('?');
+        std::string path = url.substr(0, queryStart);
+        std::vector<AsyncWebParameter> params;
+        if (queryStart != std::string::npos)
+        {
+            std::string query = url.substr(queryStart + 1);
+            size_t start = 0;
+            while (start <= query.size())
+            {
+                size_t end = query.find('&', start);
+                std::string pair = query.substr(start, end == std::string::npos ? std::string::npos : end - start);
+                if (!pair.empty())
+                {
+                    size_t equals = pair.find('=');
+                    std::string name = urlDecode(pair.substr(0, equals));
+                    std::string value = equals == std::string::npos ? std::string() : urlDecode(pair.substr(equals + 1));
+                    params.push_back(AsyncWebParameter(name.c_str(), value.c_str()));
+                }
+                if (end == std::string::npos)
+                {
+                    break;
+                }
+                start = end + 1;
+            }
+        }
+        std::vector<AsyncWebHeader> requestHeaders;
+        for (const auto &header : headers)
+        {
+            requestHeaders.push_back(AsyncWebHeader(header.first.c_str(), header.second.c_str()));
+        }
+
+        std::unique_ptr<AsyncWebServerRequest> request(new AsyncWebServerRequest(server, parseMethod(method), path.c_str(), params, requestHeaders, body.size()));
+        AsyncWebHandler *handler = server->findHandler(request.get());
+        if (handler == nullptr)
+        {
+            server->handleNotFound(request.get());
+        }
+        else
+        {
+            // The body arrives one TCP segment at a time, in a buffer the handler may not keep
+            std::vector<uint8_t> segment;
+            for (size_t index = 0; index < body.size(); index += TCP_SEGMENT_SIZE)
+            {
+                size_t length = std::min(TCP_SEGMENT_SIZE, body.size() - index);
+                segment.assign(body.begin() + index, body.begin() + index + length);
+                handler->handleBody(request.get(), segment.data(), length, index, body.size());
+            }
+            handler->handleRequest(request.get());
+        }
+
+        AsyncWebServerResponse *response = request->response();
+        if (response == nullptr)
+        {
+            return result;
+        }
+        result.code = response->code();
+        result.contentType = toStdString(response->contentType());
+        for (const AsyncWebHeader &header : response->headers())
+        {
+            result.headers.push_back(std::make_pair(toStdString(header.name()), toStdString(header.value())));
+        }
+        uint8_t buffer[TCP_SEGMENT_SIZE];
+        std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + POLL_TIMEOUT;
+        for (;;)
+        {
+            size_t count = response->fillBody(buffer, sizeof(buffer), result.body.size());
+            if (count == RESPONSE_TRY_AGAIN)
+            {
+                if (std::chrono::steady_clock::now() > deadline)
+                {
+                    result.code = 0;
+                    break;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+            if (count == 0)
+            {
+                break;
+            }
+            result.body.append(reinterpret_cast<const char *>(buffer), count);
+        }
+        return result;
+    }
+
+    WebSocket::WebSocket(const std::string &path, uint16_t port) : _connection(std::make_shared<WebSocketConnection>())
+    {
+        AsyncWebServer *server = findServer(port);
+        if (server == nullptr)
+        {
+            return;
+        }
+        for (AsyncWebHandler *handler : server->handlers())
+        {
+            AsyncWebSocket *socket = dynamic_cast<AsyncWebSocket *>(handler);
+            if (socket != nullptr && path == socket->url())
+            {
+                _connection->socket = socket;
+                _connection->id = socket->connect(_connection);
+                return;
+            }
+        }
+    }
+
+    WebSocket::~WebSocket()
+    {
+        if (_connection->socket != nullptr)
+        {
+            _connection->socket->disconnect(_connection->id);
+        }
+    }
+
+    bool WebSocket::connected() const
+    {
+        std::lock_guard<std::mutex> lock(_connection->mutex);
+        return _connection->socket != nullptr && _connection->closeCode == 0;
+    }
+
+    void WebSocket::send(const std::string &data, bool binary, size_t fragment)
+    {
+        if (!connected())
+        {
+            return;
+        }
+        size_t frameSize = fragment == 0 ? data.size() : fragment;
+        size_t offset = 0;
+        uint32_t num = 0;
+        std::vector<uint8_t> frame;
+        do
+        {
+            size_t length = std::min(frameSize, data.size() - offset);
+            AwsFrameInfo info = {};
+            info.message_opcode = binary ? WS_BINARY : WS_TEXT;
+            info.num = num;
+            info.final = offset + length == data.size();
+            info.masked = 1;
+            info.opcode = num == 0 ? info.message_opcode : WS_CONTINUATION;
+            info.len = length;
+            info.index = 0;
+            // Text frames arrive NUL-terminated, as the real server leaves them
+            frame.assign(data.begin() + offset, data.begin() + offset + length);
+            frame.push_back(0);
+            _connection->socket->receive(_connection->id, info, frame.data(), length);
+            offset += length;
+            ++num;
+        } while (offset < data.size());
+    }
+
+    bool WebSocket::receive(Message &message, uint32_t timeoutMs)
+    {
+        std::unique_lock<std::mutex> lock(_connection->mutex);
+        WebSocketConnection &connection = *_connection;
+        connection.changed.wait_for(lock, std::chrono::milliseconds(timeoutMs), [&connection]()
+                                    { return !connection.inbox.empty() || connection.closeCode != 0; });
+        if (connection.inbox.empty())
+        {
+            return false;
+        }
+        message = connection.inbox.front().message;
+        advanceTo(connection.inbox.front().sent);
+        connection.inbox.pop_front();
+        return true;
+    }
+
+    uint16_t WebSocket::closeCode() const
+    {
+        std::lock_guard<std::mutex> lock(_connection->mutex);
+        return _connection->closeCode;
+    }
+}
@@ -0,0 +1,191 @@
+// ⚡🔌 Arduino-CTL 🔌⚡
+//
+// Copyright (C) 2024 ixaxaar
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <Wire.h>
+#include "sim.h"
+#include "siminternal.h"
+#include <map>
+#include <mutex>
+
+TwoWire Wire;
+
+static std::map<uint8_t, std::shared_ptr<sim::I2cDevice>> i2cDevices;
+static std::mutex i2cMutex; // The bus is shared by every TwoWire instance and task
+
+namespace sim
+{
+    RegisterDevice::RegisterDevice() : _pointer(0)
+    {
+        memset(_registers, 0, sizeof(_registers));
+    }
+
+    void RegisterDevice::write(const uint8_t *data, size_t length)
+    {
+        if (length == 0)
+        {
+            return;
+        }
+        _pointer = data[0];
+        for (size_t i = 1; i < length; ++i)
+        {
+            _registers[_pointer++] = data[i];
+        }
+    }
+
+    size_t RegisterDevice::read(uint8_t *data, size_t length)
+    {
+        for (size_t i = 0; i < length; ++i)
+        {
+            data[i] = _registers[_pointer++];
+        }
+        return length;
+    }
+
+    void attachI2c(uint8_t address, std::shared_ptr<I2cDevice> device)
+    {
+        std::lock_guard<std::mutex> lock(i2cMutex);
+        i2cDevices[address & 0x7F] = device;
+    }
+
+    void detachI2c(uint8_t address)
+    {
+        std::lock_guard<std::mutex> lock(i2cMutex);
+        i2cDevices.erase(address & 0x7F);
+    }
+
+    void resetI2c()
+    {
+        std::lock_guard<std::mutex> lock(i2cMutex);
+        i2cDevices.clear();
+    }
+}
+
+// Find the device at an address; the caller holds i2cMutex
+static sim::I2cDevice *findDevice(uint16_t address)
+{
+    auto device = i2cDevices.find(static_cast<uint8_t>(address & 0x7F));
+    return device == i2cDevices.end() ? nullptr : device->second.get();
+}
+
+TwoWire::TwoWire() : _frequency(100000), _txAddress(0), _txLength(0), _rxLength(0), _rxIndex(0) {}
+
+bool TwoWire::begin(int sda, int scl, uint32_t frequency)
+{
+    if (frequency != 0)
+    {
+        _frequency = frequency;
+    }
+    return true;
+}
+
+bool TwoWire::end()
+{
+    return true;
+}
+
+bool TwoWire::setClock(uint32_t frequency)
+{
+    if (frequency == 0)
+    {
+        return false;
+    }
+    _frequency = frequency;
+    return true;
+}
+
+void TwoWire::spend(size_t bytes) const
+{
+    // Start and stop take about one clock period each; every byte, the address included, takes nine
+    uint64_t clocks = 2 + 9 * (bytes + 1);
+    sim::advance((clocks * 1000000 + _frequency - 1) / _frequency);
+}
+
+void TwoWire::beginTransmission(uint16_t address)
+{
+    _txAddress = address;
+    _txLength = 0;
+}
+
+uint8_t TwoWire::endTransmission(bool sendStop)
+{
+    size_t length = _txLength;
+    _txLength = 0;
+    std::lock_guard<std::mutex> lock(i2cMutex);
+    sim::I2cDevice *device = findDevice(_txAddress);
+    if (device == nullptr)
+    {
+        spend(0);
+        return 2; // Address not acknowledged
+    }
+    spend(length);
+    if (length > 0)
+    {
+        device->write(_txBuffer, length);
+    }
+    return 0;
+}
+
+size_t TwoWire::requestFrom(uint16_t address, size_t size, bool sendStop)
+{
+    _rxIndex = 0;
+    _rxLength = 0;
+    size = std::min(size, static_cast<size_t>(I2C_BUFFER_LENGTH));
+    std::lock_guard<std::mutex> lock(i2cMutex);
+    sim::I2cDevice *device = findDevice(address);
+    if (device == nullptr)
+    {
+        spend(0);
+        return 0;
+    }
+    _rxLength = std::min(device->read(_rxBuffer, size), size);
+    spend(_rxLength);
+    return _rxLength;
+}
+
+size_t TwoWire::write(uint8_t data)
+{
+    if (_txLength >= I2C_BUFFER_LENGTH)
+    {
+        return 0;
+    }
+    _txBuffer[_txLength++] = data;
+    return 1;
+}
+
+size_t TwoWire::write(const uint8_t *data, size_t length)
+{
+    size_t written = 0;
+    while (written < length && write(data[written]))
+    {
+        ++written;
+    }
+    return written;
+}
+
+int TwoWire::available()
+{
+    return static_cast<int>(_rxLength - _rxIndex);
+}
+
+int TwoWire::read()
+{
+    return _rxIndex < _rxLength ? _rxBuffer[_rxIndex++] : -1;
+}
+
+int TwoWire::peek()
+{
+    return _rxIndex < _rxLength ? _rxBuffer[_rxIndex] : -1;
+}
@@ -16,27 +16,67 @@
 
 #include "I2Cctl.h"
 #include <sstream>
-#include "base64.hpp"
+#include "base64codec.h"
+#include "params.h"
+
+namespace
+{
+struct InitParams
+{
+    int sdaPin;
+    int sclPin;
+    uint32_t frequency;
+};
+
+struct ReadFromDeviceParams
+{
+    uint8_t address = 0;
+    size_t numBytes = 0;
+};
+
+struct WriteToDeviceParams
+{
+    uint8_t address = 0;
+    const std::string *data = nullptr;
+};
+
+struct SetClockParams
+{
+    uint32_t frequency = 100000;
+};
+}
+
+// Wire receives into a buffer of this size; longer reads would be cut short
+static const size_t MAX_READ_BYTES = I2C_BUFFER_LENGTH;
+
+// Parameter schemas; getSupportedFunctions() describes the commands from the same arrays
+static constexpr ParamSpec<InitParams> INIT_PARAMS[] = {
+    integerParam<InitParams, int, &InitParams::sdaPin>("sdaPin", "int", -1, NUM_DIGITAL_PINS - 1),
+    integerParam<InitParams, int, &InitParams::sclPin>("sclPin", "int", -1, NUM_DIGITAL_PINS - 1),
+    integerParam<InitParams, uint32_t, &InitParams::frequency>("frequency", "uint32_t", 1)};
+
+static constexpr ParamSpec<ReadFromDeviceParams> READ_FROM_DEVICE_PARAMS[] = {
+    integerParam<ReadFromDeviceParams, uint8_t, &ReadFromDeviceParams::address>("address", "uint8_t", 0, 0x7F),
+    integerParam<ReadFromDeviceParams, size_t, &ReadFromDeviceParams::numBytes>("numBytes", "size_t", 0, MAX_READ_BYTES)};
+
+static constexpr ParamSpec<WriteToDeviceParams> WRITE_TO_DEVICE_PARAMS[] = {
+    integerParam<WriteToDeviceParams, uint8_t, &WriteToDeviceParams::address>("address", "uint8_t", 0, 0x7F),
+    textParam<WriteToDeviceParams, &WriteToDeviceParams::data>("data", "std::vector<uint8_t>")};
+
+static constexpr ParamSpec<SetClockParams> SET_CLOCK_PARAMS[] = {
+    integerParam<SetClockParams, uint32_t, &SetClockParams::frequency>("frequency", "uint32_t", 1)};
 
 I2CCtl::I2CCtl() : _sdaPin(SDA), _sclPin(SCL), _frequency(100000) {}
 
 void I2CCtl::init(const std::vector<std::pair<std::string, std::string>> &params)
 {
-    for (const auto &param : params)
-    {
-        if (param.first == "sdaPin")
-        {
-            _sdaPin = std::stoi(param.second);
-        }
-        else if (param.first == "sclPin")
-        {
-            _sclPin = std::stoi(param.second);
-        }
-        else if (param.first == "frequency")
-        {
-            _frequency = std::stoul(param.second);
-        }
-    }
+    // Invalid values keep the current setting
+    InitParams args = {_sdaPin, _sclPin, _frequency};
+    ParamError error;
+    bindParams(INIT_PARAMS, params, args, error);
+    _sdaPin = args.sdaPin;
+    _sclPin = args.sclPin;
+    _frequency = args.frequency;
     Wire.begin(_sdaPin, _sclPin);
     setClock(_frequency);
 }
@@ -46,92 +86,84 @@ void I2CCtl::deinit()
     Wire.end();
 }
 
-std::pair<std::string, void *> I2CCtl::execute(const std::string &command, const std::vector<std::pair<std::string, std::string>> &params)
+const I2CCtl::Handler I2CCtl::handlers[I2CCtl::OP_COUNT] = {
+    &I2CCtl::handleReadFromDevice,
+    &I2CCtl::handleWriteToDevice,
+    &I2CCtl::handleSetClock};
+
+void I2CCtl::dispatch(uint16_t opcode, const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result)
 {
-    if (command == "readFromDevice")
+    if (opcode >= OP_COUNT)
     {
-        uint8_t address = 0;
-        size_t numBytes = 0;
-        for (const auto &param : params)
-        {
-            if (param.first == "address")
-            {
-                address = std::stoul(param.second);
-            }
-            else if (param.first == "numBytes")
-            {
-                numBytes = std::stoul(param.second);
-            }
-        }
-        std::vector<uint8_t> result = readFromDevice(address, numBytes);
-        return {"std::vector<uint8_t>", new std::vector<uint8_t>(result)};
+        result.setError("Command not found");
+        return;
     }
-    else if (command == "writeToDevice")
+    (this->*handlers[opcode])(params, result);
+}
+
+std::vector<FunctionInfo> I2CCtl::getSupportedFunctions()
+{
+    // Entries are listed in Opcode order; the position of each entry is its opcode
+    return {
+        describeCommand("readFromDevice", READ_FROM_DEVICE_PARAMS, ResultType::Bytes, true),
+        describeCommand("writeToDevice", WRITE_TO_DEVICE_PARAMS),
+        describeCommand("setClock", SET_CLOCK_PARAMS)};
+}
+
+void I2CCtl::handleReadFromDevice(const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result)
+{
+    ReadFromDeviceParams args;
+    if (bindParams(READ_FROM_DEVICE_PARAMS, params, args, result))
+    {
+        readFromDevice(args.address, args.numBytes, result);
+    }
+}
+
+void I2CCtl::handleWriteToDevice(const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result)
+{
+    WriteToDeviceParams args;
+    if (!bindParams(WRITE_TO_DEVICE_PARAMS, params, args, result))
     {
-        uint8_t address = 0;
-        std::vector<uint8_t> data;
-        for (const auto &param : params)
-        {
-            if (param.first == "address")
-            {
-                address = std::stoul(param.second);
-            }
-            else if (param.first == "data")
-            {
-                data.resize(decode_base64_length(reinterpret_cast<const unsigned char *>(param.second.c_str())));
-                decode_base64(reinterpret_cast<const unsigned char *>(param.second.c_str()), param.second.length(), data.data());
-            }
-        }
-        writeToDevice(address, data);
-        return {"", nullptr};
+        return;
     }
-    else if (command == "setClock")
+    _buffer.clear();
+    if (args.data != nullptr && !base64Decode(*args.data, _buffer))
     {
-        uint32_t frequency = 100000;
-        for (const auto &param : params)
-        {
-            if (param.first == "frequency")
-            {
-                frequency = std::stoul(param.second);
-                break;
-            }
-        }
-        setClock(frequency);
-        return {"", nullptr};
+        result.setError("Invalid base64 data", "data");
+        return;
     }
-    return {"", nullptr};
+    writeToDevice(args.address, _buffer);
 }
 
-std::vector<FunctionInfo> I2CCtl::getSupportedFunctions()
+void I2CCtl::handleSetClock(const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result)
 {
-    return {
-        {"readFromDevice", {{"address", "uint8_t"}, {"numBytes", "size_t"}}},
-        {"writeToDevice", {{"address", "uint8_t"}, {"data", "std::vector<uint8_t>"}}},
-        {"setClock", {{"frequency", "uint32_t"}}}};
+    SetClockParams args;
+    if (bindParams(SET_CLOCK_PARAMS, params, args, result))
+    {
+        setClock(args.frequency);
+    }
 }
 
-std::vector<uint8_t> I2CCtl::readFromDevice(uint8_t address, size_t numBytes)
+void I2CCtl::readFromDevice(uint8_t address, size_t numBytes, ResultSink &result)
 {
     Wire.beginTransmission(address);
     Wire.requestFrom(address, numBytes);
 
-    std::vector<uint8_t> data;
-    while (Wire.available())
+    uint8_t *data = result.allocBytes(numBytes);
+    size_t count = 0;
+    while (Wire.available() && count < numBytes)
     {
-        data.push_back(Wire.read());
+        data[count++] = Wire.read();
     }
+    result.setSize(count);
 
     Wire.endTransmission();
-    return data;
 }
 
 void I2CCtl::writeToDevice(uint8_t address, const std::vector<uint8_t> &data)
 {
     Wire.beginTransmission(address);
-    for (uint8_t byte : data)
-    {
-        Wire.write(byte);
-    }
+    Wire.write(data.data(), data.size());
     Wire.endTransmission();
 }
 
@@ -16,7 +16,39 @@
 
 #include "I2Sctl.h"
 #include <sstream>
-#include "base64.hpp"
+#include "base64codec.h"
+#include "params.h"
+
+namespace
+{
+struct InitParams
+{
+    int i2sPort;
+};
+
+struct ReadDataParams
+{
+    size_t numBytes = 0;
+};
+
+struct WriteDataParams
+{
+    const std::string *data = nullptr;
+};
+}
+
+// Most bytes one readData takes, bounding its result buffer
+static const size_t MAX_READ_BYTES = 16384;
+
+// Parameter schemas; getSupportedFunctions() describes the commands from the same arrays
+static constexpr ParamSpec<InitParams> INIT_PARAMS[] = {
+    integerParam<InitParams, int, &InitParams::i2sPort>("i2sPort", "int", I2S_NUM_0, I2S_NUM_MAX - 1)};
+
+static constexpr ParamSpec<ReadDataParams> READ_DATA_PARAMS[] = {
+    integerParam<ReadDataParams, size_t, &ReadDataParams::numBytes>("numBytes", "size_t", 0, MAX_READ_BYTES)};
+
+static constexpr ParamSpec<WriteDataParams> WRITE_DATA_PARAMS[] = {
+    textParam<WriteDataParams, &WriteDataParams::data>("data", "std::vector<uint8_t>")};
 
 I2SCtl::I2SCtl() : _i2sPort(I2S_NUM_0)
 {
@@ -41,13 +73,11 @@ I2SCtl::I2SCtl() : _i2sPort(I2S_NUM_0)
 
 void I2SCtl::init(const std::vector<std::pair<std::string, std::string>> &params)
 {
-    for (const auto &param : params)
-    {
-        if (param.first == "i2sPort")
-        {
-            _i2sPort = (i2s_port_t)std::stoi(param.second);
-        }
-    }
+    // An invalid port keeps the current one
+    InitParams args = {_i2sPort};
+    ParamError error;
+    bindParams(INIT_PARAMS, params, args, error);
+    _i2sPort = (i2s_port_t)args.i2sPort;
     i2s_driver_install(_i2sPort, &_i2sConfig, 0, NULL);
     i2s_set_pin(_i2sPort, &_i2sPins);
 }
@@ -57,54 +87,59 @@ void I2SCtl::deinit()
     i2s_driver_uninstall(_i2sPort);
 }
 
-std::pair<std::string, void *> I2SCtl::execute(const std::string &command, const std::vector<std::pair<std::string, std::string>> &params)
+const I2SCtl::Handler I2SCtl::handlers[I2SCtl::OP_COUNT] = {
+    &I2SCtl::handleReadData,
+    &I2SCtl::handleWriteData};
+
+void I2SCtl::dispatch(uint16_t opcode, const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result)
 {
-    if (command == "readData")
+    if (opcode >= OP_COUNT)
     {
-        size_t numBytes = 0;
-        for (const auto &param : params)
-        {
-            if (param.first == "numBytes")
-            {
-                numBytes = std::stoul(param.second);
-                break;
-            }
-        }
-        std::vector<uint8_t> result = readData(numBytes);
-        return {"std::vector<uint8_t>", new std::vector<uint8_t>(result)};
+        result.setError("Command not found");
+        return;
     }
-    else if (command == "writeData")
-    {
-        std::vector<uint8_t> data;
-        for (const auto &param : params)
-        {
-            if (param.first == "data")
-            {
-                data.resize(decode_base64_length(reinterpret_cast<const unsigned char *>(param.second.c_str())));
-                decode_base64(reinterpret_cast<const unsigned char *>(param.second.c_str()), param.second.length(), data.data());
-                break;
-            }
-        }
-        writeData(data);
-        return {"", nullptr};
-    }
-    return {"", nullptr};
+    (this->*handlers[opcode])(params, result);
 }
 
 std::vector<FunctionInfo> I2SCtl::getSupportedFunctions()
 {
+    // Entries are listed in Opcode order; the position of each entry is its opcode
     return {
-        {"readData", {{"numBytes", "size_t"}}},
-        {"writeData", {{"data", "std::vector<uint8_t>"}}}};
+        describeCommand("readData", READ_DATA_PARAMS, ResultType::Bytes),
+        describeCommand("writeData", WRITE_DATA_PARAMS)};
+}
+
+void I2SCtl::handleReadData(const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result)
+{
+    ReadDataParams args;
+    if (bindParams(READ_DATA_PARAMS, params, args, result))
+    {
+        readData(args.numBytes, result);
+    }
+}
+
+void I2SCtl::handleWriteData(const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result)
+{
+    WriteDataParams args;
+    if (!bindParams(WRITE_DATA_PARAMS, params, args, result))
+    {
+        return;
+    }
+    _buffer.clear();
+    if (args.data != nullptr && !base64Decode(*args.data, _buffer))
+    {
+        result.setError("Invalid base64 data", "data");
+        return;
+    }
+    writeData(_buffer);
 }
 
-std::vector<uint8_t> I2SCtl::readData(size_t numBytes)
+void I2SCtl::readData(size_t numBytes, ResultSink &result)
 {
-    std::vector<uint8_t> data(numBytes);
-    size_t bytesRead;
-    i2s_read(_i2sPort, data.data(), numBytes, &bytesRead, portMAX_DELAY);
-    data.resize(bytesRead);
-    return data;
+    uint8_t *data = result.allocBytes(numBytes);
+    size_t bytesRead = 0;
+    i2s_read(_i2sPort, data, numBytes, &bytesRead, portMAX_DELAY);
+    result.setSize(bytesRead);
 }
 
 void I2SCtl::writeData(const std::vector<uint8_t> &data)
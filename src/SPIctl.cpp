@@ -16,31 +16,59 @@
 
 #include "SPIctl.h"
 #include <sstream>
-#include "base64.hpp"
+#include "base64codec.h"
+#include "params.h"
+
+namespace
+{
+struct InitParams
+{
+    int sckPin;
+    int misoPin;
+    int mosiPin;
+    int ssPin;
+};
+
+struct TransferParams
+{
+    const std::string *data = nullptr;
+};
+
+struct SetSettingsParams
+{
+    uint32_t clock = 4000000;
+    uint8_t bitOrder = MSBFIRST;
+    uint8_t dataMode = SPI_MODE0;
+};
+}
+
+// Parameter schemas; getSupportedFunctions() describes the commands from the same arrays
+static constexpr ParamSpec<InitParams> INIT_PARAMS[] = {
+    integerParam<InitParams, int, &InitParams::sckPin>("sckPin", "int", -1, NUM_DIGITAL_PINS - 1),
+    integerParam<InitParams, int, &InitParams::misoPin>("misoPin", "int", -1, NUM_DIGITAL_PINS - 1),
+    integerParam<InitParams, int, &InitParams::mosiPin>("mosiPin", "int", -1, NUM_DIGITAL_PINS - 1),
+    integerParam<InitParams, int, &InitParams::ssPin>("ssPin", "int", -1, NUM_DIGITAL_PINS - 1)};
+
+static constexpr ParamSpec<TransferParams> TRANSFER_PARAMS[] = {
+    textParam<TransferParams, &TransferParams::data>("data", "std::vector<uint8_t>")};
+
+static constexpr ParamSpec<SetSettingsParams> SET_SETTINGS_PARAMS[] = {
+    integerParam<SetSettingsParams, uint32_t, &SetSettingsParams::clock>("clock", "uint32_t", 1),
+    integerParam<SetSettingsParams, uint8_t, &SetSettingsParams::bitOrder>("bitOrder", "uint8_t", LSBFIRST, MSBFIRST),
+    integerParam<SetSettingsParams, uint8_t, &SetSettingsParams::dataMode>("dataMode", "uint8_t", SPI_MODE0, SPI_MODE3)};
 
 SPICtl::SPICtl() : _sckPin(SCK), _misoPin(MISO), _mosiPin(MOSI), _ssPin(SS), _spiSettings(4000000, MSBFIRST, SPI_MODE0) {}
 
 void SPICtl::init(const std::vector<std::pair<std::string, std::string>> &params)
 {
-    for (const auto &param : params)
-    {
-        if (param.first == "sckPin")
-        {
-            _sckPin = std::stoi(param.second);
-        }
-        else if (param.first == "misoPin")
-        {
-            _misoPin = std::stoi(param.second);
-        }
-        else if (param.first == "mosiPin")
-        {
-            _mosiPin = std::stoi(param.second);
-        }
-        else if (param.first == "ssPin")
-        {
-            _ssPin = std::stoi(param.second);
-        }
-    }
+    // Invalid values keep the current setting
+    InitParams args = {_sckPin, _misoPin, _mosiPin, _ssPin};
+    ParamError error;
+    bindParams(INIT_PARAMS, params, args, error);
+    _sckPin = args.sckPin;
+    _misoPin = args.misoPin;
+    _mosiPin = args.mosiPin;
+    _ssPin = args.ssPin;
     SPI.begin(_sckPin, _misoPin, _mosiPin, _ssPin);
 }
 
@@ -49,66 +77,68 @@ void SPICtl::deinit()
     SPI.end();
 }
 
-std::pair<std::string, void *> SPICtl::execute(const std::string &command, const std::vector<std::pair<std::string, std::string>> &params)
+const SPICtl::Handler SPICtl::handlers[SPICtl::OP_COUNT] = {
+    &SPICtl::handleTransfer,
+    &SPICtl::handleSetSettings};
+
+void SPICtl::dispatch(uint16_t opcode, const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result)
 {
-    if (command == "transfer")
+    if (opcode >= OP_COUNT)
     {
-        std::vector<uint8_t> data;
-        for (const auto &param : params)
-        {
-            if (param.first == "data")
-            {
-                data.resize(decode_base64_length(reinterpret_cast<const unsigned char *>(param.second.c_str())));
-                decode_base64(reinterpret_cast<const unsigned char *>(param.second.c_str()), param.second.length(), data.data());
-                break;
-            }
-        }
-        std::vector<uint8_t> result = transfer(data);
-        return {"std::vector<uint8_t>", new std::vector<uint8_t>(result)};
+        result.setError("Command not found");
+        return;
     }
-    else if (command == "setSettings")
+    (this->*handlers[opcode])(params, result);
+}
+
+std::vector<FunctionInfo> SPICtl::getSupportedFunctions()
+{
+    // Entries are listed in Opcode order; the position of each entry is its opcode
+    return {
+        describeCommand("transfer", TRANSFER_PARAMS, ResultType::Bytes),
+        describeCommand("setSettings", SET_SETTINGS_PARAMS)};
+}
+
+void SPICtl::handleTransfer(const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result)
+{
+    // The payload is decoded straight into the result buffer, and each byte is
+    // replaced by the one clocked in while it is shifted out
+    TransferParams args;
+    if (!bindParams(TRANSFER_PARAMS, params, args, result))
+    {
+        return;
+    }
+    uint8_t *data = result.allocBytes(0);
+    size_t length = 0;
+    if (args.data != nullptr)
     {
-        uint32_t clock = 4000000;
-        uint8_t bitOrder = MSBFIRST;
-        uint8_t dataMode = SPI_MODE0;
-        for (const auto &param : params)
+        data = result.allocBytes(base64DecodedLength(args.data->data(), args.data->size()));
+        if (!base64Decode(args.data->data(), args.data->size(), data, length))
         {
-            if (param.first == "clock")
-            {
-                clock = std::stoul(param.second);
-            }
-            else if (param.first == "bitOrder")
-            {
-                bitOrder = std::stoul(param.second);
-            }
-            else if (param.first == "dataMode")
-            {
-                dataMode = std::stoul(param.second);
-            }
+            result.setError("Invalid base64 data", "data");
+            return;
         }
-        setSettings(clock, bitOrder, dataMode);
-        return {"", nullptr};
     }
-    return {"", nullptr};
+    transfer(data, length);
 }
 
-std::vector<FunctionInfo> SPICtl::getSupportedFunctions()
+void SPICtl::handleSetSettings(const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result)
 {
-    return {
-        {"transfer", {{"data", "std::vector<uint8_t>"}}},
-        {"setSettings", {{"clock", "uint32_t"}, {"bitOrder", "uint8_t"}, {"dataMode", "uint8_t"}}}};
+    SetSettingsParams args;
+    if (bindParams(SET_SETTINGS_PARAMS, params, args, result))
+    {
+        setSettings(args.clock, args.bitOrder, args.dataMode);
+    }
 }
 
-std::vector<uint8_t> SPICtl::transfer(const std::vector<uint8_t> &data)
+void SPICtl::transfer(uint8_t *data, size_t length)
 {
-    std::vector<uint8_t> received(data.size());
     beginTransaction();
-    for (size_t i = 0; i < data.size(); ++i)
+    for (size_t i = 0; i < length; ++i)
     {
-        received[i] = SPI.transfer(data[i]);
+        data[i] = SPI.transfer(data[i]);
     }
     endTransaction();
-    return received;
 }
 
 void SPICtl::beginTransaction()
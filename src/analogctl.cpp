@@ -16,89 +16,380 @@
 
 #include "analogctl.h"
 #include <sstream>
-#include "base64.hpp"
+#include <algorithm>
+#include <driver/adc.h>
+#include <esp_timer.h>
+#include <soc/syscon_struct.h>
+#include "base64codec.h"
+#include "samples.h"
+#include "params.h"
 
-AnalogCtl::AnalogCtl() : _pin(0), _resolution(10) {}
+namespace
+{
+struct InitParams
+{
+    int pin;
+    int resolution; ///< 0 when not given, leaving the ADC resolution alone
+};
 
-void AnalogCtl::init(const std::vector<std::pair<std::string, std::string>> &params)
+struct ReadAnalogParams
+{
+    int numSamples = 1;
+    const std::string *encoding = nullptr;
+    const std::string *reduce = nullptr;
+    uint32_t decimate = 1;
+};
+
+struct WriteAnalogParams
+{
+    const std::string *values = nullptr;
+};
+
+struct StartContinuousParams
+{
+    uint32_t sampleRate = 100000;
+    int blockSamples = 512;
+    int numBlocks = 8;
+};
+
+struct ReadContinuousParams
+{
+    int numBlocks = 1;
+    const std::string *encoding = nullptr;
+    uint32_t timeoutMs = 1000;
+    const std::string *reduce = nullptr;
+    uint32_t decimate = 1;
+};
+
+struct ScanParams
+{
+    const std::string *pins = nullptr;
+    int numSamples = 1;
+    uint32_t sampleRate = 1000;
+    const std::string *layout = nullptr;
+    const std::string *encoding = nullptr;
+};
+}
+
+// Most samples one readAnalog takes; they are a millisecond apart
+static const int MAX_READ_SAMPLES = 4096;
+
+// Conversion rates the ADC's DMA path supports
+static const uint32_t MIN_CONTINUOUS_RATE = 20000;
+static const uint32_t MAX_CONTINUOUS_RATE = 2000000;
+
+// Largest DMA block the I2S driver allocates, in samples
+static const int MAX_BLOCK_SAMPLES = 1024;
+
+// Most DMA blocks in the ring, bounding the memory continuous sampling takes
+static const int MAX_RING_BLOCKS = 64;
+
+// Depth of the I2S event queue; overflow events beyond it are lost
+static const int EVENT_QUEUE_LENGTH = 16;
+
+// Entries of the ADC1 pattern table, and so the most pins a scan takes
+static const size_t MAX_SCAN_PINS = 16;
+
+// Most samples a scan returns over all its pins
+static const size_t MAX_SCAN_SAMPLES = 16384;
+
+// Slack on top of the expected duration of a pattern scan before its read gives up
+static const uint32_t SCAN_TIMEOUT_MARGIN_MS = 100;
+
+// Parameter schemas; getSupportedFunctions() describes the commands from the same arrays
+static constexpr ParamSpec<InitParams> INIT_PARAMS[] = {
+    integerParam<InitParams, int, &InitParams::pin>("pin", "int", 0, NUM_DIGITAL_PINS - 1),
+    integerParam<InitParams, int, &InitParams::resolution>("resolution", "int", 1, 16)};
+
+static constexpr ParamSpec<ReadAnalogParams> READ_ANALOG_PARAMS[] = {
+    integerParam<ReadAnalogParams, int, &ReadAnalogParams::numSamples>("numSamples", "int", 0, MAX_READ_SAMPLES),
+    textParam<ReadAnalogParams, &ReadAnalogParams::encoding>("encoding", "std::string"),
+    textParam<ReadAnalogParams, &ReadAnalogParams::reduce>("reduce", "std::string"),
+    integerParam<ReadAnalogParams, uint32_t, &ReadAnalogParams::decimate>("decimate", "uint32_t", 1, SampleReducer::MAX_FACTOR)};
+
+static constexpr ParamSpec<WriteAnalogParams> WRITE_ANALOG_PARAMS[] = {
+    textParam<WriteAnalogParams, &WriteAnalogParams::values>("values", "std::vector<int>")};
+
+static constexpr ParamSpec<StartContinuousParams> START_CONTINUOUS_PARAMS[] = {
+    integerParam<StartContinuousParams, uint32_t, &StartContinuousParams::sampleRate>("sampleRate", "uint32_t", MIN_CONTINUOUS_RATE, MAX_CONTINUOUS_RATE),
+    integerParam<StartContinuousParams, int, &StartContinuousParams::blockSamples>("blockSamples", "int", 8, MAX_BLOCK_SAMPLES),
+    integerParam<StartContinuousParams, int, &StartContinuousParams::numBlocks>("numBlocks", "int", 2, MAX_RING_BLOCKS)};
+
+static constexpr ParamSpec<ReadContinuousParams> READ_CONTINUOUS_PARAMS[] = {
+    integerParam<ReadContinuousParams, int, &ReadContinuousParams::numBlocks>("numBlocks", "int", 1, MAX_RING_BLOCKS),
+    textParam<ReadContinuousParams, &ReadContinuousParams::encoding>("encoding", "std::string"),
+    integerParam<ReadContinuousParams, uint32_t, &ReadContinuousParams::timeoutMs>("timeoutMs", "uint32_t", 0, 60000),
+    textParam<ReadContinuousParams, &ReadContinuousParams::reduce>("reduce", "std::string"),
+    integerParam<ReadContinuousParams, uint32_t, &ReadContinuousParams::decimate>("decimate", "uint32_t", 1, SampleReducer::MAX_FACTOR)};
+
+static constexpr ParamSpec<ScanParams> SCAN_PARAMS[] = {
+    textParam<ScanParams, &ScanParams::pins>("pins", "std::string"),
+    integerParam<ScanParams, int, &ScanParams::numSamples>("numSamples", "int", 1, MAX_SCAN_SAMPLES),
+    integerParam<ScanParams, uint32_t, &ScanParams::sampleRate>("sampleRate", "uint32_t", 1, MAX_CONTINUOUS_RATE),
+    textParam<ScanParams, &ScanParams::layout>("layout", "std::string"),
+    textParam<ScanParams, &ScanParams::encoding>("encoding", "std::string")};
+
+// Scale a 12-bit conversion from the DMA to the configured resolution, as analogRead() would
+static uint16_t scaleConversion(uint32_t conversion, int resolution)
+{
+    return static_cast<uint16_t>(resolution <= 12 ? conversion >> (12 - resolution) : conversion << (resolution - 12));
+}
+
+// Parse a comma-separated list of distinct GPIO numbers
+static bool parsePinList(const std::string &text, std::vector<uint8_t> &pins)
 {
-    for (const auto &param : params)
+    pins.clear();
+    const char *cursor = text.c_str();
+    while (true)
     {
-        if (param.first == "pin")
+        char *end;
+        long pin = strtol(cursor, &end, 10);
+        if (end == cursor || pin < 0 || pin >= NUM_DIGITAL_PINS || pins.size() == MAX_SCAN_PINS ||
+            std::find(pins.begin(), pins.end(), static_cast<uint8_t>(pin)) != pins.end())
+        {
+            return false;
+        }
+        pins.push_back(static_cast<uint8_t>(pin));
+        if (*end == '\0')
         {
-            _pin = std::stoi(param.second);
+            return true;
         }
-        else if (param.first == "resolution")
+        if (*end != ',')
         {
-            _resolution = std::stoi(param.second);
-            analogReadResolution(_resolution);
+            return false;
         }
+        cursor = end + 1;
+    }
+}
+
+AnalogCtl::AnalogCtl()
+    : _pin(0), _resolution(10), _continuous(false), _events(nullptr), _sampleRate(0), _blockSamples(0), _ringBlocks(0), _continuousStart(0), _consumed(0) {}
+
+void AnalogCtl::init(const std::vector<std::pair<std::string, std::string>> &params)
+{
+    // Invalid values keep the current setting
+    InitParams args = {_pin, 0};
+    ParamError error;
+    bindParams(INIT_PARAMS, params, args, error);
+    stopContinuous();
+    _pin = args.pin;
+    if (args.resolution != 0)
+    {
+        _resolution = args.resolution;
+        analogReadResolution(_resolution);
     }
     pinMode(_pin, INPUT);
 }
 
 void AnalogCtl::deinit()
 {
-    // No specific deinitialization needed for analog pins
+    stopContinuous();
 }
 
-std::pair<std::string, void *> AnalogCtl::execute(const std::string &command, const std::vector<std::pair<std::string, std::string>> &params)
+const AnalogCtl::Handler AnalogCtl::handlers[AnalogCtl::OP_COUNT] = {
+    &AnalogCtl::handleReadAnalog,
+    &AnalogCtl::handleWriteAnalog,
+    &AnalogCtl::handleStartContinuous,
+    &AnalogCtl::handleReadContinuous,
+    &AnalogCtl::handleStopContinuous,
+    &AnalogCtl::handleScan};
+
+void AnalogCtl::dispatch(uint16_t opcode, const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result)
 {
-    if (command == "readAnalog")
+    if (opcode >= OP_COUNT)
     {
-        int numSamples = 1;
-        for (const auto &param : params)
-        {
-            if (param.first == "numSamples")
-            {
-                numSamples = std::stoi(param.second);
-                break;
-            }
-        }
-        std::vector<int> result = readAnalog(numSamples);
-        return {"std::vector<int>", new std::vector<int>(result)};
+        result.setError("Command not found");
+        return;
+    }
+    (this->*handlers[opcode])(params, result);
+}
+
+bool AnalogCtl::dispatchPacked(uint16_t opcode, const int32_t *args, size_t count)
+{
+    if (opcode != OP_WRITE_ANALOG)
+    {
+        return false;
     }
-    else if (command == "writeAnalog")
+    for (size_t i = 0; i < count; ++i)
     {
-        std::vector<int> values;
-        for (const auto &param : params)
+        if (i > 0)
         {
-            if (param.first == "values")
-            {
-                std::vector<uint8_t> decodedData(decode_base64_length(reinterpret_cast<const unsigned char *>(param.second.c_str())));
-                decode_base64(reinterpret_cast<const unsigned char *>(param.second.c_str()), param.second.length(), decodedData.data());
-                values.reserve(decodedData.size() / sizeof(int));
-                for (size_t i = 0; i < decodedData.size(); i += sizeof(int))
-                {
-                    int value;
-                    memcpy(&value, &decodedData[i], sizeof(int));
-                    values.push_back(value);
-                }
-                break;
-            }
+            delay(1); // Same spacing as writeAnalog, without holding up the caller after the last value
         }
-        writeAnalog(values);
-        return {"", nullptr};
+        analogWrite(_pin, args[i]);
     }
-    return {"", nullptr};
+    return true;
 }
 
 std::vector<FunctionInfo> AnalogCtl::getSupportedFunctions()
 {
+    // Entries are listed in Opcode order; the position of each entry is its opcode
     return {
-        {"readAnalog", {{"numSamples", "int"}}},
-        {"writeAnalog", {{"values", "std::vector<int>"}}}};
+        describeCommand("readAnalog", READ_ANALOG_PARAMS, ResultType::Bytes, true),
+        describeCommand("writeAnalog", WRITE_ANALOG_PARAMS),
+        describeCommand("startContinuous", START_CONTINUOUS_PARAMS),
+        describeCommand("readContinuous", READ_CONTINUOUS_PARAMS, ResultType::Bytes),
+        describeCommand("stopContinuous"),
+        describeCommand("scan", SCAN_PARAMS, ResultType::Bytes)};
 }
 
-std::vector<int> AnalogCtl::readAnalog(int numSamples)
+void AnalogCtl::handleReadAnalog(const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result)
 {
-    std::vector<int> samples;
+    ReadAnalogParams args;
+    SampleEncoding encoding = SampleEncoding::Int32;
+    SampleReduction reduction = SampleReduction::None;
+    if (!bindParams(READ_ANALOG_PARAMS, params, args, result))
+    {
+        return;
+    }
+    if (args.encoding != nullptr && !parseSampleEncoding(*args.encoding, encoding))
+    {
+        result.setError("Unknown encoding", "encoding");
+        return;
+    }
+    if (args.reduce != nullptr && !parseSampleReduction(*args.reduce, reduction))
+    {
+        result.setError("Unknown reduction", "reduce");
+        return;
+    }
+    if (_continuous)
+    {
+        result.setError("Continuous sampling running");
+        return;
+    }
+    readAnalog(args.numSamples, encoding, reduction, args.decimate, result);
+}
+
+void AnalogCtl::handleWriteAnalog(const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result)
+{
+    WriteAnalogParams args;
+    if (!bindParams(WRITE_ANALOG_PARAMS, params, args, result))
+    {
+        return;
+    }
+    _buffer.clear();
+    if (args.values != nullptr && !base64Decode(*args.values, _buffer))
+    {
+        result.setError("Invalid base64 data", "values");
+        return;
+    }
+    _values.clear();
+    for (size_t i = 0; i + sizeof(int) <= _buffer.size(); i += sizeof(int))
+    {
+        int value;
+        memcpy(&value, &_buffer[i], sizeof(int));
+        _values.push_back(value);
+    }
+    writeAnalog(_values);
+}
+
+void AnalogCtl::handleStartContinuous(const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result)
+{
+    StartContinuousParams args;
+    if (!bindParams(START_CONTINUOUS_PARAMS, params, args, result))
+    {
+        return;
+    }
+    if (args.blockSamples % 2 != 0)
+    {
+        result.setError("Block size must be even", "blockSamples");
+        return;
+    }
+    startContinuous(args.sampleRate, args.blockSamples, args.numBlocks, result);
+}
+
+void AnalogCtl::handleReadContinuous(const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result)
+{
+    ReadContinuousParams args;
+    SampleEncoding encoding = SampleEncoding::Int32;
+    SampleReduction reduction = SampleReduction::None;
+    if (!bindParams(READ_CONTINUOUS_PARAMS, params, args, result))
+    {
+        return;
+    }
+    if (args.encoding != nullptr && !parseSampleEncoding(*args.encoding, encoding))
+    {
+        result.setError("Unknown encoding", "encoding");
+        return;
+    }
+    if (args.reduce != nullptr && !parseSampleReduction(*args.reduce, reduction))
+    {
+        result.setError("Unknown reduction", "reduce");
+        return;
+    }
+    if (!_continuous)
+    {
+        result.setError("Continuous sampling not running");
+        return;
+    }
+    readContinuous(args.numBlocks, encoding, reduction, args.decimate, args.timeoutMs, result);
+}
+
+void AnalogCtl::handleStopContinuous(const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result)
+{
+    stopContinuous();
+}
+
+void AnalogCtl::handleScan(const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result)
+{
+    ScanParams args;
+    SampleEncoding encoding = SampleEncoding::Int32;
+    if (!bindParams(SCAN_PARAMS, params, args, result))
+    {
+        return;
+    }
+    if (args.pins == nullptr)
+    {
+        result.setError("Missing parameter", "pins");
+        return;
+    }
+    if (!parsePinList(*args.pins, _scanPins))
+    {
+        result.setError("Invalid pin list", "pins");
+        return;
+    }
+    bool blocks = false;
+    if (args.layout != nullptr && !(blocks = *args.layout == "blocks") && *args.layout != "interleaved")
+    {
+        result.setError("Unknown layout", "layout");
+        return;
+    }
+    if (args.encoding != nullptr && !parseSampleEncoding(*args.encoding, encoding))
+    {
+        result.setError("Unknown encoding", "encoding");
+        return;
+    }
+    if (static_cast<size_t>(args.numSamples) * _scanPins.size() > MAX_SCAN_SAMPLES)
+    {
+        result.setError("Scan too long", "numSamples");
+        return;
+    }
+    if (_continuous)
+    {
+        result.setError("Continuous sampling running");
+        return;
+    }
+    scan(args.numSamples, args.sampleRate, blocks, encoding, result);
+}
+
+void AnalogCtl::readAnalog(int numSamples, SampleEncoding encoding, SampleReduction reduction, uint32_t factor, ResultSink &result)
+{
+    if (numSamples < 0)
+    {
+        numSamples = 0;
+    }
+    SampleEncoder encoder(encoding, result.allocBytes(maxEncodedSize(encoding, reducedCount(reduction, numSamples, factor))));
+    SampleReducer reducer(reduction, factor, encoder);
     for (int i = 0; i < numSamples; ++i)
     {
-        samples.push_back(analogRead(_pin));
+        reducer.add(analogRead(_pin));
         delay(1); // Short delay between readings
     }
-    return samples;
+    result.setSize(encoder.finish());
+    if (encoding != SampleEncoding::Int32)
+    {
+        result.setFormat(sampleEncodingName(encoding), reducer.count());
+    }
 }
 
 void AnalogCtl::writeAnalog(const std::vector<int> &values)
@@ -109,3 +400,261 @@ void AnalogCtl::writeAnalog(const std::vector<int> &values)
         delay(1); // Short delay between writes
     }
 }
+
+void AnalogCtl::startContinuous(uint32_t sampleRate, int blockSamples, int numBlocks, ResultSink &result)
+{
+    stopContinuous();
+    // Only ADC1 can feed the I2S DMA; ADC2 channels are numbered from 10
+    int8_t channel = digitalPinToAnalogChannel(_pin);
+    if (channel < 0 || channel >= ADC1_CHANNEL_MAX)
+    {
+        result.setError("Pin has no ADC1 channel");
+        return;
+    }
+    i2s_config_t config = {
+        .mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_RX | I2S_MODE_ADC_BUILT_IN),
+        .sample_rate = sampleRate,
+        .bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT,
+        .channel_format = I2S_CHANNEL_FMT_ONLY_LEFT,
+        .communication_format = I2S_COMM_FORMAT_STAND_I2S,
+        .intr_alloc_flags = ESP_INTR_FLAG_LEVEL1,
+        .dma_buf_count = numBlocks,
+        .dma_buf_len = blockSamples,
+        .use_apll = false,
+        .tx_desc_auto_clear = false,
+        .fixed_mclk = 0};
+    if (i2s_driver_install(I2S_NUM_0, &config, EVENT_QUEUE_LENGTH, &_events) != ESP_OK)
+    {
+        result.setError("I2S0 is in use");
+        return;
+    }
+    i2s_set_adc_mode(ADC_UNIT_1, (adc1_channel_t)channel);
+    adc1_config_width(ADC_WIDTH_BIT_12);
+    adc1_config_channel_atten((adc1_channel_t)channel, ADC_ATTEN_DB_11);
+    _continuousStart = esp_timer_get_time();
+    i2s_adc_enable(I2S_NUM_0);
+    _continuous = true;
+    _sampleRate = sampleRate;
+    _blockSamples = blockSamples;
+    _ringBlocks = numBlocks;
+    _consumed = 0;
+}
+
+void AnalogCtl::readContinuous(int numBlocks, SampleEncoding encoding, SampleReduction reduction, uint32_t factor, uint32_t timeoutMs, ResultSink &result)
+{
+    size_t numSamples = static_cast<size_t>(numBlocks) * _blockSamples;
+    _words.resize(numSamples);
+    size_t bytesRead = 0;
+    int64_t readStart = esp_timer_get_time();
+    i2s_read(I2S_NUM_0, _words.data(), numSamples * sizeof(uint16_t), &bytesRead, pdMS_TO_TICKS(timeoutMs));
+    numSamples = bytesRead / sizeof(uint16_t);
+
+    // Blocks dropped before the ones just read move the start of these samples on
+    bool eventsLost = uxQueueMessagesWaiting(_events) == EVENT_QUEUE_LENGTH;
+    i2s_event_t event;
+    while (xQueueReceive(_events, &event, 0) == pdTRUE)
+    {
+        if (event.type == I2S_EVENT_RX_Q_OVF)
+        {
+            _consumed += _blockSamples;
+        }
+    }
+    if (eventsLost)
+    {
+        // More blocks were dropped than the queue could report; the ring held no more than its
+        // capacity when the read began, which bounds how far behind the read can have started
+        uint64_t done = static_cast<uint64_t>(readStart - _continuousStart) * _sampleRate / 1000000 + 1;
+        uint64_t capacity = static_cast<uint64_t>(_ringBlocks) * _blockSamples;
+        while (done > _consumed + capacity)
+        {
+            _consumed += _blockSamples;
+        }
+    }
+    int64_t start = _continuousStart + static_cast<int64_t>(_consumed * 1000000 / _sampleRate);
+    _consumed += numSamples;
+
+    // The DMA stores each pair of samples swapped, with the channel in the top four bits of each
+    SampleEncoder encoder(encoding, result.allocBytes(maxEncodedSize(encoding, reducedCount(reduction, numSamples, factor))));
+    SampleReducer reducer(reduction, factor, encoder);
+    for (size_t i = 0; i < numSamples; ++i)
+    {
+        uint32_t sample = _words[i ^ 1] & 0xFFF;
+        reducer.add(scaleConversion(sample, _resolution));
+    }
+    result.setSize(encoder.finish());
+    if (encoding != SampleEncoding::Int32)
+    {
+        result.setFormat(sampleEncodingName(encoding), reducer.count());
+    }
+    result.setStartTime(start);
+}
+
+void AnalogCtl::stopContinuous()
+{
+    if (!_continuous)
+    {
+        return;
+    }
+    i2s_adc_disable(I2S_NUM_0);
+    i2s_driver_uninstall(I2S_NUM_0);
+    _events = nullptr;
+    _continuous = false;
+}
+
+void AnalogCtl::scan(size_t numSamples, uint32_t sampleRate, bool blocks, SampleEncoding encoding, ResultSink &result)
+{
+    const size_t numPins = _scanPins.size();
+    const size_t total = numSamples * numPins;
+    int64_t start = 0;
+    uint32_t skew = 0;
+
+    // The DMA only reads ADC1, at conversion rates it supports
+    bool pattern = numPins * sampleRate >= MIN_CONTINUOUS_RATE && numPins * sampleRate <= MAX_CONTINUOUS_RATE;
+    for (uint8_t pin : _scanPins)
+    {
+        int8_t channel = digitalPinToAnalogChannel(pin);
+        pattern = pattern && channel >= 0 && channel < ADC1_CHANNEL_MAX;
+    }
+    esp_err_t status = pattern ? scanPattern(numSamples, sampleRate, start, skew) : ESP_ERR_NOT_SUPPORTED;
+    if (status == ESP_ERR_NOT_SUPPORTED)
+    {
+        scanLoop(numSamples, sampleRate, start, skew);
+    }
+    else if (status == ESP_ERR_TIMEOUT)
+    {
+        result.setError("ADC read timed out");
+        return;
+    }
+    else if (status != ESP_OK)
+    {
+        result.setError("ADC pattern out of sync");
+        return;
+    }
+
+    SampleEncoder encoder(encoding, result.allocBytes(maxEncodedSize(encoding, total)));
+    for (size_t i = 0; i < total; ++i)
+    {
+        encoder.add(blocks ? _words[i % numSamples * numPins + i / numSamples] : _words[i]);
+    }
+    result.setSize(encoder.finish());
+    if (encoding != SampleEncoding::Int32)
+    {
+        result.setFormat(sampleEncodingName(encoding), total);
+    }
+    result.setStartTime(start);
+    if (numPins > 1)
+    {
+        result.setSkew(skew);
+    }
+}
+
+esp_err_t AnalogCtl::scanPattern(size_t numSamples, uint32_t sampleRate, int64_t &start, uint32_t &skew)
+{
+    const size_t numPins = _scanPins.size();
+    const uint32_t conversionRate = sampleRate * numPins;
+    i2s_config_t config = {
+        .mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_RX | I2S_MODE_ADC_BUILT_IN),
+        .sample_rate = conversionRate,
+        .bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT,
+        .channel_format = I2S_CHANNEL_FMT_ONLY_LEFT,
+        .communication_format = I2S_COMM_FORMAT_STAND_I2S,
+        .intr_alloc_flags = ESP_INTR_FLAG_LEVEL1,
+        .dma_buf_count = 4,
+        .dma_buf_len = MAX_BLOCK_SAMPLES,
+        .use_apll = false,
+        .tx_desc_auto_clear = false,
+        .fixed_mclk = 0};
+    if (i2s_driver_install(I2S_NUM_0, &config, 0, NULL) != ESP_OK)
+    {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    adc1_config_width(ADC_WIDTH_BIT_12);
+    for (uint8_t pin : _scanPins)
+    {
+        adc1_config_channel_atten((adc1_channel_t)digitalPinToAnalogChannel(pin), ADC_ATTEN_DB_11);
+    }
+    i2s_set_adc_mode(ADC_UNIT_1, (adc1_channel_t)digitalPinToAnalogChannel(_scanPins[0]));
+    i2s_adc_enable(I2S_NUM_0);
+
+    // Enabling sets up a single-entry pattern, so the scan's table goes in afterwards and the
+    // DMA restarts from its first entry
+    for (size_t i = 0; i < numPins; ++i)
+    {
+        uint32_t entry = (digitalPinToAnalogChannel(_scanPins[i]) << 4) | (ADC_WIDTH_BIT_12 << 2) | ADC_ATTEN_DB_11;
+        uint32_t shift = 24 - i % 4 * 8;
+        uint32_t &word = SYSCON.saradc_sar1_patt_tab[i / 4];
+        word = (word & ~(0xFFu << shift)) | (entry << shift);
+    }
+    SYSCON.saradc_ctrl.sar1_patt_len = numPins - 1;
+    SYSCON.saradc_ctrl.sar1_patt_p_clear = 1;
+    SYSCON.saradc_ctrl.sar1_patt_p_clear = 0;
+    i2s_start(I2S_NUM_0);
+    start = esp_timer_get_time();
+
+    // One set more than asked for, in case the data has to be lined up on the first entry, in the DMA's pairs
+    size_t count = (numSamples + 1) * numPins;
+    count += count % 2;
+    _words.resize(count);
+    size_t bytesRead = 0;
+    uint32_t timeoutMs = static_cast<uint32_t>(count * 1000 / conversionRate) + SCAN_TIMEOUT_MARGIN_MS;
+    i2s_read(I2S_NUM_0, _words.data(), count * sizeof(uint16_t), &bytesRead, pdMS_TO_TICKS(timeoutMs));
+    i2s_adc_disable(I2S_NUM_0);
+    i2s_driver_uninstall(I2S_NUM_0);
+    if (bytesRead < count * sizeof(uint16_t))
+    {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    // The DMA stores each pair of samples swapped; every sample carries its channel in the top four bits
+    for (size_t i = 0; i + 1 < count; i += 2)
+    {
+        std::swap(_words[i], _words[i + 1]);
+    }
+    const uint16_t firstChannel = digitalPinToAnalogChannel(_scanPins[0]);
+    size_t offset = 0;
+    while (offset < numPins && (_words[offset] >> 12) != firstChannel)
+    {
+        ++offset;
+    }
+    for (size_t i = 0; i < numSamples * numPins; ++i)
+    {
+        uint16_t word = _words[offset + i];
+        if (offset == numPins || (word >> 12) != digitalPinToAnalogChannel(_scanPins[i % numPins]))
+        {
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+        _words[i] = scaleConversion(word & 0xFFF, _resolution);
+    }
+    start += static_cast<int64_t>(offset) * 1000000 / conversionRate;
+    skew = 1000000000u / conversionRate;
+    return ESP_OK;
+}
+
+void AnalogCtl::scanLoop(size_t numSamples, uint32_t sampleRate, int64_t &start, uint32_t &skew)
+{
+    const size_t numPins = _scanPins.size();
+    _words.resize(numSamples * numPins);
+    int64_t next = esp_timer_get_time();
+    int64_t widest = 0;
+    for (size_t set = 0; set < numSamples; ++set)
+    {
+        int64_t first = esp_timer_get_time();
+        if (set == 0)
+        {
+            start = first;
+        }
+        for (size_t i = 0; i < numPins; ++i)
+        {
+            _words[set * numPins + i] = analogRead(_scanPins[i]);
+        }
+        // A set spans numPins conversions; the time they took bounds the skew between adjacent pins
+        widest = std::max(widest, esp_timer_get_time() - first);
+        next += 1000000 / sampleRate;
+        int64_t wait = next - esp_timer_get_time();
+        if (wait > 0 && set + 1 < numSamples)
+        {
+            delayMicroseconds(static_cast<uint32_t>(wait));
+        }
+    }
+    skew = static_cast<uint32_t>(widest * 1000 / static_cast<int64_t>(numPins));
+}
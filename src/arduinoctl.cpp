@@ -16,10 +16,73 @@
 
 #include "arduinoctl.h"
 #include <algorithm>
+#include "params.h"
 
 AsyncWebServer server(80);
+AsyncWebSocket webSocket("/ws");
+AsyncUDP udp;
 RemoteControlServer remoteServer;
 
+// Expected size of a single non-byte result in the response, used to pre-size the response buffer
+static const size_t RESULT_SIZE_ESTIMATE = 24;
+
+// Task name and core of each bus executor, indexed by BusResource. Core 0 also runs
+// WiFi, so it gets the buses whose commands mostly wait on slow clocks or DMA.
+struct BusExecutorConfig
+{
+    const char *name;
+    BaseType_t core;
+};
+
+static const BusExecutorConfig BUS_EXECUTORS[] = {
+    {nullptr, 0},     // General: runs on the batch executor
+    {"bus-gpio", 1},
+    {"bus-adc", 1},
+    {"bus-i2c", 0},
+    {"bus-spi", 1},
+    {"bus-i2s", 0}};
+
+// Name of each bus in /capabilities, indexed by BusResource
+static const char *const BUS_NAMES[] = {"general", "gpio", "adc", "i2c", "spi", "i2s"};
+
+// Name of a result kind in /capabilities
+static const char *resultTypeName(ResultType type)
+{
+    switch (type)
+    {
+    case ResultType::Int:
+        return "int";
+    case ResultType::Bytes:
+        return "bytes";
+    default:
+        return "none";
+    }
+}
+
+// Append a JSON string literal, escaping the characters JSON requires
+static void appendJsonString(std::string &out, const std::string &value)
+{
+    out += '"';
+    for (char c : value)
+    {
+        if (c == '"' || c == '\\')
+        {
+            out += '\\';
+            out += c;
+        }
+        else if (static_cast<unsigned char>(c) < 0x20)
+        {
+            char escaped[8];
+            out.append(escaped, snprintf(escaped, sizeof(escaped), "\\u%04x", c));
+        }
+        else
+        {
+            out += c;
+        }
+    }
+    out += '"';
+}
+
 // Helper function to convert Arduino String to std::string
 std::string to_std_string(const String &arduino_string)
 {
@@ -32,21 +95,212 @@ String to_arduino_string(const std::string &std_string)
     return String(std_string.c_str());
 }
 
-void handleExecute(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total)
+// Per-request body buffer, stored in request->_tempObject; AsyncWebServer free()s it with the request
+struct RequestBody
+{
+    size_t length;   ///< Number of body bytes received so far
+    size_t total;    ///< Total body length announced by the client
+    bool overflowed; ///< Whether the body was rejected for being too large
+    char data[1];    ///< Body bytes, followed by a NUL terminator
+};
+
+void handleRequestBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total)
 {
-    if (len > 0)
+    if (index == 0 && request->_tempObject == nullptr)
     {
-        std::string json(reinterpret_cast<char *>(data), len);
-        std::string result = remoteServer.executeCommands(json);
-        request->send(200, "application/json", to_arduino_string(result));
+        bool tooLarge = total > ARDUINOCTL_MAX_BODY_SIZE;
+        RequestBody *body = tooLarge ? nullptr : static_cast<RequestBody *>(malloc(sizeof(RequestBody) + total));
+        if (body == nullptr)
+        {
+            // Keep just the header so the request is answered with 413 once it ends
+            tooLarge = true;
+            body = static_cast<RequestBody *>(malloc(sizeof(RequestBody)));
+            if (body == nullptr)
+            {
+                return;
+            }
+        }
+        body->length = 0;
+        body->total = total;
+        body->overflowed = tooLarge;
+        request->_tempObject = body;
     }
-    else
+
+    RequestBody *body = static_cast<RequestBody *>(request->_tempObject);
+    if (body == nullptr || body->overflowed || index != body->length || index + len > body->total)
+    {
+        return;
+    }
+    memcpy(body->data + index, data, len);
+    body->length += len;
+}
+
+// Return the buffered body of a request, or answer the request with an error and return null
+static RequestBody *completeBody(AsyncWebServerRequest *request)
+{
+    RequestBody *body = static_cast<RequestBody *>(request->_tempObject);
+    if (body != nullptr && body->overflowed)
+    {
+        request->send(413, "text/plain", "Request body too large");
+        return nullptr;
+    }
+    if (body == nullptr || body->length == 0)
     {
         request->send(400, "text/plain", "No data received");
+        return nullptr;
+    }
+    if (body->length != body->total)
+    {
+        request->send(400, "text/plain", "Incomplete request body");
+        return nullptr;
+    }
+    body->data[body->length] = '\0';
+    return body;
+}
+
+// Copy a window of a job's response; spliced payloads are encoded here, so the time counts towards the Encode phase
+static size_t readResponse(Job &job, uint8_t *buffer, size_t maxLen, size_t index)
+{
+    uint32_t started = micros();
+    size_t copied = job.response.read(index, buffer, maxLen);
+    remoteServer.recordStreamedEncode(job.response, micros() - started, index + copied >= job.response.size());
+    return copied;
+}
+
+// Send the response of a finished job in the format of its request, encoding it as the connection drains
+static void sendResults(AsyncWebServerRequest *request, const std::shared_ptr<Job> &job)
+{
+    AsyncWebServerResponse *response = request->beginResponse(job->msgpack ? "application/msgpack" : "application/json", job->response.size(), [job](uint8_t *buffer, size_t maxLen, size_t index) -> size_t
+                                                              { return readResponse(*job, buffer, maxLen, index); });
+    request->send(response);
+}
+
+// Queue the body of a request to the executor and answer with its results, or with a job ID for ?async=1
+static void handleCommands(AsyncWebServerRequest *request, bool msgpack)
+{
+    RequestBody *body = completeBody(request);
+    if (body == nullptr)
+    {
+        return;
+    }
+
+    // The job takes over the body so it outlives the request
+    request->_tempObject = nullptr;
+    std::shared_ptr<Job> job = std::make_shared<Job>(body, body->data, body->length, msgpack);
+    bool async = request->hasParam("async");
+    if (!remoteServer.submitJob(job, async))
+    {
+        request->send(503, "text/plain", "Too many pending commands");
+        return;
+    }
+    if (async)
+    {
+        char accepted[32];
+        snprintf(accepted, sizeof(accepted), "{\"job\":%lu}", static_cast<unsigned long>(job->id));
+        request->send(202, "application/json", accepted);
+        return;
+    }
+
+    if (job->wait(ARDUINOCTL_INLINE_WAIT_MS))
+    {
+        sendResults(request, job);
+        return;
     }
+
+    // AsyncTCP polls the filler until the executor has finished the job
+    AsyncWebServerResponse *response = request->beginChunkedResponse(msgpack ? "application/msgpack" : "application/json", [job](uint8_t *buffer, size_t maxLen, size_t index) -> size_t
+                                                                     {
+        if (!job->isDone())
+        {
+            return RESPONSE_TRY_AGAIN;
+        }
+        return readResponse(*job, buffer, maxLen, index); });
+    request->send(response);
+}
+
+void handleExecute(AsyncWebServerRequest *request)
+{
+    handleCommands(request, false);
 }
 
-RemoteControlServer::RemoteControlServer() {}
+void handleMsgPack(AsyncWebServerRequest *request)
+{
+    handleCommands(request, true);
+}
+
+void handleCache(AsyncWebServerRequest *request)
+{
+    char counters[64];
+    snprintf(counters, sizeof(counters), "{\"hits\":%lu,\"misses\":%lu}", static_cast<unsigned long>(remoteServer.resultCache().hits()), static_cast<unsigned long>(remoteServer.resultCache().misses()));
+    request->send(200, "application/json", counters);
+}
+
+void handleMetrics(AsyncWebServerRequest *request)
+{
+    std::string text;
+    remoteServer.renderMetrics(text);
+    request->send(200, "text/plain; version=0.0.4", to_arduino_string(text));
+}
+
+void handleCapabilities(AsyncWebServerRequest *request)
+{
+    std::shared_ptr<const RemoteControlServer::Capabilities> capabilities = remoteServer.capabilities();
+    if (!capabilities)
+    {
+        request->send(503, "text/plain", "Modules not registered yet");
+        return;
+    }
+
+    // Clients revalidate at startup; an unchanged registry costs a header exchange
+    AsyncWebHeader *match = request->getHeader("If-None-Match");
+    AsyncWebServerResponse *response;
+    if (match != nullptr && match->value().equals(capabilities->etag.c_str()))
+    {
+        response = request->beginResponse(304);
+    }
+    else
+    {
+        // The filler reads the cached document in place; the lambda keeps it alive if the registry is rebuilt
+        response = request->beginResponse("application/json", capabilities->json.size(), [capabilities](uint8_t *buffer, size_t maxLen, size_t index) -> size_t
+                                          {
+            size_t length = std::min(maxLen, capabilities->json.size() - index);
+            memcpy(buffer, capabilities->json.data() + index, length);
+            return length; });
+    }
+    response->addHeader("ETag", capabilities->etag.c_str());
+    response->addHeader("Cache-Control", "no-cache");
+    request->send(response);
+}
+
+void handleJobs(AsyncWebServerRequest *request)
+{
+    AsyncWebParameter *param = request->getParam("id");
+    uint32_t id = param ? strtoul(param->value().c_str(), nullptr, 10) : 0;
+    std::shared_ptr<Job> job = id != 0 ? remoteServer.findJob(id) : nullptr;
+    if (!job)
+    {
+        request->send(404, "text/plain", "Unknown job");
+        return;
+    }
+    if (!job->isDone())
+    {
+        char pending[48];
+        snprintf(pending, sizeof(pending), "{\"job\":%lu,\"status\":\"pending\"}", static_cast<unsigned long>(id));
+        request->send(202, "application/json", pending);
+        return;
+    }
+    remoteServer.forgetJob(id);
+    sendResults(request, job);
+}
+
+RemoteControlServer::RemoteControlServer()
+    : cache(ARDUINOCTL_CACHE_SIZE),
+      programs(ARDUINOCTL_MAX_PROGRAMS),
+      documentPool(ARDUINOCTL_DOCUMENT_POOL_SIZE),
+      executor("arduinoctl", ARDUINOCTL_EXECUTOR_STACK_SIZE, ARDUINOCTL_EXECUTOR_PRIORITY, ARDUINOCTL_EXECUTOR_CORE, ARDUINOCTL_EXECUTOR_QUEUE_DEPTH),
+      jobs(ARDUINOCTL_MAX_JOBS)
+{
+}
 
 bool RemoteControlServer::begin()
 {
@@ -79,101 +333,1009 @@ bool RemoteControlServer::begin()
     Serial.print("IP address: ");
     Serial.println(WiFi.localIP());
 
+    finalizeRegistry();
+
+    if (!executor.begin())
+    {
+        Serial.println("Failed to start the command executor");
+        return false;
+    }
+
+    // A bus whose executor cannot start runs its commands on the batch executor instead
+    batchDone = xSemaphoreCreateCounting(static_cast<UBaseType_t>(BusResource::Count), 0);
+    for (size_t bus = 1; batchDone != nullptr && bus < static_cast<size_t>(BusResource::Count); ++bus)
+    {
+        busExecutors[bus].reset(new Executor(BUS_EXECUTORS[bus].name, ARDUINOCTL_BUS_EXECUTOR_STACK_SIZE, ARDUINOCTL_EXECUTOR_PRIORITY, BUS_EXECUTORS[bus].core, 2));
+        if (!busExecutors[bus]->begin())
+        {
+            Serial.println("Failed to start a bus executor");
+            busExecutors[bus].reset();
+        }
+    }
+
     // Set up web server
-    server.on("/execute", HTTP_POST, [](AsyncWebServerRequest *request) {}, NULL, handleExecute);
+    server.on("/execute", HTTP_POST, handleExecute, NULL, handleRequestBody);
+    server.on("/msgpack", HTTP_POST, handleMsgPack, NULL, handleRequestBody);
+    server.on("/jobs", HTTP_GET, handleJobs);
+    server.on("/cache", HTTP_GET, handleCache);
+    server.on("/metrics", HTTP_GET, handleMetrics);
+    server.on("/capabilities", HTTP_GET, handleCapabilities);
+
+    webSocket.onEvent([this](AsyncWebSocket *socket, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len)
+                      { handleWebSocketEvent(socket, client, type, arg, data, len); });
+    server.addHandler(&webSocket);
 
     server.begin();
     Serial.println("HTTP server started");
 
+    if (ARDUINOCTL_UDP_PORT != 0)
+    {
+        const std::string apiKey = configCtl.getApiKey();
+        udpToken = udpTokenFor(apiKey.data(), apiKey.size());
+        if (udp.listen(ARDUINOCTL_UDP_PORT))
+        {
+            udp.onPacket([this](AsyncUDPPacket &packet)
+                         { handleUdpPacket(packet.data(), packet.length()); });
+            Serial.println("UDP fast path started");
+        }
+        else
+        {
+            Serial.println("Failed to start UDP fast path");
+        }
+    }
+
     return true;
 }
 
 void RemoteControlServer::registerModule(const std::string &name, std::shared_ptr<ModuleInterface> module)
 {
     modules.push_back(std::make_pair(name, module));
+    registryBuilt = false;
+}
+
+void RemoteControlServer::finalizeRegistry()
+{
+    std::vector<std::string> names;
+    for (const auto &module : modules)
+    {
+        names.push_back(module.first);
+        module.second->buildOpcodeTable();
+    }
+    if (!moduleIndex.build(names))
+    {
+        Serial.println("No perfect hash for the module names; using a linear search");
+    }
+    moduleBuses.clear();
+    cacheableCommands.clear();
+    std::vector<std::pair<std::string, std::vector<std::string>>> commandNames;
+    for (const auto &module : modules)
+    {
+        moduleBuses.push_back(module.second->resource());
+        std::vector<bool> cacheable;
+        std::vector<std::string> functions;
+        for (const FunctionInfo &function : module.second->getSupportedFunctions())
+        {
+            cacheable.push_back(function.cacheable);
+            functions.push_back(function.name);
+        }
+        cacheableCommands.push_back(cacheable);
+        commandNames.emplace_back(module.first, functions);
+    }
+    metrics.setCommands(commandNames);
+    udpSequences.assign(modules.size(), SequenceFilter());
+    std::atomic_store(&capabilityDocument, buildCapabilities());
+
+    // Stored steps hold indices into the old tables; look them up again by name
+    ResultSink unresolved;
+    programs.resolve([this, &unresolved](ProgramStep &step)
+                     { return resolveCommand(step.moduleName.data(), step.moduleName.size(), step.commandName.data(), step.commandName.size(), step.module, step.opcode, unresolved); });
+    registryBuilt = true;
+}
+
+std::shared_ptr<const RemoteControlServer::Capabilities> RemoteControlServer::buildCapabilities()
+{
+    std::shared_ptr<Capabilities> capabilities = std::make_shared<Capabilities>();
+    std::string &json = capabilities->json;
+    json += "{\"modules\":[";
+    for (size_t i = 0; i < modules.size(); ++i)
+    {
+        json += i == 0 ? "{\"name\":" : ",{\"name\":";
+        appendJsonString(json, modules[i].first);
+        json += ",\"bus\":\"";
+        json += BUS_NAMES[static_cast<size_t>(modules[i].second->resource())];
+        json += "\",\"commands\":[";
+        std::vector<FunctionInfo> functions = modules[i].second->getSupportedFunctions();
+        for (size_t opcode = 0; opcode < functions.size(); ++opcode)
+        {
+            const FunctionInfo &function = functions[opcode];
+            char number[12];
+            json += opcode == 0 ? "{\"name\":" : ",{\"name\":";
+            appendJsonString(json, function.name);
+            json += ",\"opcode\":";
+            json.append(number, snprintf(number, sizeof(number), "%u", static_cast<unsigned>(opcode)));
+            json += ",\"params\":[";
+            for (size_t p = 0; p < function.params.size(); ++p)
+            {
+                json += p == 0 ? "{\"name\":" : ",{\"name\":";
+                appendJsonString(json, function.params[p].first);
+                json += ",\"type\":";
+                appendJsonString(json, function.params[p].second);
+                json += "}";
+            }
+            json += "],\"result\":\"";
+            json += resultTypeName(function.result);
+            json += function.cacheable ? "\",\"cacheable\":true}" : "\",\"cacheable\":false}";
+        }
+        json += "]}";
+    }
+    json += "]}";
+
+    // FNV-1a of the document: it only changes when the registered modules do
+    uint32_t hash = 2166136261u;
+    for (char c : json)
+    {
+        hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+    }
+    char etag[16];
+    capabilities->etag.assign(etag, snprintf(etag, sizeof(etag), "\"%08lx\"", static_cast<unsigned long>(hash)));
+    return capabilities;
+}
+
+void RemoteControlServer::renderMetrics(std::string &out) const
+{
+    metrics.render(out);
+    Metrics::renderCounter(out, "arduinoctl_cache_hits_total", "Cacheable reads served from the result cache", cache.hits());
+    Metrics::renderCounter(out, "arduinoctl_cache_misses_total", "Cacheable reads that went to the hardware", cache.misses());
+}
+
+bool RemoteControlServer::submitJob(const std::shared_ptr<Job> &job, bool track)
+{
+    if (track)
+    {
+        // Random IDs keep clients from fetching each other's results by counting
+        do
+        {
+            job->id = esp_random();
+        } while (job->id == 0);
+        if (!jobs.add(job))
+        {
+            return false;
+        }
+    }
+
+    bool queued = executor.submit([this, job]()
+                                  {
+        if (job->msgpack)
+        {
+            executeMsgPack(reinterpret_cast<const uint8_t *>(job->input), job->length, job->response);
+        }
+        else
+        {
+            executeCommands(job->input, job->length, job->response);
+        }
+        job->finish(); });
+    if (!queued && track)
+    {
+        jobs.remove(job->id);
+    }
+    return queued;
+}
+
+// Whether a result is large enough to be spliced into a streamed response rather than copied into its text
+static bool isStreamed(const ResultSink &result)
+{
+    return result.type() == ResultType::Bytes && result.size() >= ARDUINOCTL_STREAM_THRESHOLD;
 }
 
 std::string RemoteControlServer::executeCommands(const std::string &jsonCommands)
 {
-    DynamicJsonDocument doc(1024);
-    DeserializationError error = deserializeJson(doc, jsonCommands);
+    std::lock_guard<std::mutex> lock(executionMutex);
+    metrics.countRequest(jsonCommands.size());
+    uint32_t started = micros();
+    JsonDocumentPool::Lease lease = documentPool.acquire(JsonDocumentPool::capacityFor(jsonCommands.data(), jsonCommands.size(), false));
+    DeserializationError error = deserializeJson(lease.doc(), jsonCommands);
+    metrics.recordPhase(Phase::Parse, micros() - started);
+    executeDocument(lease.doc(), error, lease.text(), false);
+    metrics.countResponse(lease.text().size());
+    return lease.text();
+}
+
+void RemoteControlServer::executeCommands(char *json, size_t length, ResponseStream &response)
+{
+    std::lock_guard<std::mutex> lock(executionMutex);
+    metrics.countRequest(length);
+    uint32_t started = micros();
+    // A mutable input puts ArduinoJson in zero-copy mode: strings stay in the request buffer
+    JsonDocumentPool::Lease lease = documentPool.acquire(JsonDocumentPool::capacityFor(json, length, true));
+    DeserializationError error = deserializeJson(lease.doc(), json, length);
+    metrics.recordPhase(Phase::Parse, micros() - started);
+    response.clear();
+    executeDocument(lease.doc(), error, response.text, false, &response);
+    metrics.countResponse(response.size());
+}
 
+bool RemoteControlServer::executeDocument(JsonDocument &doc, DeserializationError error, std::string &response, bool authenticated, ResponseStream *stream)
+{
+    if (error == DeserializationError::NoMemory)
+    {
+        response = "{\"error\": \"Not enough memory to parse JSON\"}";
+        metrics.countRequestError();
+        return false;
+    }
     if (error)
     {
-        return "{\"error\": \"Failed to parse JSON\"}";
+        response = "{\"error\": \"Failed to parse JSON\"}";
+        metrics.countRequestError();
+        return false;
     }
 
     // Check API key
-    if (doc["api_key"] != configCtl.getApiKey())
+    const char *apiKey = doc["api_key"] | "";
+    if (!authenticated && !checkApiKey(apiKey, strlen(apiKey)))
     {
-        return "{\"error\": \"Invalid API key\"}";
+        response = "{\"error\": \"Invalid API key\"}";
+        metrics.countRequestError();
+        return false;
+    }
+
+    if (!registryBuilt)
+    {
+        finalizeRegistry();
     }
 
     JsonArray commands = doc["commands"];
-    DynamicJsonDocument resultDoc(1024);
-    JsonArray results = resultDoc.createNestedArray("results");
+    // Most results are small; byte results grow the buffer once and keep it pooled
+    response.reserve(16 + commands.size() * RESULT_SIZE_ESTIMATE);
+    response = "{";
 
+    // Echo the request ID so pipelining clients can match responses to requests
+    JsonVariant id = doc["id"];
+    if (!id.isNull())
+    {
+        char idText[48];
+        size_t idLength = serializeJson(id, idText, sizeof(idText));
+        response += "\"id\":";
+        if (idLength > 0 && idLength < sizeof(idText) - 1)
+        {
+            response.append(idText, idLength);
+        }
+        else
+        {
+            response += "null";
+        }
+        response += ',';
+    }
+
+    // Program management requests answer with a single field instead of results
+    char reply[64];
+    JsonVariant define = doc["define"];
+    if (!define.isNull())
+    {
+        const char *defineError = "";
+        uint32_t program = defineProgram(define.as<JsonArray>(), defineError);
+        if (program != 0)
+        {
+            snprintf(reply, sizeof(reply), "\"program\":%lu}", static_cast<unsigned long>(program));
+        }
+        else
+        {
+            snprintf(reply, sizeof(reply), "\"error\": \"%s\"}", defineError);
+        }
+        response += reply;
+        return true;
+    }
+    JsonVariant deleted = doc["delete_program"];
+    if (!deleted.isNull())
+    {
+        response += programs.remove(deleted.as<uint32_t>()) ? "\"deleted\":true}" : "\"deleted\":false}";
+        return true;
+    }
+    const std::vector<ProgramStep> *steps = nullptr;
+    JsonVariant program = doc["program"];
+    if (!program.isNull())
+    {
+        steps = programs.find(program.as<uint32_t>());
+        if (steps == nullptr)
+        {
+            response += "\"error\": \"Program not found\"}";
+            return true;
+        }
+    }
+
+    response += "\"results\":[";
+
+    uint32_t started = micros();
+    size_t count = 0;
+    if (steps != nullptr)
+    {
+        programArgs.clear();
+        for (JsonPair p : doc["args"].as<JsonObject>())
+        {
+            programArgs.emplace_back(p.key().c_str(), p.value().as<std::string>());
+        }
+        count = loadProgram(*steps, programArgs);
+    }
     for (JsonObject command : commands)
     {
-        std::string moduleName = command["module"].as<std::string>();
-        std::string commandName = command["command"].as<std::string>();
-        JsonObject params = command["params"];
+        BatchCommand &entry = batchCommand(count++);
 
-        std::vector<std::pair<std::string, std::string>> paramPairs;
-        for (JsonPair p : params)
+        // Resolve the module/command pair to integers once, then dispatch by opcode
+        const char *moduleName = command["module"] | "";
+        const char *commandName = command["command"] | "";
+        entry.cacheMs = command["cache_ms"] | 0;
+        if (resolveCommand(moduleName, strlen(moduleName), commandName, strlen(commandName), entry.module, entry.opcode, entry.result))
+        {
+            JsonObject params = command["params"];
+            for (JsonPair p : params)
+            {
+                entry.params.emplace_back(p.key().c_str(), p.value().as<std::string>());
+            }
+        }
+        else
         {
-            paramPairs.emplace_back(p.key().c_str(), p.value().as<std::string>());
+            entry.module = -1;
         }
+    }
+
+    uint32_t resolved = micros();
+    metrics.recordPhase(Phase::Resolve, resolved - started);
+    runBatch(count, doc["serial"] | false);
+    uint32_t executed = micros();
+    metrics.recordPhase(Phase::Execute, executed - resolved);
 
-        std::string result = executeCommand(moduleName, commandName, paramPairs);
-        results.add(serialized(result));
+    size_t errors = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (i > 0)
+        {
+            response += ',';
+        }
+        errors += batch[i].result.type() == ResultType::Error;
+        if (stream != nullptr && isStreamed(batch[i].result))
+        {
+            stream->spliceJson(batch[i].result);
+            continue;
+        }
+        // Byte results are encoded straight from the sink into the response
+        batch[i].result.appendJson(response);
     }
 
-    std::string response;
-    serializeJson(resultDoc, response);
-    return response;
+    response += "]}";
+    recordEncode(stream, micros() - executed);
+    metrics.countCommands(count, errors);
+    return true;
 }
 
-std::string RemoteControlServer::executeCommand(const std::string &moduleName, const std::string &command, const std::vector<std::pair<std::string, std::string>> &params)
+void RemoteControlServer::executeMsgPack(const uint8_t *data, size_t length, ResponseStream &response)
 {
-    for (const auto &module : modules)
+    std::lock_guard<std::mutex> lock(executionMutex);
+    metrics.countRequest(length);
+    // MessagePack is read in place, so no document is needed
+    response.clear();
+    executeMessage(data, length, response.text, false, &response);
+    metrics.countResponse(response.size());
+}
+
+// Compare a MessagePack map key with a field name
+static bool keyIs(const char *key, size_t length, const char *name)
+{
+    return length == strlen(name) && memcmp(key, name, length) == 0;
+}
+
+// Write a top-level {"error": message} MessagePack response
+static void writeMsgPackError(std::string &response, const char *message)
+{
+    response.clear();
+    MsgPackWriter writer(response);
+    writer.writeMap(1);
+    writer.writeString("error");
+    writer.writeString(message);
+}
+
+bool RemoteControlServer::executeMessage(const uint8_t *data, size_t length, std::string &response, bool authenticated, ResponseStream *stream)
+{
+    // Validate the whole message before executing anything, as parsing does for JSON
+    uint32_t started = micros();
+    MsgPackReader reader(data, length);
+    MsgPackReader check = reader;
+    uint32_t fields;
+    if (!check.skip() || !check.atEnd() || !reader.readMap(fields))
+    {
+        writeMsgPackError(response, "Failed to parse MessagePack");
+        metrics.countRequestError();
+        return false;
+    }
+
+    const char *apiKey = "";
+    size_t apiKeyLength = 0;
+    const uint8_t *id = nullptr;
+    size_t idLength = 0;
+    MsgPackReader commands = reader;
+    bool hasCommands = false;
+    bool serial = false;
+    int64_t programId = 0;
+    bool hasProgram = false;
+    programArgs.clear();
+    while (fields--)
+    {
+        const char *key;
+        size_t keyLength;
+        if (!reader.readString(key, keyLength))
+        {
+            reader.skip();
+        }
+        else if (keyIs(key, keyLength, "api_key") && reader.readString(apiKey, apiKeyLength))
+        {
+            continue;
+        }
+        else if (keyIs(key, keyLength, "commands"))
+        {
+            commands = reader;
+            hasCommands = true;
+        }
+        else if (keyIs(key, keyLength, "serial") && reader.readBool(serial))
+        {
+            continue;
+        }
+        else if (keyIs(key, keyLength, "program") && reader.readInt(programId))
+        {
+            hasProgram = true;
+            continue;
+        }
+        else if (keyIs(key, keyLength, "args"))
+        {
+            MsgPackReader args = reader;
+            readMsgPackParams(args, programArgs);
+        }
+        else if (keyIs(key, keyLength, "id"))
+        {
+            // Keep the raw encoding of the ID to echo it back unchanged
+            id = reader.position();
+            reader.skip();
+            idLength = reader.position() - id;
+            continue;
+        }
+        reader.skip();
+    }
+
+    if (!authenticated && !checkApiKey(apiKey, apiKeyLength))
+    {
+        writeMsgPackError(response, "Invalid API key");
+        metrics.countRequestError();
+        return false;
+    }
+
+    if (!registryBuilt)
     {
-        if (module.first == moduleName)
+        finalizeRegistry();
+    }
+
+    const std::vector<ProgramStep> *steps = nullptr;
+    if (hasProgram)
+    {
+        steps = programs.find(static_cast<uint32_t>(programId));
+        if (steps == nullptr)
         {
-            std::pair<std::string, void *> result = module.second->execute(command, params);
+            writeMsgPackError(response, "Program not found");
+            return true;
+        }
+    }
+
+    uint32_t parsed = micros();
+    metrics.recordPhase(Phase::Parse, parsed - started);
+
+    uint32_t count = 0;
+    if (!hasCommands || !commands.readArray(count))
+    {
+        count = 0;
+    }
+    uint32_t first = steps != nullptr ? loadProgram(*steps, programArgs) : 0;
+    count += first;
+
+    response.clear();
+    response.reserve(16 + count * RESULT_SIZE_ESTIMATE);
+    MsgPackWriter writer(response);
+    writer.writeMap(id ? 2 : 1);
+    if (id)
+    {
+        writer.writeString("id");
+        response.append(reinterpret_cast<const char *>(id), idLength);
+    }
+    writer.writeString("results");
+    writer.writeArray(count);
+
+    for (uint32_t index = first; index < count; ++index)
+    {
+        BatchCommand &entry = batchCommand(index);
+        const char *moduleName = "";
+        const char *commandName = "";
+        size_t moduleLength = 0;
+        size_t commandLength = 0;
+        bool paramsValid = true;
 
-            if (result.first == "std::vector<int>" || result.first == "std::vector<uint8_t>")
+        uint32_t entries = 0;
+        if (!commands.readMap(entries))
+        {
+            commands.skip();
+        }
+        while (entries--)
+        {
+            const char *key;
+            size_t keyLength;
+            if (!commands.readString(key, keyLength))
             {
-                std::vector<uint8_t> *data;
-                if (result.first == "std::vector<int>")
-                {
-                    std::vector<int> *intData = static_cast<std::vector<int> *>(result.second);
-                    data = new std::vector<uint8_t>(reinterpret_cast<uint8_t *>(intData->data()), reinterpret_cast<uint8_t *>(intData->data() + intData->size()));
-                    delete intData;
-                }
-                else
+                commands.skip();
+            }
+            else if (keyIs(key, keyLength, "module") && commands.readString(moduleName, moduleLength))
+            {
+                continue;
+            }
+            else if (keyIs(key, keyLength, "command") && commands.readString(commandName, commandLength))
+            {
+                continue;
+            }
+            else if (keyIs(key, keyLength, "cache_ms"))
+            {
+                int64_t cacheMs;
+                if (commands.readInt(cacheMs))
                 {
-                    data = static_cast<std::vector<uint8_t> *>(result.second);
+                    entry.cacheMs = cacheMs > 0 ? static_cast<uint32_t>(cacheMs) : 0;
+                    continue;
                 }
+            }
+            else if (keyIs(key, keyLength, "params"))
+            {
+                // The message was validated, so skipping from a copy always lands on the next key
+                MsgPackReader params = commands;
+                paramsValid = readMsgPackParams(params, entry.params);
+            }
+            commands.skip();
+        }
+
+        if (!paramsValid)
+        {
+            entry.result.setError("Invalid params");
+            entry.module = -1;
+        }
+        else if (!resolveCommand(moduleName, moduleLength, commandName, commandLength, entry.module, entry.opcode, entry.result))
+        {
+            entry.module = -1;
+        }
+    }
+
+    uint32_t resolved = micros();
+    metrics.recordPhase(Phase::Resolve, resolved - parsed);
+    runBatch(count, serial);
+    uint32_t executed = micros();
+    metrics.recordPhase(Phase::Execute, executed - resolved);
+
+    size_t errors = 0;
+    for (uint32_t index = 0; index < count; ++index)
+    {
+        errors += batch[index].result.type() == ResultType::Error;
+        if (stream != nullptr && isStreamed(batch[index].result))
+        {
+            stream->spliceMsgPack(batch[index].result);
+            continue;
+        }
+        // Byte results are written as raw binary straight from the sink
+        batch[index].result.appendMsgPack(response);
+    }
+    recordEncode(stream, micros() - executed);
+    metrics.countCommands(count, errors);
+    return true;
+}
+
+void RemoteControlServer::recordEncode(ResponseStream *stream, uint32_t micros)
+{
+    if (stream == nullptr)
+    {
+        metrics.recordPhase(Phase::Encode, micros);
+        return;
+    }
+    // Spliced payloads are encoded as the response is sent; the phase is recorded once it has been
+    stream->encodeMicros = micros;
+    stream->encodePending = true;
+}
 
-                std::string base64Data = encodeBase64(*data);
-                delete data;
-                return "{\"data\":\"" + base64Data + "\"}";
+void RemoteControlServer::recordStreamedEncode(ResponseStream &response, uint32_t micros, bool finished)
+{
+    if (!response.encodePending)
+    {
+        return;
+    }
+    response.encodeMicros += micros;
+    if (finished)
+    {
+        response.encodePending = false;
+        metrics.recordPhase(Phase::Encode, response.encodeMicros);
+    }
+}
+
+RemoteControlServer::BatchCommand &RemoteControlServer::batchCommand(size_t index)
+{
+    if (index >= batch.size())
+    {
+        batch.resize(index + 1);
+    }
+    BatchCommand &entry = batch[index];
+    entry.module = -1;
+    entry.opcode = ModuleInterface::INVALID_OPCODE;
+    entry.cacheMs = 0;
+    entry.params.clear();
+    entry.result.clear();
+    return entry;
+}
+
+uint32_t RemoteControlServer::defineProgram(JsonArray commands, const char *&error)
+{
+    std::vector<ProgramStep> steps;
+    ResultSink resolved;
+    for (JsonObject command : commands)
+    {
+        ProgramStep step;
+        step.cacheMs = command["cache_ms"] | 0;
+        step.moduleName = command["module"] | "";
+        step.commandName = command["command"] | "";
+        if (!resolveCommand(step.moduleName.data(), step.moduleName.size(), step.commandName.data(), step.commandName.size(), step.module, step.opcode, resolved))
+        {
+            error = resolved.error();
+            return 0;
+        }
+
+        FunctionInfo info = modules[step.module].second->getSupportedFunctions()[step.opcode];
+        std::vector<std::pair<std::string, std::string>> constants;
+        for (JsonPair p : command["params"].as<JsonObject>())
+        {
+            const char *name = p.key().c_str();
+            auto declared = std::find_if(info.params.begin(), info.params.end(), [name](const std::pair<std::string, std::string> &param)
+                                         { return param.first == name; });
+            if (declared == info.params.end())
+            {
+                error = "Unknown parameter";
+                return 0;
             }
-            else if (result.first == "int")
+            std::string value = p.value().as<std::string>();
+            if (!value.empty() && value[0] == '$')
             {
-                int *data = static_cast<int *>(result.second);
-                std::string jsonResult = std::to_string(*data);
-                delete data;
-                return "{\"data\":" + jsonResult + "}";
+                step.bindings.emplace_back(step.params.size(), value.substr(1));
             }
             else
             {
-                return "{\"data\": null}";
+                constants.emplace_back(name, value);
             }
+            step.params.emplace_back(name, value);
+        }
+
+        // Constant values go through the command's own binder; placeholders are bound when the program runs
+        ParamError invalid;
+        if (info.check && !info.check(constants, invalid))
+        {
+            error = invalid.message;
+            return 0;
         }
+        steps.push_back(std::move(step));
     }
-    return "{\"error\": \"Module not found\"}";
+
+    if (steps.empty())
+    {
+        error = "Empty program";
+        return 0;
+    }
+    uint32_t id = programs.add(std::move(steps));
+    if (id == 0)
+    {
+        error = "Too many programs";
+    }
+    return id;
+}
+
+size_t RemoteControlServer::loadProgram(const std::vector<ProgramStep> &steps, const std::vector<std::pair<std::string, std::string>> &args)
+{
+    for (size_t i = 0; i < steps.size(); ++i)
+    {
+        BatchCommand &entry = batchCommand(i);
+        if (steps[i].bind(args, entry.params) != nullptr)
+        {
+            entry.result.setError("Missing program argument");
+            continue;
+        }
+        entry.module = steps[i].module;
+        entry.opcode = steps[i].opcode;
+        entry.cacheMs = steps[i].cacheMs;
+    }
+    return steps.size();
+}
+
+void RemoteControlServer::runBatch(size_t count, bool serial)
+{
+    uint32_t buses = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (batch[i].module >= 0)
+        {
+            buses |= 1u << static_cast<uint32_t>(moduleBuses[batch[i].module]);
+        }
+    }
+
+    // With a single bus there is nothing to overlap, so skip the hand-off
+    if (serial || (buses & (buses - 1)) == 0)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (batch[i].module >= 0)
+            {
+                executeBatchCommand(batch[i]);
+            }
+        }
+        return;
+    }
+
+    size_t dispatched = 0;
+    uint32_t local = 1u << static_cast<uint32_t>(BusResource::General);
+    for (size_t bus = 1; bus < static_cast<size_t>(BusResource::Count); ++bus)
+    {
+        if ((buses & (1u << bus)) == 0)
+        {
+            continue;
+        }
+        BusResource resource = static_cast<BusResource>(bus);
+        if (busExecutors[bus] && busExecutors[bus]->submit([this, count, resource]()
+                                                           {
+                runBusCommands(count, resource);
+                xSemaphoreGive(batchDone); }))
+        {
+            ++dispatched;
+        }
+        else
+        {
+            local |= 1u << bus;
+        }
+    }
+
+    // Buses without a running executor share the calling task
+    for (size_t bus = 0; bus < static_cast<size_t>(BusResource::Count); ++bus)
+    {
+        if (buses & local & (1u << bus))
+        {
+            runBusCommands(count, static_cast<BusResource>(bus));
+        }
+    }
+    while (dispatched--)
+    {
+        xSemaphoreTake(batchDone, portMAX_DELAY);
+    }
+}
+
+void RemoteControlServer::runBusCommands(size_t count, BusResource bus)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        BatchCommand &entry = batch[i];
+        if (entry.module >= 0 && moduleBuses[entry.module] == bus)
+        {
+            executeBatchCommand(entry);
+        }
+    }
+}
+
+void RemoteControlServer::executeBatchCommand(BatchCommand &entry)
+{
+    if (!cacheableCommands[entry.module][entry.opcode])
+    {
+        executeCommand(entry.module, entry.opcode, entry.params, entry.result);
+        cache.invalidate(entry.module);
+        return;
+    }
+    if (entry.cacheMs == 0)
+    {
+        executeCommand(entry.module, entry.opcode, entry.params, entry.result);
+        return;
+    }
+    if (!cache.lookup(entry.module, entry.opcode, entry.params, millis(), entry.result))
+    {
+        executeCommand(entry.module, entry.opcode, entry.params, entry.result);
+        // The TTL runs from when the result is ready, so a read slower than it is still reused
+        cache.store(entry.module, entry.opcode, entry.params, millis(), entry.cacheMs, entry.result);
+    }
+}
+
+void RemoteControlServer::handleWebSocketEvent(AsyncWebSocket *socket, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len)
+{
+    std::lock_guard<std::mutex> lock(sessionMutex);
+    if (type == WS_EVT_CONNECT)
+    {
+        webSocketSessions.push_back({client->id(), false, std::string()});
+        return;
+    }
+
+    auto session = std::find_if(webSocketSessions.begin(), webSocketSessions.end(), [client](const WebSocketSession &s)
+                                { return s.clientId == client->id(); });
+    if (session == webSocketSessions.end())
+    {
+        return;
+    }
+
+    if (type == WS_EVT_DISCONNECT)
+    {
+        webSocketSessions.erase(session);
+        return;
+    }
+    if (type != WS_EVT_DATA)
+    {
+        return;
+    }
+
+    AwsFrameInfo *info = static_cast<AwsFrameInfo *>(arg);
+    bool binary = info->message_opcode == WS_BINARY;
+
+    // Messages that arrive in a single frame skip the reassembly buffer
+    if (info->final && info->num == 0 && info->index == 0 && info->len == len)
+    {
+        submitWebSocketMessage(*session, binary, data, len);
+        return;
+    }
+
+    // Otherwise reassemble the message across frames and TCP chunks
+    if (info->num == 0 && info->index == 0)
+    {
+        session->message.clear();
+    }
+    if (session->message.size() + len > ARDUINOCTL_MAX_BODY_SIZE)
+    {
+        session->message.clear();
+        client->close(1009, "Message too large");
+        return;
+    }
+    session->message.append(reinterpret_cast<const char *>(data), len);
+    if (info->final && info->index + len == info->len)
+    {
+        submitWebSocketMessage(*session, binary, reinterpret_cast<const uint8_t *>(session->message.data()), session->message.size());
+        session->message.clear();
+    }
+}
+
+void RemoteControlServer::submitWebSocketMessage(const WebSocketSession &session, bool binary, const uint8_t *data, size_t length)
+{
+    // AsyncTCP reuses the frame buffer before the executor gets to the message, so the job keeps a copy
+    char *input = static_cast<char *>(malloc(length + 1));
+    if (input == nullptr)
+    {
+        webSocket.close(session.clientId, 1011, "Out of memory");
+        return;
+    }
+    memcpy(input, data, length);
+    input[length] = '\0';
+
+    std::shared_ptr<Job> job = std::make_shared<Job>(input, input, length, binary);
+    uint32_t clientId = session.clientId;
+    if (!executor.submit([this, job, clientId]()
+                         { executeWebSocketMessage(*job, clientId); }))
+    {
+        std::string busy;
+        if (binary)
+        {
+            writeMsgPackError(busy, "Too many pending commands");
+            webSocket.binary(clientId, busy.data(), busy.size());
+        }
+        else
+        {
+            busy = "{\"error\": \"Too many pending commands\"}";
+            webSocket.text(clientId, busy.data(), busy.size());
+        }
+    }
+}
+
+void RemoteControlServer::executeWebSocketMessage(Job &job, uint32_t clientId)
+{
+    // The first message must carry the API key; later messages run without it. A client's
+    // messages run in order on this task, so its state here reflects every message before
+    // this one, including the one that authenticated it.
+    bool authenticated;
+    {
+        std::lock_guard<std::mutex> lock(sessionMutex);
+        auto session = std::find_if(webSocketSessions.begin(), webSocketSessions.end(), [clientId](const WebSocketSession &s)
+                                    { return s.clientId == clientId; });
+        if (session == webSocketSessions.end())
+        {
+            return;
+        }
+        authenticated = session->authenticated;
+    }
+
+    bool accepted;
+    {
+        std::lock_guard<std::mutex> lock(executionMutex);
+        metrics.countRequest(job.length);
+        if (job.msgpack)
+        {
+            JsonDocumentPool::Lease lease = documentPool.acquire(0);
+            accepted = executeMessage(reinterpret_cast<const uint8_t *>(job.input), job.length, lease.text(), authenticated);
+            metrics.countResponse(lease.text().size());
+            webSocket.binary(clientId, lease.text().data(), lease.text().size());
+        }
+        else
+        {
+            uint32_t started = micros();
+            JsonDocumentPool::Lease lease = documentPool.acquire(JsonDocumentPool::capacityFor(job.input, job.length, true));
+            DeserializationError error = deserializeJson(lease.doc(), job.input, job.length);
+            metrics.recordPhase(Phase::Parse, micros() - started);
+            accepted = executeDocument(lease.doc(), error, lease.text(), authenticated);
+            metrics.countResponse(lease.text().size());
+            webSocket.text(clientId, lease.text().data(), lease.text().size());
+        }
+    }
+    if (authenticated)
+    {
+        return;
+    }
+
+    if (accepted)
+    {
+        std::lock_guard<std::mutex> lock(sessionMutex);
+        auto session = std::find_if(webSocketSessions.begin(), webSocketSessions.end(), [clientId](const WebSocketSession &s)
+                                    { return s.clientId == clientId; });
+        if (session != webSocketSessions.end())
+        {
+            session->authenticated = true;
+        }
+    }
+    // Close after releasing sessionMutex; socket event callbacks take it while the socket holds its own lock
+    if (!accepted)
+    {
+        webSocket.close(clientId, 1008, "Invalid API key");
+    }
+}
+
+void RemoteControlServer::handleUdpPacket(const uint8_t *data, size_t length)
+{
+    UdpFrame frame;
+    if (!parseUdpFrame(data, length, udpToken, frame) || frame.module >= udpSequences.size())
+    {
+        return;
+    }
+    if (!udpSequences[frame.module].accept(frame.sequence))
+    {
+        return;
+    }
+    // Module commands only run from the executor, which also hands batches to the bus
+    // executors and waits for them; a frame that finds its queue full is dropped like a lost datagram
+    executor.submit([this, frame]()
+                    {
+        if (modules[frame.module].second->dispatchPacked(frame.opcode, frame.args, frame.argc))
+        {
+            cache.invalidate(frame.module);
+        } });
+}
+
+bool RemoteControlServer::resolveCommand(const char *moduleName, size_t moduleLength, const char *commandName, size_t commandLength, int &module, uint16_t &opcode, ResultSink &result)
+{
+    module = moduleIndex.find(moduleName, moduleLength);
+    if (module < 0)
+    {
+        result.setError("Module not found");
+        return false;
+    }
+    opcode = modules[module].second->opcodeOf(commandName, commandLength);
+    if (opcode == ModuleInterface::INVALID_OPCODE)
+    {
+        result.setError("Command not found");
+        return false;
+    }
+    return true;
+}
+
+bool RemoteControlServer::checkApiKey(const char *apiKey, size_t length) const
+{
+    const std::string &expected = configCtl.getApiKey();
+    return length == expected.size() && memcmp(apiKey, expected.data(), length) == 0;
+}
+
+void RemoteControlServer::executeCommand(size_t module, uint16_t opcode, const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result)
+{
+    uint32_t started = micros();
+    modules[module].second->dispatch(opcode, params, result);
+    metrics.recordCommand(module, opcode, micros() - started);
 }
 
 void setup()
@@ -208,5 +1370,6 @@ void loop()
 {
     // The AsyncWebServer is non-blocking, so we don't need to call server.handleClient()
     // You can add any other continuous tasks here if needed
+    webSocket.cleanupClients();
     delay(1000); // Small delay to prevent watchdog timer issues
 }
@@ -0,0 +1,168 @@
+// ⚡🔌 Arduino-CTL 🔌⚡
+//
+// Copyright (C) 2024 ixaxaar
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "base64codec.h"
+
+/// Encoding alphabet, indexed by 6-bit value
+static const char ENCODE[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/// 6-bit value of each character; standard and URL-safe characters map in, anything else is 0xFF
+static const uint8_t DECODE[256] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x3E, 0xFF, 0x3E, 0xFF, 0x3F,
+    0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E,
+    0x0F, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0xFF, 0xFF, 0xFF, 0xFF, 0x3F,
+    0xFF, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F, 0x30, 0x31, 0x32, 0x33, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+};
+
+/**
+ * @brief Get the number of characters left once trailing padding is removed
+ *
+ * @param text The base64 characters
+ * @param length Number of characters
+ * @return Length without the padding
+ */
+static size_t unpaddedLength(const char *text, size_t length)
+{
+    for (int i = 0; i < 2 && length > 0 && text[length - 1] == '='; ++i)
+    {
+        --length;
+    }
+    return length;
+}
+
+size_t base64DecodedLength(const char *text, size_t length)
+{
+    length = unpaddedLength(text, length);
+    size_t remainder = length % 4;
+    return length / 4 * 3 + (remainder > 1 ? remainder - 1 : 0);
+}
+
+size_t base64Encode(const uint8_t *data, size_t length, char *out)
+{
+    char *start = out;
+    const uint8_t *end = data + length / 3 * 3;
+    while (data != end)
+    {
+        uint32_t group = (uint32_t(data[0]) << 16) | (uint32_t(data[1]) << 8) | data[2];
+        out[0] = ENCODE[group >> 18];
+        out[1] = ENCODE[(group >> 12) & 0x3F];
+        out[2] = ENCODE[(group >> 6) & 0x3F];
+        out[3] = ENCODE[group & 0x3F];
+        data += 3;
+        out += 4;
+    }
+
+    size_t remainder = length % 3;
+    if (remainder != 0)
+    {
+        uint32_t group = uint32_t(data[0]) << 16;
+        if (remainder == 2)
+        {
+            group |= uint32_t(data[1]) << 8;
+        }
+        out[0] = ENCODE[group >> 18];
+        out[1] = ENCODE[(group >> 12) & 0x3F];
+        out[2] = remainder == 2 ? ENCODE[(group >> 6) & 0x3F] : '=';
+        out[3] = '=';
+        out += 4;
+    }
+    return out - start;
+}
+
+void base64Append(std::string &out, const uint8_t *data, size_t length)
+{
+    size_t offset = out.size();
+    out.resize(offset + base64EncodedLength(length));
+    base64Encode(data, length, &out[offset]);
+}
+
+bool base64Decode(const char *text, size_t length, uint8_t *out, size_t &written)
+{
+    const uint8_t *in = reinterpret_cast<const uint8_t *>(text);
+    uint8_t *start = out;
+    written = 0;
+
+    length = unpaddedLength(text, length);
+    size_t remainder = length % 4;
+    if (remainder == 1)
+    {
+        return false;
+    }
+
+    const uint8_t *end = in + (length - remainder);
+    while (in != end)
+    {
+        uint8_t a = DECODE[in[0]];
+        uint8_t b = DECODE[in[1]];
+        uint8_t c = DECODE[in[2]];
+        uint8_t d = DECODE[in[3]];
+        // One check per group: valid values are below 64, 0xFF has bit 7 set
+        if ((a | b | c | d) & 0x80)
+        {
+            return false;
+        }
+        uint32_t group = (uint32_t(a) << 18) | (uint32_t(b) << 12) | (uint32_t(c) << 6) | d;
+        out[0] = uint8_t(group >> 16);
+        out[1] = uint8_t(group >> 8);
+        out[2] = uint8_t(group);
+        in += 4;
+        out += 3;
+    }
+
+    if (remainder != 0)
+    {
+        uint8_t a = DECODE[in[0]];
+        uint8_t b = DECODE[in[1]];
+        uint8_t c = remainder == 3 ? DECODE[in[2]] : 0;
+        if ((a | b | c) & 0x80)
+        {
+            return false;
+        }
+        uint32_t group = (uint32_t(a) << 18) | (uint32_t(b) << 12) | (uint32_t(c) << 6);
+        *out++ = uint8_t(group >> 16);
+        if (remainder == 3)
+        {
+            *out++ = uint8_t(group >> 8);
+        }
+    }
+
+    written = out - start;
+    return true;
+}
+
+bool base64Decode(const std::string &text, std::vector<uint8_t> &out)
+{
+    out.resize(base64DecodedLength(text.data(), text.size()));
+    size_t written = 0;
+    if (!base64Decode(text.data(), text.size(), out.data(), written))
+    {
+        out.clear();
+        return false;
+    }
+    return true;
+}
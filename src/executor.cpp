@@ -0,0 +1,72 @@
+// ⚡🔌 Arduino-CTL 🔌⚡
+//
+// Copyright (C) 2024 ixaxaar
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "executor.h"
+
+Executor::Executor(const char *name, uint32_t stackSize, UBaseType_t priority, BaseType_t core, size_t depth)
+    : _name(name), _stackSize(stackSize), _priority(priority), _core(core), _depth(depth), _queue(nullptr), _task(nullptr)
+{
+}
+
+bool Executor::begin()
+{
+    if (_task != nullptr)
+    {
+        return true;
+    }
+    _queue = xQueueCreate(_depth, sizeof(std::function<void()> *));
+    if (_queue == nullptr)
+    {
+        return false;
+    }
+    if (xTaskCreatePinnedToCore(run, _name, _stackSize, this, _priority, &_task, _core) != pdPASS)
+    {
+        vQueueDelete(_queue);
+        _queue = nullptr;
+        _task = nullptr;
+        return false;
+    }
+    return true;
+}
+
+bool Executor::submit(std::function<void()> work)
+{
+    if (_queue == nullptr)
+    {
+        return false;
+    }
+    std::function<void()> *item = new std::function<void()>(std::move(work));
+    if (xQueueSend(_queue, &item, 0) != pdTRUE)
+    {
+        delete item;
+        return false;
+    }
+    return true;
+}
+
+void Executor::run(void *arg)
+{
+    Executor *executor = static_cast<Executor *>(arg);
+    for (;;)
+    {
+        std::function<void()> *item;
+        if (xQueueReceive(executor->_queue, &item, portMAX_DELAY) == pdTRUE)
+        {
+            (*item)();
+            delete item;
+        }
+    }
+}
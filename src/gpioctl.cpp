@@ -16,118 +16,852 @@
 
 #include "gpioctl.h"
 #include <sstream>
-#include "base64.hpp"
+#include <algorithm>
+#include <freertos/FreeRTOS.h>
+#include "soc/gpio_struct.h"
+#include "base64codec.h"
+#include "samples.h"
+#include "params.h"
 
-GPIOCtl::GPIOCtl() : _pin(0), _mode(INPUT)
+// Largest capture; samples of up to eight adjacent pins take a byte each while capturing
+static const int MAX_CAPTURE_SAMPLES = 16384;
+
+// Most samples one digitalRead or bankRead takes, bounding its result and how long it holds the pins
+static const int MAX_READ_SAMPLES = 4096;
+
+// Interrupts stay masked while a capture waits for its trigger and while it samples,
+// and the interrupt watchdog fires after 300 ms; the two together are kept under this
+static const uint32_t MAX_CAPTURE_MS = 100;
+
+// RMT channel that plays patterns, and the blocks of RMT memory it takes (64 items each);
+// a looping pattern must fit in them, with room for the end marker
+static const rmt_channel_t PATTERN_CHANNEL = RMT_CHANNEL_0;
+static const uint8_t PATTERN_MEMORY_BLOCKS = 4;
+
+// The RMT channel counts the undivided 80 MHz APB clock: 12.5 ns per tick
+static const uint64_t PATTERN_TICKS_PER_US = 80;
+
+// Longest stretch one half of an RMT item holds, in ticks
+static const uint32_t PATTERN_MAX_DURATION = 32767;
+
+// Longest a pin command waits for a pattern to play to its end before cutting it short
+static const uint32_t PATTERN_FINISH_TIMEOUT_MS = 100;
+
+namespace
+{
+struct InitParams
+{
+    int pin;
+    int mode;
+};
+
+struct SetPinModeParams
+{
+    int mode = INPUT;
+};
+
+struct DigitalReadParams
+{
+    int numSamples = 1;
+    const std::string *encoding = nullptr;
+};
+
+struct DigitalWriteParams
+{
+    const std::string *values = nullptr;
+};
+
+struct BankModeParams
+{
+    uint64_t mask = 0;
+    int mode = INPUT;
+};
+
+struct BankReadParams
 {
+    uint64_t mask = 0;
+    int numSamples = 1;
+    uint32_t intervalUs = 0;
+};
+
+struct BankWriteParams
+{
+    uint64_t mask = 0;
+    int64_t value = -1; ///< Single packed step, -1 if absent
+    const std::string *values = nullptr;
+    uint32_t intervalUs = 0;
+};
+
+struct CaptureParams
+{
+    uint32_t mask = 0;
+    int numSamples = 1024;
+    int preTrigger = 0;
+    uint32_t sampleRate = 1000000;
+    uint32_t triggerMask = 0;
+    uint32_t triggerValue = 0;
+    int triggerEdge = 0;
+    uint32_t timeoutMs = MAX_CAPTURE_MS;
+};
+
+struct PlayPatternParams
+{
+    const std::string *pulses = nullptr;
+    const std::string *bits = nullptr;
+    uint32_t bitRate = 0;
+    int64_t numBits = -1; ///< Bits of "bits" to play, -1 for all
+    int loop = 0;
+    int idleLevel = LOW;
+    int wait = 0;
+};
+
+enum class CaptureStatus
+{
+    Done,
+    Timeout, ///< The trigger did not fire in time
+    Overrun  ///< A sample was taken more than a period late
+};
 }
 
-void GPIOCtl::init(const std::vector<std::pair<std::string, std::string>> &params)
+// Every GPIO of the chip, bit n for GPIO n
+static const int64_t ALL_PINS_MASK = (1LL << NUM_DIGITAL_PINS) - 1;
+
+// GPIO6 to GPIO11 are wired to the SPI flash of ESP32 modules; driving them halts the chip
+static const uint64_t FLASH_PINS_MASK = 0xFC0;
+
+// Parameter schemas; getSupportedFunctions() describes the commands from the same arrays
+static constexpr ParamSpec<InitParams> INIT_PARAMS[] = {
+    integerParam<InitParams, int, &InitParams::pin>("pin", "int", 0, NUM_DIGITAL_PINS - 1),
+    integerParam<InitParams, int, &InitParams::mode>("mode", "int", 0, UINT8_MAX)};
+
+static constexpr ParamSpec<SetPinModeParams> SET_PIN_MODE_PARAMS[] = {
+    integerParam<SetPinModeParams, int, &SetPinModeParams::mode>("mode", "int", 0, UINT8_MAX)};
+
+static constexpr ParamSpec<DigitalReadParams> DIGITAL_READ_PARAMS[] = {
+    integerParam<DigitalReadParams, int, &DigitalReadParams::numSamples>("numSamples", "int", 0, MAX_READ_SAMPLES),
+    textParam<DigitalReadParams, &DigitalReadParams::encoding>("encoding", "std::string")};
+
+static constexpr ParamSpec<DigitalWriteParams> DIGITAL_WRITE_PARAMS[] = {
+    textParam<DigitalWriteParams, &DigitalWriteParams::values>("values", "std::vector<int>")};
+
+static constexpr ParamSpec<BankModeParams> BANK_MODE_PARAMS[] = {
+    integerParam<BankModeParams, uint64_t, &BankModeParams::mask>("mask", "uint64_t", 0, ALL_PINS_MASK),
+    integerParam<BankModeParams, int, &BankModeParams::mode>("mode", "int", 0, UINT8_MAX)};
+
+static constexpr ParamSpec<BankReadParams> BANK_READ_PARAMS[] = {
+    integerParam<BankReadParams, uint64_t, &BankReadParams::mask>("mask", "uint64_t", 0, ALL_PINS_MASK),
+    integerParam<BankReadParams, int, &BankReadParams::numSamples>("numSamples", "int", 0, MAX_READ_SAMPLES),
+    integerParam<BankReadParams, uint32_t, &BankReadParams::intervalUs>("intervalUs", "uint32_t")};
+
+static constexpr ParamSpec<BankWriteParams> BANK_WRITE_PARAMS[] = {
+    integerParam<BankWriteParams, uint64_t, &BankWriteParams::mask>("mask", "uint64_t", 0, ALL_PINS_MASK),
+    integerParam<BankWriteParams, int64_t, &BankWriteParams::value>("value", "uint64_t", 0, ALL_PINS_MASK),
+    textParam<BankWriteParams, &BankWriteParams::values>("values", "std::vector<uint8_t>"),
+    integerParam<BankWriteParams, uint32_t, &BankWriteParams::intervalUs>("intervalUs", "uint32_t")};
+
+static constexpr ParamSpec<CaptureParams> CAPTURE_PARAMS[] = {
+    integerParam<CaptureParams, uint32_t, &CaptureParams::mask>("mask", "uint32_t", 1),
+    integerParam<CaptureParams, int, &CaptureParams::numSamples>("numSamples", "int", 1, MAX_CAPTURE_SAMPLES),
+    integerParam<CaptureParams, int, &CaptureParams::preTrigger>("preTrigger", "int", 0, MAX_CAPTURE_SAMPLES - 1),
+    integerParam<CaptureParams, uint32_t, &CaptureParams::sampleRate>("sampleRate", "uint32_t", 1),
+    integerParam<CaptureParams, uint32_t, &CaptureParams::triggerMask>("triggerMask", "uint32_t"),
+    integerParam<CaptureParams, uint32_t, &CaptureParams::triggerValue>("triggerValue", "uint32_t"),
+    integerParam<CaptureParams, int, &CaptureParams::triggerEdge>("triggerEdge", "int", 0, 1),
+    integerParam<CaptureParams, uint32_t, &CaptureParams::timeoutMs>("timeoutMs", "uint32_t", 0, MAX_CAPTURE_MS)};
+
+static constexpr ParamSpec<PlayPatternParams> PLAY_PATTERN_PARAMS[] = {
+    textParam<PlayPatternParams, &PlayPatternParams::pulses>("pulses", "std::vector<uint32_t>"),
+    textParam<PlayPatternParams, &PlayPatternParams::bits>("bits", "std::vector<uint8_t>"),
+    integerParam<PlayPatternParams, uint32_t, &PlayPatternParams::bitRate>("bitRate", "uint32_t", 1, PATTERN_TICKS_PER_US * 1000000),
+    integerParam<PlayPatternParams, int64_t, &PlayPatternParams::numBits>("numBits", "size_t", 0),
+    integerParam<PlayPatternParams, int, &PlayPatternParams::loop>("loop", "int", 0, 1),
+    integerParam<PlayPatternParams, int, &PlayPatternParams::idleLevel>("idleLevel", "int", LOW, HIGH),
+    integerParam<PlayPatternParams, int, &PlayPatternParams::wait>("wait", "int", 0, 1)};
+
+// Bytes of one packed bank sample or step
+static size_t bankSampleSize(uint64_t mask)
 {
-    for (const auto &param : params)
+    return (__builtin_popcountll(mask) + 7) / 8;
+}
+
+// Gather the bits of the pins in mask into the low bits, lowest pin first
+static uint64_t packBank(uint64_t levels, uint64_t mask)
+{
+    uint64_t packed = 0;
+    for (uint64_t bit = 1; mask != 0; bit <<= 1, mask &= mask - 1)
     {
-        if (param.first == "pin")
+        if (levels & mask & (~mask + 1))
         {
-            _pin = std::stoi(param.second);
+            packed |= bit;
         }
-        else if (param.first == "mode")
+    }
+    return packed;
+}
+
+// Spread the low bits of packed over the pins in mask; the inverse of packBank
+static uint64_t unpackBank(uint64_t packed, uint64_t mask)
+{
+    uint64_t levels = 0;
+    for (uint64_t bit = 1; mask != 0; bit <<= 1, mask &= mask - 1)
+    {
+        if (packed & bit)
         {
-            _mode = std::stoi(param.second);
+            levels |= mask & (~mask + 1);
         }
     }
-    pinMode(_pin, _mode);
+    return levels;
 }
 
-void GPIOCtl::deinit()
+// Input levels of all pins, GPIO0-31 from the first bank and GPIO32-39 from the second
+static uint64_t readBankRegisters()
 {
-    // No specific deinitialization needed for GPIO pins
+    return GPIO.in | (static_cast<uint64_t>(GPIO.in1.val) << 32);
 }
 
-std::pair<std::string, void *> GPIOCtl::execute(const std::string &command, const std::vector<std::pair<std::string, std::string>> &params)
+// Drive the pins in set high and those in clear low, one register write per bank and direction
+static void writeBankRegisters(uint64_t set, uint64_t clear)
 {
-    if (command == "setPinMode")
+    if (static_cast<uint32_t>(clear) != 0)
     {
-        int mode = INPUT;
-        for (const auto &param : params)
+        GPIO.out_w1tc = static_cast<uint32_t>(clear);
+    }
+    if (static_cast<uint32_t>(set) != 0)
+    {
+        GPIO.out_w1ts = static_cast<uint32_t>(set);
+    }
+    if ((clear >> 32) != 0)
+    {
+        GPIO.out1_w1tc.val = static_cast<uint32_t>(clear >> 32);
+    }
+    if ((set >> 32) != 0)
+    {
+        GPIO.out1_w1ts.val = static_cast<uint32_t>(set >> 32);
+    }
+}
+
+// Wait for the next sample time, then read the input register; sets overrun if the sample is a period late
+static inline uint32_t sampleAt(uint32_t time, uint32_t period, bool &overrun)
+{
+    uint32_t now;
+    while (static_cast<int32_t>((now = ESP.getCycleCount()) - time) < 0)
+    {
+    }
+    uint32_t levels = GPIO.in;
+    overrun |= now - time >= period;
+    return levels;
+}
+
+// Sample into a ring of numSamples words until the trigger fires, then for the
+// post-trigger samples, and leave the ring in time order
+template <typename Word>
+static CaptureStatus captureWords(Word *ring, uint32_t shift, const GPIOCtl::CaptureSettings &settings)
+{
+    const size_t size = settings.numSamples;
+    size_t index = 0;
+    size_t filled = 0;
+    bool matched = true; // An edge trigger needs to see the pins not match first
+    bool overrun = false;
+
+    portDISABLE_INTERRUPTS();
+    const uint32_t start = ESP.getCycleCount();
+    uint32_t next = start;
+    while (true)
+    {
+        uint32_t levels = sampleAt(next, settings.cyclesPerSample, overrun);
+        ring[index] = static_cast<Word>(levels >> shift);
+        index = index + 1 == size ? 0 : index + 1;
+        ++filled;
+        bool match = (levels & settings.triggerMask) == settings.triggerValue;
+        if (match && !(settings.triggerEdge && matched) && filled > settings.preTrigger)
         {
-            if (param.first == "mode")
-            {
-                mode = std::stoi(param.second);
-                break;
-            }
+            break;
+        }
+        matched = match;
+        next += settings.cyclesPerSample;
+        if (next - start > settings.timeoutCycles)
+        {
+            portENABLE_INTERRUPTS();
+            return CaptureStatus::Timeout;
         }
-        setPinMode(mode);
-        return {"", nullptr};
     }
-    else if (command == "digitalRead")
+    // Interrupts stay masked into the post-trigger samples: those held off while waiting
+    // would all run at the trigger and delay the first sample
+    for (size_t remaining = size - settings.preTrigger - 1; remaining > 0; --remaining)
     {
-        int numSamples = 1;
-        for (const auto &param : params)
+        next += settings.cyclesPerSample;
+        ring[index] = static_cast<Word>(sampleAt(next, settings.cyclesPerSample, overrun) >> shift);
+        index = index + 1 == size ? 0 : index + 1;
+    }
+    portENABLE_INTERRUPTS();
+
+    // At least size samples were taken, so the oldest kept one is at index
+    std::rotate(ring, ring + index, ring + size);
+    return overrun ? CaptureStatus::Overrun : CaptureStatus::Done;
+}
+
+// Pack the selected bits of each captured word into a bit stream, in place; returns its length in bytes
+template <typename Word>
+static size_t packCapture(Word *samples, size_t count, uint32_t pins)
+{
+    uint8_t *out = reinterpret_cast<uint8_t *>(samples);
+    const int width = __builtin_popcount(pins);
+    const bool contiguous = (pins & (pins + 1)) == 0;
+    uint64_t bits = 0;
+    int pending = 0;
+    size_t length = 0;
+    // Output byte n is written after the sample it ends in was read, so it never overtakes the input
+    for (size_t i = 0; i < count; ++i)
+    {
+        uint32_t sample = samples[i];
+        bits |= (contiguous ? sample & pins : packBank(sample, pins)) << pending;
+        pending += width;
+        for (; pending >= 8; pending -= 8)
         {
-            if (param.first == "numSamples")
-            {
-                numSamples = std::stoi(param.second);
-                break;
-            }
+            out[length++] = static_cast<uint8_t>(bits);
+            bits >>= 8;
         }
-        std::vector<int> result = digitalRead(numSamples);
-        return {"std::vector<int>", new std::vector<int>(result)};
     }
-    else if (command == "digitalWrite")
+    if (pending > 0)
+    {
+        out[length++] = static_cast<uint8_t>(bits);
+    }
+    return length;
+}
+
+// Turns level stretches, timed in nanoseconds from the start of a pattern, into RMT
+// items. Equal levels merge, and stretches too long for one item are split; times
+// are converted to ticks cumulatively, so rounding never accumulates.
+class PatternWriter
+{
+public:
+    explicit PatternWriter(std::vector<rmt_item32_t> &items) : _items(items)
     {
-        std::vector<int> values;
-        for (const auto &param : params)
+        _items.clear();
+    }
+
+    // Hold a level until endNs
+    void add(uint8_t level, uint64_t endNs)
+    {
+        uint64_t endTick = (endNs * PATTERN_TICKS_PER_US + 500) / 1000;
+        uint64_t ticks = endTick - _tick;
+        _tick = endTick;
+        if (ticks == 0)
+        {
+            return;
+        }
+        if (_pending != 0 && level != _level)
         {
-            if (param.first == "values")
+            flush();
+        }
+        _level = level;
+        _pending += ticks;
+    }
+
+    // Write out the last stretch
+    void finish()
+    {
+        flush();
+    }
+
+private:
+    std::vector<rmt_item32_t> &_items;
+    uint64_t _tick = 0;    // End of the pattern so far, in ticks
+    uint64_t _pending = 0; // Ticks of _level not written yet
+    uint8_t _level = LOW;
+    bool _halfOpen = false; // Whether the last item has its second half free
+
+    void flush()
+    {
+        while (_pending > 0)
+        {
+            uint32_t duration = static_cast<uint32_t>(std::min<uint64_t>(_pending, PATTERN_MAX_DURATION));
+            _pending -= duration;
+            if (_halfOpen)
             {
-                std::vector<uint8_t> decodedData(decode_base64_length(reinterpret_cast<const unsigned char *>(param.second.c_str())));
-                decode_base64(reinterpret_cast<const unsigned char *>(param.second.c_str()), param.second.length(), decodedData.data());
-                values.reserve(decodedData.size() / sizeof(int));
-                for (size_t i = 0; i < decodedData.size(); i += sizeof(int))
-                {
-                    int value;
-                    memcpy(&value, &decodedData[i], sizeof(int));
-                    values.push_back(value);
-                }
-                break;
+                _items.back().duration1 = duration;
+                _items.back().level1 = _level;
             }
+            else
+            {
+                rmt_item32_t item;
+                item.val = 0; // A zero second half ends the pattern unless it is filled in
+                item.duration0 = duration;
+                item.level0 = _level;
+                _items.push_back(item);
+            }
+            _halfOpen = !_halfOpen;
         }
-        digitalWrite(values);
-        return {"", nullptr};
     }
-    return {"", nullptr};
+};
+
+GPIOCtl::GPIOCtl() : _pin(0), _mode(INPUT), _patternInstalled(false), _patternLoops(false)
+{
+}
+
+void GPIOCtl::init(const std::vector<std::pair<std::string, std::string>> &params)
+{
+    // Invalid values keep the current setting
+    InitParams args = {_pin, _mode};
+    ParamError error;
+    bindParams(INIT_PARAMS, params, args, error);
+    stopPattern(false);
+    _pin = args.pin;
+    _mode = args.mode;
+    pinMode(_pin, _mode);
+}
+
+void GPIOCtl::deinit()
+{
+    stopPattern(false);
+}
+
+const GPIOCtl::Handler GPIOCtl::handlers[GPIOCtl::OP_COUNT] = {
+    &GPIOCtl::handleSetPinMode,
+    &GPIOCtl::handleDigitalRead,
+    &GPIOCtl::handleDigitalWrite,
+    &GPIOCtl::handleBankMode,
+    &GPIOCtl::handleBankRead,
+    &GPIOCtl::handleBankWrite,
+    &GPIOCtl::handleCapture,
+    &GPIOCtl::handlePlayPattern,
+    &GPIOCtl::handleStopPattern};
+
+void GPIOCtl::dispatch(uint16_t opcode, const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result)
+{
+    if (opcode >= OP_COUNT)
+    {
+        result.setError("Command not found");
+        return;
+    }
+    (this->*handlers[opcode])(params, result);
+}
+
+bool GPIOCtl::dispatchPacked(uint16_t opcode, const int32_t *args, size_t count)
+{
+    if (opcode != OP_DIGITAL_WRITE)
+    {
+        return false;
+    }
+    stopPattern(true);
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (i > 0)
+        {
+            delay(1); // Same spacing as digitalWrite, without holding up the caller after the last value
+        }
+        ::digitalWrite(_pin, args[i]);
+    }
+    return true;
 }
 
 std::vector<FunctionInfo> GPIOCtl::getSupportedFunctions()
 {
+    // Entries are listed in Opcode order; the position of each entry is its opcode
     return {
-        {"setPinMode", {{"mode", "int"}}},
-        {"digitalRead", {{"numSamples", "int"}}},
-        {"digitalWrite", {{"values", "std::vector<int>"}}}};
+        describeCommand("setPinMode", SET_PIN_MODE_PARAMS),
+        describeCommand("digitalRead", DIGITAL_READ_PARAMS, ResultType::Bytes, true),
+        describeCommand("digitalWrite", DIGITAL_WRITE_PARAMS),
+        describeCommand("bankMode", BANK_MODE_PARAMS),
+        describeCommand("bankRead", BANK_READ_PARAMS, ResultType::Bytes, true),
+        describeCommand("bankWrite", BANK_WRITE_PARAMS),
+        describeCommand("capture", CAPTURE_PARAMS, ResultType::Bytes),
+        describeCommand("playPattern", PLAY_PATTERN_PARAMS),
+        describeCommand("stopPattern")};
+}
+
+void GPIOCtl::handleSetPinMode(const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result)
+{
+    SetPinModeParams args;
+    if (bindParams(SET_PIN_MODE_PARAMS, params, args, result))
+    {
+        setPinMode(args.mode);
+    }
+}
+
+void GPIOCtl::handleDigitalRead(const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result)
+{
+    DigitalReadParams args;
+    SampleEncoding encoding = SampleEncoding::Int32;
+    if (!bindParams(DIGITAL_READ_PARAMS, params, args, result))
+    {
+        return;
+    }
+    if (args.encoding != nullptr && !parseSampleEncoding(*args.encoding, encoding))
+    {
+        result.setError("Unknown encoding", "encoding");
+        return;
+    }
+    digitalRead(args.numSamples, encoding, result);
+}
+
+void GPIOCtl::handleDigitalWrite(const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result)
+{
+    DigitalWriteParams args;
+    if (!bindParams(DIGITAL_WRITE_PARAMS, params, args, result))
+    {
+        return;
+    }
+    _buffer.clear();
+    if (args.values != nullptr && !base64Decode(*args.values, _buffer))
+    {
+        result.setError("Invalid base64 data", "values");
+        return;
+    }
+    _values.clear();
+    for (size_t i = 0; i + sizeof(int) <= _buffer.size(); i += sizeof(int))
+    {
+        int value;
+        memcpy(&value, &_buffer[i], sizeof(int));
+        _values.push_back(value);
+    }
+    digitalWrite(_values);
+}
+
+void GPIOCtl::handleBankMode(const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result)
+{
+    BankModeParams args;
+    if (!bindParams(BANK_MODE_PARAMS, params, args, result))
+    {
+        return;
+    }
+    if (args.mask & FLASH_PINS_MASK)
+    {
+        result.setError("Pin reserved for flash", "mask");
+        return;
+    }
+    for (uint64_t mask = args.mask; mask != 0; mask &= mask - 1)
+    {
+        pinMode(__builtin_ctzll(mask), args.mode);
+    }
+}
+
+void GPIOCtl::handleBankRead(const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result)
+{
+    BankReadParams args;
+    if (bindParams(BANK_READ_PARAMS, params, args, result))
+    {
+        bankRead(args.mask, args.numSamples, args.intervalUs, result);
+    }
+}
+
+void GPIOCtl::handleBankWrite(const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result)
+{
+    BankWriteParams args;
+    if (!bindParams(BANK_WRITE_PARAMS, params, args, result))
+    {
+        return;
+    }
+    if (args.mask & FLASH_PINS_MASK)
+    {
+        result.setError("Pin reserved for flash", "mask");
+        return;
+    }
+    size_t sampleSize = bankSampleSize(args.mask);
+    _buffer.clear();
+    if (args.value >= 0)
+    {
+        // A single step, packed like the steps of "values"
+        for (size_t i = 0; i < sampleSize; ++i)
+        {
+            _buffer.push_back(static_cast<uint8_t>(args.value >> (8 * i)));
+        }
+    }
+    else if (args.values != nullptr && !base64Decode(*args.values, _buffer))
+    {
+        result.setError("Invalid base64 data", "values");
+        return;
+    }
+    if (sampleSize == 0)
+    {
+        return;
+    }
+    if (_buffer.size() % sampleSize != 0)
+    {
+        result.setError("Length is not a multiple of the step size", "values");
+        return;
+    }
+    bankWrite(args.mask, _buffer.data(), _buffer.size() / sampleSize, args.intervalUs);
+}
+
+void GPIOCtl::handleCapture(const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result)
+{
+    CaptureParams args;
+    if (!bindParams(CAPTURE_PARAMS, params, args, result))
+    {
+        return;
+    }
+    if (args.mask == 0)
+    {
+        result.setError("Missing parameter", "mask");
+        return;
+    }
+    if (args.preTrigger >= args.numSamples)
+    {
+        result.setError("Out of range", "preTrigger");
+        return;
+    }
+    const uint32_t cyclesPerMs = getCpuFrequencyMhz() * 1000;
+    CaptureSettings settings;
+    settings.mask = args.mask;
+    settings.numSamples = args.numSamples;
+    settings.preTrigger = args.preTrigger;
+    settings.cyclesPerSample = cyclesPerMs * 1000 / args.sampleRate;
+    if (settings.cyclesPerSample == 0)
+    {
+        result.setError("Out of range", "sampleRate");
+        return;
+    }
+    const uint64_t budgetCycles = static_cast<uint64_t>(cyclesPerMs) * MAX_CAPTURE_MS;
+    const uint64_t samplingCycles = static_cast<uint64_t>(settings.cyclesPerSample) * args.numSamples;
+    if (samplingCycles > budgetCycles)
+    {
+        result.setError("Capture too long", "numSamples");
+        return;
+    }
+    // The timeout starts once the pre-trigger samples are in, and gets what the samples leave of the budget
+    settings.timeoutCycles = std::min(static_cast<uint64_t>(cyclesPerMs) * args.timeoutMs, budgetCycles - samplingCycles) + settings.cyclesPerSample * args.preTrigger;
+    settings.triggerMask = args.triggerMask;
+    settings.triggerValue = args.triggerValue & args.triggerMask;
+    settings.triggerEdge = args.triggerEdge != 0;
+    capture(settings, result);
+}
+
+void GPIOCtl::handlePlayPattern(const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result)
+{
+    PlayPatternParams args;
+    if (!bindParams(PLAY_PATTERN_PARAMS, params, args, result))
+    {
+        return;
+    }
+    _buffer.clear();
+    // Built aside: the driver may still be reading _pattern
+    PatternWriter writer(_nextPattern);
+    if (args.pulses != nullptr)
+    {
+        // (level, duration) pairs as little-endian words: the level in bit 31, nanoseconds below
+        if (!base64Decode(*args.pulses, _buffer))
+        {
+            result.setError("Invalid base64 data", "pulses");
+            return;
+        }
+        if (_buffer.size() % 4 != 0)
+        {
+            result.setError("Length is not a multiple of 4", "pulses");
+            return;
+        }
+        uint64_t time = 0;
+        for (size_t i = 0; i < _buffer.size(); i += 4)
+        {
+            uint32_t pulse = _buffer[i] | (_buffer[i + 1] << 8) | (_buffer[i + 2] << 16) | (static_cast<uint32_t>(_buffer[i + 3]) << 24);
+            time += pulse & 0x7FFFFFFF;
+            writer.add(pulse >> 31, time);
+        }
+    }
+    else if (args.bits != nullptr)
+    {
+        // One period of the bit rate per bit, least significant bit of each byte first as "bits" samples are
+        if (!base64Decode(*args.bits, _buffer))
+        {
+            result.setError("Invalid base64 data", "bits");
+            return;
+        }
+        if (args.bitRate == 0)
+        {
+            result.setError("Missing parameter", "bitRate");
+            return;
+        }
+        uint64_t numBits = _buffer.size() * 8;
+        if (args.numBits >= 0)
+        {
+            if (static_cast<uint64_t>(args.numBits) > numBits)
+            {
+                result.setError("Out of range", "numBits");
+                return;
+            }
+            numBits = args.numBits;
+        }
+        for (uint64_t i = 0; i < numBits; ++i)
+        {
+            writer.add((_buffer[i / 8] >> (i % 8)) & 1, (i + 1) * 1000000000ULL / args.bitRate);
+        }
+    }
+    writer.finish();
+    if (_nextPattern.empty())
+    {
+        result.setError("Missing parameter", "pulses");
+        return;
+    }
+    if (args.loop && _nextPattern.size() >= RMT_MEM_ITEM_NUM * PATTERN_MEMORY_BLOCKS)
+    {
+        result.setError("Pattern too long to loop", args.pulses != nullptr ? "pulses" : "bits");
+        return;
+    }
+    if (playPattern(args.loop != 0, args.idleLevel, args.wait != 0) != ESP_OK)
+    {
+        result.setError("RMT channel unavailable");
+    }
+}
+
+void GPIOCtl::handleStopPattern(const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result)
+{
+    stopPattern(false);
 }
 
 void GPIOCtl::setPinMode(int mode)
 {
+    stopPattern(true);
     _mode = mode;
     pinMode(_pin, _mode);
 }
 
-std::vector<int> GPIOCtl::digitalRead(int numSamples)
+void GPIOCtl::digitalRead(int numSamples, SampleEncoding encoding, ResultSink &result)
 {
-    std::vector<int> samples;
+    if (numSamples < 0)
+    {
+        numSamples = 0;
+    }
+    SampleEncoder encoder(encoding, result.allocBytes(maxEncodedSize(encoding, numSamples)));
     for (int i = 0; i < numSamples; ++i)
     {
-        samples.push_back(::digitalRead(_pin));
+        encoder.add(::digitalRead(_pin));
         delay(1); // Short delay between readings
     }
-    return samples;
+    result.setSize(encoder.finish());
+    if (encoding != SampleEncoding::Int32)
+    {
+        result.setFormat(sampleEncodingName(encoding), numSamples);
+    }
 }
 
 void GPIOCtl::digitalWrite(const std::vector<int> &values)
 {
+    stopPattern(true);
     for (int value : values)
     {
         ::digitalWrite(_pin, value);
         delay(1); // Short delay between writes
     }
 }
+
+void GPIOCtl::bankRead(uint64_t mask, int numSamples, uint32_t intervalUs, ResultSink &result)
+{
+    if (numSamples < 0)
+    {
+        numSamples = 0;
+    }
+    size_t sampleSize = bankSampleSize(mask);
+    uint8_t *out = result.allocBytes(sampleSize * numSamples);
+    for (int i = 0; i < numSamples; ++i)
+    {
+        if (i > 0 && intervalUs > 0)
+        {
+            delayMicroseconds(intervalUs);
+        }
+        uint64_t packed = packBank(readBankRegisters(), mask);
+        for (size_t byte = 0; byte < sampleSize; ++byte)
+        {
+            *out++ = static_cast<uint8_t>(packed >> (8 * byte));
+        }
+    }
+}
+
+void GPIOCtl::bankWrite(uint64_t mask, const uint8_t *steps, size_t numSteps, uint32_t intervalUs)
+{
+    size_t sampleSize = bankSampleSize(mask);
+    for (size_t i = 0; i < numSteps; ++i)
+    {
+        if (i > 0 && intervalUs > 0)
+        {
+            delayMicroseconds(intervalUs);
+        }
+        uint64_t packed = 0;
+        for (size_t byte = 0; byte < sampleSize; ++byte)
+        {
+            packed |= static_cast<uint64_t>(*steps++) << (8 * byte);
+        }
+        uint64_t levels = unpackBank(packed, mask);
+        writeBankRegisters(levels, mask & ~levels);
+    }
+}
+
+void GPIOCtl::capture(const CaptureSettings &settings, ResultSink &result)
+{
+    // Words hold the pins shifted down to the lowest one, in the smallest type that fits them all
+    const uint32_t shift = settings.mask != 0 ? __builtin_ctz(settings.mask) : 0;
+    const uint32_t pins = settings.mask >> shift;
+    CaptureStatus status;
+    size_t length;
+    if (pins <= UINT8_MAX)
+    {
+        uint8_t *ring = result.allocBytes(settings.numSamples);
+        status = captureWords(ring, shift, settings);
+        length = status == CaptureStatus::Done ? packCapture(ring, settings.numSamples, pins) : 0;
+    }
+    else if (pins <= UINT16_MAX)
+    {
+        uint16_t *ring = reinterpret_cast<uint16_t *>(result.allocBytes(settings.numSamples * sizeof(uint16_t)));
+        status = captureWords(ring, shift, settings);
+        length = status == CaptureStatus::Done ? packCapture(ring, settings.numSamples, pins) : 0;
+    }
+    else
+    {
+        uint32_t *ring = reinterpret_cast<uint32_t *>(result.allocBytes(settings.numSamples * sizeof(uint32_t)));
+        status = captureWords(ring, shift, settings);
+        length = status == CaptureStatus::Done ? packCapture(ring, settings.numSamples, pins) : 0;
+    }
+
+    if (status == CaptureStatus::Timeout)
+    {
+        result.setError("Trigger timeout");
+        return;
+    }
+    if (status == CaptureStatus::Overrun)
+    {
+        result.setError("Sample rate too high", "sampleRate");
+        return;
+    }
+    result.setSize(length);
+    result.setFormat("bits", settings.numSamples);
+}
+
+esp_err_t GPIOCtl::playPattern(bool loop, uint8_t idleLevel, bool wait)
+{
+    // A fresh driver for every pattern: once the old one is uninstalled it no longer reads
+    // _pattern, and the new one starts without a transmission pending on its semaphore
+    stopPattern(false);
+    _pattern.swap(_nextPattern);
+    rmt_config_t config = RMT_DEFAULT_CONFIG_TX(static_cast<gpio_num_t>(_pin), PATTERN_CHANNEL);
+    config.clk_div = 1;
+    config.mem_block_num = PATTERN_MEMORY_BLOCKS;
+    esp_err_t status = rmt_config(&config);
+    if (status == ESP_OK)
+    {
+        status = rmt_driver_install(PATTERN_CHANNEL, 0, 0);
+    }
+    if (status != ESP_OK)
+    {
+        return status;
+    }
+    _patternInstalled = true;
+    rmt_set_idle_level(PATTERN_CHANNEL, true, idleLevel ? RMT_IDLE_LEVEL_HIGH : RMT_IDLE_LEVEL_LOW);
+    rmt_set_tx_loop_mode(PATTERN_CHANNEL, loop);
+    _patternLoops = loop;
+    return rmt_write_items(PATTERN_CHANNEL, _pattern.data(), _pattern.size(), wait && !loop);
+}
+
+void GPIOCtl::stopPattern(bool finish)
+{
+    if (!_patternInstalled)
+    {
+        return;
+    }
+    if (finish && !_patternLoops)
+    {
+        rmt_wait_tx_done(PATTERN_CHANNEL, pdMS_TO_TICKS(PATTERN_FINISH_TIMEOUT_MS));
+    }
+    rmt_tx_stop(PATTERN_CHANNEL);
+    rmt_driver_uninstall(PATTERN_CHANNEL);
+    _patternInstalled = false;
+    // Route the pin back from the RMT channel to the GPIO output register
+    pinMode(_pin, _mode);
+}
@@ -0,0 +1,94 @@
+// ⚡🔌 Arduino-CTL 🔌⚡
+//
+// Copyright (C) 2024 ixaxaar
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "jobs.h"
+#include <algorithm>
+
+Job::Job(void *storage, char *input, size_t length, bool msgpack)
+    : input(input), length(length), msgpack(msgpack), _storage(storage), _done(false), _finished(xSemaphoreCreateBinary())
+{
+}
+
+Job::~Job()
+{
+    if (_finished != nullptr)
+    {
+        vSemaphoreDelete(_finished);
+    }
+    free(_storage);
+}
+
+bool Job::wait(uint32_t timeoutMs)
+{
+    if (isDone())
+    {
+        return true;
+    }
+    if (_finished == nullptr)
+    {
+        return false;
+    }
+    return xSemaphoreTake(_finished, pdMS_TO_TICKS(timeoutMs)) == pdTRUE;
+}
+
+void Job::finish()
+{
+    _done.store(true);
+    if (_finished != nullptr)
+    {
+        xSemaphoreGive(_finished);
+    }
+}
+
+JobTable::JobTable(size_t capacity) : _capacity(capacity) {}
+
+bool JobTable::add(const std::shared_ptr<Job> &job)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_jobs.size() >= _capacity)
+    {
+        auto oldest = std::find_if(_jobs.begin(), _jobs.end(), [](const std::shared_ptr<Job> &candidate)
+                                   { return candidate->isDone(); });
+        if (oldest == _jobs.end())
+        {
+            return false;
+        }
+        _jobs.erase(oldest);
+    }
+    _jobs.push_back(job);
+    return true;
+}
+
+std::shared_ptr<Job> JobTable::find(uint32_t id)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (const auto &job : _jobs)
+    {
+        if (job->id == id)
+        {
+            return job;
+        }
+    }
+    return nullptr;
+}
+
+void JobTable::remove(uint32_t id)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _jobs.erase(std::remove_if(_jobs.begin(), _jobs.end(), [id](const std::shared_ptr<Job> &job)
+                               { return job->id == id; }),
+                _jobs.end());
+}
@@ -0,0 +1,126 @@
+// ⚡🔌 Arduino-CTL 🔌⚡
+//
+// Copyright (C) 2024 ixaxaar
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "jsonpool.h"
+
+// Smallest document the pool allocates; covers a request with a few commands
+static const size_t MIN_CAPACITY = 1024;
+
+JsonDocumentPool::Lease::Lease(JsonDocumentPool *pool, Slot *slot, DynamicJsonDocument *doc)
+    : _pool(pool), _slot(slot), _doc(doc) {}
+
+JsonDocumentPool::Lease::Lease(Lease &&other)
+    : _pool(other._pool), _slot(other._slot), _doc(other._doc), _temp(std::move(other._temp)), _text(std::move(other._text))
+{
+    other._slot = nullptr;
+    other._pool = nullptr;
+}
+
+JsonDocumentPool::Lease::~Lease()
+{
+    if (_pool && _slot)
+    {
+        _pool->release(_slot);
+    }
+}
+
+JsonDocumentPool::JsonDocumentPool(size_t slots) : _slots(slots) {}
+
+JsonDocumentPool::Lease JsonDocumentPool::acquire(size_t capacity)
+{
+    size_t rounded = MIN_CAPACITY;
+    while (rounded < capacity)
+    {
+        rounded <<= 1;
+    }
+
+    Slot *slot = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        // Prefer a free slot that is already big enough, otherwise take any free slot
+        for (auto &candidate : _slots)
+        {
+            if (candidate.busy)
+            {
+                continue;
+            }
+            if (candidate.doc && candidate.doc->capacity() >= capacity)
+            {
+                slot = &candidate;
+                break;
+            }
+            if (slot == nullptr)
+            {
+                slot = &candidate;
+            }
+        }
+        if (slot)
+        {
+            slot->busy = true;
+        }
+    }
+
+    if (slot == nullptr)
+    {
+        Lease lease(this, nullptr, nullptr);
+        if (capacity > 0)
+        {
+            lease._temp.reset(new DynamicJsonDocument(rounded));
+            lease._doc = lease._temp.get();
+        }
+        return lease;
+    }
+
+    if (capacity > 0 && (!slot->doc || slot->doc->capacity() < capacity))
+    {
+        // Free the old document first so the two never coexist on the heap
+        slot->doc.reset();
+        slot->doc.reset(new DynamicJsonDocument(rounded));
+    }
+    if (slot->doc)
+    {
+        slot->doc->clear();
+    }
+    slot->text.clear();
+    return Lease(this, slot, slot->doc.get());
+}
+
+void JsonDocumentPool::release(Slot *slot)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    slot->busy = false;
+}
+
+size_t JsonDocumentPool::capacityFor(const char *json, size_t length, bool zeroCopy)
+{
+    // Every value inside a collection is either its first element or follows a comma
+    size_t values = 1;
+    for (size_t i = 0; i < length; ++i)
+    {
+        char c = json[i];
+        if (c == ',' || c == '{' || c == '[')
+        {
+            ++values;
+        }
+    }
+    size_t capacity = JSON_ARRAY_SIZE(values);
+    if (!zeroCopy)
+    {
+        // Copied strings and keys never take more than the text itself
+        capacity += length;
+    }
+    return capacity;
+}
@@ -0,0 +1,158 @@
+// ⚡🔌 Arduino-CTL 🔌⚡
+//
+// Copyright (C) 2024 ixaxaar
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "metrics.h"
+#include <stdio.h>
+
+static const char *const PHASE_NAMES[] = {"parse", "resolve", "execute", "encode"};
+
+LatencyHistogram::LatencyHistogram() : _sum(0)
+{
+    for (auto &count : _counts)
+    {
+        count.store(0, std::memory_order_relaxed);
+    }
+}
+
+void LatencyHistogram::record(uint32_t micros)
+{
+    // Bucket k holds durations up to 2^(k+2) us: ceil(log2(micros)) - 2, clamped
+    size_t bucket = 0;
+    if (micros > 4)
+    {
+        bucket = 32 - __builtin_clz(micros - 1) - 2;
+        if (bucket > BUCKETS)
+        {
+            bucket = BUCKETS;
+        }
+    }
+    _counts[bucket].fetch_add(1, std::memory_order_relaxed);
+    _sum.fetch_add(micros, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::render(std::string &out, const char *name, const std::string &labels) const
+{
+    char line[192];
+    const char *separator = labels.empty() ? "" : ",";
+    uint64_t cumulative = 0;
+    for (size_t bucket = 0; bucket <= BUCKETS; ++bucket)
+    {
+        cumulative += _counts[bucket].load(std::memory_order_relaxed);
+        if (bucket < BUCKETS)
+        {
+            snprintf(line, sizeof(line), "%s_bucket{%s%sle=\"%g\"} %llu\n", name, labels.c_str(), separator,
+                     static_cast<double>(4ull << bucket) * 1e-6, static_cast<unsigned long long>(cumulative));
+        }
+        else
+        {
+            snprintf(line, sizeof(line), "%s_bucket{%s%sle=\"+Inf\"} %llu\n", name, labels.c_str(), separator,
+                     static_cast<unsigned long long>(cumulative));
+        }
+        out += line;
+    }
+    const char *open = labels.empty() ? "" : "{";
+    const char *close = labels.empty() ? "" : "}";
+    snprintf(line, sizeof(line), "%s_sum%s%s%s %.6f\n", name, open, labels.c_str(), close,
+             static_cast<double>(_sum.load(std::memory_order_relaxed)) * 1e-6);
+    out += line;
+    snprintf(line, sizeof(line), "%s_count%s%s%s %llu\n", name, open, labels.c_str(), close, static_cast<unsigned long long>(cumulative));
+    out += line;
+}
+
+Metrics::Metrics()
+    : _requests(0), _requestErrors(0), _commandsRun(0), _commandErrors(0), _requestBytes(0), _responseBytes(0)
+{
+}
+
+void Metrics::setCommands(const std::vector<std::pair<std::string, std::vector<std::string>>> &commands)
+{
+    _moduleNames.clear();
+    _commandNames.clear();
+    _offsets.clear();
+    for (const auto &module : commands)
+    {
+        _moduleNames.push_back(module.first);
+        _offsets.push_back(_commandNames.size());
+        _commandNames.insert(_commandNames.end(), module.second.begin(), module.second.end());
+    }
+    _offsets.push_back(_commandNames.size());
+    _commands.reset(new LatencyHistogram[_commandNames.size()]);
+}
+
+void Metrics::recordCommand(size_t module, uint16_t opcode, uint32_t micros)
+{
+    if (module + 1 < _offsets.size() && _offsets[module] + opcode < _offsets[module + 1])
+    {
+        _commands[_offsets[module] + opcode].record(micros);
+    }
+}
+
+void Metrics::recordPhase(Phase phase, uint32_t micros)
+{
+    _phases[static_cast<size_t>(phase)].record(micros);
+}
+
+void Metrics::countRequest(size_t bytes)
+{
+    _requests.fetch_add(1, std::memory_order_relaxed);
+    _requestBytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void Metrics::countResponse(size_t bytes)
+{
+    _responseBytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void Metrics::countCommands(size_t commands, size_t errors)
+{
+    _commandsRun.fetch_add(commands, std::memory_order_relaxed);
+    _commandErrors.fetch_add(errors, std::memory_order_relaxed);
+}
+
+void Metrics::renderCounter(std::string &out, const char *name, const char *help, uint64_t value)
+{
+    char line[192];
+    snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s counter\n%s %llu\n", name, help, name, name, static_cast<unsigned long long>(value));
+    out += line;
+}
+
+void Metrics::render(std::string &out) const
+{
+    renderCounter(out, "arduinoctl_requests_total", "Requests received", _requests.load());
+    renderCounter(out, "arduinoctl_request_errors_total", "Requests rejected before their commands ran", _requestErrors.load());
+    renderCounter(out, "arduinoctl_commands_total", "Commands executed", _commandsRun.load());
+    renderCounter(out, "arduinoctl_command_errors_total", "Commands that returned an error", _commandErrors.load());
+    renderCounter(out, "arduinoctl_request_bytes_total", "Bytes of request bodies", _requestBytes.load());
+    renderCounter(out, "arduinoctl_response_bytes_total", "Bytes of responses", _responseBytes.load());
+
+    out += "# HELP arduinoctl_phase_duration_seconds Time spent in each stage of the command pipeline\n"
+           "# TYPE arduinoctl_phase_duration_seconds histogram\n";
+    for (size_t phase = 0; phase < static_cast<size_t>(Phase::Count); ++phase)
+    {
+        _phases[phase].render(out, "arduinoctl_phase_duration_seconds", std::string("phase=\"") + PHASE_NAMES[phase] + "\"");
+    }
+
+    out += "# HELP arduinoctl_command_duration_seconds Time spent executing each command on the hardware\n"
+           "# TYPE arduinoctl_command_duration_seconds histogram\n";
+    for (size_t module = 0; module < _moduleNames.size(); ++module)
+    {
+        for (size_t command = _offsets[module]; command < _offsets[module + 1]; ++command)
+        {
+            _commands[command].render(out, "arduinoctl_command_duration_seconds",
+                                      "module=\"" + _moduleNames[module] + "\",command=\"" + _commandNames[command] + "\"");
+        }
+    }
+}
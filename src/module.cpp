@@ -0,0 +1,52 @@
+// ⚡🔌 Arduino-CTL 🔌⚡
+//
+// Copyright (C) 2024 ixaxaar
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "module.h"
+
+void ModuleInterface::execute(const std::string &command, const std::vector<std::pair<std::string, std::string>> &params, ResultSink &result)
+{
+    uint16_t opcode = opcodeOf(command);
+    if (opcode == INVALID_OPCODE)
+    {
+        result.setError("Command not found");
+        return;
+    }
+    dispatch(opcode, params, result);
+}
+
+void ModuleInterface::buildOpcodeTable()
+{
+    std::vector<std::string> names;
+    for (const auto &function : getSupportedFunctions())
+    {
+        names.push_back(function.name);
+    }
+    if (!_opcodes.build(names))
+    {
+        Serial.println("No perfect hash for the command names; using a linear search");
+    }
+    _opcodesBuilt = true;
+}
+
+uint16_t ModuleInterface::opcodeOf(const char *command, size_t length)
+{
+    if (!_opcodesBuilt)
+    {
+        buildOpcodeTable();
+    }
+    int index = _opcodes.find(command, length);
+    return index < 0 ? INVALID_OPCODE : static_cast<uint16_t>(index);
+}
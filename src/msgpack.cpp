@@ -0,0 +1,546 @@
+// ⚡🔌 Arduino-CTL 🔌⚡
+//
+// Copyright (C) 2024 ixaxaar
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "msgpack.h"
+#include <stdio.h>
+#include "base64codec.h"
+
+// Deepest nesting skip() follows before rejecting the input
+static const int MAX_DEPTH = 16;
+
+MsgPackWriter::MsgPackWriter(std::string &out) : _out(out) {}
+
+void MsgPackWriter::writeHeader(uint8_t type, uint64_t value, int bytes)
+{
+    _out += static_cast<char>(type);
+    for (int shift = (bytes - 1) * 8; shift >= 0; shift -= 8)
+    {
+        _out += static_cast<char>((value >> shift) & 0xFF);
+    }
+}
+
+void MsgPackWriter::writeMap(uint32_t size)
+{
+    if (size < 16)
+    {
+        writeHeader(0x80 | size, 0, 0);
+    }
+    else if (size <= 0xFFFF)
+    {
+        writeHeader(0xDE, size, 2);
+    }
+    else
+    {
+        writeHeader(0xDF, size, 4);
+    }
+}
+
+void MsgPackWriter::writeArray(uint32_t size)
+{
+    if (size < 16)
+    {
+        writeHeader(0x90 | size, 0, 0);
+    }
+    else if (size <= 0xFFFF)
+    {
+        writeHeader(0xDC, size, 2);
+    }
+    else
+    {
+        writeHeader(0xDD, size, 4);
+    }
+}
+
+void MsgPackWriter::writeString(const char *value, size_t length)
+{
+    if (length < 32)
+    {
+        writeHeader(0xA0 | length, 0, 0);
+    }
+    else if (length <= 0xFF)
+    {
+        writeHeader(0xD9, length, 1);
+    }
+    else if (length <= 0xFFFF)
+    {
+        writeHeader(0xDA, length, 2);
+    }
+    else
+    {
+        writeHeader(0xDB, length, 4);
+    }
+    _out.append(value, length);
+}
+
+void MsgPackWriter::writeBinary(const uint8_t *data, size_t length)
+{
+    writeBinaryHeader(length);
+    _out.append(reinterpret_cast<const char *>(data), length);
+}
+
+void MsgPackWriter::writeBinaryHeader(size_t length)
+{
+    if (length <= 0xFF)
+    {
+        writeHeader(0xC4, length, 1);
+    }
+    else if (length <= 0xFFFF)
+    {
+        writeHeader(0xC5, length, 2);
+    }
+    else
+    {
+        writeHeader(0xC6, length, 4);
+    }
+}
+
+void MsgPackWriter::writeInt(int64_t value)
+{
+    if (value >= 0)
+    {
+        if (value < 128)
+        {
+            writeHeader(static_cast<uint8_t>(value), 0, 0);
+        }
+        else if (value <= 0xFF)
+        {
+            writeHeader(0xCC, value, 1);
+        }
+        else if (value <= 0xFFFF)
+        {
+            writeHeader(0xCD, value, 2);
+        }
+        else if (value <= 0xFFFFFFFFLL)
+        {
+            writeHeader(0xCE, value, 4);
+        }
+        else
+        {
+            writeHeader(0xCF, value, 8);
+        }
+    }
+    else
+    {
+        if (value >= -32)
+        {
+            writeHeader(static_cast<uint8_t>(value), 0, 0);
+        }
+        else if (value >= INT8_MIN)
+        {
+            writeHeader(0xD0, static_cast<uint64_t>(value), 1);
+        }
+        else if (value >= INT16_MIN)
+        {
+            writeHeader(0xD1, static_cast<uint64_t>(value), 2);
+        }
+        else if (value >= INT32_MIN)
+        {
+            writeHeader(0xD2, static_cast<uint64_t>(value), 4);
+        }
+        else
+        {
+            writeHeader(0xD3, static_cast<uint64_t>(value), 8);
+        }
+    }
+}
+
+void MsgPackWriter::writeBool(bool value)
+{
+    writeHeader(value ? 0xC3 : 0xC2, 0, 0);
+}
+
+void MsgPackWriter::writeNil()
+{
+    writeHeader(0xC0, 0, 0);
+}
+
+MsgPackReader::MsgPackReader(const uint8_t *data, size_t length) : _data(data), _length(length), _position(0) {}
+
+MsgPackType MsgPackReader::peek() const
+{
+    if (atEnd())
+    {
+        return MsgPackType::Invalid;
+    }
+    uint8_t type = _data[_position];
+    if (type <= 0x7F || type >= 0xE0 || (type >= 0xCC && type <= 0xD3))
+    {
+        return MsgPackType::Int;
+    }
+    if (type <= 0x8F || type == 0xDE || type == 0xDF)
+    {
+        return MsgPackType::Map;
+    }
+    if (type <= 0x9F || type == 0xDC || type == 0xDD)
+    {
+        return MsgPackType::Array;
+    }
+    if (type <= 0xBF || (type >= 0xD9 && type <= 0xDB))
+    {
+        return MsgPackType::String;
+    }
+    switch (type)
+    {
+    case 0xC0:
+        return MsgPackType::Nil;
+    case 0xC2:
+    case 0xC3:
+        return MsgPackType::Bool;
+    case 0xC4:
+    case 0xC5:
+    case 0xC6:
+        return MsgPackType::Binary;
+    case 0xCA:
+    case 0xCB:
+        return MsgPackType::Float;
+    default:
+        return MsgPackType::Invalid;
+    }
+}
+
+bool MsgPackReader::readBigEndian(int bytes, uint64_t &value)
+{
+    if (_length - _position < static_cast<size_t>(bytes))
+    {
+        return false;
+    }
+    value = 0;
+    for (int i = 0; i < bytes; ++i)
+    {
+        value = (value << 8) | _data[_position++];
+    }
+    return true;
+}
+
+bool MsgPackReader::readPayloadLength(int lengthBytes, size_t fixedLength, size_t &length)
+{
+    uint64_t value = fixedLength;
+    if (lengthBytes > 0 && !readBigEndian(lengthBytes, value))
+    {
+        return false;
+    }
+    if (value > _length - _position)
+    {
+        return false;
+    }
+    length = static_cast<size_t>(value);
+    return true;
+}
+
+bool MsgPackReader::readMap(uint32_t &size)
+{
+    MsgPackReader saved = *this;
+    if (peek() != MsgPackType::Map)
+    {
+        return false;
+    }
+    uint8_t type = _data[_position++];
+    uint64_t value = type & 0x0F;
+    if ((type == 0xDE && !readBigEndian(2, value)) || (type == 0xDF && !readBigEndian(4, value)))
+    {
+        *this = saved;
+        return false;
+    }
+    size = static_cast<uint32_t>(value);
+    return true;
+}
+
+bool MsgPackReader::readArray(uint32_t &size)
+{
+    MsgPackReader saved = *this;
+    if (peek() != MsgPackType::Array)
+    {
+        return false;
+    }
+    uint8_t type = _data[_position++];
+    uint64_t value = type & 0x0F;
+    if ((type == 0xDC && !readBigEndian(2, value)) || (type == 0xDD && !readBigEndian(4, value)))
+    {
+        *this = saved;
+        return false;
+    }
+    size = static_cast<uint32_t>(value);
+    return true;
+}
+
+bool MsgPackReader::readString(const char *&value, size_t &length)
+{
+    MsgPackReader saved = *this;
+    if (peek() != MsgPackType::String)
+    {
+        return false;
+    }
+    uint8_t type = _data[_position++];
+    int lengthBytes = type <= 0xBF ? 0 : 1 << (type - 0xD9);
+    if (!readPayloadLength(lengthBytes, type & 0x1F, length))
+    {
+        *this = saved;
+        return false;
+    }
+    value = reinterpret_cast<const char *>(_data + _position);
+    _position += length;
+    return true;
+}
+
+bool MsgPackReader::readBinary(const uint8_t *&data, size_t &length)
+{
+    MsgPackReader saved = *this;
+    if (peek() != MsgPackType::Binary)
+    {
+        return false;
+    }
+    uint8_t type = _data[_position++];
+    if (!readPayloadLength(1 << (type - 0xC4), 0, length))
+    {
+        *this = saved;
+        return false;
+    }
+    data = _data + _position;
+    _position += length;
+    return true;
+}
+
+bool MsgPackReader::readInt(int64_t &value)
+{
+    MsgPackReader saved = *this;
+    if (peek() != MsgPackType::Int)
+    {
+        return false;
+    }
+    uint8_t type = _data[_position++];
+    if (type <= 0x7F)
+    {
+        value = type;
+        return true;
+    }
+    if (type >= 0xE0)
+    {
+        value = static_cast<int8_t>(type);
+        return true;
+    }
+
+    bool isSigned = type >= 0xD0;
+    int bytes = 1 << (type - (isSigned ? 0xD0 : 0xCC));
+    uint64_t raw;
+    if (!readBigEndian(bytes, raw))
+    {
+        *this = saved;
+        return false;
+    }
+    if (!isSigned)
+    {
+        if (raw > static_cast<uint64_t>(INT64_MAX))
+        {
+            *this = saved;
+            return false;
+        }
+        value = static_cast<int64_t>(raw);
+        return true;
+    }
+    // Sign-extend from the encoded width
+    int shift = 64 - bytes * 8;
+    value = static_cast<int64_t>(raw << shift) >> shift;
+    return true;
+}
+
+bool MsgPackReader::readFloat(double &value)
+{
+    MsgPackReader saved = *this;
+    if (peek() != MsgPackType::Float)
+    {
+        return false;
+    }
+    uint8_t type = _data[_position++];
+    uint64_t raw;
+    if (!readBigEndian(type == 0xCA ? 4 : 8, raw))
+    {
+        *this = saved;
+        return false;
+    }
+    if (type == 0xCA)
+    {
+        uint32_t bits = static_cast<uint32_t>(raw);
+        float f;
+        memcpy(&f, &bits, sizeof(f));
+        value = f;
+    }
+    else
+    {
+        memcpy(&value, &raw, sizeof(value));
+    }
+    return true;
+}
+
+bool MsgPackReader::readBool(bool &value)
+{
+    if (peek() != MsgPackType::Bool)
+    {
+        return false;
+    }
+    value = _data[_position++] == 0xC3;
+    return true;
+}
+
+bool MsgPackReader::readNil()
+{
+    if (peek() != MsgPackType::Nil)
+    {
+        return false;
+    }
+    ++_position;
+    return true;
+}
+
+bool MsgPackReader::skip()
+{
+    MsgPackReader saved = *this;
+    if (!skip(0))
+    {
+        *this = saved;
+        return false;
+    }
+    return true;
+}
+
+bool MsgPackReader::skip(int depth)
+{
+    if (depth > MAX_DEPTH || atEnd())
+    {
+        return false;
+    }
+
+    uint32_t count;
+    size_t length;
+    int64_t integer;
+    double number;
+    bool flag;
+    const char *text;
+    const uint8_t *bytes;
+    switch (peek())
+    {
+    case MsgPackType::Nil:
+        return readNil();
+    case MsgPackType::Bool:
+        return readBool(flag);
+    case MsgPackType::Int:
+        // uint64 values above INT64_MAX are valid MessagePack even if readInt() refuses them
+        if (_data[_position] == 0xCF)
+        {
+            uint64_t raw;
+            ++_position;
+            return readBigEndian(8, raw);
+        }
+        return readInt(integer);
+    case MsgPackType::Float:
+        return readFloat(number);
+    case MsgPackType::String:
+        return readString(text, length);
+    case MsgPackType::Binary:
+        return readBinary(bytes, length);
+    case MsgPackType::Array:
+        if (!readArray(count))
+        {
+            return false;
+        }
+        while (count--)
+        {
+            if (!skip(depth + 1))
+            {
+                return false;
+            }
+        }
+        return true;
+    case MsgPackType::Map:
+        if (!readMap(count))
+        {
+            return false;
+        }
+        while (count--)
+        {
+            if (!skip(depth + 1) || !skip(depth + 1))
+            {
+                return false;
+            }
+        }
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool readMsgPackParams(MsgPackReader &reader, std::vector<std::pair<std::string, std::string>> &params)
+{
+    params.clear();
+    uint32_t count;
+    if (!reader.readMap(count))
+    {
+        return reader.readNil();
+    }
+
+    while (count--)
+    {
+        const char *key;
+        size_t keyLength;
+        if (!reader.readString(key, keyLength))
+        {
+            return false;
+        }
+        params.emplace_back(std::string(key, keyLength), std::string());
+        std::string &value = params.back().second;
+
+        const char *text;
+        size_t length;
+        const uint8_t *bytes;
+        int64_t integer;
+        double number;
+        bool flag;
+        char buffer[32];
+        switch (reader.peek())
+        {
+        case MsgPackType::String:
+            reader.readString(text, length);
+            value.assign(text, length);
+            break;
+        case MsgPackType::Binary:
+            reader.readBinary(bytes, length);
+            value.clear();
+            base64Append(value, bytes, length);
+            break;
+        case MsgPackType::Int:
+            if (!reader.readInt(integer))
+            {
+                return false;
+            }
+            value.assign(buffer, snprintf(buffer, sizeof(buffer), "%lld", static_cast<long long>(integer)));
+            break;
+        case MsgPackType::Float:
+            reader.readFloat(number);
+            value.assign(buffer, snprintf(buffer, sizeof(buffer), "%.9g", number));
+            break;
+        case MsgPackType::Bool:
+            reader.readBool(flag);
+            value = flag ? "true" : "false";
+            break;
+        case MsgPackType::Nil:
+            reader.readNil();
+            value = "null";
+            break;
+        default:
+            return false;
+        }
+    }
+    return true;
+}
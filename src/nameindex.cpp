@@ -0,0 +1,114 @@
+// ⚡🔌 Arduino-CTL 🔌⚡
+//
+// Copyright (C) 2024 ixaxaar
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nameindex.h"
+
+NameIndex::NameIndex() : _seed(0), _mask(0), _slots(1, -1), _linear(false) {}
+
+bool NameIndex::build(const std::vector<std::string> &names)
+{
+    _names = names;
+    _linear = false;
+
+    // Start at twice the number of names so a collision-free seed is found quickly
+    size_t slotCount = 1;
+    while (slotCount < names.size() * 2)
+    {
+        slotCount <<= 1;
+    }
+
+    // Slots hold 16-bit indices
+    while (names.size() <= INT16_MAX)
+    {
+        for (uint32_t seed = 1; seed <= 256; ++seed)
+        {
+            std::vector<int16_t> slots(slotCount, -1);
+            bool collision = false;
+            for (size_t i = 0; i < names.size() && !collision; ++i)
+            {
+                uint32_t slot = hash(names[i].data(), names[i].size(), seed) & (slotCount - 1);
+                if (slots[slot] >= 0)
+                {
+                    // A repeated name keeps its first index, like the old linear search
+                    collision = _names[slots[slot]] != names[i];
+                }
+                else
+                {
+                    slots[slot] = static_cast<int16_t>(i);
+                }
+            }
+            if (!collision)
+            {
+                _seed = seed;
+                _mask = slotCount - 1;
+                _slots.swap(slots);
+                return true;
+            }
+        }
+        if (slotCount > names.size() * 64)
+        {
+            break;
+        }
+        slotCount <<= 1;
+    }
+
+    // No seed separates the names: search them in order, so every name stays reachable
+    _seed = 0;
+    _mask = 0;
+    _slots.assign(1, -1);
+    _linear = true;
+    return false;
+}
+
+int NameIndex::find(const char *name, size_t length) const
+{
+    if (_linear)
+    {
+        for (size_t i = 0; i < _names.size(); ++i)
+        {
+            if (_names[i].size() == length && memcmp(_names[i].data(), name, length) == 0)
+            {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+    int index = _slots[hash(name, length, _seed) & _mask];
+    if (index < 0)
+    {
+        return -1;
+    }
+    const std::string &candidate = _names[index];
+    if (candidate.size() != length || memcmp(candidate.data(), name, length) != 0)
+    {
+        return -1;
+    }
+    return index;
+}
+
+uint32_t NameIndex::hash(const char *name, size_t length, uint32_t seed)
+{
+    uint32_t h = 2166136261u ^ (seed * 0x9E3779B9u);
+    for (size_t i = 0; i < length; ++i)
+    {
+        h ^= static_cast<uint8_t>(name[i]);
+        h *= 16777619u;
+    }
+    h ^= h >> 15;
+    h *= 0x2C1B3C6Du;
+    h ^= h >> 12;
+    return h;
+}
@@ -0,0 +1,56 @@
+// ⚡🔌 Arduino-CTL 🔌⚡
+//
+// Copyright (C) 2024 ixaxaar
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "params.h"
+
+bool parseInteger(const char *first, const char *last, int64_t &value)
+{
+    bool negative = first != last && *first == '-';
+    if (negative)
+    {
+        ++first;
+    }
+    if (first == last)
+    {
+        return false;
+    }
+    // Accumulate as a negative number, whose range includes INT64_MIN
+    int64_t number = 0;
+    const int64_t limit = std::numeric_limits<int64_t>::min();
+    for (; first != last; ++first)
+    {
+        if (*first < '0' || *first > '9')
+        {
+            return false;
+        }
+        int digit = *first - '0';
+        if (number < (limit + digit) / 10)
+        {
+            return false;
+        }
+        number = number * 10 - digit;
+    }
+    if (!negative)
+    {
+        if (number == limit)
+        {
+            return false;
+        }
+        number = -number;
+    }
+    value = number;
+    return true;
+}
@@ -0,0 +1,105 @@
+// ⚡🔌 Arduino-CTL 🔌⚡
+//
+// Copyright (C) 2024 ixaxaar
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "programs.h"
+
+const char *ProgramStep::bind(const std::vector<std::pair<std::string, std::string>> &args, std::vector<std::pair<std::string, std::string>> &out) const
+{
+    out = params;
+    for (const auto &binding : bindings)
+    {
+        const std::pair<std::string, std::string> *arg = nullptr;
+        for (const auto &candidate : args)
+        {
+            if (candidate.first == binding.second)
+            {
+                arg = &candidate;
+                break;
+            }
+        }
+        if (arg == nullptr)
+        {
+            return binding.second.c_str();
+        }
+        out[binding.first].second = arg->second;
+    }
+    return nullptr;
+}
+
+ProgramStore::ProgramStore(size_t capacity) : _capacity(capacity), _nextId(1) {}
+
+uint32_t ProgramStore::add(std::vector<ProgramStep> steps)
+{
+    if (_programs.size() >= _capacity)
+    {
+        return 0;
+    }
+    uint32_t id = _nextId++;
+    if (_nextId == 0)
+    {
+        _nextId = 1;
+    }
+    _programs.emplace_back(id, std::move(steps));
+    return id;
+}
+
+const std::vector<ProgramStep> *ProgramStore::find(uint32_t id) const
+{
+    for (const auto &program : _programs)
+    {
+        if (program.first == id)
+        {
+            return &program.second;
+        }
+    }
+    return nullptr;
+}
+
+bool ProgramStore::remove(uint32_t id)
+{
+    for (auto it = _programs.begin(); it != _programs.end(); ++it)
+    {
+        if (it->first == id)
+        {
+            _programs.erase(it);
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t ProgramStore::resolve(const std::function<bool(ProgramStep &)> &resolveStep)
+{
+    size_t removed = 0;
+    for (auto it = _programs.begin(); it != _programs.end();)
+    {
+        bool resolved = true;
+        for (ProgramStep &step : it->second)
+        {
+            resolved = resolved && resolveStep(step);
+        }
+        if (resolved)
+        {
+            ++it;
+        }
+        else
+        {
+            it = _programs.erase(it);
+            ++removed;
+        }
+    }
+    return removed;
+}
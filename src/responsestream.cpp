@@ -0,0 +1,138 @@
+// ⚡🔌 Arduino-CTL 🔌⚡
+//
+// Copyright (C) 2024 ixaxaar
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "responsestream.h"
+#include <string.h>
+#include <algorithm>
+#include "base64codec.h"
+
+void ResponseStream::clear()
+{
+    text.clear();
+    _payloads.clear();
+    encodeMicros = 0;
+    encodePending = false;
+}
+
+ResponseStream::Payload &ResponseStream::splice(ResultSink &result, bool base64)
+{
+    _payloads.push_back(Payload{text.size(), base64, ResultSink()});
+    Payload &payload = _payloads.back();
+    payload.result.swap(result);
+    return payload;
+}
+
+void ResponseStream::spliceJson(ResultSink &result)
+{
+    result.appendJsonHead(text);
+    splice(result, true).result.appendJsonTail(text);
+}
+
+void ResponseStream::spliceMsgPack(ResultSink &result)
+{
+    result.appendMsgPackHead(text);
+    splice(result, false).result.appendMsgPackTail(text);
+}
+
+size_t ResponseStream::size() const
+{
+    size_t total = text.size();
+    for (const Payload &payload : _payloads)
+    {
+        total += payload.length();
+    }
+    return total;
+}
+
+size_t ResponseStream::read(size_t position, uint8_t *out, size_t maxLen) const
+{
+    // Walk the text pieces and payloads in order, skipping what lies before the window
+    size_t copied = 0;
+    size_t textStart = 0;
+    size_t start = 0;
+    for (size_t i = 0; i <= _payloads.size() && copied < maxLen; ++i)
+    {
+        size_t textEnd = i < _payloads.size() ? _payloads[i].offset : text.size();
+        size_t pieceLength = textEnd - textStart;
+        if (position < start + pieceLength)
+        {
+            size_t offset = position - start;
+            size_t count = std::min(pieceLength - offset, maxLen - copied);
+            memcpy(out + copied, text.data() + textStart + offset, count);
+            copied += count;
+            position += count;
+        }
+        start += pieceLength;
+        textStart = textEnd;
+
+        if (i == _payloads.size() || copied == maxLen)
+        {
+            break;
+        }
+        size_t payloadLength = _payloads[i].length();
+        if (position < start + payloadLength)
+        {
+            size_t offset = position - start;
+            size_t count = std::min(payloadLength - offset, maxLen - copied);
+            _payloads[i].read(offset, out + copied, count);
+            copied += count;
+            position += count;
+        }
+        start += payloadLength;
+    }
+    return copied;
+}
+
+size_t ResponseStream::Payload::length() const
+{
+    return base64 ? base64EncodedLength(result.size()) : result.size();
+}
+
+void ResponseStream::Payload::read(size_t position, uint8_t *out, size_t count) const
+{
+    const uint8_t *data = result.data();
+    if (!base64)
+    {
+        memcpy(out, data + position, count);
+        return;
+    }
+
+    // Whole groups of four characters are encoded in place; a window starting or
+    // ending inside a group encodes that group aside and copies its part
+    while (count > 0)
+    {
+        size_t group = position / 4;
+        size_t skip = position % 4;
+        size_t available = std::min<size_t>(3, result.size() - group * 3);
+        if (skip == 0 && count >= 4)
+        {
+            size_t groups = count / 4;
+            size_t bytes = std::min(groups * 3, result.size() - group * 3);
+            size_t written = base64Encode(data + group * 3, bytes, reinterpret_cast<char *>(out));
+            out += written;
+            position += written;
+            count -= written;
+            continue;
+        }
+        char encoded[4];
+        base64Encode(data + group * 3, available, encoded);
+        size_t part = std::min(4 - skip, count);
+        memcpy(out, encoded + skip, part);
+        out += part;
+        position += part;
+        count -= part;
+    }
+}
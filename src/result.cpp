@@ -0,0 +1,226 @@
+// ⚡🔌 Arduino-CTL 🔌⚡
+//
+// Copyright (C) 2024 ixaxaar
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "result.h"
+#include <stdio.h>
+#include <utility>
+#include "base64codec.h"
+#include "msgpack.h"
+
+ResultSink::ResultSink() : _type(ResultType::None), _int(0), _error(""), _errorParam(nullptr), _size(0), _format(nullptr), _count(0), _timed(false), _start(0), _skew(0) {}
+
+void ResultSink::clear()
+{
+    _type = ResultType::None;
+    _size = 0;
+}
+
+void ResultSink::setInt(int value)
+{
+    _type = ResultType::Int;
+    _int = value;
+}
+
+void ResultSink::setError(const char *message, const char *param)
+{
+    _type = ResultType::Error;
+    _error = message;
+    _errorParam = param;
+}
+
+uint8_t *ResultSink::allocBytes(size_t size)
+{
+    if (_bytes.size() < size)
+    {
+        _bytes.resize(size);
+    }
+    _type = ResultType::Bytes;
+    _size = size;
+    _format = nullptr;
+    _timed = false;
+    _skew = 0;
+    return _bytes.data();
+}
+
+void ResultSink::setSize(size_t size)
+{
+    if (size < _size)
+    {
+        _size = size;
+    }
+}
+
+void ResultSink::setFormat(const char *format, size_t count)
+{
+    _format = format;
+    _count = count;
+}
+
+void ResultSink::setStartTime(int64_t micros)
+{
+    _timed = true;
+    _start = micros;
+}
+
+void ResultSink::setSkew(uint32_t nanos)
+{
+    _skew = nanos;
+}
+
+void ResultSink::appendJson(std::string &out) const
+{
+    switch (_type)
+    {
+    case ResultType::Bytes:
+        appendJsonHead(out);
+        base64Append(out, _bytes.data(), _size);
+        appendJsonTail(out);
+        break;
+    case ResultType::Int:
+    {
+        char number[12];
+        int length = snprintf(number, sizeof(number), "%d", _int);
+        out += "{\"data\":";
+        out.append(number, length);
+        out += "}";
+        break;
+    }
+    case ResultType::Error:
+        out += "{\"error\": \"";
+        out += _error;
+        if (_errorParam != nullptr)
+        {
+            out += "\", \"param\": \"";
+            out += _errorParam;
+        }
+        out += "\"}";
+        break;
+    default:
+        out += "{\"data\": null}";
+        break;
+    }
+}
+
+void ResultSink::appendMsgPack(std::string &out) const
+{
+    if (_type == ResultType::Bytes)
+    {
+        appendMsgPackHead(out);
+        out.append(reinterpret_cast<const char *>(_bytes.data()), _size);
+        appendMsgPackTail(out);
+        return;
+    }
+    MsgPackWriter writer(out);
+    writer.writeMap(_type == ResultType::Error && _errorParam != nullptr ? 2 : 1);
+    switch (_type)
+    {
+    case ResultType::Int:
+        writer.writeString("data");
+        writer.writeInt(_int);
+        break;
+    case ResultType::Error:
+        writer.writeString("error");
+        writer.writeString(_error);
+        if (_errorParam != nullptr)
+        {
+            writer.writeString("param");
+            writer.writeString(_errorParam);
+        }
+        break;
+    default:
+        writer.writeString("data");
+        writer.writeNil();
+        break;
+    }
+}
+
+void ResultSink::appendJsonHead(std::string &out) const
+{
+    out += "{\"data\":\"";
+}
+
+void ResultSink::appendJsonTail(std::string &out) const
+{
+    out += "\"";
+    if (_format != nullptr)
+    {
+        char count[24];
+        out += ",\"format\":\"";
+        out += _format;
+        out += "\",\"count\":";
+        out.append(count, snprintf(count, sizeof(count), "%lu", static_cast<unsigned long>(_count)));
+    }
+    if (_timed)
+    {
+        char start[24];
+        out += ",\"start\":";
+        out.append(start, snprintf(start, sizeof(start), "%lld", static_cast<long long>(_start)));
+    }
+    if (_skew != 0)
+    {
+        char skew[12];
+        out += ",\"skewNs\":";
+        out.append(skew, snprintf(skew, sizeof(skew), "%lu", static_cast<unsigned long>(_skew)));
+    }
+    out += "}";
+}
+
+void ResultSink::appendMsgPackHead(std::string &out) const
+{
+    MsgPackWriter writer(out);
+    writer.writeMap(1 + (_format != nullptr ? 2 : 0) + (_timed ? 1 : 0) + (_skew != 0 ? 1 : 0));
+    writer.writeString("data");
+    writer.writeBinaryHeader(_size);
+}
+
+void ResultSink::appendMsgPackTail(std::string &out) const
+{
+    if (_format != nullptr)
+    {
+        MsgPackWriter writer(out);
+        writer.writeString("format");
+        writer.writeString(_format);
+        writer.writeString("count");
+        writer.writeInt(_count);
+    }
+    if (_timed)
+    {
+        MsgPackWriter writer(out);
+        writer.writeString("start");
+        writer.writeInt(_start);
+    }
+    if (_skew != 0)
+    {
+        MsgPackWriter writer(out);
+        writer.writeString("skewNs");
+        writer.writeInt(_skew);
+    }
+}
+
+void ResultSink::swap(ResultSink &other)
+{
+    std::swap(_type, other._type);
+    std::swap(_int, other._int);
+    std::swap(_error, other._error);
+    std::swap(_errorParam, other._errorParam);
+    _bytes.swap(other._bytes);
+    std::swap(_size, other._size);
+    std::swap(_format, other._format);
+    std::swap(_count, other._count);
+    std::swap(_timed, other._timed);
+    std::swap(_start, other._start);
+    std::swap(_skew, other._skew);
+}
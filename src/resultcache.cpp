@@ -0,0 +1,145 @@
+// ⚡🔌 Arduino-CTL 🔌⚡
+//
+// Copyright (C) 2024 ixaxaar
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "resultcache.h"
+#include <string.h>
+
+// Whether time a is before time b, allowing for the millisecond counter wrapping
+static bool before(uint32_t a, uint32_t b)
+{
+    return static_cast<int32_t>(a - b) < 0;
+}
+
+ResultCache::ResultCache(size_t capacity) : _entries(capacity), _hits(0), _misses(0) {}
+
+uint32_t ResultCache::hashKey(int module, uint16_t opcode, const std::vector<std::pair<std::string, std::string>> &params)
+{
+    uint32_t hash = 2166136261u ^ (static_cast<uint32_t>(module) << 16) ^ opcode;
+    for (const auto &param : params)
+    {
+        for (const std::string *text : {&param.first, &param.second})
+        {
+            for (char c : *text)
+            {
+                hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+            }
+            hash = (hash ^ 0xFF) * 16777619u; // Separator, so "ab"+"c" differs from "a"+"bc"
+        }
+    }
+    return hash;
+}
+
+bool ResultCache::lookup(int module, uint16_t opcode, const std::vector<std::pair<std::string, std::string>> &params, uint32_t now, ResultSink &result)
+{
+    uint32_t hash = hashKey(module, opcode, params);
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (Entry &entry : _entries)
+    {
+        if (!entry.valid || entry.hash != hash || entry.module != module || entry.opcode != opcode || entry.params != params)
+        {
+            continue;
+        }
+        if (!before(now, entry.expires))
+        {
+            entry.valid = false;
+            break;
+        }
+        result.clear();
+        if (entry.type == ResultType::Int)
+        {
+            result.setInt(entry.intValue);
+        }
+        else if (entry.type == ResultType::Bytes)
+        {
+            memcpy(result.allocBytes(entry.bytes.size()), entry.bytes.data(), entry.bytes.size());
+            if (entry.format != nullptr)
+            {
+                result.setFormat(entry.format, entry.count);
+            }
+            if (entry.timed)
+            {
+                result.setStartTime(entry.startTime);
+            }
+            if (entry.skew != 0)
+            {
+                result.setSkew(entry.skew);
+            }
+        }
+        ++_hits;
+        return true;
+    }
+    ++_misses;
+    return false;
+}
+
+void ResultCache::store(int module, uint16_t opcode, const std::vector<std::pair<std::string, std::string>> &params, uint32_t now, uint32_t ttl, const ResultSink &result)
+{
+    if (result.type() == ResultType::Error || _entries.empty())
+    {
+        return;
+    }
+    uint32_t hash = hashKey(module, opcode, params);
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    // Reuse the entry of the same key, else a free or stale one, else the one closest to expiring
+    Entry *slot = nullptr;
+    for (Entry &entry : _entries)
+    {
+        if (entry.valid && entry.hash == hash && entry.module == module && entry.opcode == opcode && entry.params == params)
+        {
+            slot = &entry;
+            break;
+        }
+        if (!entry.valid || !before(now, entry.expires))
+        {
+            if (slot == nullptr || slot->valid)
+            {
+                slot = &entry;
+            }
+        }
+        else if (slot == nullptr || (slot->valid && before(entry.expires, slot->expires)))
+        {
+            slot = &entry;
+        }
+    }
+
+    slot->valid = true;
+    slot->module = module;
+    slot->opcode = opcode;
+    slot->hash = hash;
+    slot->expires = now + ttl;
+    slot->params = params;
+    slot->type = result.type();
+    slot->intValue = result.intValue();
+    slot->format = result.format();
+    slot->count = result.count();
+    slot->timed = result.timed();
+    slot->startTime = result.startTime();
+    slot->skew = result.skew();
+    slot->bytes.assign(result.data(), result.data() + (result.type() == ResultType::Bytes ? result.size() : 0));
+}
+
+void ResultCache::invalidate(int module)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (Entry &entry : _entries)
+    {
+        if (entry.module == module)
+        {
+            entry.valid = false;
+        }
+    }
+}
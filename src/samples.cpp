@@ -0,0 +1,270 @@
+// ⚡🔌 Arduino-CTL 🔌⚡
+//
+// Copyright (C) 2024 ixaxaar
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "samples.h"
+#include <string.h>
+#include <algorithm>
+
+static const char *const NAMES[] = {"int32", "bits", "u16", "packed12", "delta", "rle"};
+static const char *const REDUCTION_NAMES[] = {"none", "box", "cic", "stats", "peak"};
+
+bool parseSampleEncoding(const std::string &name, SampleEncoding &encoding)
+{
+    for (size_t i = 0; i < sizeof(NAMES) / sizeof(NAMES[0]); ++i)
+    {
+        if (name == NAMES[i])
+        {
+            encoding = static_cast<SampleEncoding>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *sampleEncodingName(SampleEncoding encoding)
+{
+    return NAMES[static_cast<size_t>(encoding)];
+}
+
+bool parseSampleReduction(const std::string &name, SampleReduction &reduction)
+{
+    for (size_t i = 0; i < sizeof(REDUCTION_NAMES) / sizeof(REDUCTION_NAMES[0]); ++i)
+    {
+        if (name == REDUCTION_NAMES[i])
+        {
+            reduction = static_cast<SampleReduction>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t reducedCount(SampleReduction reduction, size_t count, uint32_t factor)
+{
+    switch (reduction)
+    {
+    case SampleReduction::None:
+        return count;
+    case SampleReduction::Stats:
+        return count / factor * 4;
+    case SampleReduction::Peak:
+        return count / factor * 2;
+    default:
+        return count / factor;
+    }
+}
+
+size_t maxEncodedSize(SampleEncoding encoding, size_t count)
+{
+    switch (encoding)
+    {
+    case SampleEncoding::Bits:
+        return (count + 7) / 8;
+    case SampleEncoding::U16:
+        return count * 2;
+    case SampleEncoding::Packed12:
+        return (count * 3 + 1) / 2;
+    case SampleEncoding::Delta:
+        return count * 3; // A zigzagged 17-bit difference takes at most three varint bytes
+    case SampleEncoding::Rle:
+        return count * 4; // Three bytes of value per run, and a run of n samples never needs more than n length bytes
+    default:
+        return count * sizeof(int);
+    }
+}
+
+SampleEncoder::SampleEncoder(SampleEncoding encoding, uint8_t *out)
+    : _encoding(encoding), _out(out), _length(0), _count(0), _previous(0), _run(0) {}
+
+void SampleEncoder::add(uint16_t sample)
+{
+    switch (_encoding)
+    {
+    case SampleEncoding::Bits:
+        if (_count % 8 == 0)
+        {
+            _out[_length++] = 0;
+        }
+        _out[_length - 1] |= (sample ? 1 : 0) << (_count % 8);
+        break;
+    case SampleEncoding::U16:
+        _out[_length++] = sample & 0xFF;
+        _out[_length++] = sample >> 8;
+        break;
+    case SampleEncoding::Packed12:
+        sample &= 0x0FFF;
+        if (_count % 2 == 0)
+        {
+            _out[_length++] = sample & 0xFF;
+            _out[_length++] = sample >> 8;
+        }
+        else
+        {
+            _out[_length - 1] |= (sample & 0x0F) << 4;
+            _out[_length++] = sample >> 4;
+        }
+        break;
+    case SampleEncoding::Delta:
+    {
+        int32_t difference = static_cast<int32_t>(sample) - _previous;
+        writeVarint((static_cast<uint32_t>(difference) << 1) ^ static_cast<uint32_t>(difference >> 31));
+        _previous = sample;
+        break;
+    }
+    case SampleEncoding::Rle:
+        if (_run > 0 && sample == _previous)
+        {
+            ++_run;
+            break;
+        }
+        if (_run > 0)
+        {
+            writeVarint(_previous);
+            writeVarint(_run);
+        }
+        _previous = sample;
+        _run = 1;
+        break;
+    default:
+    {
+        int value = sample;
+        memcpy(_out + _length, &value, sizeof(int));
+        _length += sizeof(int);
+        break;
+    }
+    }
+    ++_count;
+}
+
+size_t SampleEncoder::finish()
+{
+    if (_encoding == SampleEncoding::Rle && _run > 0)
+    {
+        writeVarint(_previous);
+        writeVarint(_run);
+        _run = 0;
+    }
+    return _length;
+}
+
+void SampleEncoder::writeVarint(uint32_t value)
+{
+    while (value >= 0x80)
+    {
+        _out[_length++] = static_cast<uint8_t>(value) | 0x80;
+        value >>= 7;
+    }
+    _out[_length++] = static_cast<uint8_t>(value);
+}
+
+// Largest integer whose square is at most value
+static uint32_t isqrt(uint64_t value)
+{
+    uint64_t root = 0;
+    uint64_t bit = 1ULL << 62;
+    while (bit > value)
+    {
+        bit >>= 2;
+    }
+    while (bit != 0)
+    {
+        if (value >= root + bit)
+        {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else
+        {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return static_cast<uint32_t>(root);
+}
+
+SampleReducer::SampleReducer(SampleReduction reduction, uint32_t factor, SampleEncoder &out)
+    : _reduction(reduction), _factor(factor), _out(out), _count(0), _phase(0), _min(0xFFFF), _max(0), _sum(0), _sumSquares(0),
+      _integrators(), _combs() {}
+
+void SampleReducer::add(uint16_t sample)
+{
+    if (_reduction == SampleReduction::None)
+    {
+        emit(sample);
+        return;
+    }
+    if (_reduction == SampleReduction::Cic)
+    {
+        // Integrators run at the input rate; unsigned wrap-around cancels out in the combs
+        _integrators[0] += sample;
+        _integrators[1] += _integrators[0];
+        _integrators[2] += _integrators[1];
+    }
+    else
+    {
+        _min = std::min(_min, sample);
+        _max = std::max(_max, sample);
+        _sum += sample;
+        _sumSquares += static_cast<uint32_t>(sample) * sample;
+    }
+    if (++_phase < _factor)
+    {
+        return;
+    }
+
+    const uint32_t half = _factor / 2;
+    switch (_reduction)
+    {
+    case SampleReduction::Box:
+        emit(static_cast<uint16_t>((_sum + half) / _factor));
+        break;
+    case SampleReduction::Cic:
+    {
+        // Combs run at the output rate; the filter's gain is factor cubed
+        uint64_t value = _integrators[2];
+        for (uint64_t &previous : _combs)
+        {
+            uint64_t input = value;
+            value -= previous;
+            previous = input;
+        }
+        uint64_t gain = static_cast<uint64_t>(_factor) * _factor * _factor;
+        emit(static_cast<uint16_t>(std::min<uint64_t>(0xFFFF, (value + gain / 2) / gain)));
+        break;
+    }
+    case SampleReduction::Stats:
+        emit(_min);
+        emit(_max);
+        emit(static_cast<uint16_t>((_sum + half) / _factor));
+        emit(static_cast<uint16_t>(isqrt((_sumSquares + half) / _factor)));
+        break;
+    default:
+        emit(_min);
+        emit(_max);
+        break;
+    }
+    _phase = 0;
+    _min = 0xFFFF;
+    _max = 0;
+    _sum = 0;
+    _sumSquares = 0;
+}
+
+void SampleReducer::emit(uint16_t value)
+{
+    _out.add(value);
+    ++_count;
+}
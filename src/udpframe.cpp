@@ -0,0 +1,73 @@
+// ⚡🔌 Arduino-CTL 🔌⚡
+//
+// Copyright (C) 2024 ixaxaar
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "udpframe.h"
+
+static uint32_t readLittleEndian(const uint8_t *data)
+{
+    return static_cast<uint32_t>(data[0]) | static_cast<uint32_t>(data[1]) << 8 |
+           static_cast<uint32_t>(data[2]) << 16 | static_cast<uint32_t>(data[3]) << 24;
+}
+
+uint32_t udpTokenFor(const char *apiKey, size_t length)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; ++i)
+    {
+        hash ^= static_cast<uint8_t>(apiKey[i]);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+bool parseUdpFrame(const uint8_t *data, size_t length, uint32_t token, UdpFrame &frame)
+{
+    if (length < UDP_FRAME_HEADER_SIZE || data[0] != UDP_FRAME_VERSION)
+    {
+        return false;
+    }
+    uint8_t argc = data[3];
+    if (argc > UDP_FRAME_MAX_ARGS || length != UDP_FRAME_HEADER_SIZE + argc * sizeof(int32_t))
+    {
+        return false;
+    }
+    if (readLittleEndian(data + 4) != token)
+    {
+        return false;
+    }
+
+    frame.module = data[1];
+    frame.opcode = data[2];
+    frame.argc = argc;
+    frame.sequence = readLittleEndian(data + 8);
+    for (uint8_t i = 0; i < argc; ++i)
+    {
+        frame.args[i] = static_cast<int32_t>(readLittleEndian(data + UDP_FRAME_HEADER_SIZE + i * sizeof(int32_t)));
+    }
+    return true;
+}
+
+bool SequenceFilter::accept(uint32_t sequence)
+{
+    // A difference in the upper half of the range means the frame is older than the last one
+    if (_started && sequence != 0 && static_cast<int32_t>(sequence - _last) <= 0)
+    {
+        return false;
+    }
+    _started = true;
+    _last = sequence;
+    return true;
+}
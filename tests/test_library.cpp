@@ -0,0 +1,1142 @@
+// ⚡🔌 Arduino-CTL 🔌⚡
+//
+// Copyright (C) 2024 ixaxaar
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <unity.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include <ArduinoJson.h>
+#include "base64.hpp"
+#include "arduinoctl.h"
+#include "base64codec.h"
+#include "metrics.h"
+#include "msgpack.h"
+#include "nameindex.h"
+#include "params.h"
+#include "programs.h"
+#include "result.h"
+#include "resultcache.h"
+#include "responsestream.h"
+#include "samples.h"
+#include "udpframe.h"
+#include "sim.h"
+
+// Count every heap allocation made through operator new
+static size_t allocationCount = 0;
+
+void *operator new(size_t size)
+{
+    ++allocationCount;
+    void *p = malloc(size ? size : 1);
+    if (!p)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_result_json_encoding()
+{
+    ResultSink sink;
+    std::string out;
+
+    memcpy(sink.allocBytes(3), "abc", 3);
+    sink.appendJson(out);
+    TEST_ASSERT_EQUAL_STRING("{\"data\":\"YWJj\"}", out.c_str());
+
+    out.clear();
+    sink.setInt(-42);
+    sink.appendJson(out);
+    TEST_ASSERT_EQUAL_STRING("{\"data\":-42}", out.c_str());
+
+    out.clear();
+    sink.setError("Module not found");
+    sink.appendJson(out);
+    TEST_ASSERT_EQUAL_STRING("{\"error\": \"Module not found\"}", out.c_str());
+
+    out.clear();
+    sink.clear();
+    sink.appendJson(out);
+    TEST_ASSERT_EQUAL_STRING("{\"data\": null}", out.c_str());
+}
+
+void test_result_short_read()
+{
+    ResultSink sink;
+    std::string out;
+
+    memcpy(sink.allocBytes(8), "abcdefgh", 8);
+    sink.setSize(3);
+    TEST_ASSERT_EQUAL(3, sink.size());
+    sink.appendJson(out);
+    TEST_ASSERT_EQUAL_STRING("{\"data\":\"YWJj\"}", out.c_str());
+}
+
+void test_result_no_allocations_per_command()
+{
+    const int numSamples = 1000;
+    ResultSink sink;
+    std::string response;
+
+    // The first command sizes the sink and the response buffer
+    sink.allocBytes(numSamples * sizeof(int));
+    response.reserve(8 * 4096);
+
+    allocationCount = 0;
+    for (int command = 0; command < 4; ++command)
+    {
+        sink.clear();
+        uint8_t *samples = sink.allocBytes(numSamples * sizeof(int));
+        for (int i = 0; i < numSamples; ++i)
+        {
+            int sample = (i * 7 + command) & 0xFFF;
+            memcpy(samples + i * sizeof(int), &sample, sizeof(int));
+        }
+        sink.appendJson(response);
+        response += ',';
+    }
+    TEST_ASSERT_EQUAL(0, allocationCount);
+
+    // The same holds through module dispatch, once the modules' buffers have grown
+    sim::reset();
+    GPIOCtl gpio;
+    gpio.init({{"pin", "13"}, {"mode", std::to_string(OUTPUT)}});
+    AnalogCtl analog;
+    analog.init({{"pin", "34"}});
+    std::vector<std::pair<std::string, std::string>> write = {{"values", "AQAAAAEAAAA="}};
+    std::vector<std::pair<std::string, std::string>> read = {{"numSamples", "16"}, {"encoding", "u16"}};
+    const uint16_t digitalWrite = gpio.opcodeOf("digitalWrite");
+    const uint16_t digitalRead = gpio.opcodeOf("digitalRead");
+    const uint16_t writeAnalog = analog.opcodeOf("writeAnalog");
+    const uint16_t readAnalog = analog.opcodeOf("readAnalog");
+    for (int command = 0; command < 4; ++command)
+    {
+        if (command == 1)
+        {
+            allocationCount = 0;
+        }
+        sink.clear();
+        gpio.dispatch(digitalWrite, write, sink);
+        gpio.dispatch(digitalRead, read, sink);
+        analog.dispatch(writeAnalog, write, sink);
+        analog.dispatch(readAnalog, read, sink);
+        TEST_ASSERT_EQUAL(ResultType::Bytes, sink.type());
+    }
+    TEST_ASSERT_EQUAL(0, allocationCount);
+}
+
+void test_msgpack_round_trip()
+{
+    std::string buffer;
+    MsgPackWriter writer(buffer);
+    const uint8_t payload[300] = {1, 2, 3};
+    writer.writeArray(8);
+    writer.writeInt(5);
+    writer.writeInt(-7);
+    writer.writeInt(70000);
+    writer.writeInt(-3000000000LL);
+    writer.writeString("spi");
+    writer.writeBinary(payload, sizeof(payload));
+    writer.writeBool(true);
+    writer.writeNil();
+
+    MsgPackReader check(reinterpret_cast<const uint8_t *>(buffer.data()), buffer.size());
+    TEST_ASSERT_TRUE(check.skip());
+    TEST_ASSERT_TRUE(check.atEnd());
+
+    MsgPackReader reader(reinterpret_cast<const uint8_t *>(buffer.data()), buffer.size());
+    uint32_t count;
+    int64_t integer;
+    const char *text;
+    const uint8_t *bytes;
+    size_t length;
+    bool flag;
+    TEST_ASSERT_TRUE(reader.readArray(count));
+    TEST_ASSERT_EQUAL(8, count);
+    TEST_ASSERT_TRUE(reader.readInt(integer));
+    TEST_ASSERT_EQUAL(5, integer);
+    TEST_ASSERT_TRUE(reader.readInt(integer));
+    TEST_ASSERT_EQUAL(-7, integer);
+    TEST_ASSERT_TRUE(reader.readInt(integer));
+    TEST_ASSERT_EQUAL(70000, integer);
+    TEST_ASSERT_TRUE(reader.readInt(integer));
+    TEST_ASSERT_TRUE(integer == -3000000000LL);
+    TEST_ASSERT_FALSE(reader.readInt(integer));
+    TEST_ASSERT_TRUE(reader.readString(text, length));
+    TEST_ASSERT_EQUAL(3, length);
+    TEST_ASSERT_EQUAL_MEMORY("spi", text, 3);
+    TEST_ASSERT_TRUE(reader.readBinary(bytes, length));
+    TEST_ASSERT_EQUAL(sizeof(payload), length);
+    TEST_ASSERT_EQUAL_MEMORY(payload, bytes, length);
+    TEST_ASSERT_TRUE(reader.readBool(flag));
+    TEST_ASSERT_TRUE(flag);
+    TEST_ASSERT_TRUE(reader.readNil());
+    TEST_ASSERT_TRUE(reader.atEnd());
+
+    // Truncated input is rejected instead of read past the end
+    MsgPackReader truncated(reinterpret_cast<const uint8_t *>(buffer.data()), buffer.size() - 1);
+    TEST_ASSERT_FALSE(truncated.skip());
+}
+
+void test_msgpack_params_match_json()
+{
+    char json[] = "{\"address\":\"72\",\"numBytes\":16,\"offset\":-3,\"enabled\":true,\"data\":\"AQID\"}";
+    DynamicJsonDocument doc(512);
+    TEST_ASSERT_FALSE(deserializeJson(doc, json));
+    std::vector<std::pair<std::string, std::string>> fromJson;
+    for (JsonPair p : doc.as<JsonObject>())
+    {
+        fromJson.emplace_back(p.key().c_str(), p.value().as<std::string>());
+    }
+
+    std::string message;
+    MsgPackWriter writer(message);
+    const uint8_t data[] = {1, 2, 3};
+    writer.writeMap(5);
+    writer.writeString("address");
+    writer.writeString("72");
+    writer.writeString("numBytes");
+    writer.writeInt(16);
+    writer.writeString("offset");
+    writer.writeInt(-3);
+    writer.writeString("enabled");
+    writer.writeBool(true);
+    writer.writeString("data");
+    writer.writeBinary(data, sizeof(data));
+
+    MsgPackReader reader(reinterpret_cast<const uint8_t *>(message.data()), message.size());
+    std::vector<std::pair<std::string, std::string>> fromMsgPack;
+    TEST_ASSERT_TRUE(readMsgPackParams(reader, fromMsgPack));
+
+    TEST_ASSERT_EQUAL(fromJson.size(), fromMsgPack.size());
+    for (size_t i = 0; i < fromJson.size(); ++i)
+    {
+        TEST_ASSERT_EQUAL_STRING(fromJson[i].first.c_str(), fromMsgPack[i].first.c_str());
+        TEST_ASSERT_EQUAL_STRING(fromJson[i].second.c_str(), fromMsgPack[i].second.c_str());
+    }
+}
+
+void test_msgpack_results_match_json()
+{
+    const uint8_t samples[] = {0x10, 0x00, 0xFF, 0x0F, 0x00};
+    ResultSink sinks[4];
+    memcpy(sinks[0].allocBytes(sizeof(samples)), samples, sizeof(samples));
+    sinks[1].setInt(1234);
+    sinks[2].setError("Command not found");
+
+    for (ResultSink &sink : sinks)
+    {
+        std::string json;
+        std::string message;
+        sink.appendJson(json);
+        sink.appendMsgPack(message);
+
+        DynamicJsonDocument doc(256);
+        TEST_ASSERT_FALSE(deserializeJson(doc, json));
+        MsgPackReader reader(reinterpret_cast<const uint8_t *>(message.data()), message.size());
+        uint32_t fields;
+        const char *key;
+        size_t keyLength;
+        TEST_ASSERT_TRUE(reader.readMap(fields));
+        TEST_ASSERT_EQUAL(1, fields);
+        TEST_ASSERT_TRUE(reader.readString(key, keyLength));
+        std::string name(key, keyLength);
+        TEST_ASSERT_TRUE(doc.containsKey(name));
+
+        JsonVariant expected = doc[name];
+        const uint8_t *bytes;
+        size_t length;
+        int64_t integer;
+        const char *text;
+        switch (sink.type())
+        {
+        case ResultType::Bytes:
+        {
+            const char *encoded = expected.as<const char *>();
+            std::vector<uint8_t> decoded(decode_base64_length(reinterpret_cast<const unsigned char *>(encoded)));
+            decode_base64(reinterpret_cast<const unsigned char *>(encoded), decoded.data());
+            TEST_ASSERT_TRUE(reader.readBinary(bytes, length));
+            TEST_ASSERT_EQUAL(decoded.size(), length);
+            TEST_ASSERT_EQUAL_MEMORY(decoded.data(), bytes, length);
+            break;
+        }
+        case ResultType::Int:
+            TEST_ASSERT_TRUE(reader.readInt(integer));
+            TEST_ASSERT_EQUAL(expected.as<int>(), integer);
+            break;
+        case ResultType::Error:
+            TEST_ASSERT_TRUE(reader.readString(text, length));
+            TEST_ASSERT_EQUAL_STRING(expected.as<const char *>(), std::string(text, length).c_str());
+            break;
+        default:
+            TEST_ASSERT_TRUE(expected.isNull());
+            TEST_ASSERT_TRUE(reader.readNil());
+            break;
+        }
+        TEST_ASSERT_TRUE(reader.atEnd());
+    }
+}
+
+void test_base64_codec()
+{
+    uint8_t data[64];
+    for (size_t i = 0; i < sizeof(data); ++i)
+    {
+        data[i] = static_cast<uint8_t>(i * 37 + 11);
+    }
+
+    // Every tail length matches the reference library and decodes back, in place
+    for (size_t length = 0; length <= 10; ++length)
+    {
+        unsigned char expected[32];
+        unsigned int expectedLength = encode_base64(data, length, expected);
+        std::string encoded;
+        base64Append(encoded, data, length);
+        TEST_ASSERT_EQUAL(expectedLength, encoded.size());
+        TEST_ASSERT_EQUAL_MEMORY(expected, encoded.data(), expectedLength);
+
+        TEST_ASSERT_EQUAL(length, base64DecodedLength(encoded.data(), encoded.size()));
+        size_t written = 0;
+        uint8_t *inPlace = reinterpret_cast<uint8_t *>(&encoded[0]);
+        TEST_ASSERT_TRUE(base64Decode(encoded.data(), encoded.size(), inPlace, written));
+        TEST_ASSERT_EQUAL(length, written);
+        TEST_ASSERT_EQUAL_MEMORY(data, inPlace, length);
+    }
+
+    // URL-safe characters and missing padding are accepted
+    std::vector<uint8_t> decoded;
+    TEST_ASSERT_TRUE(base64Decode(std::string("-_8"), decoded));
+    TEST_ASSERT_EQUAL(2, decoded.size());
+    TEST_ASSERT_EQUAL(0xFB, decoded[0]);
+    TEST_ASSERT_EQUAL(0xFF, decoded[1]);
+
+    TEST_ASSERT_FALSE(base64Decode(std::string("AAA*"), decoded));
+    TEST_ASSERT_TRUE(decoded.empty());
+    TEST_ASSERT_FALSE(base64Decode(std::string("AAAAA"), decoded));
+}
+
+void test_sample_encodings()
+{
+    const uint16_t samples[] = {1, 1, 0, 1, 0, 0, 0, 0, 1, 1};
+    const size_t count = sizeof(samples) / sizeof(samples[0]);
+    uint8_t out[64];
+
+    SampleEncoder bits(SampleEncoding::Bits, out);
+    for (uint16_t sample : samples)
+    {
+        bits.add(sample);
+    }
+    const uint8_t packedBits[] = {0x0B, 0x03};
+    TEST_ASSERT_EQUAL(maxEncodedSize(SampleEncoding::Bits, count), bits.finish());
+    TEST_ASSERT_EQUAL_MEMORY(packedBits, out, sizeof(packedBits));
+
+    SampleEncoder rle(SampleEncoding::Rle, out);
+    for (uint16_t sample : samples)
+    {
+        rle.add(sample);
+    }
+    const uint8_t runs[] = {1, 2, 0, 1, 1, 1, 0, 4, 1, 2};
+    TEST_ASSERT_EQUAL(sizeof(runs), rle.finish());
+    TEST_ASSERT_EQUAL_MEMORY(runs, out, sizeof(runs));
+
+    // 12-bit samples: two in three bytes, the odd one out in two
+    const uint16_t analog[] = {0xABC, 0x123, 0xFFF};
+    SampleEncoder packed(SampleEncoding::Packed12, out);
+    SampleEncoder delta(SampleEncoding::Delta, out + 16);
+    for (uint16_t sample : analog)
+    {
+        packed.add(sample);
+        delta.add(sample);
+    }
+    const uint8_t packed12[] = {0xBC, 0x3A, 0x12, 0xFF, 0x0F};
+    TEST_ASSERT_EQUAL(sizeof(packed12), packed.finish());
+    TEST_ASSERT_EQUAL_MEMORY(packed12, out, sizeof(packed12));
+    // Zigzag deltas +0xABC, -0x999, +0xEDC
+    const uint8_t deltas[] = {0xF8, 0x2A, 0xB1, 0x26, 0xB8, 0x3B};
+    TEST_ASSERT_EQUAL(sizeof(deltas), delta.finish());
+    TEST_ASSERT_EQUAL_MEMORY(deltas, out + 16, sizeof(deltas));
+
+    SampleEncoding encoding;
+    TEST_ASSERT_TRUE(parseSampleEncoding("packed12", encoding));
+    TEST_ASSERT_TRUE(encoding == SampleEncoding::Packed12);
+    TEST_ASSERT_FALSE(parseSampleEncoding("float", encoding));
+
+    // The format is reported next to the data
+    ResultSink sink;
+    memcpy(sink.allocBytes(2), packedBits, 2);
+    sink.setFormat("bits", count);
+    std::string json;
+    sink.appendJson(json);
+    TEST_ASSERT_EQUAL_STRING("{\"data\":\"CwM=\",\"format\":\"bits\",\"count\":10}", json.c_str());
+}
+
+void test_sample_reductions()
+{
+    const uint16_t samples[] = {10, 20, 30, 40, 0, 0, 0, 100, 7};
+    const size_t count = sizeof(samples) / sizeof(samples[0]);
+    uint16_t out[16];
+    // Returns the number of values written, which reducedCount() predicts
+    auto reduce = [&](SampleReduction reduction) -> size_t
+    {
+        SampleEncoder encoder(SampleEncoding::U16, reinterpret_cast<uint8_t *>(out));
+        SampleReducer reducer(reduction, 4, encoder);
+        for (uint16_t sample : samples)
+        {
+            reducer.add(sample);
+        }
+        return encoder.finish() / 2 == reducer.count() ? reducer.count() : 0;
+    };
+
+    // Windows of four samples; the trailing sample is dropped
+    const uint16_t box[] = {25, 25};
+    TEST_ASSERT_EQUAL(reducedCount(SampleReduction::Box, count, 4), reduce(SampleReduction::Box));
+    TEST_ASSERT_EQUAL_MEMORY(box, out, sizeof(box));
+    const uint16_t stats[] = {10, 40, 25, 27, 0, 100, 25, 50};
+    TEST_ASSERT_EQUAL(reducedCount(SampleReduction::Stats, count, 4), reduce(SampleReduction::Stats));
+    TEST_ASSERT_EQUAL_MEMORY(stats, out, sizeof(stats));
+    const uint16_t peak[] = {10, 40, 0, 100};
+    TEST_ASSERT_EQUAL(reducedCount(SampleReduction::Peak, count, 4), reduce(SampleReduction::Peak));
+    TEST_ASSERT_EQUAL_MEMORY(peak, out, sizeof(peak));
+    TEST_ASSERT_EQUAL(count, reduce(SampleReduction::None));
+    TEST_ASSERT_EQUAL_MEMORY(samples, out, sizeof(samples));
+
+    // The CIC filter passes a constant input at unit gain once its first two outputs settle
+    SampleEncoder encoder(SampleEncoding::U16, reinterpret_cast<uint8_t *>(out));
+    SampleReducer cic(SampleReduction::Cic, 8, encoder);
+    for (int i = 0; i < 40; ++i)
+    {
+        cic.add(1000);
+    }
+    TEST_ASSERT_EQUAL(5, cic.count());
+    for (int i = 2; i < 5; ++i)
+    {
+        TEST_ASSERT_EQUAL(1000, out[i]);
+    }
+
+    SampleReduction reduction;
+    TEST_ASSERT_TRUE(parseSampleReduction("stats", reduction));
+    TEST_ASSERT_TRUE(reduction == SampleReduction::Stats);
+    TEST_ASSERT_FALSE(parseSampleReduction("median", reduction));
+
+    // Reads reduce on the device: a constant half-scale source at 10 bits
+    sim::reset();
+    sim::setAnalogSource(34, {sim::Shape::Constant, sim::ADC_FULL_SCALE_VOLTS / 2, 0, 0, 0});
+    AnalogCtl analog;
+    analog.init({{"pin", "34"}, {"resolution", "10"}});
+    ResultSink result;
+    analog.execute("readAnalog", {{"numSamples", "8"}, {"encoding", "u16"}, {"reduce", "stats"}, {"decimate", "4"}}, result);
+    TEST_ASSERT_EQUAL(8, result.count());
+    const uint16_t half[] = {512, 512, 512, 512, 512, 512, 512, 512};
+    TEST_ASSERT_EQUAL_MEMORY(half, result.data(), sizeof(half));
+    analog.execute("readAnalog", {{"reduce", "median"}}, result);
+    TEST_ASSERT_EQUAL_STRING("reduce", result.errorParam());
+}
+
+void test_response_stream()
+{
+    ResultSink small;
+    small.setInt(7);
+    for (bool msgpack : {false, true})
+    {
+        ResultSink large;
+        uint8_t *bytes = large.allocBytes(1000);
+        for (size_t i = 0; i < 1000; ++i)
+        {
+            bytes[i] = static_cast<uint8_t>(i * 7);
+        }
+        large.setFormat("u16", 500);
+
+        // The same results appended in full, as the WebSocket path does
+        std::string expected = "[";
+        msgpack ? small.appendMsgPack(expected) : small.appendJson(expected);
+        msgpack ? large.appendMsgPack(expected) : large.appendJson(expected);
+        expected += "]";
+
+        ResponseStream stream;
+        stream.text = "[";
+        msgpack ? small.appendMsgPack(stream.text) : small.appendJson(stream.text);
+        msgpack ? stream.spliceMsgPack(large) : stream.spliceJson(large);
+        stream.text += "]";
+        TEST_ASSERT_TRUE(large.type() == ResultType::None);
+        TEST_ASSERT_EQUAL(expected.size(), stream.size());
+
+        // Windows of any size, in particular ones splitting base64 groups, read back the same bytes
+        for (size_t window : {1, 5, 64, 4096})
+        {
+            std::string streamed;
+            uint8_t buffer[4096];
+            size_t count;
+            while ((count = stream.read(streamed.size(), buffer, window)) > 0)
+            {
+                streamed.append(reinterpret_cast<const char *>(buffer), count);
+            }
+            TEST_ASSERT_EQUAL(expected.size(), streamed.size());
+            TEST_ASSERT_TRUE(expected == streamed);
+        }
+    }
+}
+
+struct BinderParams
+{
+    uint8_t address = 0;
+    int offset = 0;
+    const std::string *data = nullptr;
+};
+
+static constexpr ParamSpec<BinderParams> BINDER_PARAMS[] = {
+    integerParam<BinderParams, uint8_t, &BinderParams::address>("address", "uint8_t", 0, 0x7F),
+    integerParam<BinderParams, int, &BinderParams::offset>("offset", "int"),
+    textParam<BinderParams, &BinderParams::data>("data", "std::vector<uint8_t>")};
+
+void test_param_binder()
+{
+    int64_t value;
+    const char *text = "-9223372036854775808";
+    TEST_ASSERT_TRUE(parseInteger(text, text + strlen(text), value));
+    TEST_ASSERT_TRUE(value == INT64_MIN);
+    text = "9223372036854775808";
+    TEST_ASSERT_FALSE(parseInteger(text, text + strlen(text), value));
+    for (const char *invalid : {"", "-", "12a", " 1", "+1", "0x10", "1.5"})
+    {
+        TEST_ASSERT_FALSE(parseInteger(invalid, invalid + strlen(invalid), value));
+    }
+
+    // Undeclared parameters are ignored; absent ones keep their defaults
+    BinderParams params;
+    ParamError error;
+    std::vector<std::pair<std::string, std::string>> values = {{"pin", "x"}, {"address", "80"}, {"data", "AAE="}};
+    TEST_ASSERT_TRUE(bindParams(BINDER_PARAMS, values, params, error));
+    TEST_ASSERT_EQUAL(80, params.address);
+    TEST_ASSERT_EQUAL(0, params.offset);
+    TEST_ASSERT_EQUAL_STRING("AAE=", params.data->c_str());
+
+    // Out-of-range values are rejected rather than wrapped, and the error names the parameter
+    values = {{"address", "300"}, {"offset", "-5"}};
+    TEST_ASSERT_FALSE(bindParams(BINDER_PARAMS, values, params, error));
+    TEST_ASSERT_EQUAL_STRING("address", error.param);
+    TEST_ASSERT_EQUAL_STRING("Out of range", error.message);
+    TEST_ASSERT_EQUAL(80, params.address);
+    TEST_ASSERT_EQUAL(-5, params.offset);
+
+    FunctionInfo info = describeCommand("write", BINDER_PARAMS);
+    TEST_ASSERT_EQUAL(3, info.params.size());
+    TEST_ASSERT_EQUAL_STRING("uint8_t", info.params[0].second.c_str());
+
+    // Modules report bad input as a result instead of throwing
+    I2CCtl i2c;
+    ResultSink sink;
+    i2c.execute("readFromDevice", {{"address", "0x50"}}, sink);
+    std::string json;
+    sink.appendJson(json);
+    TEST_ASSERT_EQUAL_STRING("{\"error\": \"Invalid integer\", \"param\": \"address\"}", json.c_str());
+}
+
+void test_name_index()
+{
+    NameIndex index;
+    TEST_ASSERT_TRUE(index.build({"analog", "gpio", "i2c", "i2s", "spi", "gpio"}));
+    TEST_ASSERT_EQUAL(2, index.find("i2c"));
+    TEST_ASSERT_EQUAL(1, index.find("gpio"));
+    TEST_ASSERT_EQUAL(-1, index.find("uart"));
+
+    // Too many names for 16-bit slots: lookups search the names instead of failing
+    std::vector<std::string> names;
+    for (int i = 0; i < 40000; ++i)
+    {
+        names.push_back("name" + std::to_string(i));
+    }
+    TEST_ASSERT_FALSE(index.build(names));
+    TEST_ASSERT_EQUAL(0, index.find("name0"));
+    TEST_ASSERT_EQUAL(39999, index.find("name39999"));
+    TEST_ASSERT_EQUAL(-1, index.find("name40000"));
+}
+
+void test_udp_frame_parse_and_order()
+{
+    const uint32_t token = udpTokenFor("secret", 6);
+    uint8_t datagram[UDP_FRAME_HEADER_SIZE + 2 * sizeof(int32_t)] = {UDP_FRAME_VERSION, 1, 2, 2};
+    memcpy(datagram + 4, &token, sizeof(token)); // The test host is little-endian like the ESP32
+    const uint32_t sequence = 41;
+    memcpy(datagram + 8, &sequence, sizeof(sequence));
+    const int32_t args[2] = {1, -300};
+    memcpy(datagram + UDP_FRAME_HEADER_SIZE, args, sizeof(args));
+
+    UdpFrame frame;
+    TEST_ASSERT_TRUE(parseUdpFrame(datagram, sizeof(datagram), token, frame));
+    TEST_ASSERT_EQUAL(1, frame.module);
+    TEST_ASSERT_EQUAL(2, frame.opcode);
+    TEST_ASSERT_EQUAL(2, frame.argc);
+    TEST_ASSERT_EQUAL(41, frame.sequence);
+    TEST_ASSERT_EQUAL(1, frame.args[0]);
+    TEST_ASSERT_EQUAL(-300, frame.args[1]);
+
+    // Wrong token, truncated arguments and unknown versions are rejected
+    TEST_ASSERT_FALSE(parseUdpFrame(datagram, sizeof(datagram), token + 1, frame));
+    TEST_ASSERT_FALSE(parseUdpFrame(datagram, sizeof(datagram) - 1, token, frame));
+    datagram[0] = UDP_FRAME_VERSION + 1;
+    TEST_ASSERT_FALSE(parseUdpFrame(datagram, sizeof(datagram), token, frame));
+
+    SequenceFilter filter;
+    TEST_ASSERT_TRUE(filter.accept(10));
+    TEST_ASSERT_TRUE(filter.accept(12));
+    TEST_ASSERT_FALSE(filter.accept(11));
+    TEST_ASSERT_FALSE(filter.accept(12));
+    TEST_ASSERT_TRUE(filter.accept(0)); // Sender restarted
+    TEST_ASSERT_TRUE(filter.accept(1));
+    TEST_ASSERT_FALSE(filter.accept(0xFFFFFFF0u)); // Older modulo 2^32
+}
+
+void test_program_binding()
+{
+    ProgramStep step;
+    step.moduleName = "i2c";
+    step.commandName = "readFromDevice";
+    step.module = 2;
+    step.opcode = 0;
+    step.cacheMs = 0;
+    step.params = {{"address", "$sensor"}, {"numBytes", "6"}};
+    step.bindings = {{0, "sensor"}};
+
+    std::vector<std::pair<std::string, std::string>> params;
+    TEST_ASSERT_NULL(step.bind({{"sensor", "72"}}, params));
+    TEST_ASSERT_EQUAL(2, params.size());
+    TEST_ASSERT_EQUAL_STRING("72", params[0].second.c_str());
+    TEST_ASSERT_EQUAL_STRING("6", params[1].second.c_str());
+    TEST_ASSERT_EQUAL_STRING("sensor", step.bind({{"other", "1"}}, params));
+
+    // Constant values are checked by the command's own binder, ranges included
+    FunctionInfo info = describeCommand("write", BINDER_PARAMS);
+    ParamError error;
+    TEST_ASSERT_TRUE(info.check({{"offset", "-12"}, {"data", "AQID"}}, error));
+    TEST_ASSERT_FALSE(info.check({{"address", "0x48"}}, error));
+    TEST_ASSERT_FALSE(info.check({{"address", "200"}}, error));
+    TEST_ASSERT_EQUAL_STRING("Out of range", error.message);
+
+    ProgramStore store(1);
+    uint32_t id = store.add({step});
+    TEST_ASSERT_NOT_EQUAL(0, id);
+    TEST_ASSERT_EQUAL(0, store.add({step}));
+    TEST_ASSERT_NOT_NULL(store.find(id));
+    TEST_ASSERT_TRUE(store.remove(id));
+    TEST_ASSERT_NULL(store.find(id));
+
+    // Rebuilding the registry resolves steps again by name, dropping programs whose commands are gone
+    id = store.add({step});
+    TEST_ASSERT_EQUAL(0, store.resolve([](ProgramStep &stored)
+                                       { stored.module = 4; return true; }));
+    TEST_ASSERT_EQUAL(4, (*store.find(id))[0].module);
+    TEST_ASSERT_EQUAL(1, store.resolve([](ProgramStep &stored)
+                                       { return stored.moduleName != "i2c"; }));
+    TEST_ASSERT_NULL(store.find(id));
+}
+
+void test_result_cache()
+{
+    ResultCache cache(2);
+    std::vector<std::pair<std::string, std::string>> params = {{"address", "72"}, {"numBytes", "2"}};
+    ResultSink read;
+    memcpy(read.allocBytes(2), "\x12\x34", 2);
+
+    ResultSink hit;
+    TEST_ASSERT_FALSE(cache.lookup(2, 0, params, 1000, hit));
+    cache.store(2, 0, params, 1000, 50, read);
+    TEST_ASSERT_TRUE(cache.lookup(2, 0, params, 1049, hit));
+    TEST_ASSERT_EQUAL(2, hit.size());
+    TEST_ASSERT_EQUAL_MEMORY("\x12\x34", hit.data(), 2);
+
+    // Other parameters, expiry and writes to the module all miss
+    std::vector<std::pair<std::string, std::string>> other = {{"address", "73"}, {"numBytes", "2"}};
+    TEST_ASSERT_FALSE(cache.lookup(2, 0, other, 1010, hit));
+    TEST_ASSERT_FALSE(cache.lookup(2, 0, params, 1050, hit));
+    cache.store(2, 0, params, 2000, 50, read);
+    cache.invalidate(2);
+    TEST_ASSERT_FALSE(cache.lookup(2, 0, params, 2001, hit));
+
+    ResultSink failed;
+    failed.setError("Failed to read");
+    cache.store(2, 0, params, 3000, 50, failed);
+    TEST_ASSERT_FALSE(cache.lookup(2, 0, params, 3001, hit));
+    TEST_ASSERT_EQUAL(1, cache.hits());
+    TEST_ASSERT_EQUAL(5, cache.misses());
+
+    // A hit on a timed read carries the start time and skew of the live result
+    ResultSink timed;
+    memcpy(timed.allocBytes(4), "\x01\x02\x03\x04", 4);
+    timed.setFormat("u16", 2);
+    timed.setStartTime(123456);
+    timed.setSkew(500);
+    cache.store(2, 1, params, 4000, 50, timed);
+    TEST_ASSERT_TRUE(cache.lookup(2, 1, params, 4001, hit));
+    std::string live;
+    std::string cached;
+    timed.appendJson(live);
+    hit.appendJson(cached);
+    TEST_ASSERT_EQUAL_STRING(live.c_str(), cached.c_str());
+}
+
+void test_metrics_histogram()
+{
+    Metrics metrics;
+    metrics.setCommands({{"gpio", {"digitalWrite", "digitalRead"}}});
+    metrics.recordCommand(0, 1, 3);
+    metrics.recordCommand(0, 1, 5);
+    metrics.recordCommand(0, 1, 100000000);
+    metrics.recordCommand(1, 0, 5);
+    metrics.countRequest(40);
+    metrics.countCommands(3, 1);
+
+    std::string text;
+    metrics.render(text);
+    // Buckets are cumulative, and durations past the last bound only land in +Inf
+    TEST_ASSERT_NOT_NULL(strstr(text.c_str(), "arduinoctl_command_duration_seconds_bucket{module=\"gpio\",command=\"digitalRead\",le=\"4e-06\"} 1\n"));
+    TEST_ASSERT_NOT_NULL(strstr(text.c_str(), "arduinoctl_command_duration_seconds_bucket{module=\"gpio\",command=\"digitalRead\",le=\"8e-06\"} 2\n"));
+    TEST_ASSERT_NOT_NULL(strstr(text.c_str(), "arduinoctl_command_duration_seconds_bucket{module=\"gpio\",command=\"digitalRead\",le=\"+Inf\"} 3\n"));
+    TEST_ASSERT_NOT_NULL(strstr(text.c_str(), "arduinoctl_command_duration_seconds_count{module=\"gpio\",command=\"digitalRead\"} 3\n"));
+    TEST_ASSERT_NOT_NULL(strstr(text.c_str(), "arduinoctl_command_errors_total 1\n"));
+    TEST_ASSERT_NOT_NULL(strstr(text.c_str(), "arduinoctl_request_bytes_total 40\n"));
+}
+
+void test_sim_buses()
+{
+    sim::reset();
+
+    // I2C: select register 0x10 of a sensor at 0x48, then read two bytes back (opcodes
+    // are positions in getSupportedFunctions)
+    std::shared_ptr<sim::RegisterDevice> sensor = std::make_shared<sim::RegisterDevice>();
+    sensor->setRegister(0x10, 0xAB);
+    sensor->setRegister(0x11, 0xCD);
+    sim::attachI2c(0x48, sensor);
+    I2CCtl i2c;
+    i2c.init({{"frequency", "100000"}});
+    ResultSink result;
+    i2c.dispatch(1, {{"address", "72"}, {"data", "EA=="}}, result);
+    i2c.dispatch(0, {{"address", "72"}, {"numBytes", "2"}}, result);
+    TEST_ASSERT_EQUAL(2, result.size());
+    TEST_ASSERT_EQUAL_MEMORY("\xAB\xCD", result.data(), 2);
+    // Start, stop and nine clocks per byte at 100 kHz: the write, the read, and the
+    // empty write readFromDevice ends with take 20 + 29 + 11 clocks
+    TEST_ASSERT_EQUAL(600, sim::now());
+    // A read longer than Wire's buffer is refused instead of coming back short
+    i2c.dispatch(0, {{"address", "72"}, {"numBytes", "129"}}, result);
+    TEST_ASSERT_EQUAL_STRING("numBytes", result.errorParam());
+
+    // SPI: a loopback device echoes what it is sent, but only while selected
+    sim::attachSpi(SS, std::make_shared<sim::SpiLoopback>());
+    SPICtl spi;
+    spi.init({});
+    spi.dispatch(0, {{"data", "AQID"}}, result);
+    TEST_ASSERT_EQUAL_MEMORY("\x01\x02\x03", result.data(), 3);
+    TEST_ASSERT_EQUAL(HIGH, sim::outputLevel(SS));
+
+    // I2S: the data output is looped back to the input, then reads silence
+    I2SCtl i2s;
+    i2s.init({});
+    i2s.dispatch(1, {{"data", "AQIDBA=="}}, result);
+    TEST_ASSERT_EQUAL(4, sim::i2sPending(0));
+    i2s.dispatch(0, {{"numBytes", "8"}}, result);
+    TEST_ASSERT_EQUAL_MEMORY("\x01\x02\x03\x04\0\0\0\0", result.data(), 8);
+    i2s.deinit();
+
+    // ADC: a constant half-scale source reads mid-range at any resolution
+    sim::setAnalogSource(34, {sim::Shape::Constant, sim::ADC_FULL_SCALE_VOLTS / 2, 0, 0, 0});
+    AnalogCtl analog;
+    analog.init({{"pin", "34"}, {"resolution", "10"}});
+    analog.dispatch(0, {{"numSamples", "1"}}, result);
+    int sample;
+    memcpy(&sample, result.data(), sizeof(int));
+    TEST_ASSERT_EQUAL(512, sample);
+    analog.dispatch(0, {{"numSamples", "100000"}}, result);
+    TEST_ASSERT_EQUAL_STRING("Out of range", result.error());
+}
+
+void test_gpio_bank()
+{
+    sim::reset();
+    GPIOCtl gpio;
+    ResultSink result;
+
+    // An 8-bit bus on GPIO12-19 plus GPIO33 from the second bank: nine pins, two bytes per step
+    const uint64_t mask = 0xFF000ULL | (1ULL << 33);
+    const std::string maskText = std::to_string(mask);
+    gpio.execute("bankMode", {{"mask", maskText}, {"mode", std::to_string(OUTPUT)}}, result);
+    TEST_ASSERT_EQUAL(OUTPUT, sim::pinModeOf(12));
+    TEST_ASSERT_EQUAL(OUTPUT, sim::pinModeOf(33));
+
+    // Steps 0x1A5 then 0x05A; the pins of each step change at the same instant
+    gpio.execute("bankWrite", {{"mask", maskText}, {"values", "pQFaAA=="}, {"intervalUs", "10"}}, result);
+    TEST_ASSERT_EQUAL(ResultType::None, result.type());
+    TEST_ASSERT_EQUAL(HIGH, sim::outputLevel(13));
+    TEST_ASSERT_EQUAL(LOW, sim::outputLevel(12));
+    TEST_ASSERT_EQUAL(LOW, sim::outputLevel(33));
+    TEST_ASSERT_EQUAL(sim::edges(12).back().time, sim::edges(33).back().time);
+    TEST_ASSERT_EQUAL(10, sim::edges(12).back().time - sim::edges(12).front().time);
+
+    // Output pins read back what they drive, packed the same way
+    gpio.execute("bankRead", {{"mask", maskText}, {"numSamples", "2"}}, result);
+    TEST_ASSERT_EQUAL(4, result.size());
+    TEST_ASSERT_EQUAL_MEMORY("\x5A\x00\x5A\x00", result.data(), 4);
+    gpio.execute("bankWrite", {{"mask", maskText}, {"value", "256"}}, result);
+    TEST_ASSERT_EQUAL(HIGH, sim::outputLevel(33));
+    TEST_ASSERT_EQUAL(LOW, sim::outputLevel(13));
+
+    sim::setInput(4, HIGH);
+    gpio.execute("bankRead", {{"mask", "48"}}, result);
+    TEST_ASSERT_EQUAL(1, result.size());
+    TEST_ASSERT_EQUAL(0x01, result.data()[0]);
+
+    // The pins of the SPI flash are never driven
+    gpio.execute("bankWrite", {{"mask", "64"}, {"value", "1"}}, result);
+    TEST_ASSERT_EQUAL_STRING("Pin reserved for flash", result.error());
+    gpio.execute("bankWrite", {{"mask", maskText}, {"values", "AQ=="}}, result);
+    TEST_ASSERT_EQUAL_STRING("values", result.errorParam());
+}
+
+void test_gpio_capture()
+{
+    sim::reset();
+    GPIOCtl gpio;
+    ResultSink result;
+
+    // 100 kHz square wave on GPIO5, sampled at 1 MHz around a falling edge
+    sim::setAnalogSource(5, {sim::Shape::Square, 1.65, 1.65, 100000, 0});
+    gpio.execute("capture", {{"mask", "32"}, {"numSamples", "40"}, {"sampleRate", "1000000"}, {"preTrigger", "4"}, {"triggerMask", "32"}, {"triggerValue", "0"}, {"triggerEdge", "1"}}, result);
+    TEST_ASSERT_EQUAL(ResultType::Bytes, result.type());
+    TEST_ASSERT_EQUAL_STRING("bits", result.format());
+    TEST_ASSERT_EQUAL(40, result.count());
+    TEST_ASSERT_EQUAL(5, result.size());
+    for (int i = 0; i < 40; ++i)
+    {
+        // Four high samples, then the trigger sample starts five low ones
+        TEST_ASSERT_EQUAL((i + 1) % 10 < 5, (result.data()[i / 8] >> (i % 8)) & 1);
+    }
+
+    // Two pins that are not adjacent pack into two bits per sample
+    sim::setInput(7, HIGH);
+    gpio.execute("capture", {{"mask", "160"}, {"numSamples", "4"}}, result);
+    TEST_ASSERT_EQUAL(1, result.size());
+    TEST_ASSERT_EQUAL(0xAA, result.data()[0] & 0xAA);
+
+    gpio.execute("capture", {{"mask", "160"}, {"triggerMask", "128"}, {"timeoutMs", "1"}}, result);
+    TEST_ASSERT_EQUAL_STRING("Trigger timeout", result.error());
+    gpio.execute("capture", {{"mask", "32"}, {"numSamples", "1000"}, {"sampleRate", "1000"}}, result);
+    TEST_ASSERT_EQUAL_STRING("numSamples", result.errorParam());
+    // A capture must sample at least one pin
+    gpio.execute("capture", {{"mask", "0"}, {"numSamples", "4"}}, result);
+    TEST_ASSERT_EQUAL_STRING("mask", result.errorParam());
+    gpio.execute("capture", {{"numSamples", "4"}}, result);
+    TEST_ASSERT_EQUAL_STRING("mask", result.errorParam());
+
+    // The trigger wait only gets what the samples leave of the masking budget: 50 ms
+    // of samples give up on a trigger 100 ms away rather than masking for 150 ms
+    sim::reset();
+    sim::setAnalogSource(5, {sim::Shape::Square, 1.65, 1.65, 5, 0});
+    uint64_t started = sim::now();
+    gpio.execute("capture", {{"mask", "32"}, {"numSamples", "500"}, {"sampleRate", "10000"}, {"triggerMask", "32"}, {"triggerValue", "0"}}, result);
+    TEST_ASSERT_EQUAL_STRING("Trigger timeout", result.error());
+    TEST_ASSERT_TRUE(sim::now() - started <= 101000);
+}
+
+void test_gpio_pattern()
+{
+    sim::reset();
+    GPIOCtl gpio;
+    gpio.init({{"pin", "13"}, {"mode", std::to_string(OUTPUT)}});
+    ResultSink result;
+
+    // High 2 us, low 3 us, high 1 us, then the idle level
+    uint64_t start = sim::now();
+    gpio.execute("playPattern", {{"pulses", "0AcAgLgLAADoAwCA"}, {"wait", "1"}}, result);
+    TEST_ASSERT_EQUAL(ResultType::None, result.type());
+    std::vector<sim::Edge> edges = sim::edges(13);
+    TEST_ASSERT_EQUAL(4, edges.size());
+    TEST_ASSERT_EQUAL(start, edges[0].time);
+    TEST_ASSERT_EQUAL(HIGH, edges[0].level);
+    TEST_ASSERT_EQUAL(start + 2, edges[1].time);
+    TEST_ASSERT_EQUAL(start + 5, edges[2].time);
+    TEST_ASSERT_EQUAL(start + 6, edges[3].time);
+    TEST_ASSERT_EQUAL(LOW, edges[3].level);
+    TEST_ASSERT_EQUAL(start + 6, sim::now());
+
+    // Bits 1, 0, 1, 1 at 1 Mbit/s; equal bits merge into one stretch
+    start = sim::now();
+    gpio.execute("playPattern", {{"bits", "DQ=="}, {"numBits", "4"}, {"bitRate", "1000000"}, {"wait", "1"}}, result);
+    edges = sim::edges(13);
+    TEST_ASSERT_EQUAL(8, edges.size());
+    TEST_ASSERT_EQUAL(start + 1, edges[5].time);
+    TEST_ASSERT_EQUAL(start + 2, edges[6].time);
+    TEST_ASSERT_EQUAL(start + 4, edges[7].time);
+
+    // A second high is longer than an RMT item holds and is split without an edge
+    start = sim::now();
+    gpio.execute("playPattern", {{"pulses", "QEIPgOgDAAA="}, {"wait", "1"}}, result);
+    edges = sim::edges(13);
+    TEST_ASSERT_EQUAL(10, edges.size());
+    TEST_ASSERT_EQUAL(start + 1000, edges[9].time);
+
+    // Loops run until stopped, and must fit in the channel's memory
+    gpio.execute("playPattern", {{"bits", "DQ=="}, {"bitRate", "1000"}, {"loop", "1"}}, result);
+    TEST_ASSERT_TRUE(sim::rmtLooping(0));
+    gpio.execute("stopPattern", {}, result);
+    TEST_ASSERT_FALSE(sim::rmtLooping(0));
+    gpio.execute("playPattern", {{"bits", "VVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVVQ=="}, {"bitRate", "1000"}, {"loop", "1"}}, result);
+    TEST_ASSERT_EQUAL_STRING("Pattern too long to loop", result.error());
+    gpio.execute("playPattern", {{"bits", "DQ=="}}, result);
+    TEST_ASSERT_EQUAL_STRING("bitRate", result.errorParam());
+    gpio.execute("playPattern", {}, result);
+    TEST_ASSERT_EQUAL_STRING("Missing parameter", result.error());
+    gpio.execute("playPattern", {{"pulses", ""}}, result);
+    TEST_ASSERT_EQUAL_STRING("pulses", result.errorParam());
+
+    // Another driver on the channel fails the command instead of silently playing nothing
+    rmt_config_t config = RMT_DEFAULT_CONFIG_TX(static_cast<gpio_num_t>(12), RMT_CHANNEL_0);
+    rmt_config(&config);
+    rmt_driver_install(RMT_CHANNEL_0, 0, 0);
+    gpio.execute("playPattern", {{"pulses", "0AcAgLgLAADoAwCA"}}, result);
+    TEST_ASSERT_EQUAL_STRING("RMT channel unavailable", result.error());
+    rmt_driver_uninstall(RMT_CHANNEL_0);
+
+    // Pin commands let a one-shot pattern finish, but only wait so long for it: here 1 s high
+    start = sim::now();
+    gpio.execute("playPattern", {{"pulses", "AMqauw=="}}, result);
+    gpio.execute("playPattern", {{"pulses", "AMqauw=="}}, result);
+    gpio.execute("setPinMode", {{"mode", std::to_string(OUTPUT)}}, result);
+    TEST_ASSERT_TRUE(sim::now() - start <= 100000);
+    TEST_ASSERT_EQUAL(LOW, sim::outputLevel(13));
+}
+
+void test_analog_continuous()
+{
+    sim::reset();
+    AnalogCtl analog;
+    analog.init({{"pin", "36"}, {"resolution", "12"}});
+    ResultSink result;
+
+    // A 10 kHz square wave sampled at 100 kS/s: each 10-sample block holds one period
+    sim::setAnalogSource(36, {sim::Shape::Square, 1.65, 1.65, 10000, 0});
+    analog.execute("startContinuous", {{"sampleRate", "100000"}, {"blockSamples", "10"}, {"numBlocks", "4"}}, result);
+    TEST_ASSERT_EQUAL(ResultType::None, result.type());
+    uint64_t start = sim::now();
+    analog.execute("readContinuous", {{"numBlocks", "2"}, {"encoding", "u16"}}, result);
+    TEST_ASSERT_EQUAL(20, result.count());
+    TEST_ASSERT_TRUE(result.timed());
+    TEST_ASSERT_EQUAL(start, result.startTime());
+    uint16_t samples[20];
+    memcpy(samples, result.data(), sizeof(samples));
+    for (int i = 0; i < 10; ++i)
+    {
+        TEST_ASSERT_EQUAL(samples[i], samples[i + 10]);
+        TEST_ASSERT_EQUAL(4095, samples[i] + samples[(i + 5) % 10]);
+    }
+
+    // Reads carry on where the last one stopped
+    analog.execute("readContinuous", {}, result);
+    TEST_ASSERT_EQUAL(start + 200, result.startTime());
+    TEST_ASSERT_EQUAL(10 * sizeof(int32_t), result.size());
+
+    // Blocks dropped while nobody read are skipped, whole blocks at a time
+    sim::advance(10000);
+    analog.execute("readContinuous", {}, result);
+    TEST_ASSERT_TRUE(result.startTime() >= static_cast<int64_t>(start + 10000 - 400));
+    TEST_ASSERT_EQUAL(0, (result.startTime() - start) % 100);
+
+    analog.execute("readAnalog", {}, result);
+    TEST_ASSERT_EQUAL_STRING("Continuous sampling running", result.error());
+    analog.execute("stopContinuous", {}, result);
+    analog.execute("readContinuous", {}, result);
+    TEST_ASSERT_EQUAL_STRING("Continuous sampling not running", result.error());
+    analog.execute("startContinuous", {{"blockSamples", "9"}}, result);
+    TEST_ASSERT_EQUAL_STRING("blockSamples", result.errorParam());
+    analog.init({{"pin", "4"}});
+    analog.execute("startContinuous", {}, result);
+    TEST_ASSERT_EQUAL_STRING("Pin has no ADC1 channel", result.error());
+}
+
+void test_analog_scan()
+{
+    sim::reset();
+    AnalogCtl analog;
+    analog.init({{"pin", "36"}, {"resolution", "12"}});
+    ResultSink result;
+    sim::setAnalogSource(36, {sim::Shape::Constant, 0, 0, 0, 0});
+    sim::setAnalogSource(39, {sim::Shape::Constant, sim::ADC_FULL_SCALE_VOLTS, 0, 0, 0});
+    sim::setAnalogSource(34, {sim::Shape::Constant, sim::ADC_FULL_SCALE_VOLTS / 2, 0, 0, 0});
+
+    // Three ADC1 pins at 10 kS/s each go through the pattern table: one conversion period apart
+    uint64_t start = sim::now();
+    analog.execute("scan", {{"pins", "36,39,34"}, {"numSamples", "4"}, {"sampleRate", "10000"}, {"encoding", "u16"}}, result);
+    TEST_ASSERT_EQUAL(12, result.count());
+    TEST_ASSERT_EQUAL(start, result.startTime());
+    TEST_ASSERT_EQUAL(33333, result.skew());
+    const uint16_t interleaved[] = {0, 4095, 2048, 0, 4095, 2048, 0, 4095, 2048, 0, 4095, 2048};
+    TEST_ASSERT_EQUAL_MEMORY(interleaved, result.data(), sizeof(interleaved));
+    analog.execute("scan", {{"pins", "39,34"}, {"numSamples", "2"}, {"sampleRate", "10000"}, {"layout", "blocks"}, {"encoding", "u16"}}, result);
+    const uint16_t blocks[] = {4095, 4095, 2048, 2048};
+    TEST_ASSERT_EQUAL_MEMORY(blocks, result.data(), sizeof(blocks));
+
+    // An ADC2 pin, or I2S0 taken, leaves the scan to analogRead: still one pass, with the measured skew
+    sim::setAnalogSource(4, {sim::Shape::Constant, sim::ADC_FULL_SCALE_VOLTS, 0, 0, 0});
+    analog.execute("scan", {{"pins", "36,4"}, {"numSamples", "2"}, {"encoding", "u16"}}, result);
+    const uint16_t mixed[] = {0, 4095, 0, 4095};
+    TEST_ASSERT_EQUAL_MEMORY(mixed, result.data(), sizeof(mixed));
+    TEST_ASSERT_EQUAL(sim::ADC_CONVERSION_MICROS * 1000, result.skew());
+    I2SCtl i2s;
+    i2s.init({});
+    analog.execute("scan", {{"pins", "36,39"}, {"sampleRate", "20000"}, {"encoding", "u16"}}, result);
+    TEST_ASSERT_EQUAL(sim::ADC_CONVERSION_MICROS * 1000, result.skew());
+    i2s.deinit();
+
+    analog.execute("scan", {{"pins", "36,36"}}, result);
+    TEST_ASSERT_EQUAL_STRING("pins", result.errorParam());
+    analog.execute("scan", {}, result);
+    TEST_ASSERT_EQUAL_STRING("Missing parameter", result.error());
+    analog.execute("scan", {{"pins", "36"}, {"layout", "planar"}}, result);
+    TEST_ASSERT_EQUAL_STRING("layout", result.errorParam());
+}
+
+void test_sim_server()
+{
+    sim::reset();
+    setup();
+    TEST_ASSERT_EQUAL(200, sim::http("GET", "/cache").code);
+
+    // The capabilities document describes every module, and revalidates by ETag
+    sim::HttpResponse capabilities = sim::http("GET", "/capabilities");
+    TEST_ASSERT_EQUAL(200, capabilities.code);
+    TEST_ASSERT_TRUE(capabilities.body.find("{\"name\":\"gpio\",\"bus\":\"gpio\",\"commands\":[") != std::string::npos);
+    TEST_ASSERT_TRUE(capabilities.body.find("{\"name\":\"digitalRead\",\"opcode\":1,\"params\":[{\"name\":\"numSamples\",\"type\":\"int\"}") != std::string::npos);
+    TEST_ASSERT_TRUE(capabilities.body.find("\"result\":\"bytes\",\"cacheable\":true}") != std::string::npos);
+    std::string etag = capabilities.header("ETag") ? capabilities.header("ETag") : "";
+    TEST_ASSERT_FALSE(etag.empty());
+    sim::HttpResponse unchanged = sim::http("GET", "/capabilities", std::string(), {{"If-None-Match", etag}});
+    TEST_ASSERT_EQUAL(304, unchanged.code);
+    TEST_ASSERT_TRUE(unchanged.body.empty());
+
+    // Messages pipelined right behind the one carrying the API key run authenticated
+    {
+        std::string hello;
+        std::string next;
+        MsgPackWriter helloWriter(hello);
+        helloWriter.writeMap(2);
+        helloWriter.writeString("api_key");
+        helloWriter.writeString("DefaultAPIKey");
+        helloWriter.writeString("commands");
+        helloWriter.writeArray(0);
+        MsgPackWriter nextWriter(next);
+        nextWriter.writeMap(1);
+        nextWriter.writeString("commands");
+        nextWriter.writeArray(0);
+        sim::WebSocket pipelined("/ws");
+        pipelined.send(hello, true);
+        pipelined.send(next, true);
+        pipelined.send(next, true);
+        for (int i = 0; i < 3; ++i)
+        {
+            sim::WebSocket::Message reply;
+            TEST_ASSERT_TRUE(pipelined.receive(reply));
+            TEST_ASSERT_TRUE(reply.data.find("Invalid API key") == std::string::npos);
+        }
+        TEST_ASSERT_EQUAL(0, pipelined.closeCode());
+    }
+
+    // A streamed response records its Encode phase once, when it has been sent
+    {
+        std::string request;
+        MsgPackWriter writer(request);
+        writer.writeMap(2);
+        writer.writeString("api_key");
+        writer.writeString("DefaultAPIKey");
+        writer.writeString("commands");
+        writer.writeArray(1);
+        writer.writeMap(3);
+        writer.writeString("module");
+        writer.writeString("gpio");
+        writer.writeString("command");
+        writer.writeString("digitalRead");
+        writer.writeString("params");
+        writer.writeMap(1);
+        writer.writeString("numSamples");
+        writer.writeString("512");
+        sim::HttpResponse streamed = sim::http("POST", "/msgpack", request);
+        TEST_ASSERT_EQUAL(200, streamed.code);
+        TEST_ASSERT_TRUE(streamed.body.size() > 512 * sizeof(int));
+        std::string metrics = sim::http("GET", "/metrics").body;
+        size_t executed = metrics.find("arduinoctl_phase_duration_seconds_count{phase=\"execute\"} ");
+        size_t encoded = metrics.find("arduinoctl_phase_duration_seconds_count{phase=\"encode\"} ");
+        TEST_ASSERT_TRUE(executed != std::string::npos && encoded != std::string::npos);
+        TEST_ASSERT_EQUAL(atoi(metrics.c_str() + metrics.find(' ', executed)), atoi(metrics.c_str() + metrics.find(' ', encoded)));
+    }
+
+    // Three samples of a pin held high, with the 1 ms spacing of digitalRead in virtual time
+    sim::setInput(0, HIGH);
+    uint64_t before = sim::now();
+    sim::HttpResponse response = sim::http("POST", "/execute",
+                                           "{\"api_key\":\"DefaultAPIKey\",\"commands\":[{\"module\":\"gpio\",\"command\":\"digitalRead\",\"params\":{\"numSamples\":\"3\"}}]}");
+    TEST_ASSERT_EQUAL(200, response.code);
+    TEST_ASSERT_EQUAL_STRING("{\"results\":[{\"data\":\"AQAAAAEAAAABAAAA\"}]}", response.body.c_str());
+    TEST_ASSERT_TRUE(sim::now() - before >= 3000);
+
+    // A WebSocket session that fails authentication is closed by the server
+    sim::WebSocket socket("/ws");
+    TEST_ASSERT_TRUE(socket.connected());
+    socket.send("{\"api_key\":\"wrong\",\"commands\":[]}");
+    sim::WebSocket::Message message;
+    TEST_ASSERT_TRUE(socket.receive(message));
+    TEST_ASSERT_EQUAL_STRING("{\"error\": \"Invalid API key\"}", message.data.c_str());
+    TEST_ASSERT_EQUAL(1008, socket.closeCode());
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_result_json_encoding);
+    RUN_TEST(test_result_short_read);
+    RUN_TEST(test_result_no_allocations_per_command);
+    RUN_TEST(test_msgpack_round_trip);
+    RUN_TEST(test_msgpack_params_match_json);
+    RUN_TEST(test_msgpack_results_match_json);
+    RUN_TEST(test_base64_codec);
+    RUN_TEST(test_sample_encodings);
+    RUN_TEST(test_sample_reductions);
+    RUN_TEST(test_response_stream);
+    RUN_TEST(test_param_binder);
+    RUN_TEST(test_name_index);
+    RUN_TEST(test_udp_frame_parse_and_order);
+    RUN_TEST(test_program_binding);
+    RUN_TEST(test_result_cache);
+    RUN_TEST(test_metrics_histogram);
+    RUN_TEST(test_sim_buses);
+    RUN_TEST(test_gpio_bank);
+    RUN_TEST(test_gpio_capture);
+    RUN_TEST(test_gpio_pattern);
+    RUN_TEST(test_analog_continuous);
+    RUN_TEST(test_analog_scan);
+    RUN_TEST(test_sim_server);
+    return UNITY_END();
+}
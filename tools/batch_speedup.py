@@ -0,0 +1,77 @@
+#!/usr/bin/env python3
+# ⚡🔌 Arduino-CTL 🔌⚡
+#
+# Copyright (C) 2024 ixaxaar
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#  http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Measure the wall-time speedup of per-bus parallel execution on a mixed batch.
+
+Runs the same batch with "serial": true (every command in order on one task) and
+without it (commands on different buses overlap), and compares the medians.
+
+Usage: batch_speedup.py HOST API_KEY [--count N] [--port 80] [--samples 100]
+"""
+
+import argparse
+import http.client
+import json
+import time
+from typing import Any, Dict, List
+
+
+def mixed_batch(samples: int) -> List[Dict[str, Any]]:
+    return [
+        {"module": "analog", "command": "readAnalog", "params": {"numSamples": str(samples)}},
+        {"module": "gpio", "command": "digitalRead", "params": {"numSamples": str(samples)}},
+        {"module": "i2c", "command": "readFromDevice", "params": {"address": "72", "numBytes": "32"}},
+        {"module": "spi", "command": "transfer", "params": {"data": "AAAAAAAAAAAAAAAAAAAAAA=="}},
+        {"module": "analog", "command": "readAnalog", "params": {"numSamples": str(samples)}},
+        {"module": "gpio", "command": "digitalRead", "params": {"numSamples": str(samples)}},
+    ]
+
+
+def run(host: str, port: int, body: str, count: int) -> float:
+    connection = http.client.HTTPConnection(host, port)
+    times = []
+    for _ in range(count):
+        start = time.perf_counter()
+        connection.request("POST", "/execute", body, {"Content-Type": "application/json"})
+        reply = connection.getresponse().read()
+        times.append((time.perf_counter() - start) * 1000.0)
+        if b'"results"' not in reply:
+            raise RuntimeError(reply.decode(errors="replace"))
+    connection.close()
+    times.sort()
+    return times[len(times) // 2]
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("host")
+    parser.add_argument("api_key")
+    parser.add_argument("--port", type=int, default=80)
+    parser.add_argument("--count", type=int, default=20)
+    parser.add_argument("--samples", type=int, default=100, help="samples per analog/gpio read (about 1 ms each)")
+    args = parser.parse_args()
+
+    commands = mixed_batch(args.samples)
+    serial = run(args.host, args.port, json.dumps({"api_key": args.api_key, "serial": True, "commands": commands}), args.count)
+    parallel = run(args.host, args.port, json.dumps({"api_key": args.api_key, "commands": commands}), args.count)
+    print(f"  serial: p50 {serial:8.1f} ms")
+    print(f"parallel: p50 {parallel:8.1f} ms")
+    print(f" speedup: {serial / parallel:8.2f}x")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,147 @@
+#!/usr/bin/env python3
+# ⚡🔌 Arduino-CTL 🔌⚡
+#
+# Copyright (C) 2024 ixaxaar
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#  http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Compare command round-trip latency of POST /execute and the /ws WebSocket.
+
+Usage: latency.py HOST API_KEY [--count N] [--port 80]
+"""
+
+import argparse
+import base64
+import http.client
+import json
+import os
+import socket
+import struct
+import time
+from typing import Callable, List
+
+# Only parameters digitalRead declares, so both transports run the same binding; the pin is set at init
+COMMAND = {"module": "gpio", "command": "digitalRead", "params": {"numSamples": "1"}}
+
+
+class WebSocket:
+    """Just enough of a WebSocket client to exchange text messages."""
+
+    def __init__(self, host: str, port: int, path: str) -> None:
+        self.sock = socket.create_connection((host, port))
+        self.sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        key = base64.b64encode(os.urandom(16)).decode()
+        self.sock.sendall(
+            (
+                f"GET {path} HTTP/1.1\r\nHost: {host}\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                f"Sec-WebSocket-Key: {key}\r\nSec-WebSocket-Version: 13\r\n\r\n"
+            ).encode()
+        )
+        header = b""
+        while b"\r\n\r\n" not in header:
+            chunk = self.sock.recv(1)
+            if not chunk:
+                raise ConnectionError("connection closed during handshake")
+            header += chunk
+        if b" 101 " not in header.split(b"\r\n", 1)[0]:
+            raise ConnectionError(header.decode(errors="replace"))
+
+    def send(self, text: str) -> None:
+        payload = text.encode()
+        mask = os.urandom(4)
+        length = len(payload)
+        if length < 126:
+            header = struct.pack("!BB", 0x81, 0x80 | length)
+        elif length < 65536:
+            header = struct.pack("!BBH", 0x81, 0x80 | 126, length)
+        else:
+            header = struct.pack("!BBQ", 0x81, 0x80 | 127, length)
+        masked = bytes(b ^ mask[i % 4] for i, b in enumerate(payload))
+        self.sock.sendall(header + mask + masked)
+
+    def _read(self, size: int) -> bytes:
+        data = b""
+        while len(data) < size:
+            chunk = self.sock.recv(size - len(data))
+            if not chunk:
+                raise ConnectionError("connection closed")
+            data += chunk
+        return data
+
+    def receive(self) -> str:
+        message = b""
+        while True:
+            first, second = self._read(2)
+            length = second & 0x7F
+            if length == 126:
+                (length,) = struct.unpack("!H", self._read(2))
+            elif length == 127:
+                (length,) = struct.unpack("!Q", self._read(8))
+            payload = self._read(length)
+            opcode = first & 0x0F
+            if opcode == 0x8:
+                raise ConnectionError("closed by server: " + payload[2:].decode(errors="replace"))
+            if opcode in (0x9, 0xA):
+                continue
+            message += payload
+            if first & 0x80:
+                return message.decode()
+
+
+def measure(count: int, round_trip: Callable[[int], None]) -> List[float]:
+    samples = []
+    for i in range(count):
+        start = time.perf_counter()
+        round_trip(i)
+        samples.append((time.perf_counter() - start) * 1000.0)
+    return sorted(samples)
+
+
+def report(name: str, samples: List[float]) -> None:
+    p50 = samples[len(samples) // 2]
+    p99 = samples[min(len(samples) - 1, int(len(samples) * 0.99))]
+    print(f"{name:>10}: p50 {p50:7.2f} ms  p99 {p99:7.2f} ms  ({len(samples)} round trips)")
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("host")
+    parser.add_argument("api_key")
+    parser.add_argument("--port", type=int, default=80)
+    parser.add_argument("--count", type=int, default=500)
+    args = parser.parse_args()
+
+    def post(_: int) -> None:
+        # A fresh connection per request, as the existing clients do
+        connection = http.client.HTTPConnection(args.host, args.port)
+        body = json.dumps({"api_key": args.api_key, "commands": [COMMAND]})
+        connection.request("POST", "/execute", body, {"Content-Type": "application/json"})
+        connection.getresponse().read()
+        connection.close()
+
+    ws = WebSocket(args.host, args.port, "/ws")
+    ws.send(json.dumps({"api_key": args.api_key, "id": -1, "commands": []}))
+    ws.receive()
+
+    def websocket(i: int) -> None:
+        ws.send(json.dumps({"id": i, "commands": [COMMAND]}))
+        reply = json.loads(ws.receive())
+        if reply.get("id") != i:
+            raise RuntimeError(f"unexpected reply {reply}")
+
+    report("POST", measure(args.count, post))
+    report("WebSocket", measure(args.count, websocket))
+
+
+if __name__ == "__main__":
+    main()